@@ -4,28 +4,49 @@
 #include <ctype.h>
 #include <time.h>
 #include <stdarg.h>
+#include <stdint.h>
+#include <math.h>
+#include <errno.h>
+#include <stdatomic.h>
+#include <zlib.h>
 
 #ifdef _WIN32
     #include <windows.h>
     #include <direct.h>
     #include <io.h>
+    #include <process.h>
+    #include <limits.h>
+    #include <fcntl.h>
     #define access _access
     #define F_OK 0
     #define R_OK 4
     #define popen _popen
     #define pclose _pclose
+    #define chdir _chdir
+    #define getcwd _getcwd
+    #define strcasecmp _stricmp
+    #define strncasecmp _strnicmp
+    #define getpid _getpid
+    #define NULL_DEVICE "NUL"
 #else
     #include <dirent.h>
+    #include <strings.h>
     #include <sys/stat.h>
     #include <unistd.h>
     #include <sys/wait.h>
+    #include <sys/resource.h>
+    #include <sys/mman.h>
+    #include <fcntl.h>
+    #include <signal.h>
+    #include <pthread.h>
+    #include <limits.h>
+    #define NULL_DEVICE "/dev/null"
 #endif
 
 #define MAX_LINE_LENGTH 1024
 #define MAX_PATH_LENGTH 512
 #define MAX_COMMITS 1000
 #define MAX_FILES 500
-#define MAX_BRANCHES 100
 
 typedef struct {
     char hash[41];
@@ -40,8 +61,10 @@ typedef struct {
 typedef struct {
     char name[256];
     char last_commit[41];
+    long long epoch;
     int is_merged;
     int commits_ahead;
+    int commits_behind;
 } branch_info_t;
 
 typedef struct {
@@ -52,7 +75,7 @@ typedef struct {
 } file_info_t;
 
 commit_info_t commits[MAX_COMMITS];
-branch_info_t branches[MAX_BRANCHES];
+branch_info_t *branches = NULL;
 file_info_t files[MAX_FILES];
 int commit_count = 0;
 int branch_count = 0;
@@ -68,10 +91,10 @@ int run_git_command(const char *format, ...) {
     va_end(args);
 
     #ifdef _WIN32
-    char full_command[MAX_LINE_LENGTH + 10];
+    char full_command[MAX_LINE_LENGTH + 32];
     snprintf(full_command, sizeof(full_command), "%s > NUL 2>&1", command);
     #else
-    char full_command[MAX_LINE_LENGTH + 15];
+    char full_command[MAX_LINE_LENGTH + 32];
     snprintf(full_command, sizeof(full_command), "%s > /dev/null 2>&1", command);
     #endif
 
@@ -118,1011 +141,11273 @@ char* run_git_command_output(const char *format, ...) {
     return output;
 }
 
-int is_git_repository() 
+// ==================== STREAMING HELPERS ====================
+
+FILE* open_git_stream(const char *format, ...) 
+{
+    char command[MAX_LINE_LENGTH * 2];
+    va_list args;
+    va_start(args, format);
+    vsnprintf(command, sizeof(command), format, args);
+    va_end(args);
+
+    return popen(command, "r");
+}
+
+// Quotes one argument for the shell that popen runs, so names that come from the repository
+// are passed through literally: '...' with ' written as '\'' on POSIX, "..." for cmd.exe
+// (which does not expand $(...)). Returns NULL if the quoted form does not fit.
+const char* shell_quote(const char *arg, char *out, size_t size) 
 {
+    size_t n = 0;
     #ifdef _WIN32
-    return run_git_command("git rev-parse --git-dir") == 0;
+    const char quote = '"';
     #else
-    return run_git_command("git rev-parse --git-dir") == 0;
+    const char quote = '\'';
     #endif
+    if (size < 3) return NULL;
+    out[n++] = quote;
+    for (const char *p = arg; *p; p++) {
+        #ifndef _WIN32
+        if (*p == '\'') {
+            if (n + 4 >= size) return NULL;
+            memcpy(out + n, "'\\''", 4);
+            n += 4;
+            continue;
+        }
+        #endif
+        if (n + 1 >= size) return NULL;
+        out[n++] = *p;
+    }
+    if (n + 2 > size) return NULL;
+    out[n++] = quote;
+    out[n] = '\0';
+    return out;
 }
 
-// ==================== COMMIT ANALYSIS ====================
+// Reads one line of any length into a growable buffer; returns -1 at end of stream
+long read_stream_line(FILE *fp, char **line, size_t *capacity) 
+{
+    if (!*line) {
+        *capacity = MAX_LINE_LENGTH;
+        *line = malloc(*capacity);
+    }
+
+    size_t len = 0;
+    (*line)[0] = '\0';
+    while (fgets(*line + len, (int)(*capacity - len), fp)) {
+        len += strlen(*line + len);
+        if (len > 0 && (*line)[len-1] == '\n') {
+            (*line)[--len] = '\0';
+            if (len > 0 && (*line)[len-1] == '\r') (*line)[--len] = '\0';
+            return (long)len;
+        }
+        if (len + 1 >= *capacity) {
+            *capacity *= 2;
+            *line = realloc(*line, *capacity);
+        }
+    }
+    return len > 0 ? (long)len : -1;
+}
+
+// A git process kept alive for request/response batches (e.g. cat-file --batch-check).
+// Callers send a group of requests, then read exactly one response line per request.
+typedef struct {
+    FILE *to_git;
+    FILE *from_git;
+#ifdef _WIN32
+    char command[MAX_LINE_LENGTH];
+    char request_path[MAX_PATH_LENGTH];
+#else
+    pid_t pid;
+#endif
+} git_coprocess_t;
+
+const char* get_cache_dir();
+int get_temp_path(char *out, size_t size, const char *name);
+
+int coprocess_open(git_coprocess_t *cp, const char *command) 
+{
+    memset(cp, 0, sizeof(*cp));
+
+#ifdef _WIN32
+    // No portable bidirectional popen: spool each request group to a file instead
+    if (get_temp_path(cp->request_path, sizeof(cp->request_path), "batch") != 0) return -1;
+    snprintf(cp->command, sizeof(cp->command), "%s", command);
+    cp->to_git = fopen(cp->request_path, "w");
+    return cp->to_git ? 0 : -1;
+#else
+    int to_child[2], from_child[2];
+    if (pipe(to_child) != 0) return -1;
+    if (pipe(from_child) != 0) {
+        close(to_child[0]);
+        close(to_child[1]);
+        return -1;
+    }
+
+    signal(SIGPIPE, SIG_IGN);
+    pid_t pid = fork();
+    if (pid < 0) {
+        close(to_child[0]); close(to_child[1]);
+        close(from_child[0]); close(from_child[1]);
+        return -1;
+    }
+    if (pid == 0) {
+        dup2(to_child[0], STDIN_FILENO);
+        dup2(from_child[1], STDOUT_FILENO);
+        close(to_child[0]); close(to_child[1]);
+        close(from_child[0]); close(from_child[1]);
+        execl("/bin/sh", "sh", "-c", command, (char *)NULL);
+        _exit(127);
+    }
+
+    close(to_child[0]);
+    close(from_child[1]);
+    cp->pid = pid;
+    cp->to_git = fdopen(to_child[1], "w");
+    cp->from_git = fdopen(from_child[0], "r");
+    return (cp->to_git && cp->from_git) ? 0 : -1;
+#endif
+}
+
+void coprocess_send(git_coprocess_t *cp, const char *request) 
+{
+#ifdef _WIN32
+    if (cp->from_git) {
+        pclose(cp->from_git);
+        cp->from_git = NULL;
+        cp->to_git = fopen(cp->request_path, "w");
+    }
+#endif
+    fputs(request, cp->to_git);
+    fputc('\n', cp->to_git);
+}
+
+long coprocess_receive(git_coprocess_t *cp, char **line, size_t *capacity) 
+{
+#ifdef _WIN32
+    if (!cp->from_git) {
+        char command[MAX_LINE_LENGTH + MAX_PATH_LENGTH];
+        fclose(cp->to_git);
+        cp->to_git = NULL;
+        snprintf(command, sizeof(command), "%s < \"%s\"", cp->command, cp->request_path);
+        cp->from_git = popen(command, "r");
+        if (!cp->from_git) return -1;
+    }
+#else
+    fflush(cp->to_git);
+#endif
+    return read_stream_line(cp->from_git, line, capacity);
+}
+
+// Raw payload that follows a response line (cat-file --batch object contents)
+size_t coprocess_read(git_coprocess_t *cp, void *buffer, size_t size) 
+{
+    return fread(buffer, 1, size, cp->from_git);
+}
+
+void coprocess_close(git_coprocess_t *cp) 
+{
+#ifdef _WIN32
+    if (cp->to_git) fclose(cp->to_git);
+    if (cp->from_git) pclose(cp->from_git);
+    remove(cp->request_path);
+#else
+    if (cp->to_git) fclose(cp->to_git);
+    if (cp->from_git) fclose(cp->from_git);
+    if (cp->pid > 0) waitpid(cp->pid, NULL, 0);
+#endif
+    memset(cp, 0, sizeof(*cp));
+}
+
+// ==================== REPOSITORY DISCOVERY ====================
+
+// Found without spawning git: the .git directory (per worktree), the shared common
+// directory, the top of the working tree, and the current directory relative to it
+typedef struct {
+    char git_dir[MAX_PATH_LENGTH];
+    char common_dir[MAX_PATH_LENGTH];
+    char worktree[MAX_PATH_LENGTH];
+    char prefix[MAX_PATH_LENGTH];
+    int found;
+    int reftable;
+} repository_t;
+
+static repository_t repo;
 
-void load_commit_history() 
+int hex_to_oid(const char *hex, unsigned char *oid);
+double monotonic_seconds();
+
+static int absolute_path(const char *path, char *out, size_t size) 
 {
-    // Use Windows-compatible git log format
     #ifdef _WIN32
-    char *output = run_git_command_output("git log --oneline -1000");
+    if (!_fullpath(out, path, size)) return -1;
+    for (char *p = out; *p; p++) {
+        if (*p == '\\') *p = '/';
+    }
+    return 0;
     #else
-    char *output = run_git_command_output("git log --oneline --format=\"%%H %%an %%ad %%s\" --date=short -1000");
+    char resolved[PATH_MAX];
+    if (!realpath(path, resolved) || strlen(resolved) >= size) return -1;
+    strcpy(out, resolved);
+    return 0;
     #endif
-    
-    if (!output) {
-        return;
+}
+
+static int is_absolute_path(const char *path) 
+{
+    #ifdef _WIN32
+    if (isalpha((unsigned char)path[0]) && path[1] == ':') return 1;
+    if (path[0] == '\\') return 1;
+    #endif
+    return path[0] == '/';
+}
+
+// First line of a small file, without the line ending
+static int read_first_line(const char *path, char *out, size_t size) 
+{
+    FILE *fp = fopen(path, "r");
+    if (!fp) return -1;
+    int ok = fgets(out, (int)size, fp) != NULL;
+    fclose(fp);
+    if (!ok) return -1;
+    out[strcspn(out, "\r\n")] = '\0';
+    return 0;
+}
+
+int is_directory(const char *path) 
+{
+    #ifdef _WIN32
+    DWORD attributes = GetFileAttributesA(path);
+    return attributes != INVALID_FILE_ATTRIBUTES && (attributes & FILE_ATTRIBUTE_DIRECTORY);
+    #else
+    struct stat st;
+    return stat(path, &st) == 0 && S_ISDIR(st.st_mode);
+    #endif
+}
+
+static int file_exists(const char *path) 
+{
+    return access(path, F_OK) == 0;
+}
+
+// Same test as git: a HEAD file plus an object store, local or via commondir
+static int is_git_directory(const char *dir) 
+{
+    char path[MAX_PATH_LENGTH + 16];
+    snprintf(path, sizeof(path), "%s/HEAD", dir);
+    if (!file_exists(path)) return 0;
+    snprintf(path, sizeof(path), "%s/commondir", dir);
+    if (file_exists(path)) return 1;
+    snprintf(path, sizeof(path), "%s/objects", dir);
+    return file_exists(path);
+}
+
+// Resolves a path read from a gitdir/commondir file against the directory it was found in
+static int resolve_relative(const char *base, const char *path, char *out, size_t size) 
+{
+    char joined[MAX_PATH_LENGTH * 2];
+    if (is_absolute_path(path)) snprintf(joined, sizeof(joined), "%s", path);
+    else snprintf(joined, sizeof(joined), "%s/%s", base, path);
+    return absolute_path(joined, out, size);
+}
+
+static int set_git_dir(const char *git_dir, const char *worktree) 
+{
+    if (absolute_path(git_dir, repo.git_dir, sizeof(repo.git_dir)) != 0) return -1;
+
+    char common[MAX_PATH_LENGTH], path[MAX_PATH_LENGTH + 16];
+    snprintf(path, sizeof(path), "%s/commondir", repo.git_dir);
+    if (read_first_line(path, common, sizeof(common)) == 0) {
+        if (resolve_relative(repo.git_dir, common, repo.common_dir, sizeof(repo.common_dir)) != 0) return -1;
+    } else {
+        strcpy(repo.common_dir, repo.git_dir);
     }
 
-    char *line = strtok(output, "\n");
-    while (line && commit_count < MAX_COMMITS) {
-        commit_info_t *commit = &commits[commit_count];
-        
-        #ifdef _WIN32
-        // Windows: just get hash and message
-        char *hash = strtok(line, " ");
-        char *message = strtok(NULL, "\n");
-        
-        if (hash && message) {
-            strncpy(commit->hash, hash, 40);
-            commit->hash[40] = '\0';
-            
-            // Get author and date separately
-            char *details = run_git_command_output("git show -s --format=%%an|%%ad --date=short %s", hash);
-            if (details) {
-                char *author = strtok(details, "|");
-                char *date = strtok(NULL, "|");
-                if (author) strncpy(commit->author, author, 255);
-                if (date) strncpy(commit->date, date, 63);
+    snprintf(path, sizeof(path), "%s/reftable", repo.common_dir);
+    repo.reftable = file_exists(path);
+
+    repo.worktree[0] = '\0';
+    repo.prefix[0] = '\0';
+    if (worktree && absolute_path(worktree, repo.worktree, sizeof(repo.worktree)) == 0) {
+        char cwd[MAX_PATH_LENGTH];
+        size_t length = strlen(repo.worktree);
+        if (getcwd(cwd, sizeof(cwd)) && absolute_path(cwd, cwd, sizeof(cwd)) == 0 &&
+            strncmp(cwd, repo.worktree, length) == 0 && cwd[length] == '/') {
+            snprintf(repo.prefix, sizeof(repo.prefix), "%s/", cwd + length + 1);
+        }
+    }
+    repo.found = 1;
+    return 0;
+}
+
+// Mirrors git's setup: $GIT_DIR if set, otherwise walk up from the current directory
+// looking for a .git directory, a "gitdir:" file (worktrees, submodules), or a bare repository
+int discover_repository() 
+{
+    if (repo.found) return 0;
+
+    const char *env_dir = getenv("GIT_DIR");
+    if (env_dir && env_dir[0]) {
+        const char *env_worktree = getenv("GIT_WORK_TREE");
+        char cwd[MAX_PATH_LENGTH];
+        if (!is_git_directory(env_dir)) return -1;
+        return set_git_dir(env_dir, env_worktree && env_worktree[0] ? env_worktree :
+                                    (getcwd(cwd, sizeof(cwd)) ? cwd : NULL));
+    }
+
+    char dir[MAX_PATH_LENGTH];
+    if (!getcwd(dir, sizeof(dir)) || absolute_path(dir, dir, sizeof(dir)) != 0) return -1;
+    for (;;) {
+        char dot_git[MAX_PATH_LENGTH + 8], line[MAX_PATH_LENGTH];
+        snprintf(dot_git, sizeof(dot_git), "%s/.git", dir);
+        if (is_directory(dot_git)) {
+            if (is_git_directory(dot_git)) return set_git_dir(dot_git, dir);
+        } else if (read_first_line(dot_git, line, sizeof(line)) == 0 && strncmp(line, "gitdir: ", 8) == 0) {
+            char target[MAX_PATH_LENGTH];
+            if (resolve_relative(dir, line + 8, target, sizeof(target)) == 0 && is_git_directory(target)) {
+                return set_git_dir(target, dir);
             }
-            
-            strncpy(commit->message, message, 511);
-            commit->message[511] = '\0';
-            
-            // Get stats
-            char *stats = run_git_command_output("git show --stat %s", hash);
-            if (stats) {
-                commit->files_changed = 0;
-                commit->insertions = 0;
-                commit->deletions = 0;
-                
-                char *stat_line = strtok(stats, "\n");
-                while (stat_line) {
-                    if (strstr(stat_line, "file") != NULL && strstr(stat_line, "changed")) {
-                        // Simple parsing for Windows
-                        char *p = stat_line;
-                        while (*p) {
-                            if (isdigit(*p)) {
-                                commit->files_changed = atoi(p);
-                                break;
-                            }
-                            p++;
-                        }
-                        break;
-                    }
-                    stat_line = strtok(NULL, "\n");
-                }
+            return -1;
+        }
+        if (is_git_directory(dir)) return set_git_dir(dir, NULL);
+
+        char *slash = strrchr(dir, '/');
+        if (!slash) return -1;
+        if (slash == dir || (slash == dir + 2 && dir[1] == ':')) {
+            if (slash[1] == '\0') return -1;
+            slash[1] = '\0';   // one more round at the filesystem root
+        } else {
+            *slash = '\0';
+        }
+    }
+}
+
+// Per-worktree refs live in the worktree's own git dir, everything else in the common dir
+static int is_per_worktree_ref(const char *name) 
+{
+    return strchr(name, '/') == NULL || strncmp(name, "refs/bisect/", 12) == 0 ||
+           strncmp(name, "refs/worktree/", 14) == 0 || strncmp(name, "refs/rewritten/", 15) == 0;
+}
+
+// Resolves a full ref name (HEAD, refs/heads/x, ...) through symrefs, loose files and
+// packed-refs. Returns 1 and the symref target in `symref` when `name` is symbolic.
+int resolve_ref(const char *name, char *oid_hex, char *symref, size_t symref_size) 
+{
+    char current[MAX_PATH_LENGTH];
+    snprintf(current, sizeof(current), "%s", name);
+    if (symref) symref[0] = '\0';
+    if (discover_repository() != 0 || repo.reftable) return -1;
+
+    for (int depth = 0; depth < 5; depth++) {
+        char path[MAX_PATH_LENGTH * 2], line[MAX_PATH_LENGTH];
+        snprintf(path, sizeof(path), "%s/%s", is_per_worktree_ref(current) ? repo.git_dir : repo.common_dir, current);
+        if (!is_directory(path) && read_first_line(path, line, sizeof(line)) == 0) {
+            if (strncmp(line, "ref: ", 5) == 0) {
+                if (depth == 0 && symref) snprintf(symref, symref_size, "%s", line + 5);
+                snprintf(current, sizeof(current), "%s", line + 5);
+                continue;
             }
-            
-            commit_count++;
+            unsigned char oid[20];
+            if (strlen(line) < 40 || hex_to_oid(line, oid) != 0) return -1;
+            memcpy(oid_hex, line, 40);
+            oid_hex[40] = '\0';
+            return 0;
         }
-        #else
-        // Unix version (original)
-        char *hash = strtok(line, " ");
-        char *author = strtok(NULL, " ");
-        char *date = strtok(NULL, " ");
-        char *message = strtok(NULL, "\n");
-        
-        if (hash && author && date && message) {
-            strncpy(commit->hash, hash, 40);
-            commit->hash[40] = '\0';
-            
-            strncpy(commit->author, author, 255);
-            commit->author[255] = '\0';
-            
-            strncpy(commit->date, date, 63);
-            commit->date[63] = '\0';
-            
-            strncpy(commit->message, message, 511);
-            commit->message[511] = '\0';
-            
-            char stats_cmd[512];
-            snprintf(stats_cmd, sizeof(stats_cmd), "git show --stat %s", hash);
-            char *stats_output = run_git_command_output(stats_cmd);
-            
-            if (stats_output) {
-                commit->files_changed = 0;
-                commit->insertions = 0;
-                commit->deletions = 0;
-                
-                char *stat_line = strtok(stats_output, "\n");
-                while (stat_line) {
-                    if (strstr(stat_line, "file") != NULL) {
-                        char *files_ptr = strstr(stat_line, "file");
-                        if (files_ptr) {
-                            char *num_start = files_ptr;
-                            while (num_start > stat_line && isdigit(*(num_start-1))) {
-                                num_start--;
-                            }
-                            commit->files_changed = atoi(num_start);
-                        }
-                        break;
-                    }
-                    stat_line = strtok(NULL, "\n");
-                }
+
+        snprintf(path, sizeof(path), "%s/packed-refs", repo.common_dir);
+        FILE *fp = fopen(path, "r");
+        if (!fp) return -1;
+        char *entry = NULL;
+        size_t capacity = 0;
+        int found = -1;
+        size_t name_length = strlen(current);
+        while (read_stream_line(fp, &entry, &capacity) >= 0) {
+            if (strlen(entry) == 41 + name_length && entry[40] == ' ' && strcmp(entry + 41, current) == 0) {
+                memcpy(oid_hex, entry, 40);
+                oid_hex[40] = '\0';
+                found = 0;
+                break;
             }
-            
-            commit_count++;
         }
-        #endif
-        line = strtok(NULL, "\n");
+        free(entry);
+        fclose(fp);
+        return found;
     }
+    return -1;
 }
 
-void show_commit_summary() {
-    printf("📊 Repository Analysis\n");
-    printf("=====================\n");
-    printf("Total commits: %d\n", commit_count);
-    
-    if (commit_count == 0) {
-        printf("No commit history found.\n\n");
+// Name of the checked-out branch, or "" when HEAD is detached
+int current_branch_name(char *out, size_t size) 
+{
+    char oid[41], target[MAX_PATH_LENGTH];
+    out[0] = '\0';
+    if (discover_repository() != 0) return -1;
+    if (repo.reftable) {
+        char *branch = run_git_command_output("git branch --show-current");
+        if (!branch) return -1;
+        snprintf(out, size, "%s", branch);
+        return 0;
+    }
+    resolve_ref("HEAD", oid, target, sizeof(target));
+    if (strncmp(target, "refs/heads/", 11) == 0) snprintf(out, size, "%s", target + 11);
+    return 0;
+}
+
+int is_git_repository() 
+{
+    if (discover_repository() == 0) return 1;
+    // Layouts we do not understand natively still get git's verdict
+    return run_git_command("git rev-parse --git-dir") == 0;
+}
+
+// ==================== WORKER POOL ====================
+
+#ifdef _WIN32
+typedef HANDLE thread_t;
+typedef CRITICAL_SECTION mutex_t;
+#define mutex_init(m) InitializeCriticalSection(m)
+#define mutex_lock(m) EnterCriticalSection(m)
+#define mutex_unlock(m) LeaveCriticalSection(m)
+#define mutex_destroy(m) DeleteCriticalSection(m)
+typedef CONDITION_VARIABLE cond_t;
+#define cond_init(c) InitializeConditionVariable(c)
+#define cond_wait(c, m) SleepConditionVariableCS(c, m, INFINITE)
+#define cond_broadcast(c) WakeAllConditionVariable(c)
+#define cond_destroy(c) ((void)(c))
+#else
+typedef pthread_t thread_t;
+typedef pthread_mutex_t mutex_t;
+#define mutex_init(m) pthread_mutex_init(m, NULL)
+#define mutex_lock(m) pthread_mutex_lock(m)
+#define mutex_unlock(m) pthread_mutex_unlock(m)
+#define mutex_destroy(m) pthread_mutex_destroy(m)
+typedef pthread_cond_t cond_t;
+#define cond_init(c) pthread_cond_init(c, NULL)
+#define cond_wait(c, m) pthread_cond_wait(c, m)
+#define cond_broadcast(c) pthread_cond_broadcast(c)
+#define cond_destroy(c) pthread_cond_destroy(c)
+#endif
+
+#define MAX_WORKERS 64
+
+typedef void (*parallel_task_fn)(void *context, int index);
+
+typedef struct {
+    parallel_task_fn task;
+    void *context;
+    int count;
+    int next;
+    mutex_t lock;
+} parallel_queue_t;
+
+#ifdef _WIN32
+static DWORD WINAPI parallel_worker(LPVOID arg) 
+#else
+static void* parallel_worker(void *arg) 
+#endif
+{
+    parallel_queue_t *queue = arg;
+    for (;;) {
+        mutex_lock(&queue->lock);
+        int index = queue->next < queue->count ? queue->next++ : -1;
+        mutex_unlock(&queue->lock);
+        if (index < 0) break;
+        queue->task(queue->context, index);
+    }
+    return 0;
+}
+
+int default_job_count() 
+{
+    #ifdef _WIN32
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    int cpus = (int)info.dwNumberOfProcessors;
+    #else
+    int cpus = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    #endif
+    return cpus < 1 ? 1 : cpus > 16 ? 16 : cpus;
+}
+
+// Runs task(context, i) for i in [0, count) on at most `workers` threads; tasks are
+// handed out in index order, so callers put the most expensive ones first
+void parallel_for(int count, int workers, parallel_task_fn task, void *context) 
+{
+    parallel_queue_t queue;
+    queue.task = task;
+    queue.context = context;
+    queue.count = count;
+    queue.next = 0;
+    if (workers > MAX_WORKERS) workers = MAX_WORKERS;
+    if (workers > count) workers = count;
+    if (workers <= 1) {
+        for (int i = 0; i < count; i++) task(context, i);
         return;
     }
-    
-    int total_insertions = 0, total_deletions = 0;
-    for (int i = 0; i < commit_count; i++) {
-        total_insertions += commits[i].insertions;
-        total_deletions += commits[i].deletions;
+
+    thread_t threads[MAX_WORKERS];
+    int started = 0;
+    mutex_init(&queue.lock);
+    for (int i = 0; i < workers; i++) {
+        #ifdef _WIN32
+        threads[started] = CreateThread(NULL, 0, parallel_worker, &queue, 0, NULL);
+        if (threads[started]) started++;
+        #else
+        if (pthread_create(&threads[started], NULL, parallel_worker, &queue) == 0) started++;
+        #endif
     }
-    printf("Total changes: +%d -%d lines\n", total_insertions, total_deletions);
-    
-    char authors[50][256];
-    int author_counts[50] = {0};
-    int author_count = 0;
-    
-    for (int i = 0; i < commit_count; i++) {
-        int found = 0;
-        for (int j = 0; j < author_count; j++) {
-            if (strcmp(authors[j], commits[i].author) == 0) {
-                author_counts[j]++;
-                found = 1;
-                break;
+    if (started == 0) parallel_worker(&queue);
+    for (int i = 0; i < started; i++) {
+        #ifdef _WIN32
+        WaitForSingleObject(threads[i], INFINITE);
+        CloseHandle(threads[i]);
+        #else
+        pthread_join(threads[i], NULL);
+        #endif
+    }
+    mutex_destroy(&queue.lock);
+}
+
+// ==================== STREAM PIPELINE ====================
+
+#define PIPE_CHUNK_SIZE (64 << 10)
+#define PIPE_CHUNKS 16          // at most 1 MiB of output in flight, however long the stream
+
+// A reader thread copies a stream into a ring of fixed chunks while the caller parses lines
+// straight out of them, so parsing overlaps with the git process producing the output.
+// Each side only advances its own counter; a side takes the lock only to sleep when the
+// ring is full or empty, and the other only wakes it when it said it was sleeping.
+typedef struct {
+    FILE *fp;
+    char *chunks;
+    size_t lengths[PIPE_CHUNKS];
+    atomic_long filled;         // chunks published by the reader
+    atomic_long released;       // chunks handed back by the parser
+    atomic_int finished;        // the stream ended
+    atomic_int stopping;        // the parser gave up early
+    atomic_int sleepers;
+    mutex_t lock;
+    cond_t changed;
+    thread_t reader;
+    int threaded;               // 0 when no thread could start: the parser reads for itself
+    unsigned long long bytes;
+    // Parser side
+    long current;               // chunk being parsed, or -1
+    size_t offset;
+    char *carry;                // a line that straddles chunks
+    size_t carry_size, carry_capacity;
+} stream_pipe_t;
+
+// Sleeps while *counter still equals `value`, unless the stream ended or is being stopped
+static void stream_pipe_wait(stream_pipe_t *sp, atomic_long *counter, long value) 
+{
+    mutex_lock(&sp->lock);
+    atomic_fetch_add(&sp->sleepers, 1);
+    while (atomic_load(counter) == value && !atomic_load(&sp->finished) && !atomic_load(&sp->stopping)) {
+        cond_wait(&sp->changed, &sp->lock);
+    }
+    atomic_fetch_sub(&sp->sleepers, 1);
+    mutex_unlock(&sp->lock);
+}
+
+static void stream_pipe_wake(stream_pipe_t *sp) 
+{
+    if (!atomic_load(&sp->sleepers)) return;
+    mutex_lock(&sp->lock);
+    cond_broadcast(&sp->changed);
+    mutex_unlock(&sp->lock);
+}
+
+// Fills the next free chunk with whatever the stream has; returns 0 at end of stream
+static int stream_pipe_produce(stream_pipe_t *sp) 
+{
+    long slot = atomic_load(&sp->filled);
+    if (slot - atomic_load(&sp->released) == PIPE_CHUNKS) stream_pipe_wait(sp, &sp->released, slot - PIPE_CHUNKS);
+    if (atomic_load(&sp->stopping)) return 0;
+
+    char *chunk = sp->chunks + (size_t)(slot % PIPE_CHUNKS) * PIPE_CHUNK_SIZE;
+    #ifdef _WIN32
+    int got = _read(_fileno(sp->fp), chunk, PIPE_CHUNK_SIZE);
+    #else
+    ssize_t got;
+    while ((got = read(fileno(sp->fp), chunk, PIPE_CHUNK_SIZE)) < 0 && errno == EINTR);
+    #endif
+    if (got <= 0) return 0;
+    sp->lengths[slot % PIPE_CHUNKS] = (size_t)got;
+    sp->bytes += (size_t)got;
+    atomic_store(&sp->filled, slot + 1);
+    stream_pipe_wake(sp);
+    return 1;
+}
+
+#ifdef _WIN32
+static DWORD WINAPI stream_pipe_reader(LPVOID arg) 
+#else
+static void* stream_pipe_reader(void *arg) 
+#endif
+{
+    stream_pipe_t *sp = arg;
+    while (stream_pipe_produce(sp));
+    atomic_store(&sp->finished, 1);
+    mutex_lock(&sp->lock);
+    cond_broadcast(&sp->changed);
+    mutex_unlock(&sp->lock);
+    return 0;
+}
+
+// Starts reading `fp` in the background; the caller still owns (and pcloses) the stream
+void stream_pipe_open(stream_pipe_t *sp, FILE *fp) 
+{
+    memset(sp, 0, sizeof(*sp));
+    sp->fp = fp;
+    sp->chunks = malloc((size_t)PIPE_CHUNKS * PIPE_CHUNK_SIZE);
+    sp->current = -1;
+    atomic_init(&sp->filled, 0);
+    atomic_init(&sp->released, 0);
+    atomic_init(&sp->finished, 0);
+    atomic_init(&sp->stopping, 0);
+    atomic_init(&sp->sleepers, 0);
+    mutex_init(&sp->lock);
+    cond_init(&sp->changed);
+    #ifdef _WIN32
+    sp->reader = CreateThread(NULL, 0, stream_pipe_reader, sp, 0, NULL);
+    sp->threaded = sp->reader != NULL;
+    #else
+    sp->threaded = pthread_create(&sp->reader, NULL, stream_pipe_reader, sp) == 0;
+    #endif
+}
+
+static char* stream_pipe_carry(stream_pipe_t *sp, const char *text, size_t length) 
+{
+    if (sp->carry_size + length + 1 > sp->carry_capacity) {
+        sp->carry_capacity = (sp->carry_size + length + 1) * 2;
+        sp->carry = realloc(sp->carry, sp->carry_capacity);
+    }
+    memcpy(sp->carry + sp->carry_size, text, length);
+    sp->carry_size += length;
+    sp->carry[sp->carry_size] = '\0';
+    return sp->carry;
+}
+
+static char* stream_pipe_result(char *line, size_t length, long *length_out) 
+{
+    if (length > 0 && line[length - 1] == '\r') line[--length] = '\0';
+    if (length_out) *length_out = (long)length;
+    return line;
+}
+
+// The next line without its newline, NUL-terminated and valid until the next call, or NULL
+// at end of stream. Lines inside one chunk are returned in place; only a line that
+// straddles two chunks is copied.
+char* stream_pipe_line(stream_pipe_t *sp, long *length) 
+{
+    sp->carry_size = 0;
+    for (;;) {
+        if (sp->current < 0) {
+            long slot = atomic_load(&sp->released);
+            if (atomic_load(&sp->filled) == slot) {
+                if (!sp->threaded) {
+                    if (!stream_pipe_produce(sp)) atomic_store(&sp->finished, 1);
+                } else {
+                    stream_pipe_wait(sp, &sp->filled, slot);
+                }
             }
+            if (atomic_load(&sp->filled) == slot) break;
+            sp->current = slot % PIPE_CHUNKS;
+            sp->offset = 0;
         }
-        if (!found && author_count < 50) {
-            strcpy(authors[author_count], commits[i].author);
-            author_counts[author_count] = 1;
-            author_count++;
+
+        char *start = sp->chunks + (size_t)sp->current * PIPE_CHUNK_SIZE + sp->offset;
+        size_t available = sp->lengths[sp->current] - sp->offset;
+        char *newline = memchr(start, '\n', available);
+        if (newline) {
+            size_t length_in_chunk = (size_t)(newline - start);
+            sp->offset += length_in_chunk + 1;
+            if (sp->carry_size == 0) {
+                *newline = '\0';
+                return stream_pipe_result(start, length_in_chunk, length);
+            }
+            stream_pipe_carry(sp, start, length_in_chunk);
+            return stream_pipe_result(sp->carry, sp->carry_size, length);
         }
+
+        // The chunk is used up: keep its tail and hand it back to the reader
+        stream_pipe_carry(sp, start, available);
+        sp->current = -1;
+        atomic_fetch_add(&sp->released, 1);
+        stream_pipe_wake(sp);
     }
-    
-    if (author_count > 0) {
-        int max_commits = 0;
-        char top_author[256] = "";
-        for (int i = 0; i < author_count; i++) {
-            if (author_counts[i] > max_commits) {
-                max_commits = author_counts[i];
-                strcpy(top_author, authors[i]);
-            }
+    return sp->carry_size ? stream_pipe_result(sp->carry, sp->carry_size, length) : NULL;
+}
+
+// Stops the reader (it may still be waiting for one more read from the stream) and frees
+// the ring; pclose the stream afterwards
+void stream_pipe_close(stream_pipe_t *sp) 
+{
+    atomic_store(&sp->stopping, 1);
+    mutex_lock(&sp->lock);
+    cond_broadcast(&sp->changed);
+    mutex_unlock(&sp->lock);
+    if (sp->threaded) {
+        #ifdef _WIN32
+        WaitForSingleObject(sp->reader, INFINITE);
+        CloseHandle(sp->reader);
+        #else
+        pthread_join(sp->reader, NULL);
+        #endif
+    }
+    cond_destroy(&sp->changed);
+    mutex_destroy(&sp->lock);
+    free(sp->chunks);
+    free(sp->carry);
+    sp->chunks = sp->carry = NULL;
+}
+
+// ==================== PROGRESS ====================
+
+#define PROGRESS_DELAY 0.25     // seconds before the first line, so quick commands stay silent
+#define PROGRESS_INTERVAL 0.1
+#define LIVE_INTERVAL 0.2       // refresh period of provisional tables
+
+// Progress lines go to stderr, and only when it is a terminal, so piped reports stay clean
+typedef struct {
+    const char *label;
+    const char *unit;
+    long long total;            // an estimate; 0 when unknown
+    double started, last_draw;
+    int drawn;
+} progress_t;
+
+static int stream_is_terminal(FILE *stream) 
+{
+    #ifdef _WIN32
+    return _isatty(_fileno(stream));
+    #else
+    return isatty(fileno(stream));
+    #endif
+}
+
+void progress_begin(progress_t *p, const char *label, const char *unit, long long total) 
+{
+    memset(p, 0, sizeof(*p));
+    if (!stream_is_terminal(stderr)) return;
+    p->label = label;
+    p->unit = unit;
+    p->total = total;
+    p->started = monotonic_seconds();
+}
+
+void progress_update(progress_t *p, long long done) 
+{
+    if (!p->label) return;
+    double now = monotonic_seconds();
+    if (now - p->started < PROGRESS_DELAY || now - p->last_draw < PROGRESS_INTERVAL) return;
+    p->last_draw = now;
+    p->drawn = 1;
+    if (p->total > done) {
+        fprintf(stderr, "\r⏳ %s: %lld / ~%lld %s (%d%%)   ", p->label, done, p->total, p->unit,
+                (int)(100 * done / p->total));
+    } else {
+        fprintf(stderr, "\r⏳ %s: %lld %s   ", p->label, done, p->unit);
+    }
+    fflush(stderr);
+}
+
+void progress_end(progress_t *p) 
+{
+    if (p->drawn) {
+        fprintf(stderr, "\r\033[K");
+        fflush(stderr);
+    }
+    p->label = NULL;
+    p->drawn = 0;
+}
+
+// A block of report lines redrawn in place while its data is still provisional. Frames are
+// only drawn when stdout is a terminal that understands cursor movement.
+typedef struct {
+    int enabled;
+    int lines;                  // height of the frame on screen, erased before the next one
+    double last_draw;
+} live_block_t;
+
+void live_block_begin(live_block_t *b) 
+{
+    memset(b, 0, sizeof(*b));
+    #ifndef _WIN32
+    b->enabled = stream_is_terminal(stdout) && getenv("TERM") && strcmp(getenv("TERM"), "dumb") != 0;
+    #endif
+    b->last_draw = monotonic_seconds();
+}
+
+// Returns 1 when a new frame is due; the caller prints it with live_printf and then calls
+// live_block_flush. Line wrapping is off meanwhile so every line takes one row.
+int live_block_due(live_block_t *b) 
+{
+    if (!b->enabled) return 0;
+    double now = monotonic_seconds();
+    if (now - b->last_draw < LIVE_INTERVAL) return 0;
+    b->last_draw = now;
+    if (b->lines > 0) printf("\033[%dA\033[J", b->lines);
+    printf("\033[?7l");
+    b->lines = 0;
+    return 1;
+}
+
+void live_block_flush(live_block_t *b) 
+{
+    (void)b;
+    printf("\033[?7h");
+    fflush(stdout);
+}
+
+void live_printf(live_block_t *b, const char *format, ...) 
+{
+    va_list args;
+    va_start(args, format);
+    vprintf(format, args);
+    va_end(args);
+    for (const char *p = format; *p; p++) {
+        if (*p == '\n') b->lines++;
+    }
+}
+
+void live_block_end(live_block_t *b) 
+{
+    if (b->lines > 0) printf("\033[%dA\033[J", b->lines);
+    b->lines = 0;
+    fflush(stdout);
+}
+
+// ==================== CACHE STORAGE ====================
+
+static char git_common_dir[MAX_PATH_LENGTH] = "";
+static char cache_dir[MAX_PATH_LENGTH] = "";
+
+int make_directory(const char *path) 
+{
+    #ifdef _WIN32
+    return _mkdir(path);
+    #else
+    return mkdir(path, 0755);
+    #endif
+}
+
+const char* get_git_common_dir() 
+{
+    if (!git_common_dir[0] && discover_repository() == 0) {
+        snprintf(git_common_dir, sizeof(git_common_dir), "%s", repo.common_dir);
+    }
+    if (!git_common_dir[0]) {
+        char *git_dir = run_git_command_output("git rev-parse --git-common-dir");
+        if (!git_dir || strlen(git_dir) == 0) {
+            return NULL;
+        }
+        snprintf(git_common_dir, sizeof(git_common_dir), "%s", git_dir);
+    }
+    return git_common_dir;
+}
+
+// Caches live in <git-common-dir>/gitsmart so every worktree shares them
+const char* get_cache_dir() 
+{
+    if (!cache_dir[0]) {
+        const char *git_dir = get_git_common_dir();
+        if (!git_dir) {
+            return NULL;
+        }
+        snprintf(cache_dir, sizeof(cache_dir), "%s/gitsmart", git_dir);
+        make_directory(cache_dir);
+    }
+    return cache_dir;
+}
+
+int get_cache_path(char *out, size_t size, const char *name) 
+{
+    const char *dir = get_cache_dir();
+    if (!dir) return -1;
+    int length = snprintf(out, size, "%s/%s", dir, name);
+    return length < 0 || (size_t)length >= size ? -1 : 0;
+}
+
+// "<prefix>-<pid>-<n>.tmp": the cache directory is shared by every gitsmart run in the
+// repository (hooks, prompts), so scratch files get names no other process will use
+int unique_temp_path(char *out, size_t size, const char *prefix) 
+{
+    static atomic_int counter;
+    int length = snprintf(out, size, "%s-%d-%d.tmp", prefix, (int)getpid(), atomic_fetch_add(&counter, 1));
+    return length < 0 || (size_t)length >= size ? -1 : 0;
+}
+
+// A scratch file in the cache directory, named after `name` but unique to this process
+int get_temp_path(char *out, size_t size, const char *name) 
+{
+    char prefix[MAX_PATH_LENGTH + 64];
+    if (get_cache_path(prefix, sizeof(prefix), name) != 0) return -1;
+    return unique_temp_path(out, size, prefix);
+}
+
+// Atomically swaps a freshly written cache file into place
+int replace_file(const char *tmp_path, const char *final_path) 
+{
+    #ifdef _WIN32
+    remove(final_path);
+    #endif
+    return rename(tmp_path, final_path);
+}
+
+// Read-only view of a whole cache file: mmap where available, a heap copy elsewhere
+typedef struct {
+    const unsigned char *data;
+    size_t size;
+} mapped_file_t;
+
+int map_file(const char *path, mapped_file_t *map) 
+{
+    map->data = NULL;
+    map->size = 0;
+
+    #ifdef _WIN32
+    FILE *fp = fopen(path, "rb");
+    if (!fp) return -1;
+    fseek(fp, 0, SEEK_END);
+    long size = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+    unsigned char *data = size > 0 ? malloc(size) : NULL;
+    if (!data || fread(data, 1, size, fp) != (size_t)size) {
+        free(data);
+        fclose(fp);
+        return -1;
+    }
+    fclose(fp);
+    map->data = data;
+    map->size = (size_t)size;
+    #else
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return -1;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+        close(fd);
+        return -1;
+    }
+    void *data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) return -1;
+    map->data = data;
+    map->size = (size_t)st.st_size;
+    #endif
+    return 0;
+}
+
+void unmap_file(mapped_file_t *map) 
+{
+    if (!map->data) return;
+    #ifdef _WIN32
+    free((void *)map->data);
+    #else
+    munmap((void *)map->data, map->size);
+    #endif
+    map->data = NULL;
+    map->size = 0;
+}
+
+// Turns a command-line path into a path relative to the repository root
+void normalize_repo_path(const char *input, char *out, size_t size) 
+{
+    char prefix[MAX_PATH_LENGTH] = "";
+    if (discover_repository() == 0) {
+        snprintf(prefix, sizeof(prefix), "%s", repo.prefix);
+    } else {
+        char *show_prefix = run_git_command_output("git rev-parse --show-prefix");
+        if (show_prefix) strncpy(prefix, show_prefix, sizeof(prefix) - 1);
+    }
+    while (strncmp(input, "./", 2) == 0) input += 2;
+    if (strcmp(input, ".") == 0) input = "";
+    snprintf(out, size, "%s%s", prefix, input);
+    #ifdef _WIN32
+    for (char *p = out; *p; p++) {
+        if (*p == '\\') *p = '/';
+    }
+    #endif
+}
+
+// ==================== HASH TABLES ====================
+
+unsigned int hash_string(const char *s) 
+{
+    unsigned int hash = 2166136261u;
+    while (*s) {
+        hash ^= (unsigned char)*s++;
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+// Interns repository paths so indexes can refer to them by small integer ids
+typedef struct {
+    char **names;
+    int *buckets;
+    int count;
+    int capacity;
+    int bucket_count;
+} path_table_t;
+
+int path_table_find(const path_table_t *table, const char *path) 
+{
+    if (table->bucket_count == 0) return -1;
+    unsigned int slot = hash_string(path) & (table->bucket_count - 1);
+    while (table->buckets[slot] >= 0) {
+        if (strcmp(table->names[table->buckets[slot]], path) == 0) {
+            return table->buckets[slot];
+        }
+        slot = (slot + 1) & (table->bucket_count - 1);
+    }
+    return -1;
+}
+
+static void path_table_rehash(path_table_t *table, int bucket_count) 
+{
+    free(table->buckets);
+    table->bucket_count = bucket_count;
+    table->buckets = malloc(sizeof(int) * bucket_count);
+    memset(table->buckets, -1, sizeof(int) * bucket_count);
+    for (int i = 0; i < table->count; i++) {
+        unsigned int slot = hash_string(table->names[i]) & (bucket_count - 1);
+        while (table->buckets[slot] >= 0) slot = (slot + 1) & (bucket_count - 1);
+        table->buckets[slot] = i;
+    }
+}
+
+int path_table_intern(path_table_t *table, const char *path) 
+{
+    int id = path_table_find(table, path);
+    if (id >= 0) return id;
+
+    if (table->count == table->capacity) {
+        table->capacity = table->capacity ? table->capacity * 2 : 256;
+        table->names = realloc(table->names, sizeof(char *) * table->capacity);
+    }
+    table->names[table->count] = strdup(path);
+    id = table->count++;
+
+    if (table->count * 2 > table->bucket_count) {
+        path_table_rehash(table, table->bucket_count ? table->bucket_count * 2 : 512);
+    } else {
+        unsigned int slot = hash_string(path) & (table->bucket_count - 1);
+        while (table->buckets[slot] >= 0) slot = (slot + 1) & (table->bucket_count - 1);
+        table->buckets[slot] = id;
+    }
+    return id;
+}
+
+void path_table_free(path_table_t *table) 
+{
+    for (int i = 0; i < table->count; i++) free(table->names[i]);
+    free(table->names);
+    free(table->buckets);
+    memset(table, 0, sizeof(*table));
+}
+
+int hex_to_oid(const char *hex, unsigned char *oid) 
+{
+    for (int i = 0; i < 20; i++) {
+        int hi = hex[2*i], lo = hex[2*i + 1];
+        if (!isxdigit(hi) || !isxdigit(lo)) return -1;
+        hi = isdigit(hi) ? hi - '0' : tolower(hi) - 'a' + 10;
+        lo = isdigit(lo) ? lo - '0' : tolower(lo) - 'a' + 10;
+        oid[i] = (unsigned char)((hi << 4) | lo);
+    }
+    return 0;
+}
+
+void oid_to_hex(const unsigned char *oid, char *hex) 
+{
+    static const char digits[] = "0123456789abcdef";
+    for (int i = 0; i < 20; i++) {
+        hex[2*i] = digits[oid[i] >> 4];
+        hex[2*i + 1] = digits[oid[i] & 15];
+    }
+    hex[40] = '\0';
+}
+
+int is_null_oid(const unsigned char *oid) 
+{
+    for (int i = 0; i < 20; i++) {
+        if (oid[i]) return 0;
+    }
+    return 1;
+}
+
+// Maps binary object ids to a 64-bit value (object sizes, commit positions, ...)
+typedef struct {
+    unsigned char oid[20];
+    long long value;
+    int used;
+} oid_entry_t;
+
+typedef struct {
+    oid_entry_t *entries;
+    size_t capacity;
+    size_t count;
+} oid_map_t;
+
+static size_t oid_slot(const unsigned char *oid, size_t capacity) 
+{
+    size_t hash = ((size_t)oid[0] << 24) | ((size_t)oid[1] << 16) | ((size_t)oid[2] << 8) | oid[3];
+    return hash & (capacity - 1);
+}
+
+long long* oid_map_find(const oid_map_t *map, const unsigned char *oid) 
+{
+    if (map->capacity == 0) return NULL;
+    size_t slot = oid_slot(oid, map->capacity);
+    while (map->entries[slot].used) {
+        if (memcmp(map->entries[slot].oid, oid, 20) == 0) {
+            return &map->entries[slot].value;
+        }
+        slot = (slot + 1) & (map->capacity - 1);
+    }
+    return NULL;
+}
+
+long long* oid_map_insert(oid_map_t *map, const unsigned char *oid, int *created) 
+{
+    long long *existing = oid_map_find(map, oid);
+    if (existing) {
+        if (created) *created = 0;
+        return existing;
+    }
+
+    if ((map->count + 1) * 2 > map->capacity) {
+        size_t new_capacity = map->capacity ? map->capacity * 2 : 1024;
+        oid_entry_t *old_entries = map->entries;
+        size_t old_capacity = map->capacity;
+        map->entries = calloc(new_capacity, sizeof(oid_entry_t));
+        map->capacity = new_capacity;
+        for (size_t i = 0; i < old_capacity; i++) {
+            if (!old_entries[i].used) continue;
+            size_t slot = oid_slot(old_entries[i].oid, new_capacity);
+            while (map->entries[slot].used) slot = (slot + 1) & (new_capacity - 1);
+            map->entries[slot] = old_entries[i];
+        }
+        free(old_entries);
+    }
+
+    size_t slot = oid_slot(oid, map->capacity);
+    while (map->entries[slot].used) slot = (slot + 1) & (map->capacity - 1);
+    memcpy(map->entries[slot].oid, oid, 20);
+    map->entries[slot].value = 0;
+    map->entries[slot].used = 1;
+    map->count++;
+    if (created) *created = 1;
+    return &map->entries[slot].value;
+}
+
+void oid_map_free(oid_map_t *map) 
+{
+    free(map->entries);
+    memset(map, 0, sizeof(*map));
+}
+
+void format_size(long long bytes, char *out, size_t size) 
+{
+    static const char *units[] = {"B", "KB", "MB", "GB", "TB"};
+    double value = (double)(bytes < 0 ? -bytes : bytes);
+    int unit = 0;
+    while (value >= 1024 && unit < 4) {
+        value /= 1024;
+        unit++;
+    }
+    snprintf(out, size, unit ? "%s%.1f %s" : "%s%.0f %s", bytes < 0 ? "-" : "", value, units[unit]);
+}
+
+// ==================== EXTERNAL AGGREGATION ====================
+
+// Sums counters under 64-bit keys within a memory budget. Keys hash into a fixed number of
+// partitions, each a fixed-size table; a partition that fills up is sorted and spilled as a
+// run file. Finishing k-way merges every run with what is still in memory (in several passes
+// when the runs outnumber the descriptors or read buffers available), so entries come out in
+// key order with exactly the sums one unbounded table would hold.
+#define AGG_PARTITIONS 16
+#define AGG_MIN_SLOTS 256
+#define AGG_MIN_READ_BUFFER 4096
+#define AGG_MAX_MERGE_WIDTH 64
+
+size_t aggregation_memory_limit = 0;    // bytes, from --mem-limit; 0 never spills
+
+typedef struct {
+    uint64_t key;
+    uint64_t value;
+} agg_entry_t;
+
+typedef struct {
+    agg_entry_t *slots;         // UINT64_MAX keys mark empty slots
+    size_t capacity, count;
+} agg_partition_t;
+
+typedef struct {
+    agg_partition_t partitions[AGG_PARTITIONS];
+    size_t memory_limit;
+    size_t partition_slots;     // fixed when there is a limit
+    char run_prefix[MAX_PATH_LENGTH + 32];
+    int run_count;
+    size_t spilled;
+} spill_agg_t;
+
+typedef void (*agg_emit_fn)(void *context, uint64_t key, uint64_t value);
+
+static uint64_t agg_hash(uint64_t key) 
+{
+    key ^= key >> 33;
+    key *= 0xff51afd7ed558ccdULL;
+    key ^= key >> 33;
+    return key;
+}
+
+// Half the budget goes to the tables, the rest to read buffers when runs are merged
+void agg_init(spill_agg_t *agg, size_t memory_limit) 
+{
+    static int instance = 0;
+    memset(agg, 0, sizeof(*agg));
+    agg->memory_limit = memory_limit;
+    agg->partition_slots = AGG_MIN_SLOTS;
+    while (memory_limit && agg->partition_slots * 2 * sizeof(agg_entry_t) * AGG_PARTITIONS <= memory_limit / 2) {
+        agg->partition_slots *= 2;
+    }
+    const char *dir = memory_limit ? get_cache_dir() : NULL;
+    if (memory_limit && !dir) {
+        fprintf(stderr, "❌ No cache directory for aggregation runs; counting in memory past --mem-limit\n");
+        agg->memory_limit = 0;
+    } else if (dir) snprintf(agg->run_prefix, sizeof(agg->run_prefix), "%s/agg-%d-%d", dir, (int)getpid(), instance++);
+}
+
+static int compare_agg_entries(const void *a, const void *b) 
+{
+    uint64_t x = ((const agg_entry_t *)a)->key, y = ((const agg_entry_t *)b)->key;
+    return (x > y) - (x < y);
+}
+
+// Moves a partition's entries to the front of its table, sorted by key
+static size_t agg_sort_partition(agg_partition_t *part) 
+{
+    size_t n = 0;
+    for (size_t i = 0; i < part->capacity; i++) {
+        if (part->slots[i].key != UINT64_MAX) part->slots[n++] = part->slots[i];
+    }
+    qsort(part->slots, n, sizeof(agg_entry_t), compare_agg_entries);
+    return n;
+}
+
+static void agg_run_path(const spill_agg_t *agg, int run, char *out, size_t size) 
+{
+    snprintf(out, size, "%s-%d.tmp", agg->run_prefix, run);
+}
+
+static void agg_spill(spill_agg_t *agg, agg_partition_t *part) 
+{
+    char path[MAX_PATH_LENGTH + 64];
+    agg_run_path(agg, agg->run_count, path, sizeof(path));
+    size_t n = agg_sort_partition(part);
+    FILE *fp = fopen(path, "wb");
+    if (fp && fwrite(part->slots, sizeof(agg_entry_t), n, fp) == n && fclose(fp) == 0) {
+        agg->run_count++;
+        agg->spilled += n;
+        memset(part->slots, 0xff, sizeof(agg_entry_t) * part->capacity);
+        part->count = 0;
+        return;
+    }
+    // Out of disk: keep going in memory rather than lose counts, but say the budget is gone
+    fprintf(stderr, "❌ Cannot write aggregation run %s: %s; counting in memory past --mem-limit\n",
+            path, strerror(errno));
+    if (fp) fclose(fp);
+    remove(path);
+    agg->memory_limit = 0;
+}
+
+static void agg_grow(agg_partition_t *part, size_t capacity) 
+{
+    agg_entry_t *old = part->slots;
+    size_t old_capacity = part->capacity;
+    part->slots = malloc(sizeof(agg_entry_t) * capacity);
+    memset(part->slots, 0xff, sizeof(agg_entry_t) * capacity);
+    part->capacity = capacity;
+    for (size_t i = 0; i < old_capacity; i++) {
+        if (old[i].key == UINT64_MAX) continue;
+        size_t slot = (size_t)agg_hash(old[i].key) & (capacity - 1);
+        while (part->slots[slot].key != UINT64_MAX) slot = (slot + 1) & (capacity - 1);
+        part->slots[slot] = old[i];
+    }
+    free(old);
+}
+
+void agg_add(spill_agg_t *agg, uint64_t key, uint64_t value) 
+{
+    uint64_t hash = agg_hash(key);
+    agg_partition_t *part = &agg->partitions[hash >> 60];
+    if (!part->slots) agg_grow(part, agg->partition_slots);
+    if ((part->count + 1) * 4 > part->capacity * 3) {
+        if (agg->memory_limit) agg_spill(agg, part);
+        if (!agg->memory_limit) agg_grow(part, part->capacity * 2);
+    }
+
+    size_t slot = (size_t)hash & (part->capacity - 1);
+    while (part->slots[slot].key != UINT64_MAX && part->slots[slot].key != key) {
+        slot = (slot + 1) & (part->capacity - 1);
+    }
+    if (part->slots[slot].key == UINT64_MAX) {
+        part->slots[slot].key = key;
+        part->slots[slot].value = 0;
+        part->count++;
+    }
+    part->slots[slot].value += value;
+}
+
+// One sorted source for the merge: a run file or a partition still in memory
+typedef struct {
+    FILE *fp;
+    const agg_entry_t *entries;
+    size_t remaining;
+    agg_entry_t head;
+} agg_source_t;
+
+static int agg_source_next(agg_source_t *source) 
+{
+    if (source->fp) return fread(&source->head, sizeof(agg_entry_t), 1, source->fp) == 1;
+    if (source->remaining == 0) return 0;
+    source->head = *source->entries++;
+    source->remaining--;
+    return 1;
+}
+
+static void agg_sift_down(agg_source_t **heap, int count, int i) 
+{
+    for (;;) {
+        int smallest = i, left = 2 * i + 1, right = left + 1;
+        if (left < count && heap[left]->head.key < heap[smallest]->head.key) smallest = left;
+        if (right < count && heap[right]->head.key < heap[smallest]->head.key) smallest = right;
+        if (smallest == i) return;
+        agg_source_t *t = heap[i];
+        heap[i] = heap[smallest];
+        heap[smallest] = t;
+        i = smallest;
+    }
+}
+
+static void agg_write_entry(void *context, uint64_t key, uint64_t value) 
+{
+    agg_entry_t entry = { key, value };
+    fwrite(&entry, sizeof(entry), 1, context);
+}
+
+// Runs one merge pass may hold open: bounded by the descriptor limit and by the half of the
+// budget set aside for read buffers (AGG_MIN_READ_BUFFER per run at the least)
+static int agg_merge_width(const spill_agg_t *agg, size_t *buffer_size) 
+{
+    int width = AGG_MAX_MERGE_WIDTH;
+#ifdef _WIN32
+    int descriptors = _getmaxstdio();
+#else
+    struct rlimit limit;
+    int descriptors = INT_MAX;
+    if (getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur != RLIM_INFINITY && limit.rlim_cur < INT_MAX) {
+        descriptors = (int)limit.rlim_cur;
+    }
+#endif
+    // Half the descriptors stay free for git pipes, mapped indexes and the merge output
+    if (descriptors / 2 < width) width = descriptors / 2;
+    size_t budget = agg->memory_limit / 2;
+    if (budget / AGG_MIN_READ_BUFFER < (size_t)width) width = (int)(budget / AGG_MIN_READ_BUFFER);
+    if (width < 2) width = 2;
+    *buffer_size = budget / width;
+    if (*buffer_size < AGG_MIN_READ_BUFFER) *buffer_size = AGG_MIN_READ_BUFFER;
+    return width;
+}
+
+// Opens up to `width` runs starting at `first`. Running out of descriptors narrows the pass
+// (one is given back for the output); any other failure is reported and returns -1.
+static int agg_open_runs(const spill_agg_t *agg, int first, int width, size_t buffer_size,
+                         agg_source_t *sources, char **buffers) 
+{
+    int opened = 0;
+    while (opened < width && first + opened < agg->run_count) {
+        char path[MAX_PATH_LENGTH + 64];
+        agg_run_path(agg, first + opened, path, sizeof(path));
+        FILE *fp = fopen(path, "rb");
+        if (!fp) {
+            int error = errno;
+            if ((error == EMFILE || error == ENFILE) && opened > 2) {
+                fclose(sources[--opened].fp);
+                sources[opened].fp = NULL;
+                break;
+            }
+            fprintf(stderr, "❌ Cannot open aggregation run %s: %s\n", path, strerror(error));
+            while (opened > 0) fclose(sources[--opened].fp);
+            return -1;
+        }
+        buffers[opened] = buffers[opened] ? buffers[opened] : malloc(buffer_size);
+        setvbuf(fp, buffers[opened], _IOFBF, buffer_size);
+        memset(&sources[opened], 0, sizeof(agg_source_t));
+        sources[opened++].fp = fp;
+    }
+    return opened;
+}
+
+// Emits every key once, in ascending order (emit may be NULL to discard), then frees the
+// tables and removes the runs. When there are more runs than one pass can hold open, groups
+// of them are first merged into longer runs. Returns -1 if a run cannot be read or written.
+int agg_finish(spill_agg_t *agg, agg_emit_fn emit, void *context) 
+{
+    size_t buffer_size;
+    int width = agg_merge_width(agg, &buffer_size);
+    agg_source_t *sources = calloc(width + AGG_PARTITIONS, sizeof(agg_source_t));
+    agg_source_t **heap = malloc(sizeof(agg_source_t *) * (width + AGG_PARTITIONS));
+    char **buffers = calloc(width, sizeof(char *));
+
+    int first = 0, result = 0;
+    for (;;) {
+        int opened = agg_open_runs(agg, first, width, buffer_size, sources, buffers);
+        if (opened < 0) {
+            result = -1;
+            break;
+        }
+        int last_pass = first + opened == agg->run_count;
+        int source_count = opened;
+        if (last_pass) {
+            for (int p = 0; p < AGG_PARTITIONS; p++) {
+                agg_partition_t *part = &agg->partitions[p];
+                if (!part->slots) continue;
+                agg_source_t *source = &sources[source_count++];
+                memset(source, 0, sizeof(*source));
+                source->entries = part->slots;
+                source->remaining = agg_sort_partition(part);
+            }
+        }
+
+        char out_path[MAX_PATH_LENGTH + 64];
+        FILE *out = NULL;
+        if (!last_pass) {
+            agg_run_path(agg, agg->run_count, out_path, sizeof(out_path));
+            if (!(out = fopen(out_path, "wb"))) {
+                fprintf(stderr, "❌ Cannot write aggregation run %s: %s\n", out_path, strerror(errno));
+                result = -1;
+            }
+        }
+
+        int heap_count = 0;
+        for (int i = 0; i < source_count && result == 0; i++) {
+            if (agg_source_next(&sources[i])) heap[heap_count++] = &sources[i];
+        }
+        for (int i = heap_count / 2 - 1; i >= 0; i--) agg_sift_down(heap, heap_count, i);
+        while (heap_count > 0) {
+            uint64_t key = heap[0]->head.key, value = 0;
+            while (heap_count > 0 && heap[0]->head.key == key) {
+                value += heap[0]->head.value;
+                if (!agg_source_next(heap[0])) heap[0] = heap[--heap_count];
+                agg_sift_down(heap, heap_count, 0);
+            }
+            if (out) agg_write_entry(out, key, value);
+            else if (emit) emit(context, key, value);
+        }
+
+        for (int i = 0; i < opened; i++) {
+            char path[MAX_PATH_LENGTH + 64];
+            if (ferror(sources[i].fp)) result = -1;
+            fclose(sources[i].fp);
+            agg_run_path(agg, first + i, path, sizeof(path));
+            remove(path);
+        }
+        first += opened;
+        if (out) {
+            if (ferror(out) | fclose(out)) {
+                fprintf(stderr, "❌ Cannot write aggregation run %s\n", out_path);
+                result = -1;
+            }
+            agg->run_count++;
+        }
+        if (last_pass || result != 0) break;
+    }
+
+    for (int r = first; r < agg->run_count; r++) {
+        char path[MAX_PATH_LENGTH + 64];
+        agg_run_path(agg, r, path, sizeof(path));
+        remove(path);
+    }
+    for (int i = 0; i < width; i++) free(buffers[i]);
+    for (int p = 0; p < AGG_PARTITIONS; p++) free(agg->partitions[p].slots);
+    free(sources);
+    free(heap);
+    free(buffers);
+    memset(agg->partitions, 0, sizeof(agg->partitions));
+    agg->run_count = 0;
+    return result;
+}
+
+// "512M", "2G", "65536K" or plain bytes; 0 on anything else
+size_t parse_memory_size(const char *text) 
+{
+    char *end;
+    double value = strtod(text, &end);
+    if (end == text || value <= 0) return 0;
+    switch (toupper((unsigned char)*end)) {
+    case 'K': value *= 1024; end++; break;
+    case 'M': value *= 1024 * 1024; end++; break;
+    case 'G': value *= 1024.0 * 1024 * 1024; end++; break;
+    default: break;
+    }
+    if (toupper((unsigned char)*end) == 'B') end++;
+    return *end ? 0 : (size_t)value;
+}
+
+// ==================== INDEX FILES ====================
+
+// Cache indexes are written in native byte order; sections are padded to 4 bytes
+static size_t align4(size_t n) 
+{
+    return (n + 3) & ~(size_t)3;
+}
+
+int get_head_oid(char *out) 
+{
+    if (resolve_ref("HEAD", out, NULL, 0) == 0) return 0;
+    if (repo.found && !repo.reftable) return -1;   // unborn branch
+    char *head = run_git_command_output("git rev-parse --verify -q HEAD");
+    if (!head || strlen(head) != 40) return -1;
+    memcpy(out, head, 41);
+    return 0;
+}
+
+int is_ancestor_of_head(const char *commit) 
+{
+    return commit[0] && run_git_command("git merge-base --is-ancestor %s HEAD", commit) == 0;
+}
+
+// Path names as stored in an index: offsets, NUL-terminated names, then ids sorted by name
+typedef struct {
+    uint32_t count;
+    const uint32_t *offsets;
+    const char *names;
+    const uint32_t *sorted_ids;
+} name_table_view_t;
+
+size_t name_table_size(uint32_t count, uint32_t name_bytes) 
+{
+    return 4 * ((size_t)count + 1) + align4(name_bytes) + 4 * (size_t)count;
+}
+
+const unsigned char* name_table_read(name_table_view_t *table, const unsigned char *cursor,
+                                     uint32_t count, uint32_t name_bytes) 
+{
+    table->count = count;
+    table->offsets = (const uint32_t *)cursor;
+    cursor += 4 * ((size_t)count + 1);
+    table->names = (const char *)cursor;
+    cursor += align4(name_bytes);
+    table->sorted_ids = (const uint32_t *)cursor;
+    return cursor + 4 * (size_t)count;
+}
+
+const char* name_table_get(const name_table_view_t *table, uint32_t id) 
+{
+    return table->names + table->offsets[id];
+}
+
+int name_table_find(const name_table_view_t *table, const char *name) 
+{
+    uint32_t lo = 0, hi = table->count;
+    while (lo < hi) {
+        uint32_t mid = lo + (hi - lo) / 2;
+        int cmp = strcmp(name_table_get(table, table->sorted_ids[mid]), name);
+        if (cmp == 0) return (int)table->sorted_ids[mid];
+        if (cmp < 0) lo = mid + 1;
+        else hi = mid;
+    }
+    return -1;
+}
+
+uint32_t name_table_bytes(const path_table_t *paths) 
+{
+    size_t bytes = 0;
+    for (int i = 0; i < paths->count; i++) bytes += strlen(paths->names[i]) + 1;
+    return (uint32_t)bytes;
+}
+
+static char **sort_names_by;
+
+static int compare_ids_by_name(const void *a, const void *b) 
+{
+    return strcmp(sort_names_by[*(const uint32_t *)a], sort_names_by[*(const uint32_t *)b]);
+}
+
+void name_table_write(FILE *fp, const path_table_t *paths) 
+{
+    static const char padding[4] = {0};
+    uint32_t count = (uint32_t)paths->count;
+    uint32_t *offsets = malloc(sizeof(uint32_t) * (count + 1));
+    uint32_t *sorted_ids = malloc(sizeof(uint32_t) * (count + 1));
+
+    offsets[0] = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        offsets[i + 1] = offsets[i] + (uint32_t)strlen(paths->names[i]) + 1;
+        sorted_ids[i] = i;
+    }
+    sort_names_by = paths->names;
+    qsort(sorted_ids, count, sizeof(uint32_t), compare_ids_by_name);
+
+    fwrite(offsets, sizeof(uint32_t), count + 1, fp);
+    for (uint32_t i = 0; i < count; i++) fwrite(paths->names[i], 1, strlen(paths->names[i]) + 1, fp);
+    fwrite(padding, 1, align4(offsets[count]) - offsets[count], fp);
+    fwrite(sorted_ids, sizeof(uint32_t), count, fp);
+
+    free(offsets);
+    free(sorted_ids);
+}
+
+// Opens a per-process temp file next to the final cache file; finish_index_file() swaps
+// it into place, so concurrent writers never interleave and the last rename wins
+FILE* begin_index_file(const char *path, char *tmp_path, size_t size) 
+{
+    if (unique_temp_path(tmp_path, size, path) != 0) return NULL;
+    return fopen(tmp_path, "wb");
+}
+
+int finish_index_file(FILE *fp, const char *tmp_path, const char *path) 
+{
+    if (fclose(fp) != 0) {
+        remove(tmp_path);
+        return -1;
+    }
+    return replace_file(tmp_path, path);
+}
+
+// ==================== HISTORY WALK ====================
+
+// Every history-based report is an analyzer fed from one shared `git log` stream.
+// Adding a report means adding an analyzer here, not another git invocation.
+
+#define WALK_NEEDS_FILES 1
+#define WALK_NEEDS_LINE_STATS 2
+
+typedef struct {
+    char hash[41];
+    char parents[MAX_LINE_LENGTH];
+    int parent_count;
+    long long epoch;
+    char date[16];
+    char author[256];
+    char subject[512];
+    int files_changed;
+    int insertions;
+    int deletions;
+} history_commit_t;
+
+typedef struct {
+    const char *path;
+    const char *old_path;
+    int insertions;
+    int deletions;
+} file_change_t;
+
+typedef struct analyzer {
+    const char *name;
+    int needs;
+    void (*begin)(struct analyzer *self);
+    // Returns non-zero to receive this commit's file changes; clear `active` once satisfied
+    int (*on_commit)(struct analyzer *self, const history_commit_t *commit);
+    void (*on_file_change)(struct analyzer *self, const history_commit_t *commit, const file_change_t *change);
+    void (*finish)(struct analyzer *self);
+    void *state;
+    int active;
+} analyzer_t;
+
+typedef struct {
+    char *text;
+    size_t length, capacity;
+    size_t *offsets;
+    int *insertions, *deletions;
+    int count, capacity_entries;
+} walk_changes_t;
+
+static size_t walk_store_text(walk_changes_t *c, const char *text, size_t length) 
+{
+    if (c->length + length + 1 > c->capacity) {
+        c->capacity = (c->length + length + 1) * 2;
+        c->text = realloc(c->text, c->capacity);
+    }
+    size_t offset = c->length;
+    memcpy(c->text + offset, text, length);
+    c->text[offset + length] = '\0';
+    c->length += length + 1;
+    return offset;
+}
+
+// Expands numstat rename notation ("a => b" or "dir/{a => b}/file") into old/new paths
+static void walk_add_change(walk_changes_t *c, const char *old_path, size_t old_length,
+                            const char *path, size_t length, int insertions, int deletions) 
+{
+    if (c->count == c->capacity_entries) {
+        c->capacity_entries = c->capacity_entries ? c->capacity_entries * 2 : 64;
+        c->offsets = realloc(c->offsets, sizeof(size_t) * 2 * c->capacity_entries);
+        c->insertions = realloc(c->insertions, sizeof(int) * c->capacity_entries);
+        c->deletions = realloc(c->deletions, sizeof(int) * c->capacity_entries);
+    }
+    c->offsets[2 * c->count] = walk_store_text(c, path, length);
+    c->offsets[2 * c->count + 1] = old_path ? walk_store_text(c, old_path, old_length) : (size_t)-1;
+    c->insertions[c->count] = insertions;
+    c->deletions[c->count] = deletions;
+    c->count++;
+}
+
+static void parse_numstat_path(walk_changes_t *c, const char *spec, int insertions, int deletions) 
+{
+    const char *arrow = strstr(spec, " => ");
+    if (!arrow) {
+        walk_add_change(c, NULL, 0, spec, strlen(spec), insertions, deletions);
+        return;
+    }
+
+    const char *open = strchr(spec, '{');
+    const char *close = open ? strchr(arrow, '}') : NULL;
+    if (!open || !close || open > arrow) {
+        walk_add_change(c, spec, arrow - spec, arrow + 4, strlen(arrow + 4), insertions, deletions);
+        return;
+    }
+
+    char old_path[MAX_PATH_LENGTH * 2], new_path[MAX_PATH_LENGTH * 2];
+    const char *suffix = close + 1;
+    int old_middle = (int)(arrow - open - 1), new_middle = (int)(close - arrow - 4);
+    // An empty side drops the duplicated separator: "a/{ => b}/c" is "a/c" -> "a/b/c"
+    snprintf(old_path, sizeof(old_path), "%.*s%.*s%s", (int)(open - spec), spec, old_middle, open + 1,
+             old_middle == 0 && *suffix == '/' ? suffix + 1 : suffix);
+    snprintf(new_path, sizeof(new_path), "%.*s%.*s%s", (int)(open - spec), spec, new_middle, arrow + 4,
+             new_middle == 0 && *suffix == '/' ? suffix + 1 : suffix);
+    walk_add_change(c, old_path, strlen(old_path), new_path, strlen(new_path), insertions, deletions);
+}
+
+static void parse_walk_change(walk_changes_t *c, char *line, int numstat) 
+{
+    char *first = strchr(line, '\t');
+    if (!first) return;
+    *first++ = '\0';
+
+    if (numstat) {
+        // <insertions>\t<deletions>\t<path>, with "-" counts for binary files
+        char *path = strchr(first, '\t');
+        if (!path) return;
+        *path++ = '\0';
+        int insertions = line[0] == '-' ? 0 : atoi(line);
+        int deletions = first[0] == '-' ? 0 : atoi(first);
+        parse_numstat_path(c, path, insertions, deletions);
+    } else {
+        // <status>\t<path> or R<score>\t<old>\t<new>
+        char *second = strchr(first, '\t');
+        if (second) *second++ = '\0';
+        if ((line[0] == 'R' || line[0] == 'C') && second) {
+            walk_add_change(c, line[0] == 'R' ? first : NULL, strlen(first), second, strlen(second), 0, 0);
+        } else {
+            walk_add_change(c, NULL, 0, second ? second : first, strlen(second ? second : first), 0, 0);
+        }
+    }
+}
+
+static int parse_walk_commit(history_commit_t *commit, char *line) 
+{
+    // commit <hash>\t<parents>\t<committer epoch>\t<author date>\t<author>\t<subject>
+    char *fields[6];
+    fields[0] = line + 7;
+    for (int i = 1; i < 6; i++) {
+        fields[i] = strchr(fields[i - 1], '\t');
+        if (!fields[i]) return -1;
+        *fields[i]++ = '\0';
+    }
+    if (strlen(fields[0]) != 40) return -1;
+
+    memset(commit, 0, sizeof(*commit));
+    strcpy(commit->hash, fields[0]);
+    strncpy(commit->parents, fields[1], sizeof(commit->parents) - 1);
+    commit->parent_count = commit->parents[0] ? 1 : 0;
+    for (const char *p = commit->parents; *p; p++) {
+        if (*p == ' ') commit->parent_count++;
+    }
+    commit->epoch = atoll(fields[2]);
+    strncpy(commit->date, fields[3], sizeof(commit->date) - 1);
+    strncpy(commit->author, fields[4], sizeof(commit->author) - 1);
+    strncpy(commit->subject, fields[5], sizeof(commit->subject) - 1);
+    return 0;
+}
+
+static void walk_changes_free(walk_changes_t *c) 
+{
+    free(c->text);
+    free(c->offsets);
+    free(c->insertions);
+    free(c->deletions);
+    memset(c, 0, sizeof(*c));
+}
+
+static int any_analyzer_active(analyzer_t **analyzers, int count) 
+{
+    for (int i = 0; i < count; i++) {
+        if (analyzers[i]->active) return 1;
+    }
+    return 0;
+}
+
+static void dispatch_walk_commit(analyzer_t **analyzers, int count, history_commit_t *commit, walk_changes_t *changes) 
+{
+    commit->files_changed = changes->count;
+    for (int i = 0; i < changes->count; i++) {
+        commit->insertions += changes->insertions[i];
+        commit->deletions += changes->deletions[i];
+    }
+
+    for (int a = 0; a < count; a++) {
+        analyzer_t *analyzer = analyzers[a];
+        if (!analyzer->active) continue;
+        if (!analyzer->on_commit(analyzer, commit) || !analyzer->on_file_change) continue;
+        for (int i = 0; i < changes->count; i++) {
+            file_change_t change;
+            size_t old_offset = changes->offsets[2 * i + 1];
+            change.path = changes->text + changes->offsets[2 * i];
+            change.old_path = old_offset == (size_t)-1 ? NULL : changes->text + old_offset;
+            change.insertions = changes->insertions[i];
+            change.deletions = changes->deletions[i];
+            analyzer->on_file_change(analyzer, commit, &change);
+        }
+    }
+}
+
+typedef struct {
+    analyzer_t **analyzers;
+    int count;
+    int numstat;
+    history_commit_t commit;
+    walk_changes_t changes;
+    int have_commit;
+    int commits_read;
+    progress_t progress;
+} walk_state_t;
+
+// Feeds one line of log output; returns 0 once no analyzer wants more history
+static int walk_feed_line(walk_state_t *w, char *line) 
+{
+    if (strncmp(line, "commit ", 7) == 0) {
+        if (w->have_commit) {
+            w->have_commit = 0;
+            dispatch_walk_commit(w->analyzers, w->count, &w->commit, &w->changes);
+            if (!any_analyzer_active(w->analyzers, w->count)) return 0;
+        }
+        w->changes.count = 0;
+        w->changes.length = 0;
+        w->have_commit = parse_walk_commit(&w->commit, line) == 0;
+        w->commits_read += w->have_commit;
+        if ((w->commits_read & 63) == 0) progress_update(&w->progress, w->commits_read);
+    } else if (line[0] && w->have_commit) {
+        parse_walk_change(&w->changes, line, w->numstat);
+    }
+    return 1;
+}
+
+// Hands over the commit still being collected; returns 0 once no analyzer wants more history
+static int walk_flush(walk_state_t *w) 
+{
+    if (w->have_commit) {
+        w->have_commit = 0;
+        dispatch_walk_commit(w->analyzers, w->count, &w->commit, &w->changes);
+    }
+    return any_analyzer_active(w->analyzers, w->count);
+}
+
+#define WALK_FORMAT "--date=short --format=\"commit %%H%%x09%%P%%x09%%ct%%x09%%ad%%x09%%an%%x09%%s\""
+#define WALK_FIRST_WAVE 128     // commits diffed before sharding starts (most reports stop early)
+#define WALK_SHARD_MIN 256
+#define WALK_SHARD_MAX 8192
+
+int walk_jobs = 0;              // diff processes for sharded walks; 0 means one per CPU
+
+// One wave of a sharded walk: contiguous runs of commit ids, each diffed by its own git
+// process, with the output kept per shard so it can be replayed in log order
+typedef struct {
+    char (*ids)[41];
+    int count;
+    int shard_count;
+    const char *diff;
+    char **output;
+    size_t *output_size;
+} walk_wave_t;
+
+static void walk_shard_task(void *context, int shard) 
+{
+    walk_wave_t *wave = context;
+    int per_shard = (wave->count + wave->shard_count - 1) / wave->shard_count;
+    int first = shard * per_shard;
+    int last = first + per_shard < wave->count ? first + per_shard : wave->count;
+    if (first >= last) return;
+
+    char list_path[MAX_PATH_LENGTH + 64];
+    if (get_temp_path(list_path, sizeof(list_path), "walk") != 0) return;
+    FILE *list = fopen(list_path, "w");
+    if (!list) return;
+    for (int i = first; i < last; i++) fprintf(list, "%s\n", wave->ids[i]);
+    fclose(list);
+
+    FILE *fp = open_git_stream("git -c core.quotePath=false log --no-walk=unsorted --stdin %s " WALK_FORMAT " < \"%s\"",
+                               wave->diff, list_path);
+    if (fp) {
+        size_t capacity = 1 << 16, size = 0, got;
+        char *output = malloc(capacity);
+        while ((got = fread(output + size, 1, capacity - size - 1, fp)) > 0) {
+            size += got;
+            if (capacity - size < 4096) {
+                capacity *= 2;
+                output = realloc(output, capacity);
+            }
+        }
+        output[size] = '\0';
+        pclose(fp);
+        wave->output[shard] = output;
+        wave->output_size[shard] = size;
+    }
+    remove(list_path);
+}
+
+// Lists commit ids with rev-list (cheap), then diffs them in waves of parallel shards and
+// replays the shard outputs in order, so analyzers see exactly what one `git log` would give.
+// Waves grow geometrically, which keeps reports that stop after a few commits cheap.
+// Returns -1 if the walk could not start, leaving the caller to stream instead.
+static int walk_history_sharded(walk_state_t *w, const char *diff, int jobs) 
+{
+    const char *dir = get_cache_dir();
+    FILE *revs = dir ? open_git_stream("git rev-list HEAD 2>" NULL_DEVICE) : NULL;
+    if (!revs) return -1;
+
+    int capacity = jobs * WALK_SHARD_MAX * 2;
+    walk_wave_t wave = { malloc(41 * (size_t)capacity), 0, 0, diff,
+                         calloc(jobs * 2, sizeof(char *)), calloc(jobs * 2, sizeof(size_t)) };
+    char *line = NULL;
+    size_t line_capacity = 0;
+    int shard_size = WALK_SHARD_MIN, more = 1, wanted = 1;
+    for (int wave_number = 0; more && wanted; wave_number++) {
+        // Two shards per worker evens out commits of very different sizes
+        int shard_count = wave_number == 0 ? 1 : jobs * 2;
+        int limit = wave_number == 0 ? WALK_FIRST_WAVE : shard_count * shard_size;
+        wave.count = 0;
+        while (wave.count < limit && (more = read_stream_line(revs, &line, &line_capacity) >= 0)) {
+            if (strlen(line) == 40) memcpy(wave.ids[wave.count++], line, 41);
+        }
+        if (wave.count == 0) break;
+        wave.shard_count = shard_count < wave.count ? shard_count : wave.count;
+        parallel_for(wave.shard_count, jobs, walk_shard_task, &wave);
+
+        for (int shard = 0; shard < wave.shard_count; shard++) {
+            char *p = wave.output[shard], *end = p + wave.output_size[shard];
+            while (wanted && p && p < end) {
+                char *nl = memchr(p, '\n', end - p);
+                if (!nl) nl = end;
+                *nl = '\0';
+                if (nl > p && nl[-1] == '\r') nl[-1] = '\0';
+                wanted = walk_feed_line(w, p);
+                p = nl + 1;
+            }
+            free(wave.output[shard]);
+            wave.output[shard] = NULL;
+        }
+        if (wanted) wanted = walk_flush(w);
+        if (wave_number > 0 && shard_size < WALK_SHARD_MAX) shard_size *= 2;
+    }
+    free(line);
+    pclose(revs);
+    free(wave.ids);
+    free(wave.output);
+    free(wave.output_size);
+    return 0;
+}
+
+long long estimate_commit_count();
+int walk_history_native(walk_state_t *w);
+
+// Feeds history newest first into every analyzer; stops as soon as none is still active.
+// Walks that need diffs are sharded across the worker pool when there is more than one CPU;
+// walks that need none read commits from the object store without running git.
+// Returns the number of commits read.
+int run_history_walk(analyzer_t **analyzers, int count) 
+{
+    int needs = 0;
+    for (int i = 0; i < count; i++) {
+        analyzers[i]->active = 1;
+        if (analyzers[i]->begin) analyzers[i]->begin(analyzers[i]);
+        if (analyzers[i]->active) needs |= analyzers[i]->needs;
+    }
+
+    walk_state_t *w = calloc(1, sizeof(walk_state_t));
+    w->analyzers = analyzers;
+    w->count = count;
+    w->numstat = (needs & WALK_NEEDS_LINE_STATS) != 0;
+    if (any_analyzer_active(analyzers, count)) {
+        progress_begin(&w->progress, "Reading history", "commits", estimate_commit_count());
+        const char *diff = (needs & WALK_NEEDS_LINE_STATS) ? "--numstat -M" :
+                           (needs & WALK_NEEDS_FILES) ? "--name-status -M" : "";
+        int jobs = walk_jobs > 0 ? walk_jobs : default_job_count();
+        if (!diff[0] && walk_history_native(w) == 0) {
+            // Metadata only: read straight from the object store
+        } else if (!diff[0] || jobs < 2 || walk_history_sharded(w, diff, jobs) != 0) {
+            FILE *log = open_git_stream("git -c core.quotePath=false log %s " WALK_FORMAT " HEAD", diff);
+            if (log) {
+                stream_pipe_t lines;
+                stream_pipe_open(&lines, log);
+                char *line;
+                while ((line = stream_pipe_line(&lines, NULL))) {
+                    if (!walk_feed_line(w, line)) break;
+                }
+                walk_flush(w);
+                stream_pipe_close(&lines);
+                pclose(log);
+            }
+        }
+        progress_end(&w->progress);
+    }
+
+    for (int i = 0; i < count; i++) {
+        if (analyzers[i]->finish) analyzers[i]->finish(analyzers[i]);
+    }
+    int commits_read = w->commits_read;
+    walk_changes_free(&w->changes);
+    free(w);
+    return commits_read;
+}
+
+// Tracks which walked commits an index is missing. Starting from HEAD, every commit the
+// index does not know is new, and the walk can stop once all their parents were seen.
+typedef struct {
+    oid_map_t known;
+    oid_map_t walked;
+    int pending;
+} walk_frontier_t;
+
+void frontier_start(walk_frontier_t *f, const char *head) 
+{
+    unsigned char head_oid[20];
+    if (hex_to_oid(head, head_oid) != 0) return;
+    if (oid_map_find(&f->known, head_oid)) return;
+    *oid_map_insert(&f->walked, head_oid, NULL) = 0;
+    f->pending = 1;
+}
+
+// Returns the slot for a commit seen for the first time and missing from the index
+// (callers store a non-zero value in it), or NULL when the commit can be skipped
+long long* frontier_visit(walk_frontier_t *f, const history_commit_t *c) 
+{
+    unsigned char oid[20];
+    if (hex_to_oid(c->hash, oid) != 0 || oid_map_find(&f->known, oid)) return NULL;
+
+    int created = 0;
+    long long *slot = oid_map_insert(&f->walked, oid, &created);
+    if (!created && *slot > 0) return NULL;
+    if (!created) f->pending--;
+
+    // Claim the slot before inserting parents, which may move the table
+    *slot = -1;
+    for (const char *p = c->parents; strlen(p) >= 40; p += 41) {
+        unsigned char parent[20];
+        if (hex_to_oid(p, parent) != 0) break;
+        if (!oid_map_find(&f->known, parent) && !oid_map_find(&f->walked, parent)) {
+            *oid_map_insert(&f->walked, parent, NULL) = 0;
+            f->pending++;
+        }
+        if (p[40] != ' ') break;
+    }
+    return oid_map_find(&f->walked, oid);
+}
+
+void frontier_free(walk_frontier_t *f) 
+{
+    oid_map_free(&f->known);
+    oid_map_free(&f->walked);
+}
+
+// ==================== COMMIT ANALYSIS ====================
+
+// Keeps the newest few commits, for reports that only glance at recent activity
+typedef struct {
+    commit_info_t commits[10];
+    int count;
+    int limit;
+} recent_commits_t;
+
+static int recent_commits_on_commit(analyzer_t *self, const history_commit_t *c) 
+{
+    recent_commits_t *recent = self->state;
+    commit_info_t *commit = &recent->commits[recent->count++];
+    strcpy(commit->hash, c->hash);
+    strcpy(commit->author, c->author);
+    strcpy(commit->date, c->date);
+    strcpy(commit->message, c->subject);
+    commit->files_changed = c->files_changed;
+    commit->insertions = c->insertions;
+    commit->deletions = c->deletions;
+    if (recent->count == recent->limit) self->active = 0;
+    return 0;
+}
+
+analyzer_t recent_commits_analyzer(recent_commits_t *recent, int limit) 
+{
+    analyzer_t analyzer = { "recent", WALK_NEEDS_LINE_STATS, NULL, recent_commits_on_commit, NULL, NULL, recent, 0 };
+    memset(recent, 0, sizeof(*recent));
+    recent->limit = limit < 10 ? limit : 10;
+    return analyzer;
+}
+
+
+static int commit_store_on_commit(analyzer_t *self, const history_commit_t *c) 
+{
+    commit_info_t *commit = &commits[commit_count++];
+    strcpy(commit->hash, c->hash);
+    strcpy(commit->author, c->author);
+    strcpy(commit->date, c->date);
+    strcpy(commit->message, c->subject);
+    commit->files_changed = c->files_changed;
+    commit->insertions = c->insertions;
+    commit->deletions = c->deletions;
+
+    if (commit_count == MAX_COMMITS) self->active = 0;
+    return 0;
+}
+
+// Fills the commit store used by show_commit_summary (newest MAX_COMMITS commits)
+analyzer_t commit_store_analyzer() 
+{
+    analyzer_t analyzer = { "commits", WALK_NEEDS_LINE_STATS, NULL, commit_store_on_commit, NULL, NULL, NULL, 0 };
+    commit_count = 0;
+    return analyzer;
+}
+
+// Totals behind the commit summary; submodule reports fold into the same shape
+typedef struct {
+    int commits, insertions, deletions;
+    char authors[50][256];
+    int author_counts[50];
+    int author_count;
+    char latest_date[64];
+    char latest_message[512];
+} commit_summary_t;
+
+void summary_add_author(commit_summary_t *summary, const char *author, int count) 
+{
+    for (int j = 0; j < summary->author_count; j++) {
+        if (strcmp(summary->authors[j], author) == 0) {
+            summary->author_counts[j] += count;
+            return;
+        }
+    }
+    if (summary->author_count < 50) {
+        snprintf(summary->authors[summary->author_count], sizeof(summary->authors[0]), "%s", author);
+        summary->author_counts[summary->author_count++] = count;
+    }
+}
+
+void summarize_commits(commit_summary_t *summary) 
+{
+    memset(summary, 0, sizeof(*summary));
+    summary->commits = commit_count;
+    for (int i = 0; i < commit_count; i++) {
+        summary->insertions += commits[i].insertions;
+        summary->deletions += commits[i].deletions;
+        summary_add_author(summary, commits[i].author, 1);
+    }
+    if (commit_count > 0) {
+        strcpy(summary->latest_date, commits[0].date);
+        strcpy(summary->latest_message, commits[0].message);
+    }
+}
+
+// First author with the most commits, or -1 without any
+int summary_top_author(const commit_summary_t *summary) 
+{
+    int top = -1;
+    for (int i = 0; i < summary->author_count; i++) {
+        if (summary->author_counts[i] > 0 && (top < 0 || summary->author_counts[i] > summary->author_counts[top])) top = i;
+    }
+    return top;
+}
+
+void fold_submodule_summaries(commit_summary_t *summary);
+
+void show_commit_summary() {
+    printf("📊 Repository Analysis\n");
+    printf("=====================\n");
+    
+    commit_summary_t summary;
+    summarize_commits(&summary);
+    fold_submodule_summaries(&summary);
+    printf("Total commits: %d\n", summary.commits);
+    
+    if (summary.commits == 0) {
+        printf("No commit history found.\n\n");
+        return;
+    }
+    
+    printf("Total changes: +%d -%d lines\n", summary.insertions, summary.deletions);
+    
+    int top = summary_top_author(&summary);
+    if (top >= 0) {
+        printf("Most active author: %s (%d commits)\n", summary.authors[top], summary.author_counts[top]);
+    }
+    
+    if (summary.commits > 0) {
+        printf("Latest commit: %s\n", summary.latest_message);
+    }
+    printf("\n");
+}
+
+// ==================== PATH HISTORY INDEX ====================
+
+#define HISTORY_VERSION 1
+
+// On-disk layout: header, commit epochs, commit oids, "author\tsubject" texts,
+// path names, per-path posting lists (commit positions, oldest first), rename edges
+typedef struct {
+    char magic[4];
+    uint32_t version;
+    char head[40];
+    uint32_t commit_count;
+    uint32_t path_count;
+    uint32_t posting_count;
+    uint32_t rename_count;
+    uint32_t name_bytes;
+    uint32_t text_bytes;
+} history_header_t;
+
+// At commit position `commit`, old_id was renamed to new_id
+typedef struct {
+    uint32_t new_id;
+    uint32_t old_id;
+    uint32_t commit;
+} rename_edge_t;
+
+typedef struct {
+    mapped_file_t file;
+    const history_header_t *header;
+    const int64_t *epochs;
+    const unsigned char *oids;
+    const uint32_t *text_offsets;
+    const char *text;
+    name_table_view_t paths;
+    const uint32_t *post_ptr;
+    const uint32_t *postings;
+    const rename_edge_t *renames;
+} history_index_t;
+
+typedef struct {
+    path_table_t paths;
+    uint32_t commit_count, commit_capacity;
+    unsigned char *oids;
+    int64_t *epochs;
+    uint32_t *text_offsets;
+    char *text;
+    size_t text_length, text_capacity;
+    uint32_t *post_path, *post_commit;
+    size_t post_count, post_capacity;
+    rename_edge_t *renames;
+    uint32_t rename_count, rename_capacity;
+    int spill;                  // under --mem-limit postings go through `spilled` instead
+    spill_agg_t spilled;        // keys are path << 32 | commit position
+} history_builder_t;
+
+int open_history_index(const char *path, history_index_t *idx) 
+{
+    memset(idx, 0, sizeof(*idx));
+    if (map_file(path, &idx->file) != 0) return -1;
+
+    const history_header_t *h = (const history_header_t *)idx->file.data;
+    if (idx->file.size < sizeof(*h) || memcmp(h->magic, "GSPH", 4) != 0 || h->version != HISTORY_VERSION) {
+        unmap_file(&idx->file);
+        return -1;
+    }
+
+    size_t c = h->commit_count, p = h->path_count;
+    size_t expected = sizeof(*h) + 8 * c + align4(20 * c) + 4 * (c + 1) + align4(h->text_bytes) +
+                      name_table_size(h->path_count, h->name_bytes) + 4 * (p + 1) +
+                      4 * (size_t)h->posting_count + sizeof(rename_edge_t) * h->rename_count;
+    if (idx->file.size != expected) {
+        unmap_file(&idx->file);
+        return -1;
+    }
+
+    const unsigned char *cursor = idx->file.data + sizeof(*h);
+    idx->header = h;
+    idx->epochs = (const int64_t *)cursor;          cursor += 8 * c;
+    idx->oids = cursor;                             cursor += align4(20 * c);
+    idx->text_offsets = (const uint32_t *)cursor;   cursor += 4 * (c + 1);
+    idx->text = (const char *)cursor;               cursor += align4(h->text_bytes);
+    cursor = name_table_read(&idx->paths, cursor, h->path_count, h->name_bytes);
+    idx->post_ptr = (const uint32_t *)cursor;       cursor += 4 * (p + 1);
+    idx->postings = (const uint32_t *)cursor;       cursor += 4 * (size_t)h->posting_count;
+    idx->renames = (const rename_edge_t *)cursor;
+    return 0;
+}
+
+// Author and subject of an indexed commit, stored as "author\tsubject"
+void history_commit_text(const history_index_t *idx, uint32_t commit, char *author, size_t author_size,
+                         char *subject, size_t subject_size) 
+{
+    const char *text = idx->text + idx->text_offsets[commit];
+    const char *tab = strchr(text, '\t');
+    size_t author_length = tab ? (size_t)(tab - text) : strlen(text);
+    if (author_length >= author_size) author_length = author_size - 1;
+    memcpy(author, text, author_length);
+    author[author_length] = '\0';
+    snprintf(subject, subject_size, "%s", tab ? tab + 1 : "");
+}
+
+static int compare_u32_desc(const void *a, const void *b) 
+{
+    uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+    return (x < y) - (x > y);
+}
+
+// Collects the commits that touched a path under its current or any earlier name,
+// newest first. Each earlier name only contributes commits made before its rename.
+int history_collect(const history_index_t *idx, int path_id, uint32_t **commits, int *names_followed) 
+{
+    typedef struct { uint32_t path; uint32_t cutoff; } pending_name_t;
+    pending_name_t *pending = malloc(sizeof(pending_name_t) * 16);
+    int pending_count = 0, pending_capacity = 16;
+    uint32_t *out = NULL;
+    size_t count = 0, capacity = 0;
+
+    pending[pending_count++] = (pending_name_t){ (uint32_t)path_id, UINT32_MAX };
+    *names_followed = 0;
+    while (pending_count > 0) {
+        pending_name_t name = pending[--pending_count];
+        (*names_followed)++;
+
+        for (uint32_t i = idx->post_ptr[name.path]; i < idx->post_ptr[name.path + 1]; i++) {
+            if (idx->postings[i] > name.cutoff) break;
+            if (count == capacity) {
+                capacity = capacity ? capacity * 2 : 64;
+                out = realloc(out, sizeof(uint32_t) * capacity);
+            }
+            out[count++] = idx->postings[i];
+        }
+
+        // Cutoffs strictly decrease along a chain, so rename cycles terminate
+        for (uint32_t r = 0; r < idx->header->rename_count; r++) {
+            const rename_edge_t *edge = &idx->renames[r];
+            if (edge->new_id != name.path || edge->commit >= name.cutoff || edge->old_id == name.path) continue;
+            if (pending_count == pending_capacity) {
+                pending_capacity *= 2;
+                pending = realloc(pending, sizeof(pending_name_t) * pending_capacity);
+            }
+            pending[pending_count++] = (pending_name_t){ edge->old_id, edge->commit };
+        }
+    }
+    free(pending);
+
+    qsort(out, count, sizeof(uint32_t), compare_u32_desc);
+    size_t unique = 0;
+    for (size_t i = 0; i < count; i++) {
+        if (unique == 0 || out[unique - 1] != out[i]) out[unique++] = out[i];
+    }
+    *commits = out;
+    return (int)unique;
+}
+
+static void history_add_commit(history_builder_t *b, const unsigned char *oid, int64_t epoch, const char *text) 
+{
+    if (b->commit_count == b->commit_capacity) {
+        b->commit_capacity = b->commit_capacity ? b->commit_capacity * 2 : 1024;
+        b->oids = realloc(b->oids, 20 * (size_t)b->commit_capacity);
+        b->epochs = realloc(b->epochs, sizeof(int64_t) * b->commit_capacity);
+        b->text_offsets = realloc(b->text_offsets, sizeof(uint32_t) * (b->commit_capacity + 1));
+    }
+    size_t length = strlen(text) + 1;
+    if (b->text_length + length > b->text_capacity) {
+        b->text_capacity = (b->text_length + length) * 2;
+        b->text = realloc(b->text, b->text_capacity);
+    }
+    memcpy(b->oids + 20 * (size_t)b->commit_count, oid, 20);
+    b->epochs[b->commit_count] = epoch;
+    b->text_offsets[b->commit_count] = (uint32_t)b->text_length;
+    memcpy(b->text + b->text_length, text, length);
+    b->text_length += length;
+    b->commit_count++;
+    b->text_offsets[b->commit_count] = (uint32_t)b->text_length;
+}
+
+static void history_add_posting(history_builder_t *b, int path_id) 
+{
+    if (b->spill) {
+        agg_add(&b->spilled, ((uint64_t)path_id << 32) | (b->commit_count - 1), 1);
+        return;
+    }
+    if (b->post_count == b->post_capacity) {
+        b->post_capacity = b->post_capacity ? b->post_capacity * 2 : 4096;
+        b->post_path = realloc(b->post_path, sizeof(uint32_t) * b->post_capacity);
+        b->post_commit = realloc(b->post_commit, sizeof(uint32_t) * b->post_capacity);
+    }
+    b->post_path[b->post_count] = (uint32_t)path_id;
+    b->post_commit[b->post_count++] = b->commit_count - 1;
+}
+
+static void history_add_rename(history_builder_t *b, int old_id, int new_id) 
+{
+    if (b->rename_count == b->rename_capacity) {
+        b->rename_capacity = b->rename_capacity ? b->rename_capacity * 2 : 64;
+        b->renames = realloc(b->renames, sizeof(rename_edge_t) * b->rename_capacity);
+    }
+    b->renames[b->rename_count++] = (rename_edge_t){ (uint32_t)new_id, (uint32_t)old_id, b->commit_count - 1 };
+}
+
+typedef struct {
+    FILE *out;
+    uint32_t *counts;
+} posting_spill_t;
+
+// Spilled postings come back sorted by path, then commit: already in on-disk order
+static void history_spill_posting(void *context, uint64_t key, uint64_t value) 
+{
+    posting_spill_t *s = context;
+    uint32_t commit = (uint32_t)key;
+    s->counts[(key >> 32) + 1] += (uint32_t)value;
+    for (uint64_t i = 0; i < value; i++) fwrite(&commit, sizeof(commit), 1, s->out);
+}
+
+static void copy_postings(FILE *from, FILE *to, uint32_t count) 
+{
+    uint32_t buffer[1024];
+    while (count > 0) {
+        size_t n = fread(buffer, sizeof(uint32_t), count < 1024 ? count : 1024, from);
+        if (n == 0) return;
+        fwrite(buffer, sizeof(uint32_t), n, to);
+        count -= (uint32_t)n;
+    }
+}
+
+static int write_history_index(const char *path, const char *head, history_builder_t *b, const history_index_t *old) 
+{
+    // Bucket the new postings by path; they all come after the old ones in commit order
+    uint32_t paths = (uint32_t)b->paths.count;
+    uint32_t old_paths = old ? old->header->path_count : 0;
+    uint32_t *new_ptr = calloc(paths + 1, sizeof(uint32_t));
+    uint32_t *new_postings = NULL;
+    char spill_path[MAX_PATH_LENGTH + 64];
+    posting_spill_t spill = { NULL, new_ptr };
+    if (b->spill) {
+        if (get_temp_path(spill_path, sizeof(spill_path), "postings") != 0 ||
+            !(spill.out = fopen(spill_path, "w+b")) || agg_finish(&b->spilled, history_spill_posting, &spill) != 0 ||
+            fflush(spill.out) != 0 || ferror(spill.out)) {
+            if (spill.out) {
+                fclose(spill.out);
+                remove(spill_path);
+            }
+            free(new_ptr);
+            return -1;
+        }
+        rewind(spill.out);
+    } else {
+        new_postings = malloc(sizeof(uint32_t) * (b->post_count + 1));
+        for (size_t i = 0; i < b->post_count; i++) new_ptr[b->post_path[i] + 1]++;
+    }
+    for (uint32_t p = 0; p < paths; p++) new_ptr[p + 1] += new_ptr[p];
+    if (!b->spill) {
+        uint32_t *fill = malloc(sizeof(uint32_t) * (paths + 1));
+        memcpy(fill, new_ptr, sizeof(uint32_t) * (paths + 1));
+        for (size_t i = 0; i < b->post_count; i++) new_postings[fill[b->post_path[i]]++] = b->post_commit[i];
+        free(fill);
+    }
+
+    char tmp_path[MAX_PATH_LENGTH + 64];
+    FILE *fp = begin_index_file(path, tmp_path, sizeof(tmp_path));
+    if (!fp) {
+        if (spill.out) {
+            fclose(spill.out);
+            remove(spill_path);
+        }
+        free(new_ptr);
+        free(new_postings);
+        return -1;
+    }
+
+    uint32_t *post_ptr = malloc(sizeof(uint32_t) * (paths + 1));
+    post_ptr[0] = 0;
+    for (uint32_t p = 0; p < paths; p++) {
+        uint32_t old_count = p < old_paths ? old->post_ptr[p + 1] - old->post_ptr[p] : 0;
+        post_ptr[p + 1] = post_ptr[p] + old_count + (new_ptr[p + 1] - new_ptr[p]);
+    }
+
+    uint32_t old_renames = old ? old->header->rename_count : 0;
+    history_header_t h;
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, "GSPH", 4);
+    h.version = HISTORY_VERSION;
+    memcpy(h.head, head, 40);
+    h.commit_count = b->commit_count;
+    h.path_count = paths;
+    h.posting_count = post_ptr[paths];
+    h.rename_count = old_renames + b->rename_count;
+    h.name_bytes = name_table_bytes(&b->paths);
+    h.text_bytes = (uint32_t)b->text_length;
+
+    static const char padding[4] = {0};
+    fwrite(&h, sizeof(h), 1, fp);
+    fwrite(b->epochs, sizeof(int64_t), b->commit_count, fp);
+    fwrite(b->oids, 20, b->commit_count, fp);
+    fwrite(padding, 1, align4(20 * (size_t)b->commit_count) - 20 * (size_t)b->commit_count, fp);
+    fwrite(b->text_offsets, sizeof(uint32_t), b->commit_count + 1, fp);
+    fwrite(b->text, 1, b->text_length, fp);
+    fwrite(padding, 1, align4(b->text_length) - b->text_length, fp);
+    name_table_write(fp, &b->paths);
+    fwrite(post_ptr, sizeof(uint32_t), paths + 1, fp);
+    for (uint32_t p = 0; p < paths; p++) {
+        if (p < old_paths) {
+            fwrite(old->postings + old->post_ptr[p], sizeof(uint32_t), old->post_ptr[p + 1] - old->post_ptr[p], fp);
+        }
+        if (spill.out) copy_postings(spill.out, fp, new_ptr[p + 1] - new_ptr[p]);
+        else fwrite(new_postings + new_ptr[p], sizeof(uint32_t), new_ptr[p + 1] - new_ptr[p], fp);
+    }
+    if (spill.out) {
+        fclose(spill.out);
+        remove(spill_path);
+    }
+    if (old_renames) fwrite(old->renames, sizeof(rename_edge_t), old_renames, fp);
+    if (b->rename_count) fwrite(b->renames, sizeof(rename_edge_t), b->rename_count, fp);
+
+    free(new_ptr);
+    free(new_postings);
+    free(post_ptr);
+    return finish_index_file(fp, tmp_path, path);
+}
+
+static void free_history_builder(history_builder_t *b) 
+{
+    if (b->spill) agg_finish(&b->spilled, NULL, NULL);
+    path_table_free(&b->paths);
+    free(b->oids);
+    free(b->epochs);
+    free(b->text_offsets);
+    free(b->text);
+    free(b->post_path);
+    free(b->post_commit);
+    free(b->renames);
+}
+
+// Commits the index does not have yet, newest first as they arrive from the walk
+typedef struct {
+    unsigned char oid[20];
+    int64_t epoch;
+    size_t text_offset;
+    uint32_t first_parent, parent_count;
+    uint32_t first_event, event_count;
+} new_commit_t;
+
+typedef struct {
+    int old_id;
+    int new_id;
+} path_event_t;
+
+typedef struct {
+    char path[MAX_PATH_LENGTH];
+    char head[41];
+    history_index_t old;
+    int have_old;
+    int incremental;
+    int result;
+    walk_frontier_t frontier;
+    history_builder_t builder;
+    new_commit_t *commits;
+    uint32_t commit_count, commit_capacity;
+    unsigned char (*parents)[20];
+    uint32_t parent_count, parent_capacity;
+    path_event_t *events;
+    uint32_t event_count, event_capacity;
+    FILE *event_spill;          // under --mem-limit events are written here instead
+    char event_path[MAX_PATH_LENGTH + 64];
+    char *text;
+    size_t text_length, text_capacity;
+} history_update_t;
+
+static void history_update_begin(analyzer_t *self) 
+{
+    history_update_t *u = self->state;
+    u->result = -1;
+    if (get_head_oid(u->head) != 0 || get_cache_path(u->path, sizeof(u->path), "history.idx") != 0) {
+        self->active = 0;
+        return;
+    }
+
+    u->have_old = open_history_index(u->path, &u->old) == 0;
+    if (u->have_old && memcmp(u->old.header->head, u->head, 40) == 0) {
+        u->result = 0;
+        self->active = 0;
+        return;
+    }
+
+    char old_head[41] = "";
+    if (u->have_old) {
+        memcpy(old_head, u->old.header->head, 40);
+        old_head[40] = '\0';
+    }
+    u->incremental = u->have_old && is_ancestor_of_head(old_head);
+    if (u->incremental) {
+        history_index_t *old = &u->old;
+        for (uint32_t i = 0; i < old->header->path_count; i++) {
+            path_table_intern(&u->builder.paths, name_table_get(&old->paths, i));
+        }
+        for (uint32_t i = 0; i < old->header->commit_count; i++) {
+            history_add_commit(&u->builder, old->oids + 20 * (size_t)i, old->epochs[i], old->text + old->text_offsets[i]);
+            oid_map_insert(&u->frontier.known, old->oids + 20 * (size_t)i, NULL);
+        }
+    }
+    frontier_start(&u->frontier, u->head);
+
+    // Path events and postings grow with history, so a memory budget moves them to disk;
+    // the interned path names and per-commit records stay in memory and are not covered by it
+    if (aggregation_memory_limit) {
+        agg_init(&u->builder.spilled, aggregation_memory_limit);
+        u->builder.spill = u->builder.spilled.memory_limit != 0;
+        if (u->builder.spill && get_temp_path(u->event_path, sizeof(u->event_path), "events") == 0) {
+            u->event_spill = fopen(u->event_path, "w+b");
+        }
+        if (u->builder.spill && !u->event_spill) {
+            fprintf(stderr, "❌ Cannot create path event spill file; keeping events in memory past --mem-limit\n");
+        }
+    }
+}
+
+static int history_update_on_commit(analyzer_t *self, const history_commit_t *c) 
+{
+    history_update_t *u = self->state;
+    long long *slot = frontier_visit(&u->frontier, c);
+    if (!slot) return 0;
+
+    if (u->commit_count == u->commit_capacity) {
+        u->commit_capacity = u->commit_capacity ? u->commit_capacity * 2 : 1024;
+        u->commits = realloc(u->commits, sizeof(new_commit_t) * u->commit_capacity);
+    }
+    new_commit_t *commit = &u->commits[u->commit_count++];
+    *slot = u->commit_count;
+    hex_to_oid(c->hash, commit->oid);
+    commit->epoch = c->epoch;
+    commit->first_event = u->event_count;
+    commit->event_count = 0;
+    commit->first_parent = u->parent_count;
+    commit->parent_count = 0;
+
+    size_t length = strlen(c->author) + strlen(c->subject) + 2;
+    if (u->text_length + length > u->text_capacity) {
+        u->text_capacity = (u->text_length + length) * 2;
+        u->text = realloc(u->text, u->text_capacity);
+    }
+    commit->text_offset = u->text_length;
+    snprintf(u->text + u->text_length, length, "%s\t%s", c->author, c->subject);
+    u->text_length += length;
+
+    for (const char *p = c->parents; strlen(p) >= 40; p += 41) {
+        unsigned char parent[20];
+        if (hex_to_oid(p, parent) != 0) break;
+        if (u->parent_count == u->parent_capacity) {
+            u->parent_capacity = u->parent_capacity ? u->parent_capacity * 2 : 1024;
+            u->parents = realloc(u->parents, 20 * (size_t)u->parent_capacity);
+        }
+        memcpy(u->parents[u->parent_count++], parent, 20);
+        commit->parent_count++;
+        if (p[40] != ' ') break;
+    }
+
+    if (u->frontier.pending == 0) self->active = 0;
+    return 1;
+}
+
+static void history_update_on_file_change(analyzer_t *self, const history_commit_t *c, const file_change_t *change) 
+{
+    history_update_t *u = self->state;
+    (void)c;
+    path_event_t event;
+    event.new_id = path_table_intern(&u->builder.paths, change->path);
+    event.old_id = change->old_path ? path_table_intern(&u->builder.paths, change->old_path) : -1;
+    if (u->event_spill) {
+        fwrite(&event, sizeof(event), 1, u->event_spill);
+    } else {
+        if (u->event_count == u->event_capacity) {
+            u->event_capacity = u->event_capacity ? u->event_capacity * 2 : 4096;
+            u->events = realloc(u->events, sizeof(path_event_t) * u->event_capacity);
+        }
+        u->events[u->event_count] = event;
+    }
+    u->event_count++;
+    u->commits[u->commit_count - 1].event_count++;
+}
+
+// Appends the new commits parents-first so positions stay topologically ordered.
+// Returns -1 if spilled events cannot be read back.
+static int append_new_commits(history_update_t *u) 
+{
+    uint32_t *stack = malloc(sizeof(uint32_t) * (u->commit_count + 1));
+    uint32_t *next_parent = calloc(u->commit_count + 1, sizeof(uint32_t));
+    unsigned char *state = calloc(u->commit_count + 1, 1);
+    path_event_t *spilled = NULL;
+    uint32_t spilled_capacity = 0;
+    int result = 0;
+
+    for (uint32_t root = u->commit_count; root-- > 0;) {
+        if (state[root]) continue;
+        uint32_t depth = 0;
+        stack[depth++] = root;
+        state[root] = 1;
+        while (depth > 0) {
+            uint32_t current = stack[depth - 1];
+            new_commit_t *commit = &u->commits[current];
+            if (next_parent[current] < commit->parent_count) {
+                long long *parent = oid_map_find(&u->frontier.walked, u->parents[commit->first_parent + next_parent[current]++]);
+                if (parent && *parent > 0 && !state[*parent - 1]) {
+                    state[*parent - 1] = 1;
+                    stack[depth++] = (uint32_t)(*parent - 1);
+                }
+                continue;
+            }
+
+            depth--;
+            history_add_commit(&u->builder, commit->oid, commit->epoch, u->text + commit->text_offset);
+            path_event_t *events = u->events;
+            if (!u->event_spill) {
+                events += commit->first_event;
+            } else if (commit->event_count > 0) {
+                if (commit->event_count > spilled_capacity) {
+                    spilled_capacity = commit->event_count;
+                    spilled = realloc(spilled, sizeof(path_event_t) * spilled_capacity);
+                }
+                fseek(u->event_spill, (long)(sizeof(path_event_t) * commit->first_event), SEEK_SET);
+                if (fread(spilled, sizeof(path_event_t), commit->event_count, u->event_spill) != commit->event_count) {
+                    result = -1;
+                    continue;
+                }
+                events = spilled;
+            }
+            for (uint32_t e = 0; e < commit->event_count; e++) {
+                path_event_t *event = &events[e];
+                if (event->old_id >= 0) {
+                    history_add_posting(&u->builder, event->old_id);
+                    history_add_rename(&u->builder, event->old_id, event->new_id);
+                }
+                history_add_posting(&u->builder, event->new_id);
+            }
+        }
+    }
+
+    free(stack);
+    free(next_parent);
+    free(state);
+    free(spilled);
+    return result;
+}
+
+static void history_update_finish(analyzer_t *self) 
+{
+    history_update_t *u = self->state;
+    if (u->result != 0 && u->frontier.pending == 0 && u->commit_count > 0 &&
+        !(u->event_spill && (fflush(u->event_spill) != 0 || ferror(u->event_spill))) && append_new_commits(u) == 0) {
+        u->result = write_history_index(u->path, u->head, &u->builder, u->incremental ? &u->old : NULL);
+    }
+    if (u->event_spill) {
+        fclose(u->event_spill);
+        remove(u->event_path);
+    }
+
+    if (u->have_old) unmap_file(&u->old.file);
+    free_history_builder(&u->builder);
+    frontier_free(&u->frontier);
+    free(u->commits);
+    free(u->parents);
+    free(u->events);
+    free(u->text);
+}
+
+// Keeps history.idx in step with HEAD by indexing only commits it has not seen
+analyzer_t history_index_analyzer(history_update_t *update) 
+{
+    analyzer_t analyzer = { "history-index", WALK_NEEDS_FILES, history_update_begin, history_update_on_commit,
+                            history_update_on_file_change, history_update_finish, update, 0 };
+    memset(update, 0, sizeof(*update));
+    return analyzer;
+}
+
+// Brings the rename-aware path history index up to date with HEAD and maps it
+int load_history_index(history_index_t *idx) 
+{
+    history_update_t update;
+    analyzer_t analyzer = history_index_analyzer(&update);
+    analyzer_t *analyzers[] = { &analyzer };
+    run_history_walk(analyzers, 1);
+    if (update.result != 0) return -1;
+    return open_history_index(update.path, idx);
+}
+
+// ==================== COMMIT GRAPH & BLOOM FILTERS ====================
+
+#define BLOOM_VERSION 1
+#define BLOOM_NUM_HASHES 7
+#define BLOOM_BITS_PER_ENTRY 10
+#define BLOOM_MAX_CHANGED_PATHS 512
+#define GRAPH_MAX_LAYERS 64
+
+uint32_t get_be32(const unsigned char *p) 
+{
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+}
+
+uint64_t get_be64(const unsigned char *p) 
+{
+    return ((uint64_t)get_be32(p) << 32) | get_be32(p + 4);
+}
+
+// One file of git's commit-graph (a single file, or one layer of a split chain)
+typedef struct {
+    mapped_file_t file;
+    uint32_t commit_count;
+    uint32_t base_count;
+    const unsigned char *fanout;
+    const unsigned char *oids;
+    const unsigned char *commit_data;
+    const unsigned char *extra_edges;
+    const unsigned char *bloom_index;
+    const unsigned char *bloom_data;
+    size_t bloom_data_size;
+} graph_layer_t;
+
+typedef struct {
+    graph_layer_t layers[GRAPH_MAX_LAYERS];
+    int layer_count;
+    uint32_t commit_count;
+    int has_bloom;
+    uint32_t bloom_hash_version;
+    uint32_t bloom_num_hashes;
+} commit_graph_t;
+
+static int open_graph_layer(const char *path, graph_layer_t *layer) 
+{
+    memset(layer, 0, sizeof(*layer));
+    if (map_file(path, &layer->file) != 0) return -1;
+    const unsigned char *data = layer->file.data;
+    size_t size = layer->file.size;
+
+    // "CGPH", version 1, SHA-1, chunk count, base graph count
+    if (size < 8 || memcmp(data, "CGPH", 4) != 0 || data[4] != 1 || data[5] != 1) {
+        unmap_file(&layer->file);
+        return -1;
+    }
+
+    int chunk_count = data[6];
+    if (size < 8 + 12 * ((size_t)chunk_count + 1)) {
+        unmap_file(&layer->file);
+        return -1;
+    }
+    for (int i = 0; i < chunk_count; i++) {
+        const unsigned char *entry = data + 8 + 12 * i;
+        uint32_t id = get_be32(entry);
+        uint64_t offset = get_be64(entry + 4), end = get_be64(entry + 16);
+        if (offset > size || end > size || end < offset) continue;
+        if (id == 0x4f494446) layer->fanout = data + offset;                  // OIDF
+        else if (id == 0x4f49444c) layer->oids = data + offset;               // OIDL
+        else if (id == 0x43444154) layer->commit_data = data + offset;        // CDAT
+        else if (id == 0x45444745) layer->extra_edges = data + offset;        // EDGE
+        else if (id == 0x42494458) layer->bloom_index = data + offset;        // BIDX
+        else if (id == 0x42444154 && end - offset >= 12) {                    // BDAT
+            layer->bloom_data = data + offset;
+            layer->bloom_data_size = end - offset;
+        }
+    }
+
+    if (!layer->fanout || !layer->oids || !layer->commit_data) {
+        unmap_file(&layer->file);
+        return -1;
+    }
+    layer->commit_count = get_be32(layer->fanout + 4 * 255);
+    return 0;
+}
+
+// Loads objects/info/commit-graph, or the split commit-graph chain, if git wrote one
+int open_commit_graph(commit_graph_t *graph) 
+{
+    memset(graph, 0, sizeof(*graph));
+    const char *git_dir = get_git_common_dir();
+    if (!git_dir) return -1;
+
+    char path[MAX_PATH_LENGTH * 2];
+    snprintf(path, sizeof(path), "%s/objects/info/commit-graph", git_dir);
+    if (open_graph_layer(path, &graph->layers[0]) == 0) {
+        graph->layer_count = 1;
+    } else {
+        snprintf(path, sizeof(path), "%s/objects/info/commit-graphs/commit-graph-chain", git_dir);
+        FILE *chain = fopen(path, "r");
+        if (!chain) return -1;
+        char hash[128];
+        while (graph->layer_count < GRAPH_MAX_LAYERS && fgets(hash, sizeof(hash), chain)) {
+            hash[strcspn(hash, "\r\n")] = '\0';
+            if (!hash[0]) continue;
+            snprintf(path, sizeof(path), "%s/objects/info/commit-graphs/graph-%s.graph", git_dir, hash);
+            if (open_graph_layer(path, &graph->layers[graph->layer_count]) != 0) break;
+            graph->layer_count++;
+        }
+        fclose(chain);
+        if (graph->layer_count == 0) return -1;
+    }
+
+    graph->has_bloom = 1;
+    for (int i = 0; i < graph->layer_count; i++) {
+        graph_layer_t *layer = &graph->layers[i];
+        layer->base_count = graph->commit_count;
+        graph->commit_count += layer->commit_count;
+        if (!layer->bloom_index || !layer->bloom_data) {
+            graph->has_bloom = 0;
+        } else if (i == 0) {
+            graph->bloom_hash_version = get_be32(layer->bloom_data);
+            graph->bloom_num_hashes = get_be32(layer->bloom_data + 4);
+        }
+    }
+    return 0;
+}
+
+void close_commit_graph(commit_graph_t *graph) 
+{
+    for (int i = 0; i < graph->layer_count; i++) unmap_file(&graph->layers[i].file);
+    graph->layer_count = 0;
+}
+
+// Commits in the commit-graph, an upper bound for progress on walks from HEAD; 0 without one
+long long estimate_commit_count() 
+{
+    commit_graph_t graph;
+    if (open_commit_graph(&graph) != 0) return 0;
+    long long count = graph.commit_count;
+    close_commit_graph(&graph);
+    return count;
+}
+
+// Global position of a commit across all layers, or -1 when the graph does not cover it
+long commit_graph_find(const commit_graph_t *graph, const unsigned char *oid) 
+{
+    for (int i = graph->layer_count - 1; i >= 0; i--) {
+        const graph_layer_t *layer = &graph->layers[i];
+        uint32_t lo = oid[0] ? get_be32(layer->fanout + 4 * (oid[0] - 1)) : 0;
+        uint32_t hi = get_be32(layer->fanout + 4 * oid[0]);
+        while (lo < hi) {
+            uint32_t mid = lo + (hi - lo) / 2;
+            int cmp = memcmp(layer->oids + 20 * (size_t)mid, oid, 20);
+            if (cmp == 0) return (long)(layer->base_count + mid);
+            if (cmp < 0) lo = mid + 1;
+            else hi = mid;
+        }
+    }
+    return -1;
+}
+
+const graph_layer_t* commit_graph_layer(const commit_graph_t *graph, uint32_t position, uint32_t *local) 
+{
+    for (int i = graph->layer_count - 1; i >= 0; i--) {
+        if (position >= graph->layers[i].base_count) {
+            *local = position - graph->layers[i].base_count;
+            return &graph->layers[i];
+        }
+    }
+    return NULL;
+}
+
+// CDAT packs a 30-bit generation number over a 34-bit commit time
+long long commit_graph_commit_time(const commit_graph_t *graph, uint32_t position) 
+{
+    uint32_t local;
+    const graph_layer_t *layer = commit_graph_layer(graph, position, &local);
+    if (!layer) return 0;
+    const unsigned char *entry = layer->commit_data + 36 * (size_t)local;
+    return ((long long)(get_be32(entry + 28) & 3) << 32) | get_be32(entry + 32);
+}
+
+// git's murmur3 variant; hash version 1 sign-extends bytes above 0x7f, version 2 does not
+static uint32_t bloom_murmur3(uint32_t seed, const char *data, size_t length, int signed_bytes) 
+{
+    const uint32_t c1 = 0xcc9e2d51, c2 = 0x1b873593;
+    size_t blocks = length / 4;
+    #define BLOOM_BYTE(i) (signed_bytes ? (uint32_t)(int32_t)(signed char)data[i] : (uint32_t)(unsigned char)data[i])
+    #define BLOOM_ROTL(x, r) (((x) << (r)) | ((x) >> (32 - (r))))
+
+    for (size_t i = 0; i < blocks; i++) {
+        uint32_t k = BLOOM_BYTE(4*i) | (BLOOM_BYTE(4*i + 1) << 8) | (BLOOM_BYTE(4*i + 2) << 16) | (BLOOM_BYTE(4*i + 3) << 24);
+        k *= c1;
+        k = BLOOM_ROTL(k, 15);
+        k *= c2;
+        seed ^= k;
+        seed = BLOOM_ROTL(seed, 13) * 5 + 0xe6546b64;
+    }
+
+    uint32_t k1 = 0;
+    size_t tail = blocks * 4;
+    switch (length & 3) {
+    case 3: k1 ^= BLOOM_BYTE(tail + 2) << 16; /* fall through */
+    case 2: k1 ^= BLOOM_BYTE(tail + 1) << 8;  /* fall through */
+    case 1:
+        k1 ^= BLOOM_BYTE(tail);
+        k1 *= c1;
+        k1 = BLOOM_ROTL(k1, 15);
+        k1 *= c2;
+        seed ^= k1;
+    }
+    #undef BLOOM_BYTE
+    #undef BLOOM_ROTL
+
+    seed ^= (uint32_t)length;
+    seed ^= seed >> 16;
+    seed *= 0x85ebca6b;
+    seed ^= seed >> 13;
+    seed *= 0xc2b2ae35;
+    seed ^= seed >> 16;
+    return seed;
+}
+
+typedef struct {
+    uint32_t hashes[16];
+    int count;
+} bloom_key_t;
+
+void bloom_key_init(bloom_key_t *key, const char *path, size_t length, uint32_t num_hashes, int hash_version) 
+{
+    uint32_t hash0 = bloom_murmur3(0x293ae76f, path, length, hash_version == 1);
+    uint32_t hash1 = bloom_murmur3(0x7e646e2c, path, length, hash_version == 1);
+    key->count = num_hashes < 16 ? (int)num_hashes : 16;
+    for (int i = 0; i < key->count; i++) key->hashes[i] = hash0 + (uint32_t)i * hash1;
+}
+
+// Like git, a query for a/b/c also requires a/b and a to be present, which cuts false positives
+#define BLOOM_MAX_KEYS 32
+
+typedef struct {
+    bloom_key_t keys[BLOOM_MAX_KEYS];
+    int count;
+} bloom_keyvec_t;
+
+void bloom_keyvec_init(bloom_keyvec_t *vec, const char *path, uint32_t num_hashes, int hash_version) 
+{
+    vec->count = 0;
+    size_t length = strlen(path);
+    while (length > 0 && vec->count < BLOOM_MAX_KEYS) {
+        bloom_key_init(&vec->keys[vec->count++], path, length, num_hashes, hash_version);
+        while (length > 0 && path[length - 1] != '/') length--;
+        if (length > 0) length--;
+    }
+}
+
+// 0 = definitely not in the filter, 1 = maybe (an empty filter tells us nothing)
+int bloom_filter_contains(const unsigned char *filter, size_t length, const bloom_key_t *key) 
+{
+    uint64_t bits = (uint64_t)length * 8;
+    if (bits == 0) return 1;
+    for (int i = 0; i < key->count; i++) {
+        uint64_t bit = key->hashes[i] % bits;
+        if (!(filter[bit / 8] & (1u << (bit % 8)))) return 0;
+    }
+    return 1;
+}
+
+int bloom_filter_contains_all(const unsigned char *filter, size_t length, const bloom_keyvec_t *vec) 
+{
+    for (int i = 0; i < vec->count; i++) {
+        if (!bloom_filter_contains(filter, length, &vec->keys[i])) return 0;
+    }
+    return 1;
+}
+
+void bloom_filter_add(unsigned char *filter, size_t length, const bloom_key_t *key) 
+{
+    uint64_t bits = (uint64_t)length * 8;
+    for (int i = 0; i < key->count; i++) {
+        uint64_t bit = key->hashes[i] % bits;
+        filter[bit / 8] |= (unsigned char)(1u << (bit % 8));
+    }
+}
+
+int commit_graph_bloom_filter(const commit_graph_t *graph, uint32_t position, const unsigned char **filter, size_t *length) 
+{
+    uint32_t local;
+    const graph_layer_t *layer = commit_graph_layer(graph, position, &local);
+    if (!layer || !layer->bloom_index) return -1;
+    uint32_t start = local ? get_be32(layer->bloom_index + 4 * (size_t)(local - 1)) : 0;
+    uint32_t end = get_be32(layer->bloom_index + 4 * (size_t)local);
+    if (end < start || 12 + (size_t)end > layer->bloom_data_size) return -1;
+    *filter = layer->bloom_data + 12 + start;
+    *length = end - start;
+    return 0;
+}
+
+// gitsmart's own filters (bloom.idx) for repositories whose commit-graph has none:
+// header, oids sorted for binary search, cumulative filter ends, filter bytes
+typedef struct {
+    char magic[4];
+    uint32_t version;
+    char head[40];
+    uint32_t commit_count;
+    uint32_t num_hashes;
+    uint32_t bits_per_entry;
+    uint32_t data_bytes;
+} bloom_header_t;
+
+typedef struct {
+    mapped_file_t file;
+    const bloom_header_t *header;
+    const unsigned char *oids;
+    const uint32_t *ends;
+    const unsigned char *data;
+} bloom_index_t;
+
+int open_bloom_index(const char *path, bloom_index_t *idx) 
+{
+    memset(idx, 0, sizeof(*idx));
+    if (map_file(path, &idx->file) != 0) return -1;
+    const bloom_header_t *h = (const bloom_header_t *)idx->file.data;
+    size_t n = idx->file.size >= sizeof(*h) ? h->commit_count : 0;
+    if (idx->file.size < sizeof(*h) || memcmp(h->magic, "GSBF", 4) != 0 || h->version != BLOOM_VERSION ||
+        idx->file.size != sizeof(*h) + align4(20 * n) + 4 * n + h->data_bytes) {
+        unmap_file(&idx->file);
+        return -1;
+    }
+    idx->header = h;
+    idx->oids = idx->file.data + sizeof(*h);
+    idx->ends = (const uint32_t *)(idx->oids + align4(20 * n));
+    idx->data = (const unsigned char *)(idx->ends + n);
+    return 0;
+}
+
+long bloom_index_find(const bloom_index_t *idx, const unsigned char *oid) 
+{
+    uint32_t lo = 0, hi = idx->header->commit_count;
+    while (lo < hi) {
+        uint32_t mid = lo + (hi - lo) / 2;
+        int cmp = memcmp(idx->oids + 20 * (size_t)mid, oid, 20);
+        if (cmp == 0) return (long)mid;
+        if (cmp < 0) lo = mid + 1;
+        else hi = mid;
+    }
+    return -1;
+}
+
+typedef struct {
+    unsigned char oid[20];
+    uint32_t offset;
+    uint32_t length;
+} bloom_entry_t;
+
+typedef struct {
+    char path[MAX_PATH_LENGTH];
+    char head[41];
+    bloom_index_t old;
+    int have_old;
+    int started;                // begin found HEAD and the cache path; only then is there anything to write
+    int result;
+    walk_frontier_t frontier;
+    bloom_entry_t *entries;
+    uint32_t entry_count, entry_capacity;
+    unsigned char *data;
+    size_t data_length, data_capacity;
+    path_table_t keys;
+} bloom_update_t;
+
+static void bloom_update_begin(analyzer_t *self) 
+{
+    bloom_update_t *u = self->state;
+    u->result = -1;
+    if (get_head_oid(u->head) != 0 || get_cache_path(u->path, sizeof(u->path), "bloom.idx") != 0) {
+        self->active = 0;
+        return;
+    }
+    u->started = 1;
+
+    u->have_old = open_bloom_index(u->path, &u->old) == 0;
+    if (u->have_old && memcmp(u->old.header->head, u->head, 40) == 0) {
+        u->result = 0;
+        self->active = 0;
+        return;
+    }
+
+    // Filters are per commit and never change, so existing ones stay valid even after a rewrite
+    if (u->have_old) {
+        for (uint32_t i = 0; i < u->old.header->commit_count; i++) {
+            oid_map_insert(&u->frontier.known, u->old.oids + 20 * (size_t)i, NULL);
+        }
+    }
+    frontier_start(&u->frontier, u->head);
+    if (u->frontier.pending == 0) self->active = 0;
+}
+
+static void bloom_add_key(bloom_update_t *u, const char *path) 
+{
+    // A path also "touches" each of its leading directories
+    char prefix[MAX_PATH_LENGTH * 2];
+    snprintf(prefix, sizeof(prefix), "%s", path);
+    for (char *slash = strchr(prefix, '/'); slash; slash = strchr(slash + 1, '/')) {
+        *slash = '\0';
+        path_table_intern(&u->keys, prefix);
+        *slash = '/';
+    }
+    path_table_intern(&u->keys, prefix);
+}
+
+static void bloom_finish_entry(bloom_update_t *u) 
+{
+    if (u->entry_count == 0) return;
+    bloom_entry_t *entry = &u->entries[u->entry_count - 1];
+    size_t length;
+    if (u->keys.count > BLOOM_MAX_CHANGED_PATHS) {
+        length = 1;
+    } else {
+        length = ((size_t)u->keys.count * BLOOM_BITS_PER_ENTRY + 7) / 8;
+    }
+
+    if (u->data_length + length > u->data_capacity) {
+        u->data_capacity = (u->data_length + length) * 2 + 4096;
+        u->data = realloc(u->data, u->data_capacity);
+    }
+    unsigned char *filter = u->data + u->data_length;
+    memset(filter, u->keys.count > BLOOM_MAX_CHANGED_PATHS ? 0xff : 0, length);
+    if (u->keys.count <= BLOOM_MAX_CHANGED_PATHS) {
+        for (int i = 0; i < u->keys.count; i++) {
+            bloom_key_t key;
+            bloom_key_init(&key, u->keys.names[i], strlen(u->keys.names[i]), BLOOM_NUM_HASHES, 2);
+            bloom_filter_add(filter, length, &key);
+        }
+    }
+    entry->offset = (uint32_t)u->data_length;
+    entry->length = (uint32_t)length;
+    u->data_length += length;
+    path_table_free(&u->keys);
+}
+
+static int bloom_update_on_commit(analyzer_t *self, const history_commit_t *c) 
+{
+    bloom_update_t *u = self->state;
+    bloom_finish_entry(u);
+    long long *slot = frontier_visit(&u->frontier, c);
+    if (!slot) {
+        if (u->frontier.pending == 0) self->active = 0;
+        return 0;
+    }
+    *slot = 1;
+
+    if (u->entry_count == u->entry_capacity) {
+        u->entry_capacity = u->entry_capacity ? u->entry_capacity * 2 : 1024;
+        u->entries = realloc(u->entries, sizeof(bloom_entry_t) * u->entry_capacity);
+    }
+    hex_to_oid(c->hash, u->entries[u->entry_count++].oid);
+    if (u->frontier.pending == 0) self->active = 0;
+    return 1;
+}
+
+static void bloom_update_on_file_change(analyzer_t *self, const history_commit_t *c, const file_change_t *change) 
+{
+    bloom_update_t *u = self->state;
+    (void)c;
+    bloom_add_key(u, change->path);
+    if (change->old_path) bloom_add_key(u, change->old_path);
+}
+
+static int compare_bloom_entries(const void *a, const void *b) 
+{
+    return memcmp(((const bloom_entry_t *)a)->oid, ((const bloom_entry_t *)b)->oid, 20);
+}
+
+static int write_bloom_index(bloom_update_t *u) 
+{
+    char tmp_path[MAX_PATH_LENGTH + 64];
+    FILE *fp = begin_index_file(u->path, tmp_path, sizeof(tmp_path));
+    if (!fp) return -1;
+
+    if (u->entry_count > 0) qsort(u->entries, u->entry_count, sizeof(bloom_entry_t), compare_bloom_entries);
+    uint32_t old_count = u->have_old ? u->old.header->commit_count : 0;
+    uint32_t total = old_count + u->entry_count;
+
+    bloom_header_t h;
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, "GSBF", 4);
+    h.version = BLOOM_VERSION;
+    memcpy(h.head, u->head, 40);
+    h.commit_count = total;
+    h.num_hashes = BLOOM_NUM_HASHES;
+    h.bits_per_entry = BLOOM_BITS_PER_ENTRY;
+    h.data_bytes = (uint32_t)((u->have_old ? u->old.header->data_bytes : 0) + u->data_length);
+
+    // Merge the old and new oid-sorted runs; filter bytes follow the same order
+    uint32_t *order = malloc(sizeof(uint32_t) * (total + 1));
+    uint32_t i = 0, j = 0, k = 0;
+    while (i < old_count || j < u->entry_count) {
+        if (j == u->entry_count || (i < old_count && memcmp(u->old.oids + 20 * (size_t)i, u->entries[j].oid, 20) < 0)) {
+            order[k++] = i++;
+        } else {
+            order[k++] = old_count + j++;
+        }
+    }
+
+    static const char padding[4] = {0};
+    fwrite(&h, sizeof(h), 1, fp);
+    for (k = 0; k < total; k++) {
+        fwrite(order[k] < old_count ? u->old.oids + 20 * (size_t)order[k] : u->entries[order[k] - old_count].oid, 20, 1, fp);
+    }
+    fwrite(padding, 1, align4(20 * (size_t)total) - 20 * (size_t)total, fp);
+    uint32_t end = 0;
+    for (k = 0; k < total; k++) {
+        if (order[k] < old_count) {
+            end += u->old.ends[order[k]] - (order[k] ? u->old.ends[order[k] - 1] : 0);
+        } else {
+            end += u->entries[order[k] - old_count].length;
+        }
+        fwrite(&end, sizeof(uint32_t), 1, fp);
+    }
+    for (k = 0; k < total; k++) {
+        if (order[k] < old_count) {
+            uint32_t start = order[k] ? u->old.ends[order[k] - 1] : 0;
+            fwrite(u->old.data + start, 1, u->old.ends[order[k]] - start, fp);
+        } else {
+            const bloom_entry_t *entry = &u->entries[order[k] - old_count];
+            fwrite(u->data + entry->offset, 1, entry->length, fp);
+        }
+    }
+    free(order);
+    return finish_index_file(fp, tmp_path, u->path);
+}
+
+static void bloom_update_finish(analyzer_t *self) 
+{
+    bloom_update_t *u = self->state;
+    bloom_finish_entry(u);
+    if (u->started && u->result != 0 && u->frontier.pending == 0) {
+        u->result = write_bloom_index(u);
+    }
+    if (u->have_old) unmap_file(&u->old.file);
+    frontier_free(&u->frontier);
+    path_table_free(&u->keys);
+    free(u->entries);
+    free(u->data);
+}
+
+analyzer_t bloom_index_analyzer(bloom_update_t *update) 
+{
+    analyzer_t analyzer = { "bloom-index", WALK_NEEDS_FILES, bloom_update_begin, bloom_update_on_commit,
+                            bloom_update_on_file_change, bloom_update_finish, update, 0 };
+    memset(update, 0, sizeof(*update));
+    return analyzer;
+}
+
+typedef struct {
+    int scanned;
+    int skipped;
+    int verified;
+    int false_positives;
+    const char *source;
+} path_walk_stats_t;
+
+// Keeps the candidate commits for which `git diff-tree` confirms a change under `path`
+static int verify_path_candidates(const char *path, char (*candidates)[41], int count,
+                                  char (**found)[41], int *found_count, int *found_capacity) 
+{
+    char list_path[MAX_PATH_LENGTH + 64];
+    if (get_temp_path(list_path, sizeof(list_path), "candidates") != 0) return -1;
+    FILE *list = fopen(list_path, "w");
+    if (!list) return -1;
+    for (int i = 0; i < count; i++) fprintf(list, "%s\n", candidates[i]);
+    fclose(list);
+
+    char quoted[MAX_PATH_LENGTH * 4];
+    FILE *fp = NULL;
+    if (shell_quote(path, quoted, sizeof(quoted))) {
+        fp = open_git_stream("git diff-tree --stdin --root -r --name-only -- %s < \"%s\"", quoted, list_path);
+    }
+    int confirmed = 0;
+    if (fp) {
+        char *line = NULL;
+        size_t capacity = 0;
+        while (read_stream_line(fp, &line, &capacity) >= 0) {
+            unsigned char oid[20];
+            if (strlen(line) != 40 || hex_to_oid(line, oid) != 0) continue;
+            if (*found_count == *found_capacity) {
+                *found_capacity = *found_capacity ? *found_capacity * 2 : 64;
+                *found = realloc(*found, 41 * (size_t)*found_capacity);
+            }
+            strcpy((*found)[(*found_count)++], line);
+            confirmed++;
+        }
+        free(line);
+        pclose(fp);
+    }
+    remove(list_path);
+    return confirmed;
+}
+
+// Lists the non-merge commits (newest first, up to `limit`, 0 for all) that changed `path`
+// or anything below it. Changed-path Bloom filters, from git's commit-graph or gitsmart's
+// own cache, rule out most commits before a single diff is computed.
+int bloom_path_history(const char *path, int limit, char (**commits)[41], path_walk_stats_t *stats) 
+{
+    memset(stats, 0, sizeof(*stats));
+    *commits = NULL;
+
+    char key_path[MAX_PATH_LENGTH];
+    snprintf(key_path, sizeof(key_path), "%s", path);
+    size_t key_length = strlen(key_path);
+    while (key_length > 0 && key_path[key_length - 1] == '/') key_path[--key_length] = '\0';
+
+    commit_graph_t graph;
+    bloom_index_t own;
+    int have_graph = open_commit_graph(&graph) == 0 && graph.has_bloom;
+    int have_own = 0;
+    bloom_keyvec_t graph_keys, own_keys;
+    if (have_graph) {
+        bloom_keyvec_init(&graph_keys, key_path, graph.bloom_num_hashes, graph.bloom_hash_version);
+        stats->source = "commit-graph";
+    }
+
+    char bloom_path[MAX_PATH_LENGTH];
+    if (!have_graph && get_cache_path(bloom_path, sizeof(bloom_path), "bloom.idx") == 0) {
+        bloom_update_t update;
+        analyzer_t analyzer = bloom_index_analyzer(&update);
+        analyzer_t *analyzers[] = { &analyzer };
+        run_history_walk(analyzers, 1);
+        have_own = update.result == 0 && open_bloom_index(bloom_path, &own) == 0;
+        if (have_own) {
+            bloom_keyvec_init(&own_keys, key_path, own.header->num_hashes, 2);
+            stats->source = "gitsmart cache";
+        }
+    }
+    if (!stats->source) stats->source = "none";
+
+    FILE *revs = open_git_stream("git rev-list --no-merges HEAD");
+    if (!revs) {
+        if (have_graph) close_commit_graph(&graph);
+        if (have_own) unmap_file(&own.file);
+        return -1;
+    }
+
+    char (*candidates)[41] = malloc(41 * 256);
+    int candidate_count = 0, found_count = 0, found_capacity = 0;
+    char *line = NULL;
+    size_t capacity = 0;
+    while (read_stream_line(revs, &line, &capacity) >= 0) {
+        unsigned char oid[20];
+        if (strlen(line) != 40 || hex_to_oid(line, oid) != 0) continue;
+        stats->scanned++;
+
+        int maybe = 1;
+        const unsigned char *filter;
+        size_t filter_length;
+        long position;
+        if (have_graph && (position = commit_graph_find(&graph, oid)) >= 0 &&
+            commit_graph_bloom_filter(&graph, (uint32_t)position, &filter, &filter_length) == 0) {
+            maybe = bloom_filter_contains_all(filter, filter_length, &graph_keys);
+        } else if (have_own && (position = bloom_index_find(&own, oid)) >= 0) {
+            uint32_t start = position ? own.ends[position - 1] : 0;
+            maybe = bloom_filter_contains_all(own.data + start, own.ends[position] - start, &own_keys);
+        }
+        if (!maybe) {
+            stats->skipped++;
+            continue;
+        }
+
+        strcpy(candidates[candidate_count++], line);
+        if (candidate_count == 256) {
+            stats->verified += candidate_count;
+            stats->false_positives += candidate_count - verify_path_candidates(key_path, candidates, candidate_count, commits, &found_count, &found_capacity);
+            candidate_count = 0;
+            if (limit > 0 && found_count >= limit) break;
+        }
+    }
+    if (candidate_count > 0 && (limit == 0 || found_count < limit)) {
+        stats->verified += candidate_count;
+        stats->false_positives += candidate_count - verify_path_candidates(key_path, candidates, candidate_count, commits, &found_count, &found_capacity);
+    }
+
+    pclose(revs);
+    free(line);
+    free(candidates);
+    if (have_graph) close_commit_graph(&graph);
+    if (have_own) unmap_file(&own.file);
+    if (limit > 0 && found_count > limit) found_count = limit;
+    return found_count;
+}
+
+// ==================== REF ENUMERATION ====================
+
+// One ref: full name, target commit and committer time (0 when unknown)
+typedef struct {
+    char *name;
+    char oid[41];
+    long long epoch;
+} ref_record_t;
+
+typedef struct {
+    ref_record_t *refs;
+    int count;
+    int capacity;
+} ref_list_t;
+
+// Return non-zero to stop the enumeration
+typedef int (*ref_callback_t)(const ref_record_t *ref, void *context);
+
+static void ref_list_add(ref_list_t *list, const char *name, const char *oid) 
+{
+    if (list->count == list->capacity) {
+        list->capacity = list->capacity ? list->capacity * 2 : 256;
+        list->refs = realloc(list->refs, sizeof(ref_record_t) * list->capacity);
+    }
+    ref_record_t *ref = &list->refs[list->count++];
+    ref->name = strdup(name);
+    memcpy(ref->oid, oid, 40);
+    ref->oid[40] = '\0';
+    ref->epoch = 0;
+}
+
+void free_ref_list(ref_list_t *list) 
+{
+    for (int i = 0; i < list->count; i++) free(list->refs[i].name);
+    free(list->refs);
+    memset(list, 0, sizeof(*list));
+}
+
+static int compare_ref_names(const void *a, const void *b) 
+{
+    return strcmp(((const ref_record_t *)a)->name, ((const ref_record_t *)b)->name);
+}
+
+// Loose ref files under <common-dir>/<directory>; symbolic refs (origin/HEAD) are skipped
+static void collect_loose_refs(const char *directory, const char *prefix, ref_list_t *list) 
+{
+    char path[MAX_PATH_LENGTH * 2];
+    snprintf(path, sizeof(path), "%s/%s", repo.common_dir, directory);
+
+    #ifdef _WIN32
+    char pattern[MAX_PATH_LENGTH * 2 + 4];
+    snprintf(pattern, sizeof(pattern), "%s/*", path);
+    WIN32_FIND_DATAA entry;
+    HANDLE find = FindFirstFileA(pattern, &entry);
+    if (find == INVALID_HANDLE_VALUE) return;
+    do {
+        const char *name = entry.cFileName;
+        int is_dir = (entry.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) != 0;
+    #else
+    DIR *dir = opendir(path);
+    if (!dir) return;
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL) {
+        const char *name = entry->d_name;
+        char child_path[MAX_PATH_LENGTH * 3];
+        snprintf(child_path, sizeof(child_path), "%s/%s", path, name);
+        int is_dir = is_directory(child_path);
+    #endif
+        if (name[0] == '.') continue;
+        char ref_name[MAX_PATH_LENGTH];
+        snprintf(ref_name, sizeof(ref_name), "%s/%s", directory, name);
+        if (is_dir) {
+            collect_loose_refs(ref_name, prefix, list);
+            continue;
+        }
+        if (strncmp(ref_name, prefix, strlen(prefix)) != 0) continue;
+
+        char file_path[MAX_PATH_LENGTH * 2], line[128];
+        unsigned char oid[20];
+        snprintf(file_path, sizeof(file_path), "%s/%s", repo.common_dir, ref_name);
+        if (read_first_line(file_path, line, sizeof(line)) == 0 && strlen(line) >= 40 && hex_to_oid(line, oid) == 0) {
+            ref_list_add(list, ref_name, line);
+        }
+    #ifdef _WIN32
+    } while (FindNextFileA(find, &entry));
+    FindClose(find);
+    #else
+    }
+    closedir(dir);
+    #endif
+}
+
+static int packed_refs_sorted(const unsigned char *line, const unsigned char *eol) 
+{
+    char header[512];
+    snprintf(header, sizeof(header), "%.*s", (int)(eol - line), (const char *)line);
+    return strstr(header, " sorted") != NULL;
+}
+
+// Start of the line that contains `p` in a packed-refs buffer
+static const unsigned char* packed_line_start(const unsigned char *start, const unsigned char *p) 
+{
+    while (p > start && p[-1] != '\n') p--;
+    return p;
+}
+
+// First record line whose name sorts at or after `prefix` (packed-refs sorted by name)
+static const unsigned char* packed_refs_seek(const unsigned char *start, const unsigned char *end, const char *prefix) 
+{
+    size_t prefix_length = strlen(prefix);
+    const unsigned char *lo = start, *hi = end;
+    while (lo < hi) {
+        const unsigned char *line = packed_line_start(start, lo + (hi - lo) / 2);
+        // Peeled "^oid" lines belong to the record above them
+        while (line > start && line[0] == '^') line = packed_line_start(start, line - 1);
+        const unsigned char *next = memchr(line, '\n', end - line);
+        next = next ? next + 1 : end;
+
+        int cmp = 1;
+        if (line[0] != '#' && end - line > 41) {
+            const unsigned char *name = line + 41;
+            const unsigned char *name_end = memchr(name, '\n', end - name);
+            size_t name_length = (name_end ? name_end : end) - name;
+            cmp = memcmp(name, prefix, name_length < prefix_length ? name_length : prefix_length);
+            if (cmp == 0 && name_length < prefix_length) cmp = -1;
+            if (cmp == 0) cmp = 1;   // a match: keep looking to the left
+        } else {
+            cmp = -1;   // header line
+        }
+
+        if (cmp < 0) {
+            lo = next;
+            while (lo < end && lo[0] == '^') {
+                const unsigned char *skip = memchr(lo, '\n', end - lo);
+                lo = skip ? skip + 1 : end;
+            }
+        } else {
+            hi = line;
+        }
+    }
+    return lo;
+}
+
+// Streams every ref under `prefix` in name order, loose refs overriding packed ones
+int for_each_ref(const char *prefix, ref_callback_t callback, void *context) 
+{
+    if (discover_repository() != 0 || repo.reftable) return -1;
+
+    ref_list_t loose = {0};
+    char directory[MAX_PATH_LENGTH];
+    snprintf(directory, sizeof(directory), "%s", prefix);
+    char *slash = strrchr(directory, '/');
+    if (slash) *slash = '\0';
+    collect_loose_refs(directory[0] ? directory : "refs", prefix, &loose);
+    if (loose.count > 0) qsort(loose.refs, loose.count, sizeof(ref_record_t), compare_ref_names);
+
+    char path[MAX_PATH_LENGTH + 16];
+    mapped_file_t packed = {0};
+    snprintf(path, sizeof(path), "%s/packed-refs", repo.common_dir);
+    ref_list_t unsorted_packed = {0};
+    const unsigned char *p = NULL, *end = NULL;
+    if (map_file(path, &packed) == 0) {
+        p = packed.data;
+        end = packed.data + packed.size;
+        const unsigned char *eol = memchr(p, '\n', end - p);
+        int sorted = p[0] == '#' && eol && packed_refs_sorted(p, eol);
+        if (sorted) {
+            p = packed_refs_seek(packed.data, end, prefix);
+        } else {
+            // Old files carry no sort guarantee: read them whole and sort
+            for (const unsigned char *line = p; line < end; ) {
+                const unsigned char *next = memchr(line, '\n', end - line);
+                next = next ? next : end;
+                if (line[0] != '#' && line[0] != '^' && next - line > 41) {
+                    char name[MAX_PATH_LENGTH];
+                    snprintf(name, sizeof(name), "%.*s", (int)(next - line - 41), (const char *)line + 41);
+                    name[strcspn(name, "\r")] = '\0';
+                    if (strncmp(name, prefix, strlen(prefix)) == 0) ref_list_add(&unsorted_packed, name, (const char *)line);
+                }
+                line = next < end ? next + 1 : end;
+            }
+            qsort(unsorted_packed.refs, unsorted_packed.count, sizeof(ref_record_t), compare_ref_names);
+            p = end;
+        }
+    }
+
+    size_t prefix_length = strlen(prefix);
+    int li = 0, ui = 0, stop = 0;
+    ref_record_t packed_ref = {0};
+    char packed_name[MAX_PATH_LENGTH];
+    int have_packed = 0;
+    while (!stop) {
+        // Next packed record, from the mapped file or the sorted fallback list
+        if (!have_packed) {
+            if (ui < unsorted_packed.count) {
+                packed_ref = unsorted_packed.refs[ui++];
+                have_packed = 1;
+            }
+            while (!have_packed && p && p < end) {
+                const unsigned char *next = memchr(p, '\n', end - p);
+                next = next ? next : end;
+                const unsigned char *line = p;
+                p = next < end ? next + 1 : end;
+                if (line[0] == '#' || line[0] == '^' || next - line <= 41) continue;
+                snprintf(packed_name, sizeof(packed_name), "%.*s", (int)(next - line - 41), (const char *)line + 41);
+                packed_name[strcspn(packed_name, "\r")] = '\0';
+                if (strncmp(packed_name, prefix, prefix_length) != 0) {
+                    p = end;   // sorted: past the prefix range
+                    break;
+                }
+                packed_ref.name = packed_name;
+                memcpy(packed_ref.oid, line, 40);
+                packed_ref.oid[40] = '\0';
+                have_packed = 1;
+            }
+        }
+
+        const ref_record_t *next_ref;
+        if (li < loose.count && have_packed) {
+            int cmp = strcmp(loose.refs[li].name, packed_ref.name);
+            if (cmp <= 0) {
+                next_ref = &loose.refs[li++];
+                if (cmp == 0) have_packed = 0;
+            } else {
+                next_ref = &packed_ref;
+                have_packed = 0;
+            }
+        } else if (li < loose.count) {
+            next_ref = &loose.refs[li++];
+        } else if (have_packed) {
+            next_ref = &packed_ref;
+            have_packed = 0;
+        } else {
+            break;
+        }
+        stop = callback(next_ref, context);
+    }
+
+    free_ref_list(&loose);
+    free_ref_list(&unsorted_packed);
+    unmap_file(&packed);
+    return 0;
+}
+
+static int collect_ref(const ref_record_t *ref, void *context) 
+{
+    ref_list_add(context, ref->name, ref->oid);
+    return 0;
+}
+
+// Committer times from the commit-graph, and one `git log --no-walk` for anything it lacks
+static void fill_ref_epochs(ref_list_t *list) 
+{
+    commit_graph_t graph;
+    int have_graph = open_commit_graph(&graph) == 0;
+    oid_map_t missing = {0};
+    for (int i = 0; i < list->count; i++) {
+        unsigned char oid[20];
+        if (hex_to_oid(list->refs[i].oid, oid) != 0) continue;
+        long position = have_graph ? commit_graph_find(&graph, oid) : -1;
+        if (position >= 0) list->refs[i].epoch = commit_graph_commit_time(&graph, (uint32_t)position);
+        else oid_map_insert(&missing, oid, NULL);
+    }
+    if (have_graph) close_commit_graph(&graph);
+
+    char list_path[MAX_PATH_LENGTH + 64];
+    if (missing.count > 0 && get_temp_path(list_path, sizeof(list_path), "refs") == 0) {
+        FILE *fp = fopen(list_path, "w");
+        if (fp) {
+            for (size_t i = 0; i < missing.capacity; i++) {
+                if (!missing.entries[i].used) continue;
+                char hex[41];
+                oid_to_hex(missing.entries[i].oid, hex);
+                fprintf(fp, "%s\n", hex);
+            }
+            fclose(fp);
+            fp = open_git_stream("git log --no-walk=unsorted --stdin --format=\"%%H %%ct\" < \"%s\" 2>" NULL_DEVICE, list_path);
+            char *line = NULL;
+            size_t capacity = 0;
+            while (fp && read_stream_line(fp, &line, &capacity) >= 0) {
+                unsigned char oid[20];
+                long long *epoch;
+                if (strlen(line) > 41 && hex_to_oid(line, oid) == 0 && (epoch = oid_map_find(&missing, oid))) {
+                    *epoch = atoll(line + 41);
+                }
+            }
+            free(line);
+            if (fp) pclose(fp);
+            remove(list_path);
+        }
+        for (int i = 0; i < list->count; i++) {
+            unsigned char oid[20];
+            long long *epoch;
+            if (!list->refs[i].epoch && hex_to_oid(list->refs[i].oid, oid) == 0 && (epoch = oid_map_find(&missing, oid))) {
+                list->refs[i].epoch = *epoch;
+            }
+        }
+    }
+    oid_map_free(&missing);
+}
+
+// All refs under `prefix`, sorted by name, with committer times
+int load_refs(const char *prefix, ref_list_t *list) 
+{
+    memset(list, 0, sizeof(*list));
+    if (for_each_ref(prefix, collect_ref, list) != 0) {
+        // Reftable and other backends: let git enumerate
+        FILE *fp = open_git_stream("git for-each-ref --format=\"%%(objectname) %%(refname)\" \"%s\"", prefix);
+        char *line = NULL;
+        size_t capacity = 0;
+        while (fp && read_stream_line(fp, &line, &capacity) >= 0) {
+            if (strlen(line) > 41) ref_list_add(list, line + 41, line);
+        }
+        free(line);
+        if (fp) pclose(fp);
+        qsort(list->refs, list->count, sizeof(ref_record_t), compare_ref_names);
+    }
+    fill_ref_epochs(list);
+    return list->count;
+}
+
+const ref_record_t* find_ref(const ref_list_t *list, const char *name) 
+{
+    ref_record_t key;
+    key.name = (char *)name;
+    return bsearch(&key, list->refs, list->count, sizeof(ref_record_t), compare_ref_names);
+}
+
+// ==================== OBJECT STORE ====================
+
+// Reads objects straight from packs (.idx v2) and loose files, so commit metadata and blob
+// contents need no git process. Not thread-safe: the delta-base cache is shared.
+#define OBJ_COMMIT 1
+#define OBJ_TREE 2
+#define OBJ_BLOB 3
+#define OBJ_TAG 4
+#define OBJ_OFS_DELTA 6
+#define OBJ_REF_DELTA 7
+#define MAX_OBJECT_DIRS 8
+#define DELTA_CACHE_SLOTS 256
+#define DELTA_CACHE_BYTES (64 << 20)
+
+typedef struct {
+    mapped_file_t idx, pack;
+    uint32_t count;
+    const unsigned char *fanout, *oids, *offsets, *large_offsets;
+    size_t large_count;
+} pack_file_t;
+
+// Recently reconstructed delta bases, keyed by their position in a pack
+typedef struct {
+    int pack;
+    uint64_t offset;
+    int type;
+    unsigned char *data;        // NULL when the slot is empty
+    size_t size;
+} delta_base_t;
+
+typedef struct {
+    char dirs[MAX_OBJECT_DIRS][MAX_PATH_LENGTH];
+    int dir_count;
+    pack_file_t *packs;
+    int pack_count;
+    delta_base_t cache[DELTA_CACHE_SLOTS];
+    size_t cache_bytes;
+} object_store_t;
+
+typedef struct {
+    int type;
+    size_t size;                // inflated size (of the delta, for delta entries)
+    size_t data;                // offset of the zlib stream
+    uint64_t base_offset;       // OBJ_OFS_DELTA
+    const unsigned char *base_oid;  // OBJ_REF_DELTA
+} pack_entry_t;
+
+static void open_pack(object_store_t *store, const char *dir, const char *idx_name) 
+{
+    pack_file_t pack;
+    char path[MAX_PATH_LENGTH * 2];
+    memset(&pack, 0, sizeof(pack));
+    snprintf(path, sizeof(path), "%s/%s", dir, idx_name);
+    if (map_file(path, &pack.idx) != 0) return;
+
+    const unsigned char *data = pack.idx.data;
+    size_t size = pack.idx.size, expected = 0;
+    if (size >= 8 + 1024 && memcmp(data, "\377tOc", 4) == 0 && get_be32(data + 4) == 2) {
+        pack.fanout = data + 8;
+        pack.count = get_be32(pack.fanout + 4 * 255);
+        expected = 8 + 1024 + 28 * (size_t)pack.count + 40;
+    }
+    if (!pack.fanout || size < expected) {
+        unmap_file(&pack.idx);
+        return;
+    }
+    pack.oids = pack.fanout + 1024;
+    pack.offsets = pack.oids + 24 * (size_t)pack.count;
+    pack.large_offsets = pack.offsets + 4 * (size_t)pack.count;
+    pack.large_count = (size - expected) / 8;
+
+    strcpy(path + strlen(path) - 4, ".pack");
+    if (map_file(path, &pack.pack) != 0) {
+        unmap_file(&pack.idx);
+        return;
+    }
+    if (pack.pack.size < 12 + 20 || memcmp(pack.pack.data, "PACK", 4) != 0) {
+        unmap_file(&pack.pack);
+        unmap_file(&pack.idx);
+        return;
+    }
+    store->packs = realloc(store->packs, sizeof(pack_file_t) * (store->pack_count + 1));
+    store->packs[store->pack_count++] = pack;
+}
+
+static void open_pack_dir(object_store_t *store, const char *objects_dir) 
+{
+    char dir[MAX_PATH_LENGTH + 8];
+    snprintf(dir, sizeof(dir), "%s/pack", objects_dir);
+
+    #ifdef _WIN32
+    char pattern[MAX_PATH_LENGTH + 16];
+    snprintf(pattern, sizeof(pattern), "%s/*.idx", dir);
+    WIN32_FIND_DATAA entry;
+    HANDLE find = FindFirstFileA(pattern, &entry);
+    if (find == INVALID_HANDLE_VALUE) return;
+    do {
+        open_pack(store, dir, entry.cFileName);
+    } while (FindNextFileA(find, &entry));
+    FindClose(find);
+    #else
+    DIR *handle = opendir(dir);
+    if (!handle) return;
+    struct dirent *entry;
+    while ((entry = readdir(handle)) != NULL) {
+        size_t length = strlen(entry->d_name);
+        if (length > 4 && strcmp(entry->d_name + length - 4, ".idx") == 0) open_pack(store, dir, entry->d_name);
+    }
+    closedir(handle);
+    #endif
+}
+
+// The repository's object directory plus any alternates (one per line, relative to it)
+int object_store_open(object_store_t *store) 
+{
+    memset(store, 0, sizeof(*store));
+    if (discover_repository() != 0) return -1;
+    if (snprintf(store->dirs[0], sizeof(store->dirs[0]), "%s/objects", repo.common_dir) >= (int)sizeof(store->dirs[0])) {
+        return -1;
+    }
+    store->dir_count = 1;
+
+    char path[MAX_PATH_LENGTH + 32];
+    snprintf(path, sizeof(path), "%s/info/alternates", store->dirs[0]);
+    FILE *fp = fopen(path, "r");
+    if (fp) {
+        char *line = NULL;
+        size_t capacity = 0;
+        while (store->dir_count < MAX_OBJECT_DIRS && read_stream_line(fp, &line, &capacity) >= 0) {
+            if (!line[0] || line[0] == '#') continue;
+            // An alternate whose path does not fit is skipped, not opened under a cut-off name
+            char *dir = store->dirs[store->dir_count];
+            int length = is_absolute_path(line) ? snprintf(dir, MAX_PATH_LENGTH, "%s", line)
+                                                : snprintf(dir, MAX_PATH_LENGTH, "%s/objects/%s", repo.common_dir, line);
+            if (length < MAX_PATH_LENGTH) store->dir_count++;
+        }
+        free(line);
+        fclose(fp);
+    }
+    for (int i = 0; i < store->dir_count; i++) open_pack_dir(store, store->dirs[i]);
+    return 0;
+}
+
+void object_store_close(object_store_t *store) 
+{
+    for (int i = 0; i < store->pack_count; i++) {
+        unmap_file(&store->packs[i].idx);
+        unmap_file(&store->packs[i].pack);
+    }
+    for (int i = 0; i < DELTA_CACHE_SLOTS; i++) free(store->cache[i].data);
+    free(store->packs);
+    memset(store, 0, sizeof(*store));
+}
+
+// Fanout narrows the range to one leading byte, then a binary search over the sorted ids
+static int pack_find(const pack_file_t *pack, const unsigned char *oid, uint64_t *offset) 
+{
+    uint32_t low = oid[0] ? get_be32(pack->fanout + 4 * (oid[0] - 1)) : 0;
+    uint32_t high = get_be32(pack->fanout + 4 * oid[0]);
+    while (low < high) {
+        uint32_t mid = low + (high - low) / 2;
+        int c = memcmp(pack->oids + 20 * (size_t)mid, oid, 20);
+        if (c < 0) {
+            low = mid + 1;
+        } else if (c > 0) {
+            high = mid;
+        } else {
+            uint32_t value = get_be32(pack->offsets + 4 * (size_t)mid);
+            if (!(value & 0x80000000u)) {
+                *offset = value;
+            } else if ((value & 0x7fffffffu) < pack->large_count) {
+                *offset = get_be64(pack->large_offsets + 8 * (size_t)(value & 0x7fffffffu));
+            } else {
+                return -1;
+            }
+            return 0;
+        }
+    }
+    return -1;
+}
+
+static int store_find_packed(const object_store_t *store, const unsigned char *oid, int *pack, uint64_t *offset) 
+{
+    for (int i = 0; i < store->pack_count; i++) {
+        if (pack_find(&store->packs[i], oid, offset) == 0) {
+            *pack = i;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+static int parse_pack_entry(const pack_file_t *pack, uint64_t offset, pack_entry_t *entry) 
+{
+    const unsigned char *start = pack->pack.data, *end = start + pack->pack.size - 20;
+    if (offset < 12 || offset >= (uint64_t)(end - start)) return -1;
+    const unsigned char *p = start + offset;
+
+    // Type in bits 4-6 of the first byte, size as a little-endian varint after its low nibble
+    unsigned c = *p++;
+    int shift = 4;
+    entry->type = (c >> 4) & 7;
+    entry->size = c & 15;
+    while (c & 0x80) {
+        if (p >= end || shift > (int)(8 * sizeof(size_t)) - 7) return -1;
+        c = *p++;
+        entry->size |= (size_t)(c & 0x7f) << shift;
+        shift += 7;
+    }
+
+    if (entry->type == OBJ_OFS_DELTA) {
+        // Big-endian varint where every continuation adds one, so no distance has two encodings
+        if (p >= end) return -1;
+        c = *p++;
+        uint64_t distance = c & 0x7f;
+        while (c & 0x80) {
+            if (p >= end) return -1;
+            c = *p++;
+            distance = ((distance + 1) << 7) | (c & 0x7f);
+        }
+        if (distance == 0 || distance > offset) return -1;
+        entry->base_offset = offset - distance;
+    } else if (entry->type == OBJ_REF_DELTA) {
+        if (end - p < 20) return -1;
+        entry->base_oid = p;
+        p += 20;
+    } else if (entry->type < OBJ_COMMIT || entry->type > OBJ_TAG) {
+        return -1;
+    }
+    entry->data = (size_t)(p - start);
+    return 0;
+}
+
+// Inflates a zlib stream that must produce exactly `size` bytes; the result is NUL-terminated
+static unsigned char* inflate_exact(const unsigned char *in, size_t in_size, size_t size) 
+{
+    unsigned char *out = malloc(size + 1);
+    z_stream z;
+    memset(&z, 0, sizeof(z));
+    if (!out || inflateInit(&z) != Z_OK) {
+        free(out);
+        return NULL;
+    }
+    z.next_in = (Bytef *)in;
+    z.avail_in = in_size > UINT_MAX ? UINT_MAX : (uInt)in_size;
+    z.next_out = out;
+    z.avail_out = (uInt)(size + 1);
+    int status = inflate(&z, Z_FINISH);
+    size_t produced = z.total_out;
+    inflateEnd(&z);
+    if (status != Z_STREAM_END || produced != size) {
+        free(out);
+        return NULL;
+    }
+    out[size] = '\0';
+    return out;
+}
+
+static size_t delta_varint(const unsigned char **p, const unsigned char *end) 
+{
+    size_t value = 0;
+    int shift = 0;
+    while (*p < end && shift < (int)(8 * sizeof(size_t))) {
+        unsigned c = *(*p)++;
+        value |= (size_t)(c & 0x7f) << shift;
+        shift += 7;
+        if (!(c & 0x80)) break;
+    }
+    return value;
+}
+
+// A delta is the base and result sizes followed by copy (from the base) and insert ops
+static unsigned char* apply_delta(const unsigned char *base, size_t base_size, const unsigned char *delta,
+                                  size_t delta_size, size_t *result_size) 
+{
+    const unsigned char *p = delta, *end = delta + delta_size;
+    if (delta_varint(&p, end) != base_size) return NULL;
+    size_t size = delta_varint(&p, end), written = 0;
+    unsigned char *out = malloc(size + 1);
+    int ok = out != NULL;
+    while (ok && p < end) {
+        unsigned op = *p++;
+        if (op & 0x80) {
+            size_t offset = 0, length = 0;
+            for (int i = 0; i < 4 && ok; i++) {
+                if (!(op & (1u << i))) continue;
+                ok = p < end;
+                if (ok) offset |= (size_t)*p++ << (8 * i);
+            }
+            for (int i = 0; i < 3 && ok; i++) {
+                if (!(op & (0x10u << i))) continue;
+                ok = p < end;
+                if (ok) length |= (size_t)*p++ << (8 * i);
+            }
+            if (length == 0) length = 0x10000;
+            ok = ok && offset <= base_size && length <= base_size - offset && length <= size - written;
+            if (ok) memcpy(out + written, base + offset, length);
+            written += ok ? length : 0;
+        } else {
+            ok = op != 0 && op <= (size_t)(end - p) && op <= size - written;
+            if (ok) memcpy(out + written, p, op);
+            p += ok ? op : 0;
+            written += ok ? op : 0;
+        }
+    }
+    if (!ok || written != size) {
+        free(out);
+        return NULL;
+    }
+    out[size] = '\0';
+    *result_size = size;
+    return out;
+}
+
+static delta_base_t* delta_cache_slot(object_store_t *store, int pack, uint64_t offset) 
+{
+    uint64_t hash = (offset + (uint64_t)pack) * 0x9e3779b97f4a7c15ULL;
+    return &store->cache[(hash >> 32) % DELTA_CACHE_SLOTS];
+}
+
+static void delta_cache_put(object_store_t *store, int pack, uint64_t offset, int type,
+                            const unsigned char *data, size_t size) 
+{
+    delta_base_t *slot = delta_cache_slot(store, pack, offset);
+    if (slot->data && slot->pack == pack && slot->offset == offset) return;
+    if (slot->data) {
+        store->cache_bytes -= slot->size;
+        free(slot->data);
+        slot->data = NULL;
+    }
+    if (store->cache_bytes + size > DELTA_CACHE_BYTES) return;
+    slot->data = malloc(size + 1);
+    if (!slot->data) return;
+    memcpy(slot->data, data, size + 1);
+    slot->pack = pack;
+    slot->offset = offset;
+    slot->type = type;
+    slot->size = size;
+    store->cache_bytes += size;
+}
+
+typedef struct {
+    int pack;
+    uint64_t offset;
+} pack_position_t;
+
+// Follows the delta chain down to a cached or whole base, then applies the deltas back up,
+// caching each intermediate result since neighbouring objects usually share bases
+static unsigned char* pack_read(object_store_t *store, int pack, uint64_t offset, int *type, size_t *size) 
+{
+    pack_position_t *chain = NULL;
+    int depth = 0, capacity = 0;
+    unsigned char *data = NULL;
+    pack_entry_t entry;
+    for (;;) {
+        const delta_base_t *cached = delta_cache_slot(store, pack, offset);
+        if (cached->data && cached->pack == pack && cached->offset == offset) {
+            data = malloc(cached->size + 1);
+            if (data) memcpy(data, cached->data, cached->size + 1);
+            *type = cached->type;
+            *size = cached->size;
+            break;
+        }
+        const pack_file_t *file = &store->packs[pack];
+        if (parse_pack_entry(file, offset, &entry) != 0) break;
+        if (entry.type != OBJ_OFS_DELTA && entry.type != OBJ_REF_DELTA) {
+            data = inflate_exact(file->pack.data + entry.data, file->pack.size - entry.data, entry.size);
+            *type = entry.type;
+            *size = entry.size;
+            break;
+        }
+        if (depth == capacity) {
+            capacity = capacity ? capacity * 2 : 16;
+            chain = realloc(chain, sizeof(pack_position_t) * capacity);
+        }
+        chain[depth++] = (pack_position_t){ pack, offset };
+        if (entry.type == OBJ_OFS_DELTA) offset = entry.base_offset;
+        else if (store_find_packed(store, entry.base_oid, &pack, &offset) != 0) break;
+    }
+
+    while (data && depth > 0) {
+        pack_position_t at = chain[--depth];
+        const pack_file_t *file = &store->packs[at.pack];
+        delta_cache_put(store, pack, offset, *type, data, *size);
+        unsigned char *delta = NULL, *result = NULL;
+        if (parse_pack_entry(file, at.offset, &entry) == 0) {
+            delta = inflate_exact(file->pack.data + entry.data, file->pack.size - entry.data, entry.size);
+        }
+        if (delta) result = apply_delta(data, *size, delta, entry.size, size);
+        free(delta);
+        free(data);
+        data = result;
+        pack = at.pack;
+        offset = at.offset;
+    }
+    free(chain);
+    return data;
+}
+
+static unsigned char* loose_read(const char *objects_dir, const unsigned char *oid, int *type, size_t *size) 
+{
+    char hex[41], path[MAX_PATH_LENGTH + 64];
+    oid_to_hex(oid, hex);
+    snprintf(path, sizeof(path), "%s/%.2s/%s", objects_dir, hex, hex + 2);
+    mapped_file_t file;
+    if (map_file(path, &file) != 0) return NULL;
+
+    z_stream z;
+    memset(&z, 0, sizeof(z));
+    size_t capacity = 8192;
+    unsigned char *out = malloc(capacity);
+    int status = inflateInit(&z) == Z_OK ? Z_OK : Z_DATA_ERROR;
+    z.next_in = (Bytef *)file.data;
+    z.avail_in = file.size > UINT_MAX ? UINT_MAX : (uInt)file.size;
+    while (status == Z_OK) {
+        if (z.total_out == capacity) {
+            capacity *= 2;
+            out = realloc(out, capacity);
+        }
+        z.next_out = out + z.total_out;
+        z.avail_out = (uInt)(capacity - z.total_out);
+        status = inflate(&z, Z_NO_FLUSH);
+    }
+    size_t total = z.total_out;
+    inflateEnd(&z);
+    unmap_file(&file);
+
+    // "<type> <size>\0<payload>"
+    unsigned char *nul = status == Z_STREAM_END ? memchr(out, '\0', total) : NULL;
+    char kind[16] = "";
+    unsigned long long declared = 0;
+    if (!nul || sscanf((const char *)out, "%15s %llu", kind, &declared) != 2 || declared != total - (size_t)(nul + 1 - out)) {
+        free(out);
+        return NULL;
+    }
+    *type = strcmp(kind, "commit") == 0 ? OBJ_COMMIT : strcmp(kind, "tree") == 0 ? OBJ_TREE :
+            strcmp(kind, "blob") == 0 ? OBJ_BLOB : strcmp(kind, "tag") == 0 ? OBJ_TAG : 0;
+    *size = (size_t)declared;
+    memmove(out, nul + 1, *size);
+    out = realloc(out, *size + 1);
+    out[*size] = '\0';
+    return *type ? out : (free(out), NULL);
+}
+
+// Returns the object's contents (NUL-terminated, caller frees), or NULL when it is not
+// found in any pack or object directory
+unsigned char* object_store_read(object_store_t *store, const unsigned char *oid, int *type, size_t *size) 
+{
+    int pack;
+    uint64_t offset;
+    if (store_find_packed(store, oid, &pack, &offset) == 0) {
+        unsigned char *data = pack_read(store, pack, offset, type, size);
+        if (data) return data;
+    }
+    for (int i = 0; i < store->dir_count; i++) {
+        unsigned char *data = loose_read(store->dirs[i], oid, type, size);
+        if (data) return data;
+    }
+    return NULL;
+}
+
+// "Name <email> 1700000000 +0100": the name with trailing spaces dropped, time and zone
+static void parse_signature(const char *p, const char *eol, char *name, size_t name_size,
+                            long long *epoch, int *zone_minutes) 
+{
+    const char *open = memchr(p, '<', eol - p), *close = NULL;
+    for (const char *q = eol; q > p; q--) {
+        if (q[-1] == '>') {
+            close = q - 1;
+            break;
+        }
+    }
+    const char *name_end = open ? open : eol;
+    while (name_end > p && name_end[-1] == ' ') name_end--;
+    if (name) snprintf(name, name_size, "%.*s", (int)(name_end - p), p);
+
+    *epoch = 0;
+    *zone_minutes = 0;
+    if (!close) return;
+    char *next;
+    *epoch = strtoll(close + 1, &next, 10);
+    while (*next == ' ') next++;
+    if ((*next == '+' || *next == '-') && isdigit((unsigned char)next[1])) {
+        int hhmm = atoi(next + 1);
+        *zone_minutes = (*next == '-' ? -1 : 1) * (hhmm / 100 * 60 + hhmm % 100);
+    }
+}
+
+// Fills a history_commit_t the way WALK_FORMAT prints it: committer time, author name, the
+// author date as YYYY-MM-DD in the author's zone, and the subject paragraph on one line
+int parse_commit_object(const unsigned char *oid, const char *data, size_t size, history_commit_t *commit) 
+{
+    memset(commit, 0, sizeof(*commit));
+    oid_to_hex(oid, commit->hash);
+    const char *p = data, *end = data + size;
+    size_t parents_length = 0;
+    int have_author = 0;
+    while (p < end && *p != '\n') {
+        const char *eol = memchr(p, '\n', end - p);
+        if (!eol) eol = end;
+        if (eol - p >= 47 && strncmp(p, "parent ", 7) == 0) {
+            if (parents_length + 41 < sizeof(commit->parents)) {
+                if (parents_length) commit->parents[parents_length++] = ' ';
+                memcpy(commit->parents + parents_length, p + 7, 40);
+                parents_length += 40;
+            }
+            commit->parent_count++;
+        } else if (strncmp(p, "author ", 7) == 0) {
+            long long when;
+            int zone;
+            parse_signature(p + 7, eol, commit->author, sizeof(commit->author), &when, &zone);
+            time_t local = (time_t)(when + 60LL * zone);
+            struct tm *tm_info = gmtime(&local);
+            if (tm_info) strftime(commit->date, sizeof(commit->date), "%Y-%m-%d", tm_info);
+            have_author = 1;
+        } else if (strncmp(p, "committer ", 10) == 0) {
+            int zone;
+            parse_signature(p + 10, eol, NULL, 0, &commit->epoch, &zone);
+        }
+        p = eol < end ? eol + 1 : end;
+    }
+    if (!have_author) return -1;
+
+    // Subject: the first paragraph after any blank lines, its lines joined with spaces
+    size_t length = 0;
+    int started = 0;
+    while (p < end) {
+        const char *eol = memchr(p, '\n', end - p);
+        if (!eol) eol = end;
+        const char *line_end = eol;
+        while (line_end > p && isspace((unsigned char)line_end[-1])) line_end--;
+        if (line_end == p) {
+            if (started) break;
+        } else {
+            if (started && length + 1 < sizeof(commit->subject)) commit->subject[length++] = ' ';
+            size_t n = (size_t)(line_end - p);
+            if (n > sizeof(commit->subject) - 1 - length) n = sizeof(commit->subject) - 1 - length;
+            memcpy(commit->subject + length, p, n);
+            length += n;
+            started = 1;
+        }
+        p = eol < end ? eol + 1 : end;
+    }
+    commit->subject[length] = '\0';
+    return 0;
+}
+
+history_commit_t* read_commit(object_store_t *store, const unsigned char *oid) 
+{
+    int type;
+    size_t size;
+    unsigned char *data = object_store_read(store, oid, &type, &size);
+    history_commit_t *commit = NULL;
+    if (data && type == OBJ_COMMIT) {
+        commit = malloc(sizeof(history_commit_t));
+        if (parse_commit_object(oid, (const char *)data, size, commit) != 0) {
+            free(commit);
+            commit = NULL;
+        }
+    }
+    free(data);
+    return commit;
+}
+
+typedef struct {
+    history_commit_t *commit;
+    uint64_t sequence;
+} commit_queue_entry_t;
+
+static int commit_queue_before(const commit_queue_entry_t *a, const commit_queue_entry_t *b) 
+{
+    if (a->commit->epoch != b->commit->epoch) return a->commit->epoch > b->commit->epoch;
+    return a->sequence < b->sequence;
+}
+
+// Max-heap on committer time, ties in the order commits were queued
+typedef struct {
+    commit_queue_entry_t *heap;
+    int count, capacity;
+    uint64_t sequence;
+} commit_queue_t;
+
+static void commit_queue_push(commit_queue_t *q, history_commit_t *commit) 
+{
+    if (q->count == q->capacity) {
+        q->capacity = q->capacity ? q->capacity * 2 : 64;
+        q->heap = realloc(q->heap, sizeof(commit_queue_entry_t) * q->capacity);
+    }
+    int i = q->count++;
+    q->heap[i] = (commit_queue_entry_t){ commit, q->sequence++ };
+    while (i > 0 && commit_queue_before(&q->heap[i], &q->heap[(i - 1) / 2])) {
+        commit_queue_entry_t t = q->heap[i];
+        q->heap[i] = q->heap[(i - 1) / 2];
+        q->heap[(i - 1) / 2] = t;
+        i = (i - 1) / 2;
+    }
+}
+
+static history_commit_t* commit_queue_pop(commit_queue_t *q) 
+{
+    history_commit_t *commit = q->heap[0].commit;
+    q->heap[0] = q->heap[--q->count];
+    for (int i = 0;;) {
+        int best = i, left = 2 * i + 1, right = left + 1;
+        if (left < q->count && commit_queue_before(&q->heap[left], &q->heap[best])) best = left;
+        if (right < q->count && commit_queue_before(&q->heap[right], &q->heap[best])) best = right;
+        if (best == i) break;
+        commit_queue_entry_t t = q->heap[i];
+        q->heap[i] = q->heap[best];
+        q->heap[best] = t;
+        i = best;
+    }
+    return commit;
+}
+
+static void commit_queue_free(commit_queue_t *q) 
+{
+    for (int i = 0; i < q->count; i++) free(q->heap[i].commit);
+    free(q->heap);
+    memset(q, 0, sizeof(*q));
+}
+
+static int count_ref_callback(const ref_record_t *ref, void *context) 
+{
+    (void)ref;
+    (*(int *)context)++;
+    return 0;
+}
+
+// Grafts, shallow boundaries and replace refs change parents in ways only git applies
+static int native_walk_supported() 
+{
+    char path[MAX_PATH_LENGTH + 32];
+    if (discover_repository() != 0 || repo.reftable) return 0;
+    snprintf(path, sizeof(path), "%s/shallow", repo.common_dir);
+    if (access(path, F_OK) == 0) return 0;
+    snprintf(path, sizeof(path), "%s/info/grafts", repo.common_dir);
+    if (access(path, F_OK) == 0) return 0;
+    int replace_refs = 0;
+    if (for_each_ref("refs/replace/", count_ref_callback, &replace_refs) != 0) return 0;
+    return replace_refs == 0;
+}
+
+// Walks HEAD's history newest first in `git log` order: highest committer time first, ties
+// in the order commits were queued. Returns -1, before visiting anything, when the walk has
+// to be left to git; a commit missing later on ends the walk early.
+int walk_commits_native(int (*visit)(void *context, const history_commit_t *commit), void *context) 
+{
+    char head[41];
+    unsigned char oid[20];
+    object_store_t store;
+    if (!native_walk_supported() || get_head_oid(head) != 0 || hex_to_oid(head, oid) != 0) return -1;
+    if (object_store_open(&store) != 0) return -1;
+    history_commit_t *first = read_commit(&store, oid);
+    if (!first) {
+        object_store_close(&store);
+        return -1;
+    }
+
+    oid_map_t seen = {0};
+    oid_map_insert(&seen, oid, NULL);
+    commit_queue_t queue = {0};
+    commit_queue_push(&queue, first);
+    int wanted = 1;
+    while (queue.count > 0) {
+        history_commit_t *commit = commit_queue_pop(&queue);
+        if (wanted) wanted = visit(context, commit);
+        for (const char *p = commit->parents; wanted && strlen(p) >= 40; p += 41) {
+            int created = 0;
+            if (hex_to_oid(p, oid) != 0) break;
+            oid_map_insert(&seen, oid, &created);
+            history_commit_t *parent = created ? read_commit(&store, oid) : NULL;
+            if (parent) commit_queue_push(&queue, parent);
+            else if (created) wanted = 0;
+            if (p[40] != ' ') break;
+        }
+        free(commit);
+    }
+    commit_queue_free(&queue);
+    oid_map_free(&seen);
+    object_store_close(&store);
+    return 0;
+}
+
+static int walk_native_visit(void *context, const history_commit_t *commit) 
+{
+    walk_state_t *w = context;
+    w->commit = *commit;
+    w->changes.count = 0;
+    w->changes.length = 0;
+    w->commits_read++;
+    if ((w->commits_read & 63) == 0) progress_update(&w->progress, w->commits_read);
+    dispatch_walk_commit(w->analyzers, w->count, &w->commit, &w->changes);
+    return any_analyzer_active(w->analyzers, w->count);
+}
+
+int walk_history_native(walk_state_t *w) 
+{
+    return walk_commits_native(walk_native_visit, w);
+}
+
+#define SIDE_LEFT 1
+#define SIDE_RIGHT 2
+#define SIDE_QUEUED 4
+#define SIDE_REVISIT 8          // marks grew after the commit was expanded: its parents need them too
+
+typedef struct {
+    object_store_t store;
+    oid_map_t sides;
+    commit_queue_t queue;
+    int pending;                // queued commits that can still change a count
+    int missing;
+} side_walk_t;
+
+static int side_pending(long long sides) 
+{
+    return (sides & 3) != 3 || (sides & SIDE_REVISIT);
+}
+
+static void side_mark(side_walk_t *s, const unsigned char *oid, int add) 
+{
+    int created = 0;
+    long long *value = oid_map_insert(&s->sides, oid, &created);
+    long long old = created ? 0 : *value, now = old | add;
+    if (now == old) return;
+    if (old & SIDE_QUEUED) {
+        s->pending += side_pending(now) - side_pending(old);
+        *value = now;
+        return;
+    }
+    if (!created) now |= SIDE_REVISIT;
+    *value = now | SIDE_QUEUED;
+    history_commit_t *commit = read_commit(&s->store, oid);
+    if (!commit) {
+        s->missing = 1;
+        return;
+    }
+    commit_queue_push(&s->queue, commit);
+    s->pending += side_pending(now);
+}
+
+// Ahead/behind of `left` against `right` straight from the object store, for when there is
+// no commit-graph. A date-ordered walk marks each commit with the tips that reach it and
+// stops once every queued commit is reached from both; commits whose marks grow after they
+// were expanded are queued again. Returns -1 on a missing object or once `deadline` passes.
+int ahead_behind_native(const char *left, const char *right, double deadline, int *ahead, int *behind) 
+{
+    unsigned char oid[20];
+    side_walk_t s;
+    memset(&s, 0, sizeof(s));
+    if (!native_walk_supported() || object_store_open(&s.store) != 0) return -1;
+    if (hex_to_oid(left, oid) == 0) side_mark(&s, oid, SIDE_LEFT);
+    if (hex_to_oid(right, oid) == 0) side_mark(&s, oid, SIDE_RIGHT);
+
+    int steps = 0, status = 0;
+    while (s.queue.count > 0 && s.pending > 0 && !s.missing) {
+        if ((++steps & 63) == 0 && monotonic_seconds() > deadline) {
+            status = -1;
+            break;
+        }
+        history_commit_t *commit = commit_queue_pop(&s.queue);
+        hex_to_oid(commit->hash, oid);
+        long long *value = oid_map_find(&s.sides, oid);
+        int sides = (int)(*value & 3);
+        s.pending -= side_pending(*value);
+        *value = sides;
+        for (const char *p = commit->parents; strlen(p) >= 40; p += 41) {
+            if (hex_to_oid(p, oid) == 0) side_mark(&s, oid, sides);
+            if (p[40] != ' ') break;
+        }
+        free(commit);
+    }
+    if (s.missing) status = -1;
+
+    *ahead = *behind = 0;
+    for (size_t i = 0; status == 0 && i < s.sides.capacity; i++) {
+        if (!s.sides.entries[i].used) continue;
+        int sides = (int)(s.sides.entries[i].value & 3);
+        *ahead += sides == SIDE_LEFT;
+        *behind += sides == SIDE_RIGHT;
+    }
+    commit_queue_free(&s.queue);
+    oid_map_free(&s.sides);
+    object_store_close(&s.store);
+    return status;
+}
+
+// ==================== REACHABILITY ====================
+
+#define GRAPH_PARENT_NONE 0x70000000
+#define GRAPH_EXTRA_EDGES 0x80000000
+
+// Commit DAG with topological generation numbers, backed either by git's commit-graph
+// (positions are node ids, read on demand) or by one `git rev-list --parents` pass
+typedef struct {
+    commit_graph_t graph;
+    int use_graph;
+    uint32_t node_count;
+    oid_map_t ids;              // rev-list mode: oid -> node id + 1
+    uint32_t *parent_offsets;   // rev-list mode: CSR parents by node id
+    uint32_t *parents;
+    uint32_t *generations;
+} commit_dag_t;
+
+static int dag_parents(const commit_dag_t *dag, uint32_t node, uint32_t *out, int max) 
+{
+    if (!dag->use_graph) {
+        int count = 0;
+        for (uint32_t i = dag->parent_offsets[node]; i < dag->parent_offsets[node + 1] && count < max; i++) {
+            out[count++] = dag->parents[i];
+        }
+        return count;
+    }
+
+    uint32_t local;
+    const graph_layer_t *layer = commit_graph_layer(&dag->graph, node, &local);
+    const unsigned char *entry = layer->commit_data + 36 * (size_t)local;
+    uint32_t first = get_be32(entry + 20), second = get_be32(entry + 24);
+    int count = 0;
+    if (first == GRAPH_PARENT_NONE) return 0;
+    out[count++] = first;
+    if (second == GRAPH_PARENT_NONE) return count;
+    if (!(second & GRAPH_EXTRA_EDGES)) {
+        out[count++] = second;
+        return count;
+    }
+    // Octopus merges: the rest of the parents are in the EDGE chunk, last one flagged
+    if (!layer->extra_edges) return count;
+    for (const unsigned char *edge = layer->extra_edges + 4 * (size_t)(second & ~GRAPH_EXTRA_EDGES); count < max; edge += 4) {
+        uint32_t parent = get_be32(edge);
+        out[count++] = parent & ~GRAPH_EXTRA_EDGES;
+        if (parent & GRAPH_EXTRA_EDGES) break;
+    }
+    return count;
+}
+
+static uint32_t dag_generation(const commit_dag_t *dag, uint32_t node) 
+{
+    if (!dag->use_graph) return dag->generations[node];
+    uint32_t local;
+    const graph_layer_t *layer = commit_graph_layer(&dag->graph, node, &local);
+    return get_be32(layer->commit_data + 36 * (size_t)local + 28) >> 2;
+}
+
+static long dag_find(const commit_dag_t *dag, const unsigned char *oid) 
+{
+    if (dag->use_graph) return commit_graph_find(&dag->graph, oid);
+    long long *id = oid_map_find(&dag->ids, oid);
+    return id ? (long)(*id - 1) : -1;
+}
+
+static uint32_t dag_intern(commit_dag_t *dag, const unsigned char *oid) 
+{
+    int created = 0;
+    long long *id = oid_map_insert(&dag->ids, oid, &created);
+    if (created) *id = ++dag->node_count;
+    return (uint32_t)(*id - 1);
+}
+
+// The commit-graph when it covers every tip and has generation numbers, else rev-list
+int open_commit_dag(commit_dag_t *dag, char (*tips)[41], int tip_count) 
+{
+    memset(dag, 0, sizeof(*dag));
+    if (open_commit_graph(&dag->graph) == 0) {
+        dag->use_graph = 1;
+        for (int i = 0; i < tip_count && dag->use_graph; i++) {
+            unsigned char oid[20];
+            long position = hex_to_oid(tips[i], oid) == 0 ? commit_graph_find(&dag->graph, oid) : -1;
+            if (position < 0 || dag_generation(dag, (uint32_t)position) == 0) dag->use_graph = 0;
+        }
+        if (dag->use_graph) {
+            dag->node_count = dag->graph.commit_count;
+            return 0;
+        }
+        close_commit_graph(&dag->graph);
+    }
+
+    char list_path[MAX_PATH_LENGTH + 64];
+    if (get_temp_path(list_path, sizeof(list_path), "tips") != 0) return -1;
+    FILE *list = fopen(list_path, "w");
+    if (!list) return -1;
+    for (int i = 0; i < tip_count; i++) fprintf(list, "%s\n", tips[i]);
+    fclose(list);
+
+    // Children come before parents in --topo-order, so generations fill in on the way back
+    FILE *fp = open_git_stream("git rev-list --parents --topo-order --stdin < \"%s\"", list_path);
+    if (!fp) {
+        remove(list_path);
+        return -1;
+    }
+    uint32_t *line_nodes = NULL, *line_offsets = NULL, *edges = NULL;
+    size_t line_count = 0, line_capacity = 0, edge_count = 0, edge_capacity = 0;
+    char *line = NULL;
+    size_t capacity = 0;
+    while (read_stream_line(fp, &line, &capacity) >= 0) {
+        unsigned char oid[20];
+        if (strlen(line) < 40 || hex_to_oid(line, oid) != 0) continue;
+        if (line_count + 2 > line_capacity) {
+            line_capacity = line_capacity ? line_capacity * 2 : 4096;
+            line_nodes = realloc(line_nodes, sizeof(uint32_t) * line_capacity);
+            line_offsets = realloc(line_offsets, sizeof(uint32_t) * (line_capacity + 1));
+        }
+        line_nodes[line_count] = dag_intern(dag, oid);
+        line_offsets[line_count] = (uint32_t)edge_count;
+        for (const char *p = line + 40; *p == ' ' && strlen(p + 1) >= 40; p += 41) {
+            if (hex_to_oid(p + 1, oid) != 0) break;
+            if (edge_count == edge_capacity) {
+                edge_capacity = edge_capacity ? edge_capacity * 2 : 8192;
+                edges = realloc(edges, sizeof(uint32_t) * edge_capacity);
+            }
+            edges[edge_count++] = dag_intern(dag, oid);
+        }
+        line_count++;
+    }
+    free(line);
+    pclose(fp);
+    remove(list_path);
+    if (line_offsets) line_offsets[line_count] = (uint32_t)edge_count;
+
+    dag->parent_offsets = calloc(dag->node_count + 1, sizeof(uint32_t));
+    dag->parents = malloc(sizeof(uint32_t) * (edge_count + 1));
+    dag->generations = calloc(dag->node_count + 1, sizeof(uint32_t));
+    uint32_t *line_of = malloc(sizeof(uint32_t) * (dag->node_count + 1));
+    memset(line_of, 0xff, sizeof(uint32_t) * (dag->node_count + 1));
+    for (size_t i = 0; i < line_count; i++) line_of[line_nodes[i]] = (uint32_t)i;
+
+    uint32_t offset = 0;
+    for (uint32_t node = 0; node < dag->node_count; node++) {
+        dag->parent_offsets[node] = offset;
+        if (line_of[node] == UINT32_MAX) continue;
+        for (uint32_t e = line_offsets[line_of[node]]; e < line_offsets[line_of[node] + 1]; e++) {
+            dag->parents[offset++] = edges[e];
+        }
+    }
+    dag->parent_offsets[dag->node_count] = offset;
+    for (size_t i = line_count; i-- > 0; ) {
+        uint32_t node = line_nodes[i], generation = 1;
+        for (uint32_t e = line_offsets[i]; e < line_offsets[i + 1]; e++) {
+            if (dag->generations[edges[e]] + 1 > generation) generation = dag->generations[edges[e]] + 1;
+        }
+        dag->generations[node] = generation;
+    }
+    free(line_of);
+    free(line_nodes);
+    free(line_offsets);
+    free(edges);
+    return 0;
+}
+
+void close_commit_dag(commit_dag_t *dag) 
+{
+    if (dag->use_graph) close_commit_graph(&dag->graph);
+    oid_map_free(&dag->ids);
+    free(dag->parent_offsets);
+    free(dag->parents);
+    free(dag->generations);
+    memset(dag, 0, sizeof(*dag));
+}
+
+// Per tip and base: is the tip reachable from the base, and how many commits each side has
+// that the other lacks
+typedef struct {
+    int merged;
+    int ahead;
+    int behind;
+} reach_result_t;
+
+static int bit_is_set(const uint64_t *bits, int i) 
+{
+    return (bits[i / 64] >> (i % 64)) & 1;
+}
+
+// One walk for every tip at once: each commit carries one bit per tip and per base, and
+// commits are taken in decreasing generation order so a commit's bits are final when it is
+// popped. The walk stops once every queued commit is reachable from everything.
+// results[t * base_count + b] is filled for tip t against base b.
+int compute_reachability(char (*tips)[41], int tip_count, char (*bases)[41], int base_count, reach_result_t *results) 
+{
+    memset(results, 0, sizeof(reach_result_t) * (size_t)tip_count * base_count);
+    if (tip_count == 0 || base_count == 0) return 0;
+
+    int total = tip_count + base_count;
+    char (*all)[41] = malloc(41 * (size_t)total);
+    memcpy(all, tips, 41 * (size_t)tip_count);
+    memcpy(all + tip_count, bases, 41 * (size_t)base_count);
+
+    commit_dag_t dag;
+    if (open_commit_dag(&dag, all, total) != 0) {
+        free(all);
+        return -1;
+    }
+
+    int words = (total + 63) / 64;
+    int32_t *slot_of = malloc(sizeof(int32_t) * dag.node_count);
+    memset(slot_of, 0xff, sizeof(int32_t) * dag.node_count);
+    int32_t *tip_head = malloc(sizeof(int32_t) * dag.node_count);
+    memset(tip_head, 0xff, sizeof(int32_t) * dag.node_count);
+    int32_t *tip_next = malloc(sizeof(int32_t) * tip_count);
+
+    uint64_t *pool = NULL;
+    int *full_flags = NULL, *free_slots = NULL;
+    int pool_size = 0, pool_capacity = 0, free_count = 0;
+    uint32_t *heap = NULL;
+    int heap_count = 0, heap_capacity = 0, non_full = 0;
+
+    uint64_t *full = calloc(words, sizeof(uint64_t));
+    for (int i = 0; i < total; i++) full[i / 64] |= 1ULL << (i % 64);
+
+    #define REACH_BITS(slot) (pool + (size_t)(slot) * words)
+    for (int i = 0; i < total; i++) {
+        unsigned char oid[20];
+        long node = hex_to_oid(all[i], oid) == 0 ? dag_find(&dag, oid) : -1;
+        if (node < 0) continue;
+        if (slot_of[node] < 0) {
+            if (pool_size == pool_capacity) {
+                pool_capacity = pool_capacity ? pool_capacity * 2 : 1024;
+                pool = realloc(pool, sizeof(uint64_t) * words * (size_t)pool_capacity);
+                full_flags = realloc(full_flags, sizeof(int) * pool_capacity);
+                free_slots = realloc(free_slots, sizeof(int) * pool_capacity);
+            }
+            slot_of[node] = pool_size++;
+            memset(REACH_BITS(slot_of[node]), 0, sizeof(uint64_t) * words);
+            full_flags[slot_of[node]] = 0;
+            non_full++;
+            if (heap_count == heap_capacity) {
+                heap_capacity = heap_capacity ? heap_capacity * 2 : 1024;
+                heap = realloc(heap, sizeof(uint32_t) * heap_capacity);
+            }
+            heap[heap_count++] = (uint32_t)node;
+        }
+        REACH_BITS(slot_of[node])[i / 64] |= 1ULL << (i % 64);
+        if (i < tip_count) {
+            tip_next[i] = tip_head[node];
+            tip_head[node] = i;
+        }
+    }
+
+    // Max-heap on generation: a commit is popped only after all of its children
+    #define REACH_BEFORE(a, b) (dag_generation(&dag, a) > dag_generation(&dag, b) || \
+                                (dag_generation(&dag, a) == dag_generation(&dag, b) && (a) > (b)))
+    for (int i = heap_count / 2 - 1; i >= 0; i--) {
+        for (int j = i;;) {
+            int best = j, l = 2 * j + 1, r = l + 1;
+            if (l < heap_count && REACH_BEFORE(heap[l], heap[best])) best = l;
+            if (r < heap_count && REACH_BEFORE(heap[r], heap[best])) best = r;
+            if (best == j) break;
+            uint32_t t = heap[j]; heap[j] = heap[best]; heap[best] = t;
+            j = best;
+        }
+    }
+    for (int i = 0; i < heap_count; i++) {
+        int slot = slot_of[heap[i]];
+        if (!full_flags[slot] && memcmp(REACH_BITS(slot), full, sizeof(uint64_t) * words) == 0) {
+            full_flags[slot] = 1;
+            non_full--;
+        }
+    }
+
+    while (heap_count > 0 && non_full > 0) {
+        uint32_t node = heap[0];
+        heap[0] = heap[--heap_count];
+        for (int j = 0;;) {
+            int best = j, l = 2 * j + 1, r = l + 1;
+            if (l < heap_count && REACH_BEFORE(heap[l], heap[best])) best = l;
+            if (r < heap_count && REACH_BEFORE(heap[r], heap[best])) best = r;
+            if (best == j) break;
+            uint32_t t = heap[j]; heap[j] = heap[best]; heap[best] = t;
+            j = best;
+        }
+
+        int slot = slot_of[node];
+        uint64_t *bits = REACH_BITS(slot);
+        if (!full_flags[slot]) non_full--;
+
+        // Reachable from a tip but not the base counts as ahead, the reverse as behind;
+        // whole words are skipped so thousands of tips cost little per commit
+        for (int b = 0; b < base_count; b++) {
+            int from_base = bit_is_set(bits, tip_count + b);
+            for (int w = 0; w * 64 < tip_count; w++) {
+                uint64_t word = from_base ? ~bits[w] : bits[w];
+                if (w * 64 + 64 > tip_count) word &= (1ULL << (tip_count - w * 64)) - 1;
+                for (int t = w * 64; word; word >>= 1, t++) {
+                    if (!(word & 1)) continue;
+                    if (from_base) results[(size_t)t * base_count + b].behind++;
+                    else results[(size_t)t * base_count + b].ahead++;
+                }
+            }
+        }
+        for (int t = tip_head[node]; t >= 0; t = tip_next[t]) {
+            for (int b = 0; b < base_count; b++) {
+                if (bit_is_set(bits, tip_count + b)) results[(size_t)t * base_count + b].merged = 1;
+            }
+        }
+
+        uint32_t parents[64];
+        int parent_count = dag_parents(&dag, node, parents, 64);
+        for (int p = 0; p < parent_count; p++) {
+            uint32_t parent = parents[p];
+            if (parent >= dag.node_count) continue;
+            if (slot_of[parent] < 0) {
+                int new_slot;
+                if (free_count > 0) {
+                    new_slot = free_slots[--free_count];
+                } else {
+                    if (pool_size == pool_capacity) {
+                        pool_capacity *= 2;
+                        pool = realloc(pool, sizeof(uint64_t) * words * (size_t)pool_capacity);
+                        full_flags = realloc(full_flags, sizeof(int) * pool_capacity);
+                        free_slots = realloc(free_slots, sizeof(int) * pool_capacity);
+                        bits = REACH_BITS(slot);
+                    }
+                    new_slot = pool_size++;
+                }
+                slot_of[parent] = new_slot;
+                memset(REACH_BITS(new_slot), 0, sizeof(uint64_t) * words);
+                full_flags[new_slot] = 0;
+                non_full++;
+                if (heap_count == heap_capacity) {
+                    heap_capacity *= 2;
+                    heap = realloc(heap, sizeof(uint32_t) * heap_capacity);
+                }
+                int j = heap_count++;
+                while (j > 0 && REACH_BEFORE(parent, heap[(j - 1) / 2])) {
+                    heap[j] = heap[(j - 1) / 2];
+                    j = (j - 1) / 2;
+                }
+                heap[j] = parent;
+            }
+
+            int parent_slot = slot_of[parent];
+            uint64_t *parent_bits = REACH_BITS(parent_slot);
+            for (int w = 0; w < words; w++) parent_bits[w] |= bits[w];
+            if (!full_flags[parent_slot] && memcmp(parent_bits, full, sizeof(uint64_t) * words) == 0) {
+                full_flags[parent_slot] = 1;
+                non_full--;
+            }
+        }
+        free_slots[free_count++] = slot;
+    }
+
+    // Whatever is still queued is reachable from every tip and base
+    for (int i = 0; i < heap_count; i++) {
+        for (int t = tip_head[heap[i]]; t >= 0; t = tip_next[t]) {
+            for (int b = 0; b < base_count; b++) results[(size_t)t * base_count + b].merged = 1;
+        }
+    }
+    #undef REACH_BEFORE
+    #undef REACH_BITS
+
+    free(full);
+    free(heap);
+    free(pool);
+    free(full_flags);
+    free(free_slots);
+    free(slot_of);
+    free(tip_head);
+    free(tip_next);
+    free(all);
+    close_commit_dag(&dag);
+    return 0;
+}
+
+// ==================== BRANCH ANALYSIS ====================
+
+#define STALE_BRANCH_DAYS 90
+
+static ref_list_t local_branch_refs;
+static ref_list_t remote_branch_refs;
+static char branch_prefix[MAX_PATH_LENGTH] = "";
+
+#define MAX_BASE_BRANCHES 8
+
+static char base_branch_names[MAX_BASE_BRANCHES][256];
+static int base_branch_count = 0;
+
+// A base given as a branch, remote-tracking branch or anything rev-parse understands
+static int resolve_base_commit(const char *name, char *oid_hex) 
+{
+    char ref[MAX_PATH_LENGTH + 16];
+    snprintf(ref, sizeof(ref), "refs/heads/%s", name);
+    if (resolve_ref(ref, oid_hex, NULL, 0) == 0) return 0;
+    snprintf(ref, sizeof(ref), "refs/remotes/%s", name);
+    if (resolve_ref(ref, oid_hex, NULL, 0) == 0) return 0;
+
+    char *oid = run_git_command_output("git rev-parse --verify -q \"%s^{commit}\"", name);
+    if (!oid) return -1;
+    if (strlen(oid) < 40) return -1;
+    memcpy(oid_hex, oid, 40);
+    oid_hex[40] = '\0';
+    return 0;
+}
+
+// Merged status against every base, ahead/behind against the first, all in one walk
+static void compute_branch_reachability(char (*bases)[256], int base_count) 
+{
+    char (*tips)[41] = malloc(41 * (size_t)(branch_count + 1));
+    char (*base_oids)[41] = malloc(41 * MAX_BASE_BRANCHES);
+    base_branch_count = 0;
+    for (int i = 0; i < base_count && base_branch_count < MAX_BASE_BRANCHES; i++) {
+        if (resolve_base_commit(bases[i], base_oids[base_branch_count]) != 0) continue;
+        strcpy(base_branch_names[base_branch_count++], bases[i]);
+    }
+    for (int i = 0; i < branch_count; i++) strcpy(tips[i], branches[i].last_commit);
+
+    reach_result_t *results = malloc(sizeof(reach_result_t) * ((size_t)branch_count * MAX_BASE_BRANCHES + 1));
+    if (base_branch_count > 0 && compute_reachability(tips, branch_count, base_oids, base_branch_count, results) == 0) {
+        for (int i = 0; i < branch_count; i++) {
+            const reach_result_t *row = &results[(size_t)i * base_branch_count];
+            int is_base = 0;
+            for (int b = 0; b < base_branch_count; b++) {
+                if (strcmp(branches[i].name, base_branch_names[b]) == 0) is_base = 1;
+            }
+            for (int b = 0; b < base_branch_count && !is_base; b++) {
+                if (row[b].merged) branches[i].is_merged = 1;
+            }
+            branches[i].commits_ahead = row[0].ahead;
+            branches[i].commits_behind = row[0].behind;
+        }
+    }
+    free(results);
+    free(base_oids);
+    free(tips);
+}
+
+// Local branches (optionally only those under `prefix`, e.g. "feature/") plus remote-tracking refs,
+// compared against `bases` (main and master by default, else the current branch)
+void load_branch_info(const char *prefix, char (*bases)[256], int base_count) {
+    char ref_prefix[MAX_PATH_LENGTH + 16];
+    snprintf(branch_prefix, sizeof(branch_prefix), "%s", prefix ? prefix : "");
+    snprintf(ref_prefix, sizeof(ref_prefix), "refs/heads/%s", branch_prefix);
+
+    free_ref_list(&local_branch_refs);
+    free_ref_list(&remote_branch_refs);
+    load_refs(ref_prefix, &local_branch_refs);
+    load_refs("refs/remotes/", &remote_branch_refs);
+
+    branch_count = 0;
+    branches = realloc(branches, sizeof(branch_info_t) * (local_branch_refs.count + 1));
+    for (int i = 0; i < local_branch_refs.count; i++) {
+        const ref_record_t *ref = &local_branch_refs.refs[i];
+        branch_info_t *branch = &branches[branch_count];
+        if (strlen(ref->name + 11) >= sizeof(branch->name)) continue;
+        memset(branch, 0, sizeof(*branch));
+        strcpy(branch->name, ref->name + 11);
+        strcpy(branch->last_commit, ref->oid);
+        branch->epoch = ref->epoch;
+        
+        branch_count++;
+    }
+
+    char default_bases[2][256];
+    if (base_count == 0) {
+        char oid[41];
+        if (resolve_ref("refs/heads/main", oid, NULL, 0) == 0) strcpy(default_bases[base_count++], "main");
+        if (resolve_ref("refs/heads/master", oid, NULL, 0) == 0) strcpy(default_bases[base_count++], "master");
+        if (base_count == 0 && repo.reftable) {
+            strcpy(default_bases[base_count++], "main");
+            strcpy(default_bases[base_count++], "master");
+        }
+        if (base_count == 0 && current_branch_name(default_bases[0], sizeof(default_bases[0])) == 0 && default_bases[0][0]) {
+            base_count = 1;
+        }
+        bases = default_bases;
+    }
+    compute_branch_reachability(bases, base_count);
+}
+
+static int compare_branch_ahead(const void *a, const void *b) 
+{
+    const branch_info_t *x = *(branch_info_t * const *)a, *y = *(branch_info_t * const *)b;
+    if (x->commits_ahead != y->commits_ahead) return y->commits_ahead - x->commits_ahead;
+    return strcmp(x->name, y->name);
+}
+
+static int compare_branch_age(const void *a, const void *b) 
+{
+    const branch_info_t *x = *(branch_info_t * const *)a, *y = *(branch_info_t * const *)b;
+    if (x->epoch != y->epoch) return x->epoch < y->epoch ? -1 : 1;
+    return strcmp(x->name, y->name);
+}
+
+// Local branches against one remote: origin when it exists, otherwise the first remote found
+static void show_remote_tracking() 
+{
+    char remote[MAX_PATH_LENGTH] = "";
+    for (int i = 0; i < remote_branch_refs.count; i++) {
+        const char *name = remote_branch_refs.refs[i].name + 13;
+        const char *slash = strchr(name, '/');
+        if (!slash) continue;
+        if (!remote[0] || strncmp(name, "origin/", 7) == 0) snprintf(remote, sizeof(remote), "%.*s", (int)(slash - name), name);
+        if (strcmp(remote, "origin") == 0) break;
+    }
+    if (!remote[0]) return;
+
+    int in_sync = 0, differs = 0, local_only = 0, remote_only = 0;
+    for (int i = 0; i < branch_count; i++) {
+        char name[MAX_PATH_LENGTH * 2];
+        snprintf(name, sizeof(name), "refs/remotes/%s/%s", remote, branches[i].name);
+        const ref_record_t *tracking = find_ref(&remote_branch_refs, name);
+        if (!tracking) local_only++;
+        else if (strcmp(tracking->oid, branches[i].last_commit) == 0) in_sync++;
+        else differs++;
+    }
+
+    char remote_prefix[MAX_PATH_LENGTH * 2];
+    snprintf(remote_prefix, sizeof(remote_prefix), "refs/remotes/%s/%s", remote, branch_prefix);
+    size_t remote_prefix_length = strlen(remote_prefix);
+    for (int i = 0; i < remote_branch_refs.count; i++) {
+        const char *name = remote_branch_refs.refs[i].name;
+        if (strncmp(name, remote_prefix, remote_prefix_length) != 0) continue;
+        const char *branch = name + 14 + strlen(remote);
+        if (strcmp(branch, "HEAD") == 0) continue;
+        char local[MAX_PATH_LENGTH * 2];
+        snprintf(local, sizeof(local), "refs/heads/%s", branch);
+        if (!find_ref(&local_branch_refs, local)) remote_only++;
+    }
+
+    printf("\n🔁 Remote tracking vs %s: %d in sync, %d differ, %d local only, %d remote only\n",
+           remote, in_sync, differs, local_only, remote_only);
+}
+
+void show_branch_analysis() 
+{
+    printf("🌿 Branch Analysis\n");
+    printf("=================\n");
+    
+    if (branch_count == 0) {
+        printf("No branches found.\n\n");
+        return;
+    }
+    
+    int merged_branches = 0;
+    int active_branches = 0;
+    char current_branch[256] = "";
+    branch_info_t **active = malloc(sizeof(branch_info_t *) * branch_count);
+    
+    current_branch_name(current_branch, sizeof(current_branch));
+    
+    for (int i = 0; i < branch_count; i++) {
+        int is_base = 0;
+        for (int b = 0; b < base_branch_count; b++) {
+            if (strcmp(branches[i].name, base_branch_names[b]) == 0) is_base = 1;
+        }
+        if (branches[i].is_merged) {
+            merged_branches++;
+        } else if (!is_base &&
+                   strcmp(branches[i].name, "main") != 0 && 
+                   strcmp(branches[i].name, "master") != 0 &&
+                   strcmp(branches[i].name, current_branch) != 0) {
+            active[active_branches++] = &branches[i];
+        }
+    }
+    
+    if (branch_prefix[0]) printf("Branches under: %s\n", branch_prefix);
+    printf("Total branches: %d\n", branch_count);
+    printf("Current branch: %s\n", current_branch[0] ? current_branch : "unknown");
+    printf("Active branches: %d\n", active_branches);
+    printf("Merged branches (can be deleted): %d\n", merged_branches);
+    if (base_branch_count > 0) {
+        printf("Compared against:");
+        for (int b = 0; b < base_branch_count; b++) printf(" %s", base_branch_names[b]);
+        printf("\n");
+    }
+    
+    if (merged_branches > 0) {
+        printf("\n🚮 Branches that can be safely deleted:\n");
+        for (int i = 0; i < branch_count; i++) {
+            if (branches[i].is_merged) {
+                printf("  • %s\n", branches[i].name);
+            }
+        }
+    }
+
+    branch_info_t **by_age = malloc(sizeof(branch_info_t *) * branch_count);
+    int stale = 0;
+    time_t cutoff = time(NULL) - (time_t)STALE_BRANCH_DAYS * 86400;
+    for (int i = 0; i < branch_count; i++) {
+        if (branches[i].epoch > 0 && branches[i].epoch < cutoff && strcmp(branches[i].name, current_branch) != 0) {
+            by_age[stale++] = &branches[i];
+        }
+    }
+    if (stale > 0) {
+        qsort(by_age, stale, sizeof(branch_info_t *), compare_branch_age);
+        printf("\n🕸️  Stale branches (no commits in %d days): %d\n", STALE_BRANCH_DAYS, stale);
+        for (int i = 0; i < stale && i < 10; i++) {
+            char date[16] = "";
+            time_t when = (time_t)by_age[i]->epoch;
+            struct tm *tm_info = localtime(&when);
+            if (tm_info) strftime(date, sizeof(date), "%Y-%m-%d", tm_info);
+            printf("  • %s (last commit %s)\n", by_age[i]->name, date);
+        }
+        if (stale > 10) printf("  ... and %d more\n", stale - 10);
+    }
+    free(by_age);
+
+    if (active_branches > 0 && base_branch_count > 0) {
+        qsort(active, active_branches, sizeof(branch_info_t *), compare_branch_ahead);
+        printf("\n📐 Ahead/behind %s:\n", base_branch_names[0]);
+        for (int i = 0; i < active_branches && i < 10; i++) {
+            printf("  • %s: %d ahead, %d behind\n", active[i]->name, active[i]->commits_ahead, active[i]->commits_behind);
+        }
+        if (active_branches > 10) printf("  ... and %d more\n", active_branches - 10);
+    }
+    free(active);
+
+    show_remote_tracking();
+    printf("\n");
+}
+
+// ==================== FILE ANALYSIS ====================
+
+static int compare_file_changes(const void *a, const void *b) 
+{
+    const file_info_t *x = a, *y = b;
+    if (x->changes != y->changes) return y->changes - x->changes;
+    return strcmp(x->path, y->path);
+}
+
+// Keeps the MAX_FILES best entries as a heap whose root is the one to drop next
+static void sift_file_heap(file_info_t *heap, uint32_t *positions, int count, int i) 
+{
+    for (;;) {
+        int worst = i, left = 2 * i + 1, right = left + 1;
+        if (left < count && compare_file_changes(&heap[left], &heap[worst]) > 0) worst = left;
+        if (right < count && compare_file_changes(&heap[right], &heap[worst]) > 0) worst = right;
+        if (worst == i) return;
+        file_info_t t = heap[i];
+        heap[i] = heap[worst];
+        heap[worst] = t;
+        uint32_t p = positions[i];
+        positions[i] = positions[worst];
+        positions[worst] = p;
+        i = worst;
+    }
+}
+
+int is_submodule_path(const char *path);
+
+void load_file_analysis() 
+{
+    history_index_t history;
+    if (load_history_index(&history) != 0) {
+        return;
+    }
+
+    FILE *fp = open_git_stream("git -c core.quotePath=false ls-files --full-name");
+    if (!fp) {
+        unmap_file(&history.file);
+        return;
+    }
+
+    // Counts follow renames, so files keep their history across moves. Only the top
+    // MAX_FILES are kept, so memory does not grow with the number of tracked files.
+    uint32_t positions[MAX_FILES];
+    file_info_t candidate;
+    file_count = 0;
+    char *line = NULL;
+    size_t capacity = 0;
+    while (read_stream_line(fp, &line, &capacity) >= 0) {
+        // Listed submodules are reported by their own files instead
+        if (!line[0] || is_submodule_path(line)) continue;
+        memset(&candidate, 0, sizeof(candidate));
+        strncpy(candidate.path, line, MAX_PATH_LENGTH - 1);
+
+        uint32_t newest = UINT32_MAX;
+        int id = name_table_find(&history.paths, line);
+        if (id >= 0) {
+            uint32_t *commits = NULL;
+            int names_followed = 0;
+            candidate.changes = history_collect(&history, id, &commits, &names_followed);
+            if (candidate.changes > 0) newest = commits[0];
+            free(commits);
+        }
+
+        if (file_count < MAX_FILES) {
+            files[file_count] = candidate;
+            positions[file_count++] = newest;
+            if (file_count == MAX_FILES) {
+                for (int i = MAX_FILES / 2 - 1; i >= 0; i--) sift_file_heap(files, positions, MAX_FILES, i);
+            }
+        } else if (compare_file_changes(&candidate, &files[0]) < 0) {
+            files[0] = candidate;
+            positions[0] = newest;
+            sift_file_heap(files, positions, MAX_FILES, 0);
+        }
+    }
+    pclose(fp);
+    free(line);
+
+    for (int i = 0; i < file_count; i++) {
+        if (positions[i] == UINT32_MAX) continue;
+        char subject[MAX_LINE_LENGTH];
+        oid_to_hex(history.oids + 20 * (size_t)positions[i], files[i].last_commit);
+        history_commit_text(&history, positions[i], files[i].last_author, sizeof(files[i].last_author), subject, sizeof(subject));
+    }
+    qsort(files, file_count, sizeof(file_info_t), compare_file_changes);
+    unmap_file(&history.file);
+}
+
+void show_hot_files() 
+{
+    printf("🔥 Frequently Changed Files\n");
+    printf("===========================\n");
+    
+    if (file_count == 0) {
+        printf("No files found in repository.\n\n");
+        return;
+    }
+    
+    for (int i = 0; i < file_count - 1; i++) {
+        for (int j = 0; j < file_count - i - 1; j++) {
+            if (files[j].changes < files[j + 1].changes) {
+                file_info_t temp = files[j];
+                files[j] = files[j + 1];
+                files[j + 1] = temp;
+            }
+        }
+    }
+    
+    int count = (file_count < 10) ? file_count : 10;
+    printf("Top %d most frequently changed files:\n", count);
+    for (int i = 0; i < count; i++) {
+        if (files[i].last_author[0]) {
+            printf("%3d changes: %s (last by: %s)\n", files[i].changes, files[i].path, files[i].last_author);
+        } else {
+            printf("%3d changes: %s\n", files[i].changes, files[i].path);
+        }
+    }
+    printf("\n");
+}
+
+// ==================== DIRECTORY ROLLUPS ====================
+
+#define ROLLUP_TOP 10
+
+// Path-prefix trie of every path history touched. Components are interned once, each node's
+// children are kept sorted by component id, and directory totals come from one post-order
+// pass after the walk, so any depth can be reported from the same trie.
+typedef struct {
+    uint32_t component;
+    uint32_t child_count;
+    uint32_t *children;         // capacity is the next power of two of child_count
+    union {
+        uint32_t *list;         // sorted ids; folded into the parent and freed by the rollup
+        uint32_t single;        // most paths only ever see one author
+    } authors;
+    uint32_t author_count;
+    uint32_t changes;
+    long long insertions, deletions;
+} trie_node_t;
+
+typedef struct {
+    path_table_t components;
+    path_table_t authors;
+    trie_node_t *nodes;
+    uint32_t node_count, node_capacity;
+    uint32_t current_author;
+} path_trie_t;
+
+// Grows an array whenever its length reaches a power of two, so no capacity is stored
+static void* grow_pow2(void *array, uint32_t count, size_t element) 
+{
+    if (count & (count - 1)) return array;
+    return realloc(array, element * (count ? (size_t)count * 2 : 1));
+}
+
+static uint32_t trie_new_node(path_trie_t *trie, uint32_t component) 
+{
+    if (trie->node_count == trie->node_capacity) {
+        trie->node_capacity = trie->node_capacity ? trie->node_capacity * 2 : 1024;
+        trie->nodes = realloc(trie->nodes, sizeof(trie_node_t) * trie->node_capacity);
+    }
+    trie_node_t *node = &trie->nodes[trie->node_count];
+    memset(node, 0, sizeof(*node));
+    node->component = component;
+    return trie->node_count++;
+}
+
+static uint32_t trie_child(path_trie_t *trie, uint32_t parent, const char *name) 
+{
+    uint32_t component = (uint32_t)path_table_intern(&trie->components, name);
+    trie_node_t *node = &trie->nodes[parent];
+    uint32_t low = 0, high = node->child_count;
+    while (low < high) {
+        uint32_t mid = (low + high) / 2;
+        uint32_t c = trie->nodes[node->children[mid]].component;
+        if (c == component) return node->children[mid];
+        if (c < component) low = mid + 1;
+        else high = mid;
+    }
+
+    uint32_t child = trie_new_node(trie, component);
+    node = &trie->nodes[parent];
+    node->children = grow_pow2(node->children, node->child_count, sizeof(uint32_t));
+    memmove(node->children + low + 1, node->children + low, sizeof(uint32_t) * (node->child_count - low));
+    node->children[low] = child;
+    node->child_count++;
+    return child;
+}
+
+static const uint32_t* trie_authors(const trie_node_t *node) 
+{
+    return node->author_count == 1 ? &node->authors.single : node->authors.list;
+}
+
+static void trie_add_author(trie_node_t *node, uint32_t author) 
+{
+    if (node->author_count <= 1) {
+        if (node->author_count == 1 && node->authors.single == author) return;
+        if (node->author_count == 0) {
+            node->authors.single = author;
+            node->author_count = 1;
+            return;
+        }
+        uint32_t first = node->authors.single;
+        node->authors.list = malloc(sizeof(uint32_t) * 2);
+        node->authors.list[0] = first;
+    }
+
+    uint32_t *list = node->authors.list;
+    uint32_t low = 0, high = node->author_count;
+    while (low < high) {
+        uint32_t mid = (low + high) / 2;
+        if (list[mid] == author) return;
+        if (list[mid] < author) low = mid + 1;
+        else high = mid;
+    }
+    list = grow_pow2(list, node->author_count, sizeof(uint32_t));
+    memmove(list + low + 1, list + low, sizeof(uint32_t) * (node->author_count - low));
+    list[low] = author;
+    node->authors.list = list;
+    node->author_count++;
+}
+
+void path_trie_add(path_trie_t *trie, const char *path, uint32_t author, int insertions, int deletions) 
+{
+    if (trie->node_count == 0) trie_new_node(trie, UINT32_MAX);
+    char component[MAX_PATH_LENGTH];
+    uint32_t node = 0;
+    for (const char *p = path; *p;) {
+        const char *slash = strchr(p, '/');
+        size_t length = slash ? (size_t)(slash - p) : strlen(p);
+        if (length >= sizeof(component)) length = sizeof(component) - 1;
+        memcpy(component, p, length);
+        component[length] = '\0';
+        node = trie_child(trie, node, component);
+        p = slash ? slash + 1 : p + strlen(p);
+    }
+    trie_node_t *leaf = &trie->nodes[node];
+    leaf->changes++;
+    leaf->insertions += insertions;
+    leaf->deletions += deletions;
+    trie_add_author(leaf, author);
+}
+
+// Post-order: sums each subtree into its root and replaces author lists with merged counts.
+// Only the lists of a node's children are alive while it is merged.
+static void trie_rollup(path_trie_t *trie, uint32_t id) 
+{
+    for (uint32_t i = 0; i < trie->nodes[id].child_count; i++) {
+        uint32_t child_id = trie->nodes[id].children[i];
+        trie_rollup(trie, child_id);
+        trie_node_t *node = &trie->nodes[id], *child = &trie->nodes[child_id];
+        node->changes += child->changes;
+        node->insertions += child->insertions;
+        node->deletions += child->deletions;
+
+        const uint32_t *mine = trie_authors(node), *theirs = trie_authors(child);
+        uint32_t *merged = malloc(sizeof(uint32_t) * (node->author_count + child->author_count + 1));
+        uint32_t a = 0, b = 0, count = 0;
+        while (a < node->author_count || b < child->author_count) {
+            if (b == child->author_count || (a < node->author_count && mine[a] < theirs[b])) {
+                merged[count++] = mine[a++];
+            } else {
+                if (a < node->author_count && mine[a] == theirs[b]) a++;
+                merged[count++] = theirs[b++];
+            }
+        }
+        if (node->author_count > 1) free(node->authors.list);
+        if (child->author_count > 1) free(child->authors.list);
+        child->authors.list = NULL;
+        node->author_count = count;
+        if (count == 1) {
+            node->authors.single = merged[0];
+            free(merged);
+        } else {
+            node->authors.list = merged;
+        }
+    }
+}
+
+void path_trie_free(path_trie_t *trie) 
+{
+    for (uint32_t i = 0; i < trie->node_count; i++) {
+        free(trie->nodes[i].children);
+        if (trie->nodes[i].author_count > 1) free(trie->nodes[i].authors.list);
+    }
+    free(trie->nodes);
+    path_table_free(&trie->components);
+    path_table_free(&trie->authors);
+    memset(trie, 0, sizeof(*trie));
+}
+
+static int rollup_on_commit(analyzer_t *self, const history_commit_t *c) 
+{
+    path_trie_t *trie = self->state;
+    trie->current_author = (uint32_t)path_table_intern(&trie->authors, c->author);
+    return 1;
+}
+
+static void rollup_on_file_change(analyzer_t *self, const history_commit_t *c, const file_change_t *change) 
+{
+    (void)c;
+    path_trie_t *trie = self->state;
+    path_trie_add(trie, change->path, trie->current_author, change->insertions, change->deletions);
+}
+
+analyzer_t rollup_analyzer(path_trie_t *trie) 
+{
+    analyzer_t analyzer = { "rollup", WALK_NEEDS_FILES | WALK_NEEDS_LINE_STATS, NULL, rollup_on_commit,
+                            rollup_on_file_change, NULL, trie, 0 };
+    memset(trie, 0, sizeof(*trie));
+    return analyzer;
+}
+
+typedef struct {
+    uint32_t changes;
+    uint32_t node;
+    char *path;
+} rollup_entry_t;
+
+typedef struct {
+    const path_trie_t *trie;
+    rollup_entry_t *entries;
+    int count, capacity;
+} rollup_report_t;
+
+static int compare_rollup_entries(const void *a, const void *b) 
+{
+    const rollup_entry_t *x = a, *y = b;
+    if (x->changes != y->changes) return x->changes < y->changes ? 1 : -1;
+    return strcmp(x->path, y->path);
+}
+
+// Picks the directories at `depth`, plus shallower ones that have no subdirectories
+static void collect_rollup_dirs(rollup_report_t *report, uint32_t id, char *path, size_t length, int depth) 
+{
+    const trie_node_t *node = &report->trie->nodes[id];
+    int has_subdirs = 0;
+    for (uint32_t i = 0; i < node->child_count && depth > 0; i++) {
+        const trie_node_t *child = &report->trie->nodes[node->children[i]];
+        if (child->child_count == 0) continue;
+        const char *name = report->trie->components.names[child->component];
+        int written = snprintf(path + length, MAX_PATH_LENGTH - length, "%s/", name);
+        if (written < 0 || length + written >= MAX_PATH_LENGTH) continue;
+        has_subdirs = 1;
+        collect_rollup_dirs(report, node->children[i], path, length + written, depth - 1);
+    }
+    if (has_subdirs || length == 0) return;
+
+    if (report->count == report->capacity) {
+        report->capacity = report->capacity ? report->capacity * 2 : 64;
+        report->entries = realloc(report->entries, sizeof(rollup_entry_t) * report->capacity);
+    }
+    path[length] = '\0';
+    report->entries[report->count].changes = node->changes;
+    report->entries[report->count].node = id;
+    report->entries[report->count++].path = strdup(path);
+}
+
+void show_directory_churn(int depth) 
+{
+    printf("📂 Churn by Directory (depth %d)\n", depth);
+    printf("================================\n");
+
+    path_trie_t trie;
+    analyzer_t analyzer = rollup_analyzer(&trie);
+    analyzer_t *analyzers[] = { &analyzer };
+    run_history_walk(analyzers, 1);
+    if (trie.node_count == 0) {
+        printf("No history found.\n\n");
+        return;
+    }
+    trie_rollup(&trie, 0);
+
+    char path[MAX_PATH_LENGTH];
+    rollup_report_t report = { &trie, NULL, 0, 0 };
+    collect_rollup_dirs(&report, 0, path, 0, depth);
+    if (report.count > 0) qsort(report.entries, report.count, sizeof(rollup_entry_t), compare_rollup_entries);
+
+    const trie_node_t *root = &trie.nodes[0];
+    printf("Whole repository: %u file changes, +%lld -%lld lines, %u authors\n", root->changes,
+           root->insertions, root->deletions, root->author_count);
+    if (report.count == 0) {
+        printf("No directories at this depth.\n\n");
+    } else {
+        int count = report.count < ROLLUP_TOP ? report.count : ROLLUP_TOP;
+        printf("Top %d directories by file changes:\n", count);
+        for (int i = 0; i < count; i++) {
+            const trie_node_t *node = &trie.nodes[report.entries[i].node];
+            printf("%5u changes  +%-7lld -%-7lld %4u authors  %s\n", node->changes, node->insertions,
+                   node->deletions, node->author_count, report.entries[i].path);
+        }
+        printf("\n");
+    }
+
+    for (int i = 0; i < report.count; i++) free(report.entries[i].path);
+    free(report.entries);
+    path_trie_free(&trie);
+}
+
+// ==================== SMART BLAME ====================
+
+void smart_blame(const char *filepath) 
+{
+    if (access(filepath, R_OK) != 0) {
+        printf("❌ File not found or not readable: %s\n", filepath);
+        return;
+    }
+    
+    printf("🔍 Smart Blame: %s\n", filepath);
+    printf("==========================================\n");
+    
+    // Porcelain output is in line order: a "<commit> <orig> <final>" header per line, with the
+    // commit's full author name and summary the first time that commit appears
+    char quoted[MAX_PATH_LENGTH * 4];
+    FILE *fp = NULL;
+    if (shell_quote(filepath, quoted, sizeof(quoted))) {
+        fp = open_git_stream("git blame --porcelain -- %s 2>" NULL_DEVICE, quoted);
+    }
+    if (!fp) {
+        printf("No blame information available.\n\n");
+        return;
+    }
+    struct {
+        char hash[41];
+        char author[256];
+        char summary[512];
+    } seen[10];
+    int seen_count = 0, current = -1, line_num = 0, lines_shown = 0;
+    char *line = NULL;
+    size_t capacity = 0;
+    while (lines_shown < 10 && read_stream_line(fp, &line, &capacity) >= 0) {
+        if (strlen(line) > 41 && line[40] == ' ' && isxdigit((unsigned char)line[0])) {
+            sscanf(line + 41, "%*d %d", &line_num);
+            for (current = 0; current < seen_count && strncmp(seen[current].hash, line, 40) != 0; current++);
+            if (current == seen_count && seen_count < 10) {
+                memset(&seen[seen_count], 0, sizeof(seen[0]));
+                memcpy(seen[seen_count++].hash, line, 40);
+            }
+            if (current == 10) current = -1;
+        } else if (current >= 0 && strncmp(line, "author ", 7) == 0) {
+            snprintf(seen[current].author, sizeof(seen[0].author), "%s", line + 7);
+        } else if (current >= 0 && strncmp(line, "summary ", 8) == 0) {
+            snprintf(seen[current].summary, sizeof(seen[0].summary), "%s", line + 8);
+        } else if (line[0] == '\t' && current >= 0) {
+            printf("%3d: %s - %s\n", line_num, seen[current].author, seen[current].summary);
+            lines_shown++;
+        }
+    }
+    free(line);
+    pclose(fp);
+    
+    if (lines_shown == 0) {
+        printf("No blame information available.\n");
+    } else if (lines_shown == 10) {
+        printf("... (showing first 10 lines)\n");
+    }
+    printf("\n");
+}
+
+// ==================== OWNERSHIP MAP ====================
+
+#define OWNERS_CHUNK_LINES 4000
+#define OWNERS_TOP_AUTHORS 3
+
+typedef struct {
+    char path[MAX_PATH_LENGTH];
+    int directory;
+    int first_line;
+    int last_line;
+} blame_task_t;
+
+typedef struct {
+    int author;
+    long long lines;
+} author_lines_t;
+
+typedef struct {
+    int parent;
+    int depth;
+    long long lines;
+    int files;
+    author_lines_t *authors;
+    int author_count;
+} owner_dir_t;
+
+typedef struct {
+    blame_task_t *tasks;
+    int task_count;
+    mutex_t lock;
+    oid_map_t commit_authors;   // commit -> author id + 1, shared by every worker
+    path_table_t authors;
+    path_table_t dir_names;
+    owner_dir_t *dirs;
+    int dir_capacity;
+    int failed;
+    int tasks_done;
+    progress_t progress;
+} owners_state_t;
+
+static int owners_intern_dir(owners_state_t *s, const char *path) 
+{
+    int id = path_table_find(&s->dir_names, path);
+    if (id >= 0) return id;
+
+    int parent = -1, depth = 0;
+    if (path[0]) {
+        char parent_path[MAX_PATH_LENGTH];
+        snprintf(parent_path, sizeof(parent_path), "%s", path);
+        char *slash = strrchr(parent_path, '/');
+        if (slash) *slash = '\0';
+        else parent_path[0] = '\0';
+        parent = owners_intern_dir(s, parent_path);
+        depth = s->dirs[parent].depth + 1;
+    }
+
+    id = path_table_intern(&s->dir_names, path);
+    if (id >= s->dir_capacity) {
+        s->dir_capacity = s->dir_capacity ? s->dir_capacity * 2 : 256;
+        s->dirs = realloc(s->dirs, sizeof(owner_dir_t) * s->dir_capacity);
+    }
+    memset(&s->dirs[id], 0, sizeof(owner_dir_t));
+    s->dirs[id].parent = parent;
+    s->dirs[id].depth = depth;
+    return id;
+}
+
+static void owners_credit(owners_state_t *s, int dir, int author, long long lines) 
+{
+    for (; dir >= 0; dir = s->dirs[dir].parent) {
+        owner_dir_t *d = &s->dirs[dir];
+        d->lines += lines;
+        int i = 0;
+        while (i < d->author_count && d->authors[i].author != author) i++;
+        if (i == d->author_count) {
+            d->authors = realloc(d->authors, sizeof(author_lines_t) * (d->author_count + 1));
+            d->authors[d->author_count].author = author;
+            d->authors[d->author_count++].lines = 0;
+        }
+        d->authors[i].lines += lines;
+    }
+}
+
+// Blames one file (or one -L range of a large one) and credits its lines under a single lock
+static void owners_blame_task(void *context, int index) 
+{
+    owners_state_t *s = context;
+    const blame_task_t *task = &s->tasks[index];
+
+    char range[64] = "", quoted[MAX_PATH_LENGTH * 4];
+    if (task->first_line > 0) snprintf(range, sizeof(range), "-L %d,%d ", task->first_line, task->last_line);
+    FILE *fp = NULL;
+    if (shell_quote(task->path, quoted, sizeof(quoted))) {
+        fp = open_git_stream("git blame --porcelain %sHEAD -- %s 2>" NULL_DEVICE, range, quoted);
+    }
+    if (!fp) {
+        mutex_lock(&s->lock);
+        progress_update(&s->progress, ++s->tasks_done);
+        s->failed++;
+        mutex_unlock(&s->lock);
+        return;
+    }
+
+    // --porcelain prints a commit's metadata only the first time this process meets it
+    oid_map_t line_counts = {0};
+    path_table_t local_authors = {0};
+    oid_map_t local_commit_authors = {0};
+    unsigned char current[20];
+    int have_current = 0;
+    char *line = NULL;
+    size_t capacity = 0;
+    while (read_stream_line(fp, &line, &capacity) >= 0) {
+        if (line[0] == '\t') continue;
+        if (strlen(line) > 41 && line[40] == ' ' && hex_to_oid(line, current) == 0) {
+            (*oid_map_insert(&line_counts, current, NULL))++;
+            have_current = 1;
+        } else if (have_current && strncmp(line, "author ", 7) == 0) {
+            *oid_map_insert(&local_commit_authors, current, NULL) = path_table_intern(&local_authors, line + 7) + 1;
+        }
+    }
+    free(line);
+    int status = pclose(fp);
+
+    mutex_lock(&s->lock);
+    progress_update(&s->progress, ++s->tasks_done);
+    if (status != 0 && line_counts.count == 0) s->failed++;
+    for (size_t i = 0; i < line_counts.capacity; i++) {
+        if (!line_counts.entries[i].used) continue;
+        const unsigned char *oid = line_counts.entries[i].oid;
+        long long *author = oid_map_insert(&s->commit_authors, oid, NULL);
+        if (*author == 0) {
+            long long *local = oid_map_find(&local_commit_authors, oid);
+            *author = path_table_intern(&s->authors, local ? local_authors.names[*local - 1] : "Unknown") + 1;
+        }
+        owners_credit(s, task->directory, (int)(*author - 1), line_counts.entries[i].value);
+    }
+    mutex_unlock(&s->lock);
+
+    oid_map_free(&line_counts);
+    oid_map_free(&local_commit_authors);
+    path_table_free(&local_authors);
+}
+
+static int compare_blame_tasks(const void *a, const void *b) 
+{
+    const blame_task_t *x = a, *y = b;
+    int x_lines = x->last_line - x->first_line, y_lines = y->last_line - y->first_line;
+    if (x_lines != y_lines) return y_lines - x_lines;
+    return strcmp(x->path, y->path);
+}
+
+static int compare_author_lines(const void *a, const void *b) 
+{
+    const author_lines_t *x = a, *y = b;
+    if (x->lines != y->lines) return y->lines > x->lines ? 1 : -1;
+    return x->author - y->author;
+}
+
+static void print_owner_dir(const owners_state_t *s, int id, int max_depth, int base_depth) 
+{
+    const owner_dir_t *d = &s->dirs[id];
+    if (d->lines == 0) return;
+    printf("%*s%s/  %lld lines, %d files:", 2 * (d->depth - base_depth) + 2, "",
+           s->dir_names.names[id][0] ? s->dir_names.names[id] : ".", d->lines, d->files);
+    for (int i = 0; i < d->author_count && i < OWNERS_TOP_AUTHORS; i++) {
+        printf("%s %s %.1f%%", i ? "," : "", s->authors.names[d->authors[i].author],
+               100.0 * d->authors[i].lines / d->lines);
+    }
+    printf("\n");
+    if (d->depth - base_depth >= max_depth) return;
+
+    // Children, largest first
+    int *children = malloc(sizeof(int) * s->dir_names.count);
+    int child_count = 0;
+    for (int i = 0; i < s->dir_names.count; i++) {
+        if (s->dirs[i].parent == id && s->dirs[i].lines > 0) children[child_count++] = i;
+    }
+    for (int i = 1; i < child_count; i++) {
+        int c = children[i], j = i;
+        while (j > 0 && s->dirs[children[j-1]].lines < s->dirs[c].lines) {
+            children[j] = children[j-1];
+            j--;
+        }
+        children[j] = c;
+    }
+    for (int i = 0; i < child_count; i++) print_owner_dir(s, children[i], max_depth, base_depth);
+    free(children);
+}
+
+// Who wrote the lines that survive at HEAD, per author and per directory
+void show_ownership_map(const char *target, int jobs, int max_depth) 
+{
+    char path[MAX_PATH_LENGTH] = "";
+    if (target) normalize_repo_path(target, path, sizeof(path));
+    size_t length = strlen(path);
+    while (length > 0 && path[length - 1] == '/') path[--length] = '\0';
+
+    // Blame and grep paths are all relative to the top level from here on
+    if (discover_repository() != 0 || !repo.worktree[0] || chdir(repo.worktree) != 0) {
+        printf("Unable to find the repository top level\n\n");
+        return;
+    }
+
+    printf("👥 Code Ownership: %s\n", path[0] ? path : "(repository root)");
+    printf("==============================\n");
+
+    owners_state_t s;
+    memset(&s, 0, sizeof(s));
+    int root = owners_intern_dir(&s, path);
+
+    // Line counts for every text file at HEAD in one pass; binary files have no owners to speak of
+    char quoted[MAX_PATH_LENGTH * 4];
+    FILE *fp = NULL;
+    if (shell_quote(path[0] ? path : ".", quoted, sizeof(quoted))) {
+        fp = open_git_stream("git -c core.quotePath=false grep -I -c -e \"\" HEAD -- %s 2>" NULL_DEVICE, quoted);
+    }
+    if (!fp) {
+        printf("Unable to list tracked files\n\n");
+        return;
+    }
+
+    int task_capacity = 0, file_count = 0;
+    char *line = NULL;
+    size_t capacity = 0;
+    while (read_stream_line(fp, &line, &capacity) >= 0) {
+        char *name = strncmp(line, "HEAD:", 5) == 0 ? line + 5 : line;
+        char *separator = strrchr(name, ':');
+        if (!separator) continue;
+        *separator = '\0';
+        int lines = atoi(separator + 1);
+        if (lines <= 0 || strlen(name) >= MAX_PATH_LENGTH) continue;
+
+        char dir[MAX_PATH_LENGTH];
+        snprintf(dir, sizeof(dir), "%s", name);
+        char *slash = strrchr(dir, '/');
+        if (slash) *slash = '\0';
+        else dir[0] = '\0';
+        int dir_id = owners_intern_dir(&s, dir);
+        s.dirs[dir_id].files++;
+        for (int p = s.dirs[dir_id].parent; p >= 0; p = s.dirs[p].parent) s.dirs[p].files++;
+        file_count++;
+
+        // Very large files are split so one file cannot hold up the whole pool
+        for (int first = 1; first <= lines; first += OWNERS_CHUNK_LINES) {
+            if (s.task_count == task_capacity) {
+                task_capacity = task_capacity ? task_capacity * 2 : 1024;
+                s.tasks = realloc(s.tasks, sizeof(blame_task_t) * task_capacity);
+            }
+            blame_task_t *task = &s.tasks[s.task_count++];
+            snprintf(task->path, sizeof(task->path), "%s", name);
+            task->directory = dir_id;
+            task->first_line = lines > OWNERS_CHUNK_LINES ? first : 0;
+            task->last_line = lines > OWNERS_CHUNK_LINES ? (first + OWNERS_CHUNK_LINES - 1 < lines ? first + OWNERS_CHUNK_LINES - 1 : lines) : lines;
+        }
+    }
+    free(line);
+    pclose(fp);
+
+    if (file_count == 0) {
+        printf("No tracked text files under this path.\n\n");
+        free(s.tasks);
+        path_table_free(&s.dir_names);
+        free(s.dirs);
+        return;
+    }
+
+    printf("Blaming %d files (%d tasks) on %d workers...\n\n", file_count, s.task_count, jobs);
+    qsort(s.tasks, s.task_count, sizeof(blame_task_t), compare_blame_tasks);
+    mutex_init(&s.lock);
+    progress_begin(&s.progress, "Blaming", "tasks", s.task_count);
+    parallel_for(s.task_count, jobs, owners_blame_task, &s);
+    progress_end(&s.progress);
+    mutex_destroy(&s.lock);
+
+    for (int i = 0; i < s.dir_names.count; i++) {
+        if (s.dirs[i].author_count > 0) {
+            qsort(s.dirs[i].authors, s.dirs[i].author_count, sizeof(author_lines_t), compare_author_lines);
+        }
+    }
+
+    const owner_dir_t *top = &s.dirs[root];
+    printf("Top owners (%lld lines, %d authors):\n", top->lines, s.authors.count);
+    for (int i = 0; i < top->author_count && i < 10; i++) {
+        printf("  %5.1f%%  %-30s %lld lines\n", 100.0 * top->authors[i].lines / top->lines,
+               s.authors.names[top->authors[i].author], top->authors[i].lines);
+    }
+
+    printf("\nOwnership by directory:\n");
+    print_owner_dir(&s, root, max_depth, top->depth);
+    if (s.failed > 0) printf("\n⚠️  %d blame tasks failed\n", s.failed);
+    printf("\n");
+
+    for (int i = 0; i < s.dir_names.count; i++) free(s.dirs[i].authors);
+    free(s.dirs);
+    free(s.tasks);
+    path_table_free(&s.dir_names);
+    path_table_free(&s.authors);
+    oid_map_free(&s.commit_authors);
+}
+
+// ==================== CLEANUP SUGGESTIONS ====================
+
+void show_cleanup_suggestions() 
+{
+    printf("🧹 Cleanup Suggestions\n");
+    printf("=====================\n");
+    
+    char *status = run_git_command_output("git status --porcelain");
+    if (status && strlen(status) > 0) {
+        int untracked = 0, modified = 0;
+        char *line = strtok(status, "\n");
+        while (line) {
+            if (line[0] == '?') untracked++;
+            else modified++;
+            line = strtok(NULL, "\n");
+        }
+        
+        if (modified > 0) printf("📝 Modified files: %d (consider committing changes)\n", modified);
+        if (untracked > 0) printf("❓ Untracked files: %d (consider adding to .gitignore)\n", untracked);
+        
+        if (modified == 0 && untracked == 0) {
+            printf("✅ Working directory is clean\n");
+        }
+    } else {
+        printf("✅ Working directory is clean\n");
+    }
+    
+    char *stash = run_git_command_output("git stash list");
+    if (stash && strlen(stash) > 0) {
+        int stash_count = 0;
+        char *line = strtok(stash, "\n");
+        while (line) {
+            stash_count++;
+            line = strtok(NULL, "\n");
+        }
+        printf("💼 Stashed changes: %d (consider reviewing or applying)\n", stash_count);
+    }
+    
+    printf("\n");
+}
+
+// ==================== WORKING TREE ====================
+
+// Direct reads of the index, the config and working-tree files, shared by the diff engine
+// and the shell prompt
+#define INDEX_ENTRY_HEADER 62
+#define INDEX_CHUNK 512          // entries per worker-pool task when stat-ing the checkout
+
+typedef struct {
+    uint32_t mtime, mtime_nsec, ino, size, mode;
+    uint16_t flags, extended;
+    unsigned char oid[20];
+    size_t path;    // offset into git_index_t.paths
+} index_entry_t;
+
+typedef struct {
+    mapped_file_t file;
+    index_entry_t *entries;
+    int count;
+    char *paths;
+    size_t paths_size;
+    uint32_t version;
+} git_index_t;
+
+#define INDEX_PATH(index, i) ((index)->paths + (index)->entries[i].path)
+
+void free_git_index(git_index_t *index) 
+{
+    unmap_file(&index->file);
+    free(index->entries);
+    free(index->paths);
+    memset(index, 0, sizeof(*index));
+}
+
+// Parses index versions 2-4; paths are copied out so v4's prefix compression is undone
+int load_git_index(git_index_t *index) 
+{
+    char path[MAX_PATH_LENGTH + 16];
+    memset(index, 0, sizeof(*index));
+    snprintf(path, sizeof(path), "%s/index", repo.git_dir);
+    if (map_file(path, &index->file) != 0) return -1;
+    const unsigned char *data = index->file.data, *end = data + index->file.size;
+    if (index->file.size < 12 + 20 || memcmp(data, "DIRC", 4) != 0) {
+        unmap_file(&index->file);
+        return -1;
+    }
+    index->version = get_be32(data + 4);
+    uint32_t count = get_be32(data + 8);
+    if (index->version < 2 || index->version > 4) {
+        unmap_file(&index->file);
+        return -1;
+    }
+
+    index->entries = malloc(sizeof(index_entry_t) * (count + 1));
+    size_t capacity = index->file.size + 4096, previous = 0, previous_length = 0;
+    index->paths = malloc(capacity);
+    const unsigned char *p = data + 12;
+    for (uint32_t i = 0; i < count; i++) {
+        if (end - p < INDEX_ENTRY_HEADER + 2) break;
+        index_entry_t *entry = &index->entries[index->count];
+        entry->mtime = get_be32(p + 8);
+        entry->mtime_nsec = get_be32(p + 12);
+        entry->ino = get_be32(p + 20);
+        entry->mode = get_be32(p + 24);
+        entry->size = get_be32(p + 36);
+        memcpy(entry->oid, p + 40, 20);
+        entry->flags = (uint16_t)((p[60] << 8) | p[61]);
+        entry->extended = 0;
+        const unsigned char *name = p + INDEX_ENTRY_HEADER;
+        if ((entry->flags & 0x4000) && index->version >= 3) {
+            entry->extended = (uint16_t)((p[62] << 8) | p[63]);
+            name += 2;
+        }
+
+        size_t strip = 0;
+        if (index->version == 4) {
+            // Offset varint: how many bytes of the previous path to drop
+            unsigned char c = *name++;
+            strip = c & 127;
+            while ((c & 128) && name < end) {
+                c = *name++;
+                strip = ((strip + 1) << 7) | (c & 127);
+            }
+            if (strip > previous_length) break;
+        }
+        const unsigned char *nul = memchr(name, '\0', end - name);
+        if (!nul) break;
+        size_t keep = index->version == 4 ? previous_length - strip : 0, suffix = nul - name;
+
+        if (index->paths_size + keep + suffix + 1 > capacity) {
+            capacity = (index->paths_size + keep + suffix + 1) * 2;
+            index->paths = realloc(index->paths, capacity);
+        }
+        char *out = index->paths + index->paths_size;
+        memmove(out, index->paths + previous, keep);
+        memcpy(out + keep, name, suffix);
+        out[keep + suffix] = '\0';
+        entry->path = previous = index->paths_size;
+        previous_length = keep + suffix;
+        index->paths_size += previous_length + 1;
+        index->count++;
+
+        if (index->version == 4) p = nul + 1;
+        else p += ((name - p) + suffix + 8) & ~(size_t)7;
+    }
+
+    // A split index keeps most entries in a shared file; that layout is not read here
+    while (end - p > 20 + 8) {
+        uint32_t extension_size = get_be32(p + 4);
+        if (memcmp(p, "link", 4) == 0) {
+            free_git_index(index);
+            return -1;
+        }
+        if ((size_t)(end - p) < 8 + (size_t)extension_size) break;
+        p += 8 + extension_size;
+    }
+    return 0;
+}
+
+// SHA-1, for blob ids of working-tree files whose stat data can't settle whether they changed
+typedef struct {
+    uint32_t state[5];
+    uint64_t length;
+    unsigned char block[64];
+    size_t used;
+} sha1_t;
+
+static uint32_t rotate_left(uint32_t x, int n) 
+{
+    return (x << n) | (x >> (32 - n));
+}
+
+static void sha1_block(sha1_t *s, const unsigned char *block) 
+{
+    uint32_t w[80], a = s->state[0], b = s->state[1], c = s->state[2], d = s->state[3], e = s->state[4];
+    for (int i = 0; i < 16; i++) w[i] = get_be32(block + 4 * i);
+    for (int i = 16; i < 80; i++) w[i] = rotate_left(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+    for (int i = 0; i < 80; i++) {
+        uint32_t f, k;
+        if (i < 20) { f = (b & c) | (~b & d); k = 0x5a827999; }
+        else if (i < 40) { f = b ^ c ^ d; k = 0x6ed9eba1; }
+        else if (i < 60) { f = (b & c) | (b & d) | (c & d); k = 0x8f1bbcdc; }
+        else { f = b ^ c ^ d; k = 0xca62c1d6; }
+        uint32_t t = rotate_left(a, 5) + f + e + k + w[i];
+        e = d; d = c; c = rotate_left(b, 30); b = a; a = t;
+    }
+    s->state[0] += a; s->state[1] += b; s->state[2] += c; s->state[3] += d; s->state[4] += e;
+}
+
+void sha1_init(sha1_t *s) 
+{
+    static const uint32_t initial[5] = { 0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476, 0xc3d2e1f0 };
+    memcpy(s->state, initial, sizeof(initial));
+    s->length = 0;
+    s->used = 0;
+}
+
+void sha1_update(sha1_t *s, const void *data, size_t length) 
+{
+    const unsigned char *p = data;
+    s->length += length;
+    while (length > 0) {
+        size_t take = 64 - s->used < length ? 64 - s->used : length;
+        memcpy(s->block + s->used, p, take);
+        s->used += take;
+        p += take;
+        length -= take;
+        if (s->used == 64) {
+            sha1_block(s, s->block);
+            s->used = 0;
+        }
+    }
+}
+
+void sha1_final(sha1_t *s, unsigned char *digest) 
+{
+    uint64_t bits = s->length * 8;
+    unsigned char pad = 0x80, zero = 0, length[8];
+    sha1_update(s, &pad, 1);
+    while (s->used != 56) sha1_update(s, &zero, 1);
+    for (int i = 0; i < 8; i++) length[i] = (unsigned char)(bits >> (56 - 8 * i));
+    sha1_update(s, length, 8);
+    for (int i = 0; i < 5; i++) {
+        digest[4 * i] = (unsigned char)(s->state[i] >> 24);
+        digest[4 * i + 1] = (unsigned char)(s->state[i] >> 16);
+        digest[4 * i + 2] = (unsigned char)(s->state[i] >> 8);
+        digest[4 * i + 3] = (unsigned char)s->state[i];
+    }
+}
+
+// git's id for a file's current content ("blob <size>\0" + bytes); symlinks hash their target
+static int hash_worktree_blob(const char *path, int is_symlink, unsigned char *oid) 
+{
+    sha1_t sha;
+    char header[32];
+    sha1_init(&sha);
+    #ifndef _WIN32
+    if (is_symlink) {
+        char target[MAX_PATH_LENGTH];
+        ssize_t length = readlink(path, target, sizeof(target));
+        if (length < 0) return -1;
+        sha1_update(&sha, header, snprintf(header, sizeof(header), "blob %d", (int)length) + 1);
+        sha1_update(&sha, target, (size_t)length);
+        sha1_final(&sha, oid);
+        return 0;
+    }
+    #else
+    (void)is_symlink;
+    #endif
+    mapped_file_t file;
+    if (map_file(path, &file) != 0) {
+        // map_file refuses empty files
+        FILE *fp = fopen(path, "rb");
+        if (!fp) return -1;
+        fclose(fp);
+        file.data = NULL;
+        file.size = 0;
+        sha1_update(&sha, "blob 0", 7);
+    } else {
+        sha1_update(&sha, header, snprintf(header, sizeof(header), "blob %llu", (unsigned long long)file.size) + 1);
+        sha1_update(&sha, file.data, file.size);
+        unmap_file(&file);
+    }
+    sha1_final(&sha, oid);
+    return 0;
+}
+
+// Whether tracked entry `i` differs from its working-tree file (unmerged paths count once).
+// Stat data decides most entries; ones that are racy (modified in the same second the index
+// was written) or smudged by git are hashed.
+static int index_entry_modified(const git_index_t *index, int i, long long index_mtime, int trust_filemode) 
+{
+    const index_entry_t *entry = &index->entries[i];
+    const char *name = INDEX_PATH(index, i);
+    if ((entry->flags >> 12) & 3) return i == 0 || strcmp(name, INDEX_PATH(index, i - 1)) != 0;
+    uint32_t type = entry->mode & 0170000;
+    if ((entry->extended & 0x4000) || type == 0160000 || type == 0040000) return 0;
+    if (entry->extended & 0x2000) return 1;
+
+    char path[MAX_PATH_LENGTH * 2];
+    snprintf(path, sizeof(path), "%s/%s", repo.worktree, name);
+    #ifdef _WIN32
+    struct _stat64 info;
+    if (_stat64(path, &info) != 0) return 1;
+    int is_symlink = 0, same_inode = 1;
+    (void)trust_filemode;
+    #else
+    struct stat info;
+    if (lstat(path, &info) != 0) return 1;
+    int is_symlink = S_ISLNK(info.st_mode);
+    if (is_symlink != (type == 0120000) ||
+        (trust_filemode && !is_symlink && (entry->mode & 0100) != (info.st_mode & 0100))) {
+        return 1;
+    }
+    int same_inode = !entry->ino || entry->ino == (uint32_t)info.st_ino;
+    #endif
+    if (entry->size != (uint32_t)info.st_size && entry->size != 0) return 1;
+    if (entry->size == (uint32_t)info.st_size && entry->mtime == (uint32_t)info.st_mtime && same_inode &&
+        (long long)info.st_mtime < index_mtime) {
+        return 0;
+    }
+    unsigned char oid[20];
+    return hash_worktree_blob(path, is_symlink, oid) != 0 || memcmp(oid, entry->oid, 20) != 0;
+}
+
+// One value from the repository's config file, e.g. ("branch", "main", "merge")
+static int read_config_value(const char *section, const char *subsection, const char *key, char *out, size_t size) 
+{
+    char path[MAX_PATH_LENGTH + 16], line[MAX_LINE_LENGTH];
+    snprintf(path, sizeof(path), "%s/config", repo.common_dir);
+    FILE *fp = fopen(path, "r");
+    if (!fp) return -1;
+    int in_section = 0, found = -1;
+    while (fgets(line, sizeof(line), fp)) {
+        char *p = line;
+        while (*p == ' ' || *p == '\t') p++;
+        p[strcspn(p, "\r\n")] = '\0';
+        if (*p == '[') {
+            char name[MAX_LINE_LENGTH], sub[MAX_LINE_LENGTH] = "";
+            char *close = strchr(p, ']'), *quote = strchr(p, '"');
+            if (!close) continue;
+            if (quote && quote < close) {
+                char *end = strrchr(p, '"');
+                snprintf(name, sizeof(name), "%.*s", (int)(quote - p - 1), p + 1);
+                snprintf(sub, sizeof(sub), "%.*s", (int)(end - quote - 1), quote + 1);
+            } else {
+                snprintf(name, sizeof(name), "%.*s", (int)(close - p - 1), p + 1);
+            }
+            size_t n = strcspn(name, " \t");
+            name[n] = '\0';
+            in_section = strcasecmp(name, section) == 0 && strcmp(sub, subsection ? subsection : "") == 0;
+            continue;
+        }
+        if (!in_section || *p == '#' || *p == ';') continue;
+        size_t key_length = strcspn(p, " \t=");
+        if (key_length != strlen(key) || strncasecmp(p, key, key_length) != 0) continue;
+        char *value = strchr(p, '=');
+        value = value ? value + 1 : "true";
+        while (*value == ' ' || *value == '\t') value++;
+        size_t length = strlen(value);
+        while (length > 0 && (value[length - 1] == ' ' || value[length - 1] == '\t')) value[--length] = '\0';
+        if (length >= 2 && value[0] == '"' && value[length - 1] == '"') {
+            value[length - 1] = '\0';
+            value++;
+        }
+        snprintf(out, size, "%s", value);
+        found = 0;   // later assignments win, as in git
+    }
+    fclose(fp);
+    return found;
+}
+
+// ==================== DIFF ENGINE ====================
+
+// In-process `git diff`: file pairs come from a tree listing, the index and a stat of the
+// working tree; blob contents are read through one cat-file --batch process and working-tree
+// files are mapped. Line diffs (Myers, or histogram when diff.algorithm asks for patience or
+// histogram) run on the worker pool.
+#define DIFF_CONTEXT 3
+#define DIFF_MAX_COST 4096          // edit distance at which Myers settles for a non-minimal split
+#define DIFF_HISTOGRAM_MAX_CHAIN 64
+#define DIFF_BATCH 512              // files whose blobs are held in memory at once
+#define DIFF_BINARY_PROBE 8000
+
+typedef struct {
+    int old_start, old_count, new_start, new_count;   // 0-based starts
+} diff_hunk_t;
+
+typedef struct {
+    unsigned char oid[20];
+    uint32_t mode;          // 0 when the path does not exist on this side
+    int from_disk;          // content is the working-tree file
+} diff_side_t;
+
+typedef struct {
+    char *path;
+    char status;            // 'A', 'D', 'M', or 'U' for unmerged paths (not diffed)
+    diff_side_t old_side, new_side;
+    int binary;
+    int insertions, deletions;
+    diff_hunk_t *hunks;
+    int hunk_count;
+    char *patch;
+    size_t patch_size;
+} file_diff_t;
+
+typedef struct {
+    file_diff_t *files;
+    int count, capacity;
+    int insertions, deletions;
+} diff_result_t;
+
+typedef struct {
+    char *path;
+    uint32_t mode;
+    unsigned char oid[20];
+} tree_entry_t;
+
+void free_diff_result(diff_result_t *result) 
+{
+    for (int i = 0; i < result->count; i++) {
+        free(result->files[i].path);
+        free(result->files[i].hunks);
+        free(result->files[i].patch);
+    }
+    free(result->files);
+    memset(result, 0, sizeof(*result));
+}
+
+static void add_file_diff(diff_result_t *result, const char *path, char status,
+                          const diff_side_t *old_side, const diff_side_t *new_side) 
+{
+    if (result->count == result->capacity) {
+        result->capacity = result->capacity ? result->capacity * 2 : 64;
+        result->files = realloc(result->files, sizeof(file_diff_t) * result->capacity);
+    }
+    file_diff_t *file = &result->files[result->count++];
+    memset(file, 0, sizeof(*file));
+    file->path = strdup(path);
+    file->status = status;
+    if (old_side) file->old_side = *old_side;
+    if (new_side) file->new_side = *new_side;
+}
+
+static int compare_tree_entries(const void *a, const void *b) 
+{
+    return strcmp(((const tree_entry_t *)a)->path, ((const tree_entry_t *)b)->path);
+}
+
+static void free_tree_listing(tree_entry_t *entries, int count) 
+{
+    for (int i = 0; i < count; i++) free(entries[i].path);
+    free(entries);
+}
+
+// Every blob under `rev`, sorted by path (gitlinks are left out); -1 if rev has no tree
+static int load_tree_listing(const char *rev, tree_entry_t **entries, int *count) 
+{
+    *entries = NULL;
+    *count = 0;
+    char tree[41];
+    char *resolved = run_git_command_output("git rev-parse --verify -q \"%s^{tree}\" 2>" NULL_DEVICE, rev);
+    if (!resolved || strlen(resolved) != 40) return -1;
+    snprintf(tree, sizeof(tree), "%s", resolved);
+
+    FILE *fp = open_git_stream("git -c core.quotePath=false ls-tree -r --full-tree %s", tree);
+    if (!fp) return -1;
+    int capacity = 0;
+    char *line = NULL;
+    size_t line_capacity = 0;
+    while (read_stream_line(fp, &line, &line_capacity) >= 0) {
+        // <mode> SP <type> SP <oid> TAB <path>
+        char *p, *tab = strchr(line, '\t');
+        uint32_t mode = (uint32_t)strtoul(line, &p, 8);
+        if (!tab || strncmp(p, " blob ", 6) != 0 || tab - (p + 6) != 40) continue;
+        if (*count == capacity) {
+            capacity = capacity ? capacity * 2 : 256;
+            *entries = realloc(*entries, sizeof(tree_entry_t) * capacity);
+        }
+        tree_entry_t *entry = &(*entries)[*count];
+        if (hex_to_oid(p + 6, entry->oid) != 0) continue;
+        entry->mode = mode;
+        entry->path = strdup(tab + 1);
+        (*count)++;
+    }
+    free(line);
+    pclose(fp);
+    qsort(*entries, *count, sizeof(tree_entry_t), compare_tree_entries);
+    return 0;
+}
+
+static long long index_file_mtime() 
+{
+    char path[MAX_PATH_LENGTH + 16];
+    snprintf(path, sizeof(path), "%s/index", repo.git_dir);
+    #ifdef _WIN32
+    struct _stat64 info;
+    if (_stat64(path, &info) == 0) return info.st_mtime;
+    #else
+    struct stat info;
+    if (stat(path, &info) == 0) return info.st_mtime;
+    #endif
+    return 0;
+}
+
+static int trust_filemode() 
+{
+    char filemode[16] = "true";
+    read_config_value("core", NULL, "filemode", filemode, sizeof(filemode));
+    return strcasecmp(filemode, "false") != 0;
+}
+
+// HEAD against the index: what `git diff --staged` shows
+int diff_staged(diff_result_t *result) 
+{
+    memset(result, 0, sizeof(*result));
+    git_index_t index;
+    tree_entry_t *tree;
+    int tree_count;
+    if (load_git_index(&index) != 0) memset(&index, 0, sizeof(index));
+    if (load_tree_listing("HEAD", &tree, &tree_count) != 0) tree_count = 0;   // unborn branch
+
+    int t = 0;
+    for (int i = 0; i <= index.count; i++) {
+        const char *name = i < index.count ? INDEX_PATH(&index, i) : NULL;
+        const index_entry_t *entry = i < index.count ? &index.entries[i] : NULL;
+        // Tree paths that sort before this entry are gone from the index
+        while (t < tree_count && (!name || strcmp(tree[t].path, name) < 0)) {
+            diff_side_t old_side = { {0}, tree[t].mode, 0 };
+            memcpy(old_side.oid, tree[t].oid, 20);
+            add_file_diff(result, tree[t].path, 'D', &old_side, NULL);
+            t++;
+        }
+        if (!entry) break;
+        int in_tree = t < tree_count && strcmp(tree[t].path, name) == 0;
+        if ((entry->flags >> 12) & 3) {
+            if (i == 0 || strcmp(name, INDEX_PATH(&index, i - 1)) != 0) add_file_diff(result, name, 'U', NULL, NULL);
+            if (in_tree && (i + 1 == index.count || strcmp(name, INDEX_PATH(&index, i + 1)) != 0)) t++;
+            continue;
+        }
+        if ((entry->mode & 0170000) == 0160000 || (entry->extended & 0x2000)) {
+            if (in_tree) t++;
+            continue;
+        }
+        diff_side_t new_side = { {0}, entry->mode, 0 };
+        memcpy(new_side.oid, entry->oid, 20);
+        if (!in_tree) {
+            add_file_diff(result, name, 'A', NULL, &new_side);
+            continue;
+        }
+        if (memcmp(tree[t].oid, entry->oid, 20) != 0 || tree[t].mode != entry->mode) {
+            diff_side_t old_side = { {0}, tree[t].mode, 0 };
+            memcpy(old_side.oid, tree[t].oid, 20);
+            add_file_diff(result, name, 'M', &old_side, &new_side);
+        }
+        t++;
+    }
+    free_tree_listing(tree, tree_count);
+    free_git_index(&index);
+    return 0;
+}
+
+typedef struct {
+    const git_index_t *index;
+    long long index_mtime;
+    int trust_filemode;
+    char *modified;
+} worktree_scan_t;
+
+static void scan_worktree_chunk(void *context, int chunk) 
+{
+    worktree_scan_t *scan = context;
+    int last = (chunk + 1) * INDEX_CHUNK < scan->index->count ? (chunk + 1) * INDEX_CHUNK : scan->index->count;
+    for (int i = chunk * INDEX_CHUNK; i < last; i++) {
+        scan->modified[i] = (char)index_entry_modified(scan->index, i, scan->index_mtime, scan->trust_filemode);
+    }
+}
+
+// The working-tree side of index entry `i` once stat data says it changed
+static void worktree_side(const index_entry_t *entry, const char *name, int trust, diff_side_t *side) 
+{
+    char path[MAX_PATH_LENGTH * 2];
+    snprintf(path, sizeof(path), "%s/%s", repo.worktree, name);
+    memset(side, 0, sizeof(*side));
+    #ifdef _WIN32
+    struct _stat64 info;
+    if (_stat64(path, &info) != 0 || (info.st_mode & S_IFDIR)) return;
+    side->mode = 0100644;
+    (void)trust;
+    #else
+    struct stat info;
+    if (lstat(path, &info) != 0 || S_ISDIR(info.st_mode)) return;
+    if (S_ISLNK(info.st_mode)) side->mode = 0120000;
+    else if (trust) side->mode = (info.st_mode & 0100) ? 0100755 : 0100644;
+    else side->mode = (entry->mode & 0170000) == 0100000 ? entry->mode : 0100644;
+    #endif
+    side->from_disk = 1;
+}
+
+// `base` (a revision, or the index when NULL) against the working tree: `git diff [base]`
+int diff_worktree(const char *base, diff_result_t *result) 
+{
+    memset(result, 0, sizeof(*result));
+    if (!repo.worktree[0]) return -1;
+    git_index_t index;
+    tree_entry_t *tree = NULL;
+    int tree_count = 0;
+    if (base && load_tree_listing(base, &tree, &tree_count) != 0) return -1;
+    if (load_git_index(&index) != 0) memset(&index, 0, sizeof(index));
+
+    // Stat every tracked file up front, in parallel; only the changed ones are read later
+    worktree_scan_t scan = { &index, index_file_mtime(), trust_filemode(), calloc(index.count + 1, 1) };
+    int chunks = (index.count + INDEX_CHUNK - 1) / INDEX_CHUNK;
+    int workers = default_job_count();
+    if (chunks > 0) parallel_for(chunks, workers < chunks ? workers : chunks, scan_worktree_chunk, &scan);
+
+    int t = 0;
+    for (int i = 0; i <= index.count; i++) {
+        const char *name = i < index.count ? INDEX_PATH(&index, i) : NULL;
+        const index_entry_t *entry = i < index.count ? &index.entries[i] : NULL;
+        while (t < tree_count && (!name || strcmp(tree[t].path, name) < 0)) {
+            diff_side_t old_side = { {0}, tree[t].mode, 0 };
+            memcpy(old_side.oid, tree[t].oid, 20);
+            add_file_diff(result, tree[t].path, 'D', &old_side, NULL);
+            t++;
+        }
+        if (!entry) break;
+        int stage = (entry->flags >> 12) & 3;
+        if (stage && i > 0 && strcmp(name, INDEX_PATH(&index, i - 1)) == 0) continue;
+        int in_tree = t < tree_count && strcmp(tree[t].path, name) == 0;
+        if ((entry->mode & 0170000) == 0160000 || (!base && stage)) {
+            if (in_tree) t++;
+            continue;
+        }
+
+        diff_side_t old_side = { {0}, 0, 0 }, new_side = { {0}, entry->mode, 0 };
+        if (base) {
+            if (in_tree) {
+                old_side.mode = tree[t].mode;
+                memcpy(old_side.oid, tree[t].oid, 20);
+                t++;
+            }
+        } else if (!(entry->extended & 0x2000)) {
+            old_side.mode = entry->mode;
+            memcpy(old_side.oid, entry->oid, 20);
+        }
+        if (scan.modified[i] || stage || (entry->extended & 0x2000)) {
+            worktree_side(entry, name, scan.trust_filemode, &new_side);
+            if (stage && new_side.mode == old_side.mode) {
+                // Conflicted files have no index id to compare against; hash the file instead
+                char path[MAX_PATH_LENGTH * 2];
+                snprintf(path, sizeof(path), "%s/%s", repo.worktree, name);
+                if (hash_worktree_blob(path, new_side.mode == 0120000, new_side.oid) == 0 &&
+                    memcmp(new_side.oid, old_side.oid, 20) == 0) {
+                    continue;
+                }
+            }
+        } else {
+            memcpy(new_side.oid, entry->oid, 20);
+            if (old_side.mode == new_side.mode && memcmp(old_side.oid, new_side.oid, 20) == 0) continue;
+        }
+        if (!old_side.mode && !new_side.mode) continue;
+        char status = !old_side.mode ? 'A' : !new_side.mode ? 'D' : 'M';
+        add_file_diff(result, name, status, old_side.mode ? &old_side : NULL, new_side.mode ? &new_side : NULL);
+    }
+    free(scan.modified);
+    free_tree_listing(tree, tree_count);
+    free_git_index(&index);
+    return 0;
+}
+
+// ---- line diff ----
+
+typedef struct {
+    const char *start;
+    int length;             // including the newline, when there is one
+} diff_line_t;
+
+typedef struct {
+    const char *data;
+    size_t size;
+    mapped_file_t map;
+    char *heap;
+} diff_content_t;
+
+typedef struct {
+    const int *a, *b;       // line ids
+    char *changed_a, *changed_b;
+    int *forward, *backward;
+    int use_histogram;
+    int *head, *next, *count;   // histogram scratch, indexed by line id / line of a
+} diff_context_t;
+
+static int split_lines(const char *data, size_t size, diff_line_t **lines) 
+{
+    int count = 0, capacity = 64;
+    *lines = malloc(sizeof(diff_line_t) * capacity);
+    const char *p = data, *end = data + size;
+    while (p < end) {
+        const char *nl = memchr(p, '\n', end - p);
+        const char *next = nl ? nl + 1 : end;
+        if (count == capacity) {
+            capacity *= 2;
+            *lines = realloc(*lines, sizeof(diff_line_t) * capacity);
+        }
+        (*lines)[count].start = p;
+        (*lines)[count].length = (int)(next - p);
+        count++;
+        p = next;
+    }
+    return count;
+}
+
+// Equal lines get equal ids, so the algorithms compare integers
+static int assign_line_ids(const diff_line_t *a, int na, const diff_line_t *b, int nb, int *ids_a, int *ids_b) 
+{
+    size_t capacity = 64;
+    while (capacity < (size_t)(na + nb) * 2) capacity *= 2;
+    typedef struct { uint64_t hash; const diff_line_t *line; int id; } slot_t;
+    slot_t *slots = calloc(capacity, sizeof(slot_t));
+    int next_id = 0;
+    for (int side = 0; side < 2; side++) {
+        const diff_line_t *lines = side ? b : a;
+        int count = side ? nb : na, *ids = side ? ids_b : ids_a;
+        for (int i = 0; i < count; i++) {
+            uint64_t hash = 14695981039346656037ULL;
+            for (int k = 0; k < lines[i].length; k++) {
+                hash ^= (unsigned char)lines[i].start[k];
+                hash *= 1099511628211ULL;
+            }
+            size_t pos = (size_t)hash & (capacity - 1);
+            while (slots[pos].line && !(slots[pos].hash == hash && slots[pos].line->length == lines[i].length &&
+                                        memcmp(slots[pos].line->start, lines[i].start, lines[i].length) == 0)) {
+                pos = (pos + 1) & (capacity - 1);
+            }
+            if (!slots[pos].line) {
+                slots[pos].hash = hash;
+                slots[pos].line = &lines[i];
+                slots[pos].id = next_id++;
+            }
+            ids[i] = slots[pos].id;
+        }
+    }
+    free(slots);
+    return next_id;
+}
+
+// Myers' middle snake in linear space (forward and backward searches meeting halfway).
+// Sets the split point; past DIFF_MAX_COST edits the furthest forward point is used instead.
+static void myers_split(diff_context_t *ctx, int off1, int lim1, int off2, int lim2, int *split1, int *split2) 
+{
+    const int *a = ctx->a + off1, *b = ctx->b + off2;
+    int n = lim1 - off1, m = lim2 - off2;
+    int max_d = (n + m + 1) / 2, offset = max_d + 1;
+    int *v1 = ctx->forward, *v2 = ctx->backward;
+    for (int i = 0; i < 2 * max_d + 3; i++) v1[i] = v2[i] = -1;
+    v1[offset + 1] = v2[offset + 1] = 0;
+    int delta = n - m, odd = delta & 1;
+    int k1_start = 0, k1_end = 0, k2_start = 0, k2_end = 0;
+    int best_x = 0, best_y = 0;
+    for (int d = 0; d < max_d; d++) {
+        for (int k1 = -d + k1_start; k1 <= d - k1_end; k1 += 2) {
+            int x1 = (k1 == -d || (k1 != d && v1[offset + k1 - 1] < v1[offset + k1 + 1]))
+                   ? v1[offset + k1 + 1] : v1[offset + k1 - 1] + 1;
+            int y1 = x1 - k1;
+            while (x1 < n && y1 < m && a[x1] == b[y1]) { x1++; y1++; }
+            v1[offset + k1] = x1;
+            if (x1 > n) k1_end += 2;
+            else if (y1 > m) k1_start += 2;
+            else {
+                if (x1 + y1 > best_x + best_y) { best_x = x1; best_y = y1; }
+                if (odd) {
+                    int k2 = delta - k1;
+                    if (k2 >= -d && k2 <= d && v2[offset + k2] != -1 && x1 >= n - v2[offset + k2]) {
+                        *split1 = off1 + x1;
+                        *split2 = off2 + y1;
+                        return;
+                    }
+                }
+            }
+        }
+        for (int k2 = -d + k2_start; k2 <= d - k2_end; k2 += 2) {
+            int x2 = (k2 == -d || (k2 != d && v2[offset + k2 - 1] < v2[offset + k2 + 1]))
+                   ? v2[offset + k2 + 1] : v2[offset + k2 - 1] + 1;
+            int y2 = x2 - k2;
+            while (x2 < n && y2 < m && a[n - x2 - 1] == b[m - y2 - 1]) { x2++; y2++; }
+            v2[offset + k2] = x2;
+            if (x2 > n) k2_end += 2;
+            else if (y2 > m) k2_start += 2;
+            else if (!odd) {
+                int k1 = delta - k2;
+                if (k1 >= -d && k1 <= d && v1[offset + k1] != -1) {
+                    int x1 = v1[offset + k1];
+                    if (x1 >= n - x2) {
+                        *split1 = off1 + x1;
+                        *split2 = off2 + x1 - k1;
+                        return;
+                    }
+                }
+            }
+        }
+        if (d >= DIFF_MAX_COST && best_x + best_y > 0) break;
+    }
+    *split1 = off1 + best_x;
+    *split2 = off2 + best_y;
+}
+
+static void myers_compare(diff_context_t *ctx, int off1, int lim1, int off2, int lim2) 
+{
+    for (;;) {
+        while (off1 < lim1 && off2 < lim2 && ctx->a[off1] == ctx->b[off2]) { off1++; off2++; }
+        while (off1 < lim1 && off2 < lim2 && ctx->a[lim1 - 1] == ctx->b[lim2 - 1]) { lim1--; lim2--; }
+        if (off1 == lim1 || off2 == lim2) {
+            if (off1 < lim1) memset(ctx->changed_a + off1, 1, lim1 - off1);
+            if (off2 < lim2) memset(ctx->changed_b + off2, 1, lim2 - off2);
+            return;
+        }
+        int split1, split2;
+        myers_split(ctx, off1, lim1, off2, lim2, &split1, &split2);
+        if ((split1 == off1 && split2 == off2) || (split1 == lim1 && split2 == lim2)) {
+            memset(ctx->changed_a + off1, 1, lim1 - off1);
+            memset(ctx->changed_b + off2, 1, lim2 - off2);
+            return;
+        }
+        myers_compare(ctx, off1, split1, off2, split2);
+        off1 = split1;
+        off2 = split2;
+    }
+}
+
+// git's histogram diff (xdiff/xhistogram.c): index a's lines by occurrence count, then take
+// the longest common run whose rarest line is as rare as possible. Regions whose common lines
+// all occur more than DIFF_HISTOGRAM_MAX_CHAIN times fall back to Myers. Common prefix and
+// suffix lines are not trimmed first, since that can move the anchor.
+typedef struct {
+    int begin1, end1, begin2, end2;     // inclusive
+} diff_region_t;
+
+// Returns 1 when the region should fall back to Myers, 0 otherwise; *found is set when `lcs`
+// holds a common run
+static int histogram_find_lcs(diff_context_t *ctx, int off1, int lim1, int off2, int lim2,
+                              diff_region_t *lcs, int *found) 
+{
+    const int *a = ctx->a, *b = ctx->b;
+    for (int i = lim1 - 1; i >= off1; i--) {
+        ctx->next[i] = ctx->head[a[i]];
+        ctx->head[a[i]] = i;
+        ctx->count[a[i]]++;
+    }
+
+    int best_count = DIFF_HISTOGRAM_MAX_CHAIN + 1, has_common = 0;
+    memset(lcs, 0, sizeof(*lcs));
+    *found = 0;
+    for (int b_ptr = off2; b_ptr < lim2;) {
+        int b_next = b_ptr + 1, id = b[b_ptr], occurrences = ctx->count[id];
+        if (occurrences > best_count) {
+            has_common = 1;
+        } else if (occurrences > 0) {
+            has_common = 1;
+            for (int as = ctx->head[id];;) {
+                int np = ctx->next[as], bs = b_ptr, ae = as, be = b_ptr, rc = occurrences;
+                while (as > off1 && bs > off2 && a[as - 1] == b[bs - 1]) {
+                    as--;
+                    bs--;
+                    if (rc > 1 && ctx->count[a[as]] < rc) rc = ctx->count[a[as]];
+                }
+                while (ae < lim1 - 1 && be < lim2 - 1 && a[ae + 1] == b[be + 1]) {
+                    ae++;
+                    be++;
+                    if (rc > 1 && ctx->count[a[ae]] < rc) rc = ctx->count[a[ae]];
+                }
+                if (b_next <= be) b_next = be + 1;
+                if (lcs->end1 - lcs->begin1 < ae - as || rc < best_count) {
+                    *lcs = (diff_region_t){ as, ae, bs, be };
+                    best_count = rc;
+                    *found = 1;
+                }
+                while (np >= 0 && np <= ae) np = ctx->next[np];
+                if (np < 0) break;
+                as = np;
+            }
+        }
+        b_ptr = b_next;
+    }
+
+    for (int i = off1; i < lim1; i++) {
+        ctx->head[a[i]] = -1;
+        ctx->count[a[i]] = 0;
+    }
+    return has_common && best_count > DIFF_HISTOGRAM_MAX_CHAIN;
+}
+
+static void histogram_compare(diff_context_t *ctx, int off1, int lim1, int off2, int lim2) 
+{
+    for (;;) {
+        if (off1 == lim1 || off2 == lim2) {
+            if (off1 < lim1) memset(ctx->changed_a + off1, 1, lim1 - off1);
+            if (off2 < lim2) memset(ctx->changed_b + off2, 1, lim2 - off2);
+            return;
+        }
+        diff_region_t lcs;
+        int found;
+        if (histogram_find_lcs(ctx, off1, lim1, off2, lim2, &lcs, &found)) {
+            myers_compare(ctx, off1, lim1, off2, lim2);
+            return;
+        }
+        if (!found) {
+            memset(ctx->changed_a + off1, 1, lim1 - off1);
+            memset(ctx->changed_b + off2, 1, lim2 - off2);
+            return;
+        }
+        histogram_compare(ctx, off1, lcs.begin1, off2, lcs.begin2);
+        off1 = lcs.end1 + 1;
+        off2 = lcs.end2 + 1;
+    }
+}
+
+// Slides each group of changed lines down while the line after it equals its first line, as
+// git does, so that equivalent diffs get the same hunks
+static void compact_changes(const int *ids, char *changed, int count) 
+{
+    for (int start = 0; start < count;) {
+        if (!changed[start]) {
+            start++;
+            continue;
+        }
+        int end = start;
+        while (end < count && changed[end]) end++;
+        while (end < count && ids[start] == ids[end]) {
+            changed[start++] = 0;
+            changed[end++] = 1;
+            while (end < count && changed[end]) end++;
+        }
+        start = end;
+    }
+}
+
+static void patch_append(file_diff_t *file, size_t *capacity, const char *data, size_t length) 
+{
+    if (file->patch_size + length + 1 > *capacity) {
+        *capacity = (file->patch_size + length + 1) * 2;
+        file->patch = realloc(file->patch, *capacity);
+    }
+    memcpy(file->patch + file->patch_size, data, length);
+    file->patch_size += length;
+    file->patch[file->patch_size] = '\0';
+}
+
+static void patch_append_line(file_diff_t *file, size_t *capacity, char marker, const diff_line_t *line) 
+{
+    patch_append(file, capacity, &marker, 1);
+    patch_append(file, capacity, line->start, line->length);
+    if (line->length == 0 || line->start[line->length - 1] != '\n') {
+        patch_append(file, capacity, "\n\\ No newline at end of file\n", 29);
+    }
+}
+
+static int format_hunk_range(char *out, size_t size, int start, int count) 
+{
+    if (count == 0) return snprintf(out, size, "%d,0", start);
+    if (count == 1) return snprintf(out, size, "%d", start + 1);
+    return snprintf(out, size, "%d,%d", start + 1, count);
+}
+
+static void render_patch_header(file_diff_t *file, size_t *capacity) 
+{
+    char header[MAX_PATH_LENGTH * 3];
+    int length = snprintf(header, sizeof(header), "diff --git a/%s b/%s\n", file->path, file->path);
+    if (file->status == 'A') {
+        length += snprintf(header + length, sizeof(header) - length, "new file mode %06o\n", file->new_side.mode);
+    } else if (file->status == 'D') {
+        length += snprintf(header + length, sizeof(header) - length, "deleted file mode %06o\n", file->old_side.mode);
+    } else if (file->old_side.mode != file->new_side.mode) {
+        length += snprintf(header + length, sizeof(header) - length, "old mode %06o\nnew mode %06o\n",
+                           file->old_side.mode, file->new_side.mode);
+    }
+    if (length >= (int)sizeof(header)) length = (int)sizeof(header) - 1;
+    patch_append(file, capacity, header, length);
+    if (file->binary) {
+        length = snprintf(header, sizeof(header), "Binary files %s%s and %s%s differ\n",
+                          file->old_side.mode ? "a/" : "", file->old_side.mode ? file->path : "/dev/null",
+                          file->new_side.mode ? "b/" : "", file->new_side.mode ? file->path : "/dev/null");
+    } else {
+        length = snprintf(header, sizeof(header), "--- %s%s\n+++ %s%s\n",
+                          file->old_side.mode ? "a/" : "", file->old_side.mode ? file->path : "/dev/null",
+                          file->new_side.mode ? "b/" : "", file->new_side.mode ? file->path : "/dev/null");
+    }
+    if (length >= (int)sizeof(header)) length = (int)sizeof(header) - 1;
+    patch_append(file, capacity, header, length);
+}
+
+static int is_binary_content(const diff_content_t *content) 
+{
+    size_t probe = content->size < DIFF_BINARY_PROBE ? content->size : DIFF_BINARY_PROBE;
+    return probe > 0 && memchr(content->data, '\0', probe) != NULL;
+}
+
+// Counts, hunks and (optionally) unified text for one file from the two contents
+static void diff_contents(file_diff_t *file, const diff_content_t *old_content, const diff_content_t *new_content,
+                          int use_histogram, int want_patch) 
+{
+    size_t capacity = 0;
+    if (is_binary_content(old_content) || is_binary_content(new_content)) {
+        file->binary = 1;
+        if (want_patch) render_patch_header(file, &capacity);
+        return;
+    }
+
+    diff_line_t *lines_a, *lines_b;
+    int na = split_lines(old_content->data, old_content->size, &lines_a);
+    int nb = split_lines(new_content->data, new_content->size, &lines_b);
+    int *ids = malloc(sizeof(int) * (na + nb + 1));
+    int id_count = assign_line_ids(lines_a, na, lines_b, nb, ids, ids + na);
+
+    diff_context_t ctx;
+    memset(&ctx, 0, sizeof(ctx));
+    ctx.a = ids;
+    ctx.b = ids + na;
+    ctx.changed_a = calloc(na + nb + 2, 1);
+    ctx.changed_b = ctx.changed_a + na + 1;
+    ctx.forward = malloc(sizeof(int) * (na + nb + 4));
+    ctx.backward = malloc(sizeof(int) * (na + nb + 4));
+    if (use_histogram) {
+        ctx.head = malloc(sizeof(int) * (id_count + 1));
+        ctx.count = calloc(id_count + 1, sizeof(int));
+        ctx.next = malloc(sizeof(int) * (na + 1));
+        for (int i = 0; i <= id_count; i++) ctx.head[i] = -1;
+        histogram_compare(&ctx, 0, na, 0, nb);
+    } else {
+        myers_compare(&ctx, 0, na, 0, nb);
+    }
+    compact_changes(ctx.a, ctx.changed_a, na);
+    compact_changes(ctx.b, ctx.changed_b, nb);
+
+    // Turn the change marks into runs, then group runs within 2*context lines into hunks
+    int run_capacity = 16, run_count = 0;
+    diff_hunk_t *runs = malloc(sizeof(diff_hunk_t) * run_capacity);
+    for (int i = 0, j = 0; i < na || j < nb;) {
+        if (i < na && j < nb && !ctx.changed_a[i] && !ctx.changed_b[j]) {
+            i++;
+            j++;
+            continue;
+        }
+        int start1 = i, start2 = j;
+        while (i < na && ctx.changed_a[i]) i++;
+        while (j < nb && ctx.changed_b[j]) j++;
+        if (i == start1 && j == start2) break;
+        if (run_count == run_capacity) {
+            run_capacity *= 2;
+            runs = realloc(runs, sizeof(diff_hunk_t) * run_capacity);
+        }
+        runs[run_count++] = (diff_hunk_t){ start1, i - start1, start2, j - start2 };
+        file->deletions += i - start1;
+        file->insertions += j - start2;
+    }
+
+    if (want_patch) render_patch_header(file, &capacity);
+    for (int r = 0; r < run_count;) {
+        int last = r;
+        while (last + 1 < run_count &&
+               runs[last + 1].old_start - (runs[last].old_start + runs[last].old_count) <= 2 * DIFF_CONTEXT) {
+            last++;
+        }
+        int before = runs[r].old_start < DIFF_CONTEXT ? runs[r].old_start : DIFF_CONTEXT;
+        int end1 = runs[last].old_start + runs[last].old_count;
+        int after = na - end1 < DIFF_CONTEXT ? na - end1 : DIFF_CONTEXT;
+        diff_hunk_t hunk = { runs[r].old_start - before, 0, runs[r].new_start - before, 0 };
+        hunk.old_count = end1 + after - hunk.old_start;
+        hunk.new_count = runs[last].new_start + runs[last].new_count + after - hunk.new_start;
+        if (file->hunk_count % 8 == 0) file->hunks = realloc(file->hunks, sizeof(diff_hunk_t) * (file->hunk_count + 8));
+        file->hunks[file->hunk_count++] = hunk;
+
+        if (want_patch) {
+            char header[96], old_range[32], new_range[32];
+            format_hunk_range(old_range, sizeof(old_range), hunk.old_start, hunk.old_count);
+            format_hunk_range(new_range, sizeof(new_range), hunk.new_start, hunk.new_count);
+            patch_append(file, &capacity, header, snprintf(header, sizeof(header), "@@ -%s +%s @@\n", old_range, new_range));
+            int i = hunk.old_start, j = hunk.new_start;
+            for (int k = r; k <= last; k++) {
+                for (; i < runs[k].old_start; i++, j++) patch_append_line(file, &capacity, ' ', &lines_a[i]);
+                for (; i < runs[k].old_start + runs[k].old_count; i++) patch_append_line(file, &capacity, '-', &lines_a[i]);
+                for (; j < runs[k].new_start + runs[k].new_count; j++) patch_append_line(file, &capacity, '+', &lines_b[j]);
+            }
+            for (; i < hunk.old_start + hunk.old_count; i++) patch_append_line(file, &capacity, ' ', &lines_a[i]);
+        }
+        r = last + 1;
+    }
+
+    free(runs);
+    free(ctx.changed_a);
+    free(ctx.forward);
+    free(ctx.backward);
+    free(ctx.head);
+    free(ctx.count);
+    free(ctx.next);
+    free(ids);
+    free(lines_a);
+    free(lines_b);
+}
+
+static void load_disk_content(const char *name, uint32_t mode, diff_content_t *content) 
+{
+    char path[MAX_PATH_LENGTH * 2];
+    snprintf(path, sizeof(path), "%s/%s", repo.worktree, name);
+    #ifndef _WIN32
+    if ((mode & 0170000) == 0120000) {
+        content->heap = malloc(MAX_PATH_LENGTH);
+        ssize_t length = readlink(path, content->heap, MAX_PATH_LENGTH);
+        content->data = content->heap;
+        content->size = length > 0 ? (size_t)length : 0;
+        return;
+    }
+    #else
+    (void)mode;
+    #endif
+    if (map_file(path, &content->map) == 0) {
+        content->data = (const char *)content->map.data;
+        content->size = content->map.size;
+    }
+}
+
+static void free_content(diff_content_t *content) 
+{
+    unmap_file(&content->map);
+    free(content->heap);
+    memset(content, 0, sizeof(*content));
+}
+
+typedef struct {
+    diff_result_t *result;
+    int first;
+    diff_content_t *contents;   // two per file in the batch: old, new
+    int use_histogram;
+    int want_patch;
+} diff_batch_t;
+
+static void diff_batch_file(void *context, int index) 
+{
+    diff_batch_t *batch = context;
+    file_diff_t *file = &batch->result->files[batch->first + index];
+    diff_content_t *old_content = &batch->contents[2 * index], *new_content = old_content + 1;
+    if (file->status == 'U') return;    // unmerged paths have no single pair to diff
+    // Working-tree files are mapped here, on the worker
+    if (file->old_side.from_disk) load_disk_content(file->path, file->old_side.mode, old_content);
+    if (file->new_side.from_disk) load_disk_content(file->path, file->new_side.mode, new_content);
+    diff_contents(file, old_content, new_content, batch->use_histogram, batch->want_patch);
+    free_content(old_content);
+    free_content(new_content);
+}
+
+// Reads the blobs a batch needs straight from the object store; anything it cannot find goes
+// to the cat-file process (opened on first use): all requests go out first, then each
+// "<oid> <type> <size>" header is followed by that many content bytes
+static void load_batch_blobs(object_store_t *store, git_coprocess_t *cat, int *cat_open,
+                             diff_batch_t *batch, int count) 
+{
+    char request[48], *line = NULL;
+    size_t line_capacity = 0;
+    int requested = 0, type;
+    for (int i = 0; i < 2 * count; i++) {
+        const file_diff_t *file = &batch->result->files[batch->first + i / 2];
+        const diff_side_t *side = i % 2 ? &file->new_side : &file->old_side;
+        if (!side->mode || side->from_disk) continue;
+        diff_content_t *content = &batch->contents[i];
+        content->heap = (char*)object_store_read(store, side->oid, &type, &content->size);
+        if (content->heap) {
+            content->data = content->heap;
+            continue;
+        }
+        if (!*cat_open) *cat_open = coprocess_open(cat, "git cat-file --batch") == 0;
+        if (!*cat_open) continue;
+        oid_to_hex(side->oid, request);
+        coprocess_send(cat, request);
+        requested++;
+    }
+    for (int i = 0; i < 2 * count && requested > 0; i++) {
+        const file_diff_t *file = &batch->result->files[batch->first + i / 2];
+        const diff_side_t *side = i % 2 ? &file->new_side : &file->old_side;
+        diff_content_t *content = &batch->contents[i];
+        if (!side->mode || side->from_disk || content->heap) continue;
+        requested--;
+        if (coprocess_receive(cat, &line, &line_capacity) < 0) break;
+        char *size_field = strrchr(line, ' ');
+        if (!size_field || strstr(line, " missing")) continue;
+        size_t size = (size_t)strtoull(size_field + 1, NULL, 10);
+        content->heap = malloc(size + 1);
+        content->size = coprocess_read(cat, content->heap, size);
+        content->data = content->heap;
+        coprocess_read(cat, request, 1);    // trailing newline
+    }
+    free(line);
+}
+
+// Fills in counts and hunks for every file in `result`, plus unified text when asked
+void diff_file_contents(diff_result_t *result, int want_patch) 
+{
+    char algorithm[32] = "";
+    read_config_value("diff", NULL, "algorithm", algorithm, sizeof(algorithm));
+    int use_histogram = strcasecmp(algorithm, "histogram") == 0 || strcasecmp(algorithm, "patience") == 0;
+
+    object_store_t store;
+    int store_open = 0;
+    git_coprocess_t cat;
+    int cat_open = 0;
+    int workers = default_job_count();
+    diff_content_t *contents = calloc(2 * DIFF_BATCH, sizeof(diff_content_t));
+    for (int first = 0; first < result->count; first += DIFF_BATCH) {
+        int count = result->count - first < DIFF_BATCH ? result->count - first : DIFF_BATCH;
+        diff_batch_t batch = { result, first, contents, use_histogram, want_patch };
+        int needs_objects = 0;
+        for (int i = 0; i < count; i++) {
+            const file_diff_t *file = &result->files[first + i];
+            if ((file->old_side.mode && !file->old_side.from_disk) || (file->new_side.mode && !file->new_side.from_disk)) {
+                needs_objects = 1;
+            }
+        }
+        if (needs_objects && !store_open) store_open = object_store_open(&store) == 0;
+        if (needs_objects && store_open) load_batch_blobs(&store, &cat, &cat_open, &batch, count);
+        parallel_for(count, workers, diff_batch_file, &batch);
+        for (int i = 0; i < 2 * count; i++) free_content(&contents[i]);
+    }
+    if (cat_open) coprocess_close(&cat);
+    if (store_open) object_store_close(&store);
+    free(contents);
+
+    result->insertions = result->deletions = 0;
+    for (int i = 0; i < result->count; i++) {
+        result->insertions += result->files[i].insertions;
+        result->deletions += result->files[i].deletions;
+    }
+}
+
+// The whole result as one unified diff, for text heuristics
+char* diff_result_patch(const diff_result_t *result) 
+{
+    size_t size = 1;
+    for (int i = 0; i < result->count; i++) size += result->files[i].patch_size;
+    char *text = malloc(size), *p = text;
+    for (int i = 0; i < result->count; i++) {
+        if (!result->files[i].patch) continue;
+        memcpy(p, result->files[i].patch, result->files[i].patch_size);
+        p += result->files[i].patch_size;
+    }
+    *p = '\0';
+    return text;
+}
+
+// Tracked paths with staged or unstaged changes, each counted once; no contents are read
+int count_uncommitted_paths() 
+{
+    diff_result_t staged, unstaged;
+    diff_staged(&staged);
+    if (diff_worktree(NULL, &unstaged) != 0) memset(&unstaged, 0, sizeof(unstaged));
+    int count = 0, i = 0, j = 0;
+    while (i < staged.count || j < unstaged.count) {
+        int order = i == staged.count ? 1 : j == unstaged.count ? -1 : strcmp(staged.files[i].path, unstaged.files[j].path);
+        if (order <= 0) i++;
+        if (order >= 0) j++;
+        count++;
+    }
+    free_diff_result(&staged);
+    free_diff_result(&unstaged);
+    return count;
+}
+
+// ==================== AI COMMIT SUGGESTIONS ====================
+
+void analyze_changes_for_commit_type(char* diff_output, char* type, char* description) 
+{
+    if (strstr(diff_output, "+++ b/") && strstr(diff_output, "--- /dev/null")) {
+        strcpy(type, "feat");
+        strcpy(description, "add new feature");
+    } else if (strstr(diff_output, "fix") || strstr(diff_output, "bug") || strstr(diff_output, "error")) {
+        strcpy(type, "fix");
+        strcpy(description, "resolve issue");
+    } else if (strstr(diff_output, "refactor") || strstr(diff_output, "cleanup") || strstr(diff_output, "optimize")) {
+        strcpy(type, "refactor");
+        strcpy(description, "improve code structure");
+    } else if (strstr(diff_output, "test")) {
+        strcpy(type, "test");
+        strcpy(description, "add or update tests");
+    } else if (strstr(diff_output, "doc") || strstr(diff_output, "readme") || strstr(diff_output, "comment")) {
+        strcpy(type, "docs");
+        strcpy(description, "update documentation");
+    } else {
+        strcpy(type, "chore");
+        strcpy(description, "maintenance tasks");
+    }
+}
+
+char* extract_commit_subject(char* diff_output) 
+{
+    static char subject[200];
+    strcpy(subject, "implement changes");
+    
+    char* line = strtok(diff_output, "\n");
+    while (line) {
+        if (strstr(line, "+class ") || strstr(line, "+function ") || strstr(line, "+def ") || strstr(line, "+fn ")) {
+            char* name_start = strstr(line, "class ");
+            if (!name_start) name_start = strstr(line, "function ");
+            if (!name_start) name_start = strstr(line, "def ");
+            if (!name_start) name_start = strstr(line, "fn ");
+            
+            if (name_start) {
+                name_start += 6;
+                char* name_end = strchr(name_start, ' ');
+                if (name_end && (name_end - name_start) < 50) {
+                    strncpy(subject, name_start, name_end - name_start);
+                    subject[name_end - name_start] = '\0';
+                    strcat(subject, " implementation");
+                    break;
+                }
+            }
+        }
+        line = strtok(NULL, "\n");
+    }
+    
+    return subject;
+}
+
+int extract_key_changes(char* diff_output, char* output) 
+{
+    strcpy(output, "code changes");
+    
+    if (strstr(diff_output, "TODO") || strstr(diff_output, "FIXME")) {
+        strcpy(output, "address code comments");
+        return 1;
+    }
+    if (strstr(diff_output, "import") || strstr(diff_output, "include") || strstr(diff_output, "require")) {
+        strcpy(output, "update dependencies");
+        return 1;
+    }
+    if (strstr(diff_output, "config") || strstr(diff_output, "setting")) {
+        strcpy(output, "update configuration");
+        return 1;
+    }
+    
+    return 0;
+}
+
+void generate_commit_suggestions() 
+{
+    printf("🤖 AI Commit Message Suggestions\n");
+    printf("===============================\n");
+    
+    diff_result_t staged;
+    diff_staged(&staged);
+    if (staged.count == 0) {
+        printf("No staged changes found. Use 'git add' to stage changes first.\n\n");
+        free_diff_result(&staged);
+        return;
+    }
+    diff_file_contents(&staged, 1);
+    char* diff_output = diff_result_patch(&staged);
+    
+    char commit_type[20];
+    char description[100];
+    analyze_changes_for_commit_type(diff_output, commit_type, description);
+    
+    int files_changed = staged.count;
+    printf("Based on your changes (%d files, +%d -%d, %s):\n\n", files_changed, staged.insertions, staged.deletions, description);
+    
+    char specific_desc[100] = "changes";
+    int has_specific = extract_key_changes(diff_output, specific_desc);
+    
+    printf("1. %s: %s\n", commit_type, extract_commit_subject(diff_output));
+    printf("2. %s: update %d files for %s\n", commit_type, files_changed, description);
+    
+    if (has_specific) {
+        printf("3. %s: %s\n", commit_type, specific_desc);
+    }
+    
+    printf("\n💡 Tip: Use conventional commit format: <type>[optional scope]: <description>\n\n");
+    free(diff_output);
+    free_diff_result(&staged);
+}
+
+// ==================== CODE REVIEW HELPER ====================
+
+void generate_review_checklist() 
+{
+    printf("🔍 Code Review Checklist\n");
+    printf("=======================\n");
+    
+    diff_result_t changes;
+    if (diff_worktree("HEAD~1", &changes) != 0 || changes.count == 0) {
+        printf("No changes to review (or only one commit in repository).\n\n");
+        free_diff_result(&changes);
+        return;
+    }
+    diff_file_contents(&changes, 1);
+    char* diff_output = diff_result_patch(&changes);
+    
+    printf("Review the following for recent changes:\n\n");
+    
+    int issues_found = 0;
+    
+    if (strstr(diff_output, "TODO") || strstr(diff_output, "FIXME")) {
+        printf("❌ TODO/FIXME comments added - consider addressing before merge\n");
+        issues_found++;
+    }
+    
+    if (strstr(diff_output, "printf(") || strstr(diff_output, "console.log") || strstr(diff_output, "print(")) {
+        printf("⚠️  Debug prints found - remove before production\n");
+        issues_found++;
+    }
+    
+    if (strstr(diff_output, "password") || strstr(diff_output, "secret") || strstr(diff_output, "api_key")) {
+        printf("🚨 Potential secrets in code - verify no hardcoded credentials\n");
+        issues_found++;
+    }
+    
+    if (strstr(diff_output, "//") && !strstr(diff_output, "// TODO") && !strstr(diff_output, "// FIXME")) {
+        printf("💡 New comments added - verify they provide useful context\n");
+        issues_found++;
+    }
+    
+    printf("\n📊 Summary: %d files changed (+%d -%d), %d potential issues to check\n",
+           changes.count, changes.insertions, changes.deletions, issues_found);
+    
+    if (issues_found == 0) {
+        printf("✅ No obvious issues detected in automated checks\n");
+    }
+    
+    printf("\n");
+    free(diff_output);
+    free_diff_result(&changes);
+}
+
+// ==================== SECRET SCANNING ====================
+
+#define SECRET_MIN_LITERAL 16
+#define SECRET_MAX_FINDINGS 5000
+
+// Token rules are prefix + character class + length, indexed by first byte so a line
+// costs one table lookup per character
+typedef struct {
+    const char *name;
+    const char *prefix;
+    char charset;        // 'U' [A-Z0-9], 'a' [A-Za-z0-9], 'b' [A-Za-z0-9_-], 's' [A-Za-z0-9-], 'p' private key header
+    int min_length;
+    int max_length;
+} secret_rule_t;
+
+static const secret_rule_t secret_rules[] = {
+    { "aws-access-key", "AKIA", 'U', 16, 16 },
+    { "aws-access-key", "ASIA", 'U', 16, 16 },
+    { "github-token", "ghp_", 'a', 36, 36 },
+    { "github-token", "gho_", 'a', 36, 36 },
+    { "github-token", "ghu_", 'a', 36, 36 },
+    { "github-token", "ghs_", 'a', 36, 36 },
+    { "github-token", "ghr_", 'a', 36, 36 },
+    { "github-token", "github_pat_", 'b', 82, 82 },
+    { "gitlab-token", "glpat-", 'b', 20, 20 },
+    { "slack-token", "xoxb-", 's', 10, 72 },
+    { "slack-token", "xoxp-", 's', 10, 72 },
+    { "slack-token", "xoxa-", 's', 10, 72 },
+    { "slack-token", "xoxs-", 's', 10, 72 },
+    { "stripe-key", "sk_live_", 'a', 24, 99 },
+    { "stripe-key", "rk_live_", 'a', 24, 99 },
+    { "google-api-key", "AIza", 'b', 35, 35 },
+    { "private-key", "-----BEGIN ", 'p', 0, 0 },
+};
+#define SECRET_RULE_COUNT ((int)(sizeof(secret_rules) / sizeof(secret_rules[0])))
+
+// Identifier suffixes that make a quoted literal on the right-hand side a credential
+static const char *secret_keywords[] = {
+    "password", "passwd", "pwd", "secret", "api_key", "apikey", "access_key", "secret_key",
+    "private_key", "token", "auth_token", "access_token", "client_secret", "credentials",
+};
+
+// Rules grouped by first byte: those starting with byte c are
+// secret_rule_order[secret_rule_start[c]] up to secret_rule_start[c + 1]
+static unsigned char secret_rule_order[SECRET_RULE_COUNT];
+_Static_assert(SECRET_RULE_COUNT <= 256, "secret rule ids must fit in a byte");
+static int secret_rule_start[257];
+static int secret_rules_compiled = 0;
+
+static void compile_secret_rules() 
+{
+    if (secret_rules_compiled) return;
+    int fill[256] = {0};
+    memset(secret_rule_start, 0, sizeof(secret_rule_start));
+    for (int i = 0; i < SECRET_RULE_COUNT; i++) secret_rule_start[(unsigned char)secret_rules[i].prefix[0] + 1]++;
+    for (int c = 0; c < 256; c++) {
+        secret_rule_start[c + 1] += secret_rule_start[c];
+        fill[c] = secret_rule_start[c];
+    }
+    for (int i = 0; i < SECRET_RULE_COUNT; i++) secret_rule_order[fill[(unsigned char)secret_rules[i].prefix[0]]++] = (unsigned char)i;
+    secret_rules_compiled = 1;
+}
+
+// strstr bounded to the first `length` bytes of `text`
+static const char* find_in_span(const char *text, int length, const char *needle) 
+{
+    int needle_length = (int)strlen(needle);
+    for (int i = 0; i + needle_length <= length; i++) {
+        if (text[i] == needle[0] && memcmp(text + i, needle, needle_length) == 0) return text + i;
+    }
+    return NULL;
+}
+
+static int in_secret_charset(char charset, int c) 
+{
+    if (charset == 'U') return isupper(c) || isdigit(c);
+    if (charset == 'a') return isalnum(c);
+    if (charset == 'b') return isalnum(c) || c == '_' || c == '-';
+    if (charset == 's') return isalnum(c) || c == '-';
+    return 0;
+}
+
+double shannon_entropy(const char *s, int length) 
+{
+    int counts[256] = {0};
+    for (int i = 0; i < length; i++) counts[(unsigned char)s[i]]++;
+    double entropy = 0;
+    for (int i = 0; i < 256; i++) {
+        if (!counts[i]) continue;
+        double p = (double)counts[i] / length;
+        entropy -= p * log2(p);
+    }
+    return entropy;
+}
+
+typedef struct {
+    const char *rule;
+    int start;
+    int length;
+} secret_match_t;
+
+static int is_identifier_char(int c) 
+{
+    return isalnum(c) || c == '_';
+}
+
+// A quoted literal after `name =`, `name:`, `name :=` or `name =>` where name ends in a keyword
+static int match_keyword_assignment(const char *line, int length, int at, secret_match_t *match) 
+{
+    int end = at;
+    while (end < length && is_identifier_char((unsigned char)line[end])) end++;
+    char identifier[128];
+    int id_length = end - at < (int)sizeof(identifier) - 1 ? end - at : (int)sizeof(identifier) - 1;
+    for (int i = 0; i < id_length; i++) identifier[i] = (char)tolower((unsigned char)line[at + i]);
+    identifier[id_length] = '\0';
+
+    int keyword_found = 0;
+    for (size_t k = 0; k < sizeof(secret_keywords) / sizeof(secret_keywords[0]) && !keyword_found; k++) {
+        int kl = (int)strlen(secret_keywords[k]);
+        // Whole identifier, or a suffix after '_' so "db_password" counts and "keyboard"/"monkey" do not
+        if (id_length >= kl && strcmp(identifier + id_length - kl, secret_keywords[k]) == 0 &&
+            (id_length == kl || identifier[id_length - kl - 1] == '_')) {
+            keyword_found = 1;
+        }
+    }
+    if (!keyword_found) return 0;
+
+    int p = end;
+    if (p < length && (line[p] == '"' || line[p] == '\'')) p++;   // "password": "..."
+    while (p < length && (line[p] == ' ' || line[p] == '\t')) p++;
+    if (p < length && line[p] == ':') p++;
+    if (p < length && line[p] == '=') p++;
+    if (p < length && line[p] == '>') p++;
+    if (p == end) return 0;
+    while (p < length && (line[p] == ' ' || line[p] == '\t')) p++;
+    if (p >= length || (line[p] != '"' && line[p] != '\'')) return 0;
+
+    char quote = line[p++];
+    int start = p;
+    while (p < length && line[p] != quote) {
+        if (line[p] == ' ' || line[p] == '$' || line[p] == '{' || line[p] == '<' || line[p] == '%') return 0;
+        p++;
+    }
+    if (p >= length || p - start < 6) return 0;
+    match->rule = "credential-assignment";
+    match->start = start;
+    match->length = p - start;
+    return 1;
+}
+
+static void flush_entropy_match(secret_match_t *matches, int *count, int max_matches, int start, int length) 
+{
+    for (int m = 0; m < *count; m++) {
+        if (matches[m].start >= start && matches[m].start < start + length) return;
+    }
+    if (*count >= max_matches) return;
+    matches[*count].rule = "high-entropy-string";
+    matches[*count].start = start;
+    matches[*count].length = length;
+    (*count)++;
+}
+
+// Finds every secret-looking token in one added line; returns the number of matches
+int scan_line_for_secrets(const char *line, int length, secret_match_t *matches, int max_matches) 
+{
+    compile_secret_rules();
+    int count = 0, literal_end = 0, pending_start = -1, pending_length = 0;
+    for (int i = 0; i < length && count < max_matches; i++) {
+        // A high-entropy literal counts only if no token rule claimed its contents
+        if (pending_start >= 0 && i >= pending_start + pending_length) {
+            flush_entropy_match(matches, &count, max_matches, pending_start, pending_length);
+            pending_start = -1;
+        }
+        unsigned char c = (unsigned char)line[i];
+        int boundary = i == 0 || !is_identifier_char((unsigned char)line[i - 1]);
+
+        for (int j = secret_rule_start[c]; j < secret_rule_start[c + 1] && boundary; j++) {
+            const secret_rule_t *rule = &secret_rules[secret_rule_order[j]];
+            int prefix_length = (int)strlen(rule->prefix);
+            if (i + prefix_length > length || strncmp(line + i, rule->prefix, prefix_length) != 0) continue;
+
+            if (rule->charset == 'p') {
+                if (find_in_span(line + i, length - i, "PRIVATE KEY-----")) {
+                    matches[count].rule = rule->name;
+                    matches[count].start = i;
+                    matches[count++].length = length - i;
+                    return count;
+                }
+                continue;
+            }
+
+            int end = i + prefix_length;
+            while (end < length && in_secret_charset(rule->charset, (unsigned char)line[end])) end++;
+            int body = end - i - prefix_length;
+            if (body >= rule->min_length && body <= rule->max_length &&
+                (end == length || !is_identifier_char((unsigned char)line[end]))) {
+                matches[count].rule = rule->name;
+                matches[count].start = i;
+                matches[count++].length = end - i;
+                i = end - 1;
+                break;
+            }
+        }
+        if (count >= max_matches) break;
+
+        if (boundary && isalpha(c)) {
+            secret_match_t match;
+            if (match_keyword_assignment(line, length, i, &match)) {
+                matches[count++] = match;
+                i = match.start + match.length;
+                continue;
+            }
+            while (i + 1 < length && is_identifier_char((unsigned char)line[i + 1])) i++;
+        } else if ((c == '"' || c == '\'') && i >= literal_end) {
+            // Long, dense string literals with base64-like or hex alphabets and high entropy
+            int end = i + 1, hex = 1, dense = 1, classes = 0;
+            while (end < length && line[end] != (char)c) {
+                int d = (unsigned char)line[end];
+                if (!isxdigit(d)) hex = 0;
+                if (!isalnum(d) && d != '+' && d != '/' && d != '=' && d != '_' && d != '-') dense = 0;
+                classes |= isupper(d) ? 1 : islower(d) ? 2 : isdigit(d) ? 4 : 0;
+                end++;
+            }
+            int literal = end - i - 1;
+            if (end < length && dense && literal >= SECRET_MIN_LITERAL) {
+                double entropy = shannon_entropy(line + i + 1, literal);
+                // Random hex mixes digits and letters; random base64 mixes all three classes
+                if ((hex && literal >= 32 && (classes & 4) && classes != 4 && entropy >= 3.0) ||
+                    (!hex && classes == 7 && entropy >= 4.0)) {
+                    pending_start = i + 1;
+                    pending_length = literal;
+                }
+            }
+            // Keep scanning inside the literal so token rules still see its contents
+            literal_end = end + 1;
+        }
+    }
+    if (pending_start >= 0) flush_entropy_match(matches, &count, max_matches, pending_start, pending_length);
+    return count;
+}
+
+typedef struct {
+    uint64_t fingerprint;
+    const char *rule;
+    char preview[16];
+    char commit[41];
+    char author[64];
+    char date[16];
+    char path[MAX_PATH_LENGTH];
+    int line;
+    int order;          // position of the commit in rev-list order, lower is newer
+    int occurrences;
+} secret_finding_t;
+
+typedef struct {
+    char (*commits)[41];
+    int commit_count;
+    int shard_count;
+    mutex_t lock;
+    oid_map_t scanned_blobs;
+    oid_map_t fingerprints;   // fingerprint (padded to an oid) -> finding index + 1
+    secret_finding_t *findings;
+    int finding_count;
+    int suppressed;
+    long long lines_scanned;
+    int blobs_skipped;
+} secret_scan_t;
+
+static void record_secret(secret_scan_t *scan, const secret_match_t *match, const char *text, int order,
+                          const char *commit, const char *author, const char *date, const char *path, int line) 
+{
+    uint64_t fingerprint = 14695981039346656037ULL;
+    for (int i = 0; i < match->length; i++) {
+        fingerprint ^= (unsigned char)text[match->start + i];
+        fingerprint *= 1099511628211ULL;
+    }
+    unsigned char key[20] = {0};
+    memcpy(key, &fingerprint, sizeof(fingerprint));
+
+    mutex_lock(&scan->lock);
+    long long *slot = oid_map_insert(&scan->fingerprints, key, NULL);
+    secret_finding_t *f = NULL;
+    if (*slot > 0) {
+        f = &scan->findings[*slot - 1];
+        f->occurrences++;
+        if (order < f->order) f = NULL;   // keep the oldest introduction
+    } else if (scan->finding_count < SECRET_MAX_FINDINGS) {
+        *slot = ++scan->finding_count;
+        f = &scan->findings[*slot - 1];
+        memset(f, 0, sizeof(*f));
+        f->occurrences = 1;
+    } else {
+        scan->suppressed++;
+    }
+    if (f) {
+        f->fingerprint = fingerprint;
+        f->rule = match->rule;
+        int shown = match->length < 4 ? match->length : 4;
+        snprintf(f->preview, sizeof(f->preview), "%.*s…(%d)", shown, text + match->start, match->length);
+        snprintf(f->commit, sizeof(f->commit), "%s", commit);
+        snprintf(f->author, sizeof(f->author), "%s", author);
+        snprintf(f->date, sizeof(f->date), "%s", date);
+        snprintf(f->path, sizeof(f->path), "%s", path);
+        f->line = line;
+        f->order = order;
+    }
+    mutex_unlock(&scan->lock);
+}
+
+// One contiguous range of commits through `git log -p --stdin`, added lines only
+static void scan_secret_shard(void *context, int task) 
+{
+    secret_scan_t *scan = context;
+    int shard = scan->shard_count - 1 - task;   // oldest range first, so blobs are claimed where they appeared
+    int per_shard = (scan->commit_count + scan->shard_count - 1) / scan->shard_count;
+    int first = shard * per_shard;
+    int last = first + per_shard < scan->commit_count ? first + per_shard : scan->commit_count;
+    if (first >= last) return;
+
+    char list_path[MAX_PATH_LENGTH + 64];
+    if (get_temp_path(list_path, sizeof(list_path), "secrets") != 0) return;
+    FILE *list = fopen(list_path, "w");
+    if (!list) return;
+    for (int i = last - 1; i >= first; i--) fprintf(list, "%s\n", scan->commits[i]);
+    fclose(list);
+
+    FILE *fp = open_git_stream("git -c core.quotePath=false log -p -U0 --full-index --no-renames --no-merges "
+                               "--no-color --no-ext-diff --no-textconv --no-walk=unsorted --stdin --date=short "
+                               "--format=\"commit %%H%%x09%%an%%x09%%ad\" < \"%s\"", list_path);
+    if (!fp) {
+        remove(list_path);
+        return;
+    }
+
+    char commit[41] = "", author[64] = "", date[16] = "", path[MAX_PATH_LENGTH] = "";
+    int order = last - 1, skip_file = 1, new_line = 0;
+    long long lines_scanned = 0;
+    char *line = NULL;
+    size_t capacity = 0;
+    long length;
+    while ((length = read_stream_line(fp, &line, &capacity)) >= 0) {
+        if (strncmp(line, "commit ", 7) == 0 && length >= 47 && line[47] == '\t') {
+            snprintf(commit, sizeof(commit), "%.40s", line + 7);
+            char *tab = strchr(line + 48, '\t');
+            snprintf(author, sizeof(author), "%.*s", tab ? (int)(tab - line - 48) : 0, line + 48);
+            snprintf(date, sizeof(date), "%s", tab ? tab + 1 : "");
+            while (order > first && strcmp(scan->commits[order], commit) != 0) order--;
+            skip_file = 1;
+        } else if (strncmp(line, "diff --git ", 11) == 0) {
+            skip_file = 1;
+        } else if (strncmp(line, "index ", 6) == 0) {
+            // Identical post-images (copies, reverts, cherry-picks) are scanned once, except that
+            // an older commit may take a blob over so findings name where a secret first appeared
+            char *dots = strstr(line, "..");
+            unsigned char blob[20];
+            skip_file = 1;
+            if (dots && strlen(dots + 2) >= 40 && hex_to_oid(dots + 2, blob) == 0 && !is_null_oid(blob)) {
+                mutex_lock(&scan->lock);
+                long long *claim = oid_map_insert(&scan->scanned_blobs, blob, NULL);
+                if (*claim == 0 || order > *claim - 1) {
+                    *claim = order + 1;
+                    skip_file = 0;
+                } else {
+                    scan->blobs_skipped++;
+                }
+                mutex_unlock(&scan->lock);
+            }
+        } else if (strncmp(line, "+++ ", 4) == 0) {
+            snprintf(path, sizeof(path), "%s", strncmp(line + 4, "b/", 2) == 0 ? line + 6 : line + 4);
+        } else if (strncmp(line, "@@ ", 3) == 0) {
+            char *plus = strchr(line + 3, '+');
+            new_line = plus ? atoi(plus + 1) : 0;
+        } else if (line[0] == '+' && !skip_file) {
+            secret_match_t matches[8];
+            int found = scan_line_for_secrets(line + 1, (int)length - 1, matches, 8);
+            for (int m = 0; m < found; m++) {
+                record_secret(scan, &matches[m], line + 1, order, commit, author, date, path, new_line);
+            }
+            lines_scanned++;
+            new_line++;
+        }
+    }
+    free(line);
+    pclose(fp);
+    remove(list_path);
+
+    mutex_lock(&scan->lock);
+    scan->lines_scanned += lines_scanned;
+    mutex_unlock(&scan->lock);
+}
+
+static int compare_secret_findings(const void *a, const void *b) 
+{
+    return ((const secret_finding_t *)a)->order - ((const secret_finding_t *)b)->order;
+}
+
+// Scans every line ever added on any ref, sharded by commit range across the worker pool
+void run_history_secret_scan(int jobs) 
+{
+    printf("🛡️  Security Audit: full history\n");
+    printf("=================================\n");
+
+    secret_scan_t scan;
+    memset(&scan, 0, sizeof(scan));
+    if (!get_cache_dir()) {
+        printf("Unable to create the gitsmart cache directory\n\n");
+        return;
+    }
+
+    FILE *fp = open_git_stream("git rev-list --all --no-merges");
+    if (!fp) {
+        printf("Unable to list commits\n\n");
+        return;
+    }
+    int capacity = 0;
+    char *line = NULL;
+    size_t line_capacity = 0;
+    while (read_stream_line(fp, &line, &line_capacity) >= 0) {
+        if (strlen(line) != 40) continue;
+        if (scan.commit_count == capacity) {
+            capacity = capacity ? capacity * 2 : 4096;
+            scan.commits = realloc(scan.commits, 41 * (size_t)capacity);
+        }
+        memcpy(scan.commits[scan.commit_count++], line, 41);
+    }
+    free(line);
+    pclose(fp);
+
+    if (scan.commit_count == 0) {
+        printf("No commits to audit.\n\n");
+        return;
+    }
+
+    // Several shards per worker keeps every core busy when commit sizes vary
+    scan.shard_count = jobs * 4;
+    if (scan.shard_count > scan.commit_count) scan.shard_count = scan.commit_count;
+    scan.findings = malloc(sizeof(secret_finding_t) * SECRET_MAX_FINDINGS);
+    compile_secret_rules();
+    printf("Scanning %d commits in %d shards on %d workers...\n\n", scan.commit_count, scan.shard_count, jobs);
+
+    mutex_init(&scan.lock);
+    parallel_for(scan.shard_count, jobs, scan_secret_shard, &scan);
+    mutex_destroy(&scan.lock);
+
+    qsort(scan.findings, scan.finding_count, sizeof(secret_finding_t), compare_secret_findings);
+    for (int i = 0; i < scan.finding_count; i++) {
+        const secret_finding_t *f = &scan.findings[i];
+        printf("🔐 %-22s %s:%d\n", f->rule, f->path, f->line);
+        printf("   %s, introduced in %.7s (%s, %s)", f->preview, f->commit, f->date, f->author);
+        if (f->occurrences > 1) printf(", seen %d times", f->occurrences);
+        printf("\n");
+    }
+
+    printf("\n");
+    if (scan.finding_count == 0) {
+        printf("✅ No secrets found in %lld added lines\n", scan.lines_scanned);
+    } else {
+        printf("🔍 %d distinct secrets in %lld added lines", scan.finding_count, scan.lines_scanned);
+        if (scan.suppressed > 0) printf(" (%d more not shown)", scan.suppressed);
+        printf("\n💡 Rotate these credentials; removing them from history does not make them safe again\n");
+    }
+    if (scan.blobs_skipped > 0) printf("(%d duplicate blobs skipped)\n", scan.blobs_skipped);
+    printf("\n");
+
+    free(scan.commits);
+    free(scan.findings);
+    oid_map_free(&scan.scanned_blobs);
+    oid_map_free(&scan.fingerprints);
+}
+
+// ==================== SECURITY AUDIT ====================
+
+void run_security_audit() 
+{
+    printf("🛡️  Security Audit\n");
+    printf("=================\n");
+    
+    // Use HEAD~1 instead of HEAD~10 for Windows compatibility
+    char* diff_output = run_git_command_output("git diff HEAD~1");
+    if (!diff_output || strlen(diff_output) == 0) {
+        printf("No recent changes to audit.\n\n");
+        return;
+    }
+    
+    int security_issues = 0;
+    
+    printf("Scanning for potential security issues...\n\n");
+    
+    if (strstr(diff_output, "system(") || strstr(diff_output, "exec(") || strstr(diff_output, "popen(")) {
+        printf("❌ System command execution found - validate input sanitization\n");
+        security_issues++;
+    }
+    
+    if (strstr(diff_output, "strcpy(") || strstr(diff_output, "strcat(") || strstr(diff_output, "sprintf(")) {
+        printf("⚠️  Unsafe string functions used - consider strncpy/strncat/snprintf\n");
+        security_issues++;
+    }
+    
+    if (strstr(diff_output, "malloc(") && !strstr(diff_output, "free(")) {
+        printf("💡 Memory allocation without obvious free - check for leaks\n");
+        security_issues++;
+    }
+    
+    int secrets = 0;
+    for (const char *p = diff_output; *p; ) {
+        const char *eol = strchr(p, '\n');
+        int length = eol ? (int)(eol - p) : (int)strlen(p);
+        if (p[0] == '+' && strncmp(p, "+++ ", 4) != 0) {
+            secret_match_t matches[8];
+            secrets += scan_line_for_secrets(p + 1, length - 1, matches, 8);
+        }
+        p += length + (eol ? 1 : 0);
+    }
+    if (secrets > 0) {
+        printf("🔐 %d possible secret%s added - verify no sensitive data exposure\n", secrets, secrets == 1 ? "" : "s");
+        security_issues++;
+    }
+    
+    if (strstr(diff_output, "permission") || strstr(diff_output, "chmod") || strstr(diff_output, "access")) {
+        printf("🔒 Permission changes detected - review access control requirements\n");
+        security_issues++;
+    }
+    
+    printf("\n");
+    if (security_issues == 0) {
+        printf("✅ No obvious security issues detected\n");
+    } else {
+        printf("🔍 Found %d potential security considerations to review\n", security_issues);
+    }
+    printf("\n");
+}
+
+// ==================== CO-CHANGE INDEX ====================
+
+#define COCHANGE_MAX_FILES 50
+#define COCHANGE_VERSION 1
+
+// On-disk layout (native byte order, cache only): header, name offsets, names,
+// ids sorted by name, per-path commit counts, then the CSR row pointers, columns and values
+typedef struct {
+    char magic[4];
+    uint32_t version;
+    char head[40];
+    uint32_t commit_count;
+    uint32_t path_count;
+    uint32_t nnz;
+    uint32_t name_bytes;
+} cochange_header_t;
+
+// Symmetric sparse matrix of co-change counts; every row is sorted by column
+typedef struct {
+    uint32_t rows;
+    uint32_t nnz;
+    const uint32_t *row_ptr;
+    const uint32_t *cols;
+    const uint32_t *vals;
+} csr_matrix_t;
+
+typedef struct {
+    uint32_t col;
+    uint32_t val;
+} csr_entry_t;
+
+typedef struct {
+    mapped_file_t file;
+    const cochange_header_t *header;
+    name_table_view_t paths;
+    const uint32_t *path_commits;
+    csr_matrix_t matrix;
+} cochange_index_t;
+
+int open_cochange_index(const char *path, cochange_index_t *idx) 
+{
+    memset(idx, 0, sizeof(*idx));
+    if (map_file(path, &idx->file) != 0) return -1;
+
+    const cochange_header_t *h = (const cochange_header_t *)idx->file.data;
+    if (idx->file.size < sizeof(*h) || memcmp(h->magic, "GSCC", 4) != 0 || h->version != COCHANGE_VERSION) {
+        unmap_file(&idx->file);
+        return -1;
+    }
+
+    size_t p = h->path_count;
+    size_t expected = sizeof(*h) + name_table_size(h->path_count, h->name_bytes) + 4 * p + 4 * (p + 1) + 8 * (size_t)h->nnz;
+    if (idx->file.size != expected) {
+        unmap_file(&idx->file);
+        return -1;
+    }
+
+    const unsigned char *cursor = idx->file.data + sizeof(*h);
+    idx->header = h;
+    cursor = name_table_read(&idx->paths, cursor, h->path_count, h->name_bytes);
+    idx->path_commits = (const uint32_t *)cursor;   cursor += 4 * p;
+    idx->matrix.rows = h->path_count;
+    idx->matrix.nnz = h->nnz;
+    idx->matrix.row_ptr = (const uint32_t *)cursor; cursor += 4 * (p + 1);
+    idx->matrix.cols = (const uint32_t *)cursor;    cursor += 4 * (size_t)h->nnz;
+    idx->matrix.vals = (const uint32_t *)cursor;
+    return 0;
+}
+
+const char* cochange_path_name(const cochange_index_t *idx, uint32_t id) 
+{
+    return name_table_get(&idx->paths, id);
+}
+
+// Where the pair counts of a rebuild are merged with the previous matrix, row by row: the
+// (column, value) pairs go to a scratch file in row order, with per-row counts kept aside
+typedef struct {
+    const csr_matrix_t *base;
+    FILE *out;
+    uint32_t *row_counts;
+    uint32_t rows;
+    uint32_t row;           // row being merged; earlier rows are complete
+    uint32_t base_next;     // next unmerged base entry of that row
+    uint64_t nnz;
+} cochange_merge_t;
+
+static void cochange_write_entry(cochange_merge_t *m, uint32_t col, uint32_t value) 
+{
+    uint32_t pair[2] = { col, value };
+    fwrite(pair, sizeof(uint32_t), 2, m->out);
+    m->row_counts[m->row]++;
+    m->nnz++;
+}
+
+// Finishes rows up to (not including) `row`, copying whatever the base still has for them
+static void cochange_advance_row(cochange_merge_t *m, uint32_t row) 
+{
+    const csr_matrix_t *base = m->base;
+    while (m->row < row) {
+        if (m->row < base->rows) {
+            for (; m->base_next < base->row_ptr[m->row + 1]; m->base_next++) {
+                cochange_write_entry(m, base->cols[m->base_next], base->vals[m->base_next]);
+            }
+        }
+        m->row++;
+        if (m->row < base->rows) m->base_next = base->row_ptr[m->row];
+    }
+}
+
+static void cochange_merge_entry(void *context, uint64_t key, uint64_t value) 
+{
+    cochange_merge_t *m = context;
+    uint32_t row = (uint32_t)(key >> 32), col = (uint32_t)key;
+    cochange_advance_row(m, row);
+    const csr_matrix_t *base = m->base;
+    if (row < base->rows) {
+        uint32_t end = base->row_ptr[row + 1];
+        for (; m->base_next < end && base->cols[m->base_next] < col; m->base_next++) {
+            cochange_write_entry(m, base->cols[m->base_next], base->vals[m->base_next]);
+        }
+        if (m->base_next < end && base->cols[m->base_next] == col) value += base->vals[m->base_next++];
+    }
+    cochange_write_entry(m, col, (uint32_t)value);
+}
+
+// Copies one half (columns or values) of the scratch pairs into the index file
+static void cochange_copy_half(FILE *scratch, FILE *fp, int half) 
+{
+    uint32_t pairs[2 * 1024], half_values[1024];
+    size_t n;
+    rewind(scratch);
+    while ((n = fread(pairs, 2 * sizeof(uint32_t), 1024, scratch)) > 0) {
+        for (size_t i = 0; i < n; i++) half_values[i] = pairs[2 * i + half];
+        fwrite(half_values, sizeof(uint32_t), n, fp);
+    }
+}
+
+static int write_cochange_index(const char *path, const char *head, uint32_t commit_count, const path_table_t *paths,
+                                const uint32_t *path_commits, const cochange_merge_t *m, FILE *scratch) 
+{
+    char tmp_path[MAX_PATH_LENGTH + 64];
+    FILE *fp = begin_index_file(path, tmp_path, sizeof(tmp_path));
+    if (!fp) return -1;
+
+    cochange_header_t h;
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, "GSCC", 4);
+    h.version = COCHANGE_VERSION;
+    memcpy(h.head, head, 40);
+    h.commit_count = commit_count;
+    h.path_count = (uint32_t)paths->count;
+    h.nnz = (uint32_t)m->nnz;
+    h.name_bytes = name_table_bytes(paths);
+
+    fwrite(&h, sizeof(h), 1, fp);
+    name_table_write(fp, paths);
+    fwrite(path_commits, sizeof(uint32_t), h.path_count, fp);
+    uint32_t offset = 0;
+    fwrite(&offset, sizeof(uint32_t), 1, fp);
+    for (uint32_t r = 0; r < h.path_count; r++) {
+        offset += m->row_counts[r];
+        fwrite(&offset, sizeof(uint32_t), 1, fp);
+    }
+    fflush(scratch);
+    cochange_copy_half(scratch, fp, 0);
+    cochange_copy_half(scratch, fp, 1);
+    return finish_index_file(fp, tmp_path, path);
+}
+
+static void account_cochange_commit(const int *ids, int n, spill_agg_t *pairs, uint32_t **path_commits,
+                                    int *capacity, int path_count, uint32_t *commit_count) 
+{
+    // Mass edits (renames, reformatting) say nothing about coupling
+    if (n == 0 || n > COCHANGE_MAX_FILES) return;
+
+    if (path_count > *capacity) {
+        int old_capacity = *capacity;
+        *capacity = path_count * 2;
+        *path_commits = realloc(*path_commits, sizeof(uint32_t) * *capacity);
+        memset(*path_commits + old_capacity, 0, sizeof(uint32_t) * (*capacity - old_capacity));
+    }
+
+    (*commit_count)++;
+    for (int i = 0; i < n; i++) {
+        (*path_commits)[ids[i]]++;
+        for (int j = i + 1; j < n; j++) {
+            if (ids[i] == ids[j]) continue;
+            // Both directions, so the merged stream comes out in CSR row order
+            agg_add(pairs, ((uint64_t)ids[i] << 32) | (uint32_t)ids[j], 1);
+            agg_add(pairs, ((uint64_t)ids[j] << 32) | (uint32_t)ids[i], 1);
+        }
+    }
+}
+
+// Brings the co-change index up to date with HEAD (incrementally when possible) and maps it.
+// Pair counts go through the spill aggregator, so --mem-limit bounds the rebuild.
+int load_cochange_index(cochange_index_t *idx) 
+{
+    char current_head[41];
+    if (get_head_oid(current_head) != 0) return -1;
+
+    char path[MAX_PATH_LENGTH], scratch_path[MAX_PATH_LENGTH + 64];
+    if (get_cache_path(path, sizeof(path), "cochange.idx") != 0) return -1;
+    if (get_temp_path(scratch_path, sizeof(scratch_path), "cochange-pairs") != 0) return -1;
+
+    int have_old = open_cochange_index(path, idx) == 0;
+    if (have_old && memcmp(idx->header->head, current_head, 40) == 0) return 0;
+
+    path_table_t paths = {0};
+    uint32_t *path_commits = NULL;
+    int path_commits_capacity = 0;
+    uint32_t commit_count = 0;
+    csr_matrix_t base = {0};
+    char range[128] = "HEAD";
+
+    char old_head[41] = "";
+    if (have_old) {
+        memcpy(old_head, idx->header->head, 40);
+        old_head[40] = '\0';
+    }
+    if (have_old && is_ancestor_of_head(old_head)) {
+        uint32_t p = idx->header->path_count;
+        for (uint32_t i = 0; i < p; i++) path_table_intern(&paths, cochange_path_name(idx, i));
+        path_commits_capacity = p > 0 ? (int)p : 1;
+        path_commits = calloc(path_commits_capacity, sizeof(uint32_t));
+        memcpy(path_commits, idx->path_commits, sizeof(uint32_t) * p);
+        commit_count = idx->header->commit_count;
+        base = idx->matrix;
+        snprintf(range, sizeof(range), "%s..HEAD", old_head);
+    }
+
+    FILE *log = open_git_stream("git -c core.quotePath=false log --name-only --no-renames --format=\"commit %%H\" %s", range);
+    if (!log) {
+        if (have_old) unmap_file(&idx->file);
+        path_table_free(&paths);
+        free(path_commits);
+        return -1;
+    }
+
+    spill_agg_t pairs;
+    agg_init(&pairs, aggregation_memory_limit);
+    int *ids = NULL, id_count = 0, id_capacity = 0;
+    stream_pipe_t lines;
+    stream_pipe_open(&lines, log);
+    char *line;
+    while ((line = stream_pipe_line(&lines, NULL))) {
+        if (strncmp(line, "commit ", 7) == 0) {
+            account_cochange_commit(ids, id_count, &pairs, &path_commits, &path_commits_capacity, paths.count, &commit_count);
+            id_count = 0;
+        } else if (line[0]) {
+            if (id_count == id_capacity) {
+                id_capacity = id_capacity ? id_capacity * 2 : 64;
+                ids = realloc(ids, sizeof(int) * id_capacity);
+            }
+            ids[id_count++] = path_table_intern(&paths, line);
+        }
+    }
+    account_cochange_commit(ids, id_count, &pairs, &path_commits, &path_commits_capacity, paths.count, &commit_count);
+    stream_pipe_close(&lines);
+    pclose(log);
+    free(ids);
+
+    if (paths.count > path_commits_capacity) {
+        path_commits = realloc(path_commits, sizeof(uint32_t) * paths.count);
+        memset(path_commits + path_commits_capacity, 0, sizeof(uint32_t) * (paths.count - path_commits_capacity));
+    }
+
+    int written = -1;
+    cochange_merge_t merge = { &base, fopen(scratch_path, "w+b"), calloc(paths.count + 1, sizeof(uint32_t)),
+                               (uint32_t)paths.count, 0, base.rows ? base.row_ptr[0] : 0, 0 };
+    if (merge.out) {
+        int merged = agg_finish(&pairs, cochange_merge_entry, &merge);
+        cochange_advance_row(&merge, merge.rows);
+        // The base matrix may point into the old mapping, so only drop it after merging
+        if (have_old) unmap_file(&idx->file);
+        have_old = 0;
+        if (merged == 0) {
+            written = write_cochange_index(path, current_head, commit_count, &paths, path_commits, &merge, merge.out);
+        }
+        fclose(merge.out);
+        remove(scratch_path);
+    } else {
+        agg_finish(&pairs, NULL, NULL);
+    }
+    if (have_old) unmap_file(&idx->file);
+    free(merge.row_counts);
+    free(path_commits);
+    path_table_free(&paths);
+
+    if (written != 0) return -1;
+    return open_cochange_index(path, idx);
+}
+
+static const cochange_index_t *ranking_index;
+
+// Most frequent partners first; ties broken by path so output is stable across rebuilds
+static int compare_cochange_rank(const void *a, const void *b) 
+{
+    const csr_entry_t *x = a, *y = b;
+    if (x->val != y->val) return (x->val < y->val) - (x->val > y->val);
+    return strcmp(cochange_path_name(ranking_index, x->col), cochange_path_name(ranking_index, y->col));
+}
+
+void show_cochanged_files(const char *path) 
+{
+    cochange_index_t idx;
+    if (load_cochange_index(&idx) != 0) {
+        printf("Co-change history unavailable.\n");
+        return;
+    }
+
+    int id = name_table_find(&idx.paths, path);
+    if (id < 0 || idx.path_commits[id] == 0) {
+        printf("No co-change history recorded for %s.\n", path);
+        unmap_file(&idx.file);
+        return;
+    }
+
+    uint32_t start = idx.matrix.row_ptr[id], n = idx.matrix.row_ptr[id + 1] - start;
+    uint32_t target_commits = idx.path_commits[id];
+    printf("Files that usually change together with it (%u of %u commits touched it):\n",
+           target_commits, idx.header->commit_count);
+    if (n == 0) {
+        printf("  (always changed on its own)\n");
+        unmap_file(&idx.file);
+        return;
+    }
+
+    csr_entry_t *row = malloc(sizeof(csr_entry_t) * n);
+    for (uint32_t i = 0; i < n; i++) {
+        row[i].col = idx.matrix.cols[start + i];
+        row[i].val = idx.matrix.vals[start + i];
+    }
+    ranking_index = &idx;
+    qsort(row, n, sizeof(csr_entry_t), compare_cochange_rank);
+
+    int shown = n < 10 ? (int)n : 10;
+    printf("  %-9s %-11s %-8s %s\n", "together", "confidence", "support", "file");
+    for (int i = 0; i < shown; i++) {
+        double confidence = 100.0 * row[i].val / target_commits;
+        double support = 100.0 * row[i].val / idx.header->commit_count;
+        printf("  %9u %10.1f%% %7.2f%% %s\n", row[i].val, confidence, support, cochange_path_name(&idx, row[i].col));
+    }
+
+    free(row);
+    unmap_file(&idx.file);
+}
+
+// ==================== CHANGE IMPACT ANALYZER ====================
+
+void show_file_history(const char *path) 
+{
+    history_index_t history;
+    if (load_history_index(&history) != 0) {
+        return;
+    }
+
+    int id = name_table_find(&history.paths, path);
+    uint32_t *commits = NULL;
+    int names_followed = 0;
+    int count = id >= 0 ? history_collect(&history, id, &commits, &names_followed) : 0;
+    if (count == 0) {
+        printf("No recorded changes to this file.\n");
+        free(commits);
+        unmap_file(&history.file);
+        return;
+    }
+
+    printf("Changed in %d commits", count);
+    if (names_followed > 1) printf(" (following %d earlier names)", names_followed - 1);
+    printf("\nRecent changes to this file:\n");
+    for (int i = 0; i < count && i < 5; i++) {
+        char hash[41], author[256], subject[MAX_LINE_LENGTH];
+        oid_to_hex(history.oids + 20 * (size_t)commits[i], hash);
+        history_commit_text(&history, commits[i], author, sizeof(author), subject, sizeof(subject));
+        printf("  • %.7s %s\n", hash, subject);
+    }
+
+    free(commits);
+    unmap_file(&history.file);
+}
+
+// Directories (and paths no longer in the tree) are not in the per-file index, so their
+// history comes from a Bloom-filtered walk instead
+void show_path_history(const char *path) 
+{
+    char (*commits)[41] = NULL;
+    path_walk_stats_t stats;
+    int count = bloom_path_history(path, 0, &commits, &stats);
+    if (count <= 0) {
+        printf("No recorded changes under this path.\n");
+        free(commits);
+        return;
+    }
+
+    printf("Changed in %d commits (%d of %d skipped by %s Bloom filters)\n",
+           count, stats.skipped, stats.scanned, stats.source);
+    printf("Recent changes under this path:\n");
+    char hashes[5 * 41 + 1] = "";
+    for (int i = 0; i < count && i < 5; i++) {
+        strcat(hashes, " ");
+        strcat(hashes, commits[i]);
+    }
+    FILE *fp = open_git_stream("git show -s --format=\"%%h %%s\"%s", hashes);
+    if (fp) {
+        char *line = NULL;
+        size_t capacity = 0;
+        while (read_stream_line(fp, &line, &capacity) >= 0) {
+            printf("  • %s\n", line);
+        }
+        free(line);
+        pclose(fp);
+    }
+    free(commits);
+}
+
+void analyze_change_impact(const char* target) 
+{
+    printf("📈 Change Impact Analysis: %s\n", target);
+    printf("==============================\n");
+    
+    if (strlen(target) == 0) {
+        printf("Please specify a file or function to analyze\n\n");
+        return;
+    }
+    
+    if (is_directory(target)) {
+        printf("Analyzing impact of changes to directory: %s\n\n", target);
+
+        char repo_path[MAX_PATH_LENGTH];
+        normalize_repo_path(target, repo_path, sizeof(repo_path));
+        if (repo_path[0]) {
+            show_path_history(repo_path);
+        } else {
+            printf("Every commit touches the repository root; pick a subdirectory.\n");
+        }
+    } else if (access(target, F_OK) == 0) {
+        printf("Analyzing impact of changes to file: %s\n\n", target);
+
+        char repo_path[MAX_PATH_LENGTH];
+        normalize_repo_path(target, repo_path, sizeof(repo_path));
+        show_file_history(repo_path);
+        printf("\n");
+        show_cochanged_files(repo_path);
+    } else {
+        printf("Analyzing impact of: %s\n", target);
+        printf("(Note: This is a simple analysis. For complex projects, consider specialized tools.)\n");
+
+        // Deleted or renamed-away paths still have history worth showing
+        if (!strchr(target, ' ')) {
+            char repo_path[MAX_PATH_LENGTH];
+            normalize_repo_path(target, repo_path, sizeof(repo_path));
+            char (*commits)[41] = NULL;
+            path_walk_stats_t stats;
+            int count = bloom_path_history(repo_path, 1, &commits, &stats);
+            free(commits);
+            if (count > 0) {
+                printf("\n");
+                show_path_history(repo_path);
+            }
+        }
+    }
+    
+    printf("\n💡 Consider running tests after modifying this component\n\n");
+}
+
+// ==================== INTERACTIVE CONFLICT RESOLVER ====================
+
+#define CONFLICT_MARKER_LENGTH 7
+#define CONFLICT_MAX_RANGES 4
+
+// One unmerged path from `git status --porcelain` (DD, AU, UD, UA, DU, AA, UU); the path is
+// relative to the top of the working tree
+typedef struct {
+    char path[MAX_PATH_LENGTH];
+    char state[3];
+    int hunks;
+    int ranges[CONFLICT_MAX_RANGES][2];
+    long ours_lines;
+    long theirs_lines;
+    int has_base;
+    int unterminated;
+    int unreadable;
+} conflict_file_t;
+
+static int is_unmerged_state(const char *xy) 
+{
+    static const char *states[] = { "DD", "AU", "UD", "UA", "DU", "AA", "UU" };
+    for (int i = 0; i < 7; i++) {
+        if (strncmp(xy, states[i], 2) == 0) return 1;
+    }
+    return 0;
+}
+
+static const char* describe_unmerged_state(const char *xy) 
+{
+    if (strncmp(xy, "DD", 2) == 0) return "both deleted";
+    if (strncmp(xy, "AU", 2) == 0) return "added by us";
+    if (strncmp(xy, "UA", 2) == 0) return "added by them";
+    if (strncmp(xy, "DU", 2) == 0) return "deleted by us";
+    if (strncmp(xy, "UD", 2) == 0) return "deleted by them";
+    if (strncmp(xy, "AA", 2) == 0) return "both added";
+    return "both modified";
+}
+
+// Which marker, if any, starts this line: '<', '|', '=', '>' or 0
+static int conflict_marker_at(const unsigned char *line, const unsigned char *end) 
+{
+    if (end - line < CONFLICT_MARKER_LENGTH) return 0;
+    int c = line[0];
+    if (c != '<' && c != '|' && c != '=' && c != '>') return 0;
+    for (int i = 1; i < CONFLICT_MARKER_LENGTH; i++) {
+        if (line[i] != c) return 0;
+    }
+    // "=======" stands alone; the others are followed by a label or the end of the line
+    const unsigned char *after = line + CONFLICT_MARKER_LENGTH;
+    if (after == end || *after == '\n' || *after == '\r') return c;
+    return (c != '=' && *after == ' ') ? c : 0;
+}
+
+static void scan_conflict_task(void *context, int index) 
+{
+    conflict_file_t *file = &((conflict_file_t *)context)[index];
+    char path[MAX_PATH_LENGTH * 2 + 2];
+    snprintf(path, sizeof(path), "%s/%s", repo.worktree, file->path);
+    mapped_file_t map;
+    if (map_file(path, &map) != 0) {
+        file->unreadable = access(path, F_OK) == 0 ? 0 : 1;
+        return;
+    }
+
+    // Walk line starts with memchr and only look closer at lines that open with a marker byte
+    const unsigned char *p = map.data, *end = map.data + map.size;
+    long line_number = 1, hunk_start = 0;
+    int section = 0;   // 0 outside, '<' ours, '|' base, '=' theirs
+    while (p < end) {
+        const unsigned char *newline = memchr(p, '\n', end - p);
+        const unsigned char *line_end = newline ? newline : end;
+        int marker = conflict_marker_at(p, line_end);
+
+        if (marker == '<' && section == 0) {
+            section = '<';
+            hunk_start = line_number;
+        } else if (marker == '|' && section == '<') {
+            section = '|';
+            file->has_base = 1;
+        } else if (marker == '=' && (section == '<' || section == '|')) {
+            section = '=';
+        } else if (marker == '>' && section == '=') {
+            if (file->hunks < CONFLICT_MAX_RANGES) {
+                file->ranges[file->hunks][0] = (int)hunk_start;
+                file->ranges[file->hunks][1] = (int)line_number;
+            }
+            file->hunks++;
+            section = 0;
+        } else if (section == '<') {
+            file->ours_lines++;
+        } else if (section == '=') {
+            file->theirs_lines++;
+        }
+
+        line_number++;
+        p = newline ? newline + 1 : end;
+    }
+    file->unterminated = section != 0;
+    unmap_file(&map);
+}
+
+void interactive_conflict_resolver() 
+{
+    printf("🔄 Interactive Conflict Resolver\n");
+    printf("===============================\n");
+    
+    // -z keeps names unquoted; paths are relative to the top of the working tree
+    FILE *fp = discover_repository() == 0 && repo.worktree[0] ? open_git_stream("git status --porcelain -z") : NULL;
+    if (!fp) {
+        printf("Unable to read repository status\n\n");
+        return;
+    }
+    size_t status_size = 0, status_capacity = 1 << 16, got;
+    char *status = malloc(status_capacity);
+    while ((got = fread(status + status_size, 1, status_capacity - status_size - 1, fp)) > 0) {
+        status_size += got;
+        if (status_capacity - status_size < 4096) {
+            status_capacity *= 2;
+            status = realloc(status, status_capacity);
+        }
+    }
+    status[status_size] = '\0';
+    pclose(fp);
+
+    conflict_file_t *files = NULL;
+    int count = 0, capacity = 0;
+    for (char *entry = status; entry < status + status_size; entry += strlen(entry) + 1) {
+        if (strlen(entry) < 4) continue;
+        // Renames and copies carry their source as an extra field
+        if (strchr("RC", entry[0]) || strchr("RC", entry[1])) {
+            entry += strlen(entry) + 1;
+            continue;
+        }
+        if (!is_unmerged_state(entry)) continue;
+        if (count == capacity) {
+            capacity = capacity ? capacity * 2 : 64;
+            files = realloc(files, sizeof(conflict_file_t) * capacity);
+        }
+        memset(&files[count], 0, sizeof(conflict_file_t));
+        snprintf(files[count].state, sizeof(files[count].state), "%.2s", entry);
+        snprintf(files[count].path, sizeof(files[count].path), "%s", entry + 3);
+        count++;
+    }
+    free(status);
+
+    if (count == 0) {
+        printf("No merge conflicts detected.\n");
+        printf("This helper assists when you have unmerged files (UU, AA, DU, UD, ...).\n\n");
+        free(files);
+        return;
+    }
+    
+    parallel_for(count, default_job_count(), scan_conflict_task, files);
+
+    int total_hunks = 0, marker_free = 0;
+    long total_ours = 0, total_theirs = 0;
+    printf("1. Conflict inventory (%d unmerged files):\n", count);
+    for (int i = 0; i < count; i++) {
+        conflict_file_t *f = &files[i];
+        printf("  • [%s] %s — %s", f->state, f->path, describe_unmerged_state(f->state));
+        if (f->unreadable) {
+            printf(", not in the working tree\n");
+            continue;
+        }
+        if (f->hunks == 0) {
+            printf(", no conflict markers%s\n", strncmp(f->state, "UU", 2) == 0 || strncmp(f->state, "AA", 2) == 0 ?
+                   " (resolved but not staged, or binary)" : "");
+            marker_free++;
+            continue;
+        }
+        printf(", %d hunk%s, ours %ld / theirs %ld lines%s\n", f->hunks, f->hunks == 1 ? "" : "s",
+               f->ours_lines, f->theirs_lines, f->has_base ? ", diff3 base" : "");
+        printf("      lines");
+        for (int h = 0; h < f->hunks && h < CONFLICT_MAX_RANGES; h++) {
+            printf("%s %d-%d", h ? "," : "", f->ranges[h][0], f->ranges[h][1]);
+        }
+        if (f->hunks > CONFLICT_MAX_RANGES) printf(", ... (+%d more)", f->hunks - CONFLICT_MAX_RANGES);
+        printf("\n");
+        if (f->unterminated) printf("      ⚠️  unterminated conflict block at end of file\n");
+        total_hunks += f->hunks;
+        total_ours += f->ours_lines;
+        total_theirs += f->theirs_lines;
+    }
+    printf("\nTotal: %d hunks, %ld lines ours / %ld lines theirs", total_hunks, total_ours, total_theirs);
+    if (marker_free > 0) printf(", %d files without markers", marker_free);
+    printf("\n");
+    free(files);
+    
+    printf("\n2. For each conflicted file:\n");
+    printf("   - Open the file in your editor\n");
+    printf("   - Look for <<<<<<<, =======, >>>>>>> markers\n");
+    printf("   - Choose which changes to keep (ours/theirs/both)\n");
+    printf("   - Remove the conflict markers and clean up the code\n");
+    printf("   - Save the file\n");
+    printf("   - Delete/modify conflicts: git add <file> to keep it, git rm <file> to drop it\n");
+    
+    printf("\n3. After resolving all conflicts:\n");
+    printf("   git add .\n");
+    printf("   git commit\n");
+    
+    printf("\n4. Common tools that can help:\n");
+    printf("   - git mergetool (opens configured merge tool)\n");
+    printf("   - git diff (see differences)\n");
+    printf("   - git log --merge (see conflicting commits)\n");
+    
+    printf("\n💡 Tip: Use 'git config --global merge.tool vscode' to set up VS Code as merge tool\n\n");
+}
+
+// ==================== PERFORMANCE REGRESSION DETECTOR ====================
+
+void detect_performance_regressions() 
+{
+    printf("⚡ Performance Regression Detection\n");
+    printf("==================================\n");
+    
+    recent_commits_t recent;
+    analyzer_t analyzer = recent_commits_analyzer(&recent, 5);
+    analyzer_t *analyzers[] = { &analyzer };
+    run_history_walk(analyzers, 1);
+    if (recent.count > 0) {
+        printf("Recent commits (watch for large changes):\n");
+        for (int i = 0; i < recent.count; i++) {
+            printf("  • %.7s %s (+%d -%d)\n", recent.commits[i].hash, recent.commits[i].message,
+                   recent.commits[i].insertions, recent.commits[i].deletions);
+        }
+    }
+    
+    #ifdef _WIN32
+    char* large_files = run_git_command_output("git ls-tree -r -l HEAD | sort /R");
+    #else
+    char* large_files = run_git_command_output("git ls-tree -r -l HEAD | sort -n -k4 | tail -3");
+    #endif
+    
+    if (large_files && strlen(large_files) > 0) {
+        printf("\nFiles to monitor for size (potential performance concerns):\n");
+        char* line = strtok(large_files, "\n");
+        int count = 0;
+        while (line && count < 3) {
+            printf("  • %s\n", line);
+            line = strtok(NULL, "\n");
+            count++;
+        }
+    }
+    
+    printf("\n🔍 Performance Monitoring Tips:\n");
+    printf("• Monitor file size growth over time ('gitsmart performance --growth')\n");
+    printf("• Watch for large binary files in repo\n");
+    printf("• Consider git-lfs for large assets\n");
+    printf("• Use profilers for performance-critical code\n\n");
+}
+
+// ==================== SIZE GROWTH TRACKING ====================
+
+#define GROWTH_KEEP 100
+#define SIZE_BATCH 512
+
+typedef struct {
+    char commit[41];
+    long long epoch;
+    long long delta;
+    long long top_path_delta;
+    char top_path[MAX_PATH_LENGTH];
+    char subject[256];
+} size_jump_t;
+
+typedef struct {
+    char head[41];
+    long long total_size;
+    int commits_indexed;
+    path_table_t paths;
+    long long *path_sizes;
+    int path_sizes_capacity;
+    size_jump_t jumps[GROWTH_KEEP];
+    int jump_count;
+} growth_state_t;
+
+typedef struct {
+    char commit[41];
+    long long epoch;
+    char subject[256];
+    int first_change;
+    int change_count;
+} pending_commit_t;
+
+typedef struct {
+    int path_id;
+    int deleted;
+    unsigned char oid[20];
+} pending_change_t;
+
+// Unseen blobs are queued and sized in groups; commits are replayed once their sizes are known
+typedef struct {
+    pending_commit_t *commits;
+    int commit_count, commit_capacity;
+    pending_change_t *changes;
+    int change_count, change_capacity;
+    unsigned char (*queued)[20];
+    int queued_count;
+    oid_map_t blob_sizes;
+} growth_batch_t;
+
+static void growth_set_path_size(growth_state_t *g, int path_id, long long size) 
+{
+    if (path_id >= g->path_sizes_capacity) {
+        int old_capacity = g->path_sizes_capacity;
+        g->path_sizes_capacity = (path_id + 1) * 2;
+        g->path_sizes = realloc(g->path_sizes, sizeof(long long) * g->path_sizes_capacity);
+        memset(g->path_sizes + old_capacity, 0, sizeof(long long) * (g->path_sizes_capacity - old_capacity));
+    }
+    g->path_sizes[path_id] = size;
+}
+
+static long long growth_path_size(const growth_state_t *g, int path_id) 
+{
+    return path_id < g->path_sizes_capacity ? g->path_sizes[path_id] : 0;
+}
+
+// Keeps jumps sorted largest first, bounded by GROWTH_KEEP
+static void record_size_jump(growth_state_t *g, const size_jump_t *jump) 
+{
+    if (jump->delta <= 0) return;
+    if (g->jump_count == GROWTH_KEEP) {
+        if (jump->delta <= g->jumps[GROWTH_KEEP - 1].delta) return;
+        g->jump_count--;
+    }
+    int pos = g->jump_count++;
+    while (pos > 0 && g->jumps[pos - 1].delta < jump->delta) {
+        g->jumps[pos] = g->jumps[pos - 1];
+        pos--;
+    }
+    g->jumps[pos] = *jump;
+}
+
+static void resolve_queued_sizes(growth_batch_t *batch, git_coprocess_t *sizes) 
+{
+    char hex[41];
+    for (int i = 0; i < batch->queued_count; i++) {
+        oid_to_hex(batch->queued[i], hex);
+        coprocess_send(sizes, hex);
+    }
+
+    char *line = NULL;
+    size_t capacity = 0;
+    for (int i = 0; i < batch->queued_count; i++) {
+        if (coprocess_receive(sizes, &line, &capacity) < 0) break;
+        unsigned char oid[20];
+        char *size_field = strchr(line, ' ');
+        if (hex_to_oid(line, oid) != 0 || !size_field) continue;
+        long long *size = oid_map_find(&batch->blob_sizes, oid);
+        if (size) *size = strstr(size_field, "missing") ? 0 : atoll(size_field + 1);
+    }
+    free(line);
+    batch->queued_count = 0;
+}
+
+static void flush_growth_batch(growth_state_t *g, growth_batch_t *batch, git_coprocess_t *sizes) 
+{
+    resolve_queued_sizes(batch, sizes);
+
+    for (int c = 0; c < batch->commit_count; c++) {
+        pending_commit_t *commit = &batch->commits[c];
+        size_jump_t jump = {0};
+        int top_path = -1;
+
+        for (int i = commit->first_change; i < commit->first_change + commit->change_count; i++) {
+            pending_change_t *change = &batch->changes[i];
+            long long new_size = 0;
+            if (!change->deleted) {
+                long long *size = oid_map_find(&batch->blob_sizes, change->oid);
+                new_size = (size && *size > 0) ? *size : 0;
+            }
+            long long delta = new_size - growth_path_size(g, change->path_id);
+            growth_set_path_size(g, change->path_id, new_size);
+            jump.delta += delta;
+            if (delta > jump.top_path_delta) {
+                jump.top_path_delta = delta;
+                top_path = change->path_id;
+            }
+        }
+
+        g->total_size += jump.delta;
+        g->commits_indexed++;
+        strcpy(jump.commit, commit->commit);
+        jump.epoch = commit->epoch;
+        strcpy(jump.subject, commit->subject);
+        if (top_path >= 0) {
+            strncpy(jump.top_path, g->paths.names[top_path], MAX_PATH_LENGTH - 1);
+        }
+        record_size_jump(g, &jump);
+        strcpy(g->head, commit->commit);
+    }
+
+    batch->commit_count = 0;
+    batch->change_count = 0;
+}
+
+static void parse_growth_raw_line(growth_state_t *g, growth_batch_t *batch, char *line) 
+{
+    // :<old mode> <new mode> <old oid> <new oid> <status>\t<path>
+    char *tab = strchr(line, '\t');
+    if (!tab || batch->commit_count == 0) return;
+    *tab = '\0';
+
+    char old_mode[8], new_mode[8], old_hex[65], new_hex[65], status[8];
+    if (sscanf(line + 1, "%7s %7s %64s %64s %7s", old_mode, new_mode, old_hex, new_hex, status) != 5) return;
+    if (strcmp(old_mode, "160000") == 0 || strcmp(new_mode, "160000") == 0) return;
+
+    pending_change_t change = {0};
+    change.path_id = path_table_intern(&g->paths, tab + 1);
+    change.deleted = status[0] == 'D';
+    if (hex_to_oid(new_hex, change.oid) != 0) return;
+
+    if (!change.deleted && !is_null_oid(change.oid)) {
+        int created = 0;
+        long long *size = oid_map_insert(&batch->blob_sizes, change.oid, &created);
+        if (created) {
+            *size = -1;
+            memcpy(batch->queued[batch->queued_count++], change.oid, 20);
+        }
+    }
+
+    if (batch->change_count == batch->change_capacity) {
+        batch->change_capacity = batch->change_capacity ? batch->change_capacity * 2 : 1024;
+        batch->changes = realloc(batch->changes, sizeof(pending_change_t) * batch->change_capacity);
+    }
+    batch->changes[batch->change_count++] = change;
+    batch->commits[batch->commit_count - 1].change_count++;
+}
+
+static void parse_growth_commit_line(growth_batch_t *batch, char *line) 
+{
+    // commit <hash> <epoch> <subject>
+    if (batch->commit_count == batch->commit_capacity) {
+        batch->commit_capacity = batch->commit_capacity ? batch->commit_capacity * 2 : 256;
+        batch->commits = realloc(batch->commits, sizeof(pending_commit_t) * batch->commit_capacity);
+    }
+    pending_commit_t *commit = &batch->commits[batch->commit_count];
+    memset(commit, 0, sizeof(*commit));
+
+    char *hash = line + 7;
+    char *epoch = strchr(hash, ' ');
+    if (!epoch || epoch - hash != 40) return;
+    *epoch++ = '\0';
+    char *subject = strchr(epoch, ' ');
+    if (subject) *subject++ = '\0';
+
+    strcpy(commit->commit, hash);
+    commit->epoch = atoll(epoch);
+    strncpy(commit->subject, subject ? subject : "", sizeof(commit->subject) - 1);
+    commit->first_change = batch->change_count;
+    batch->commit_count++;
+}
+
+void load_growth_cache(growth_state_t *g) 
+{
+    char path[MAX_PATH_LENGTH];
+    if (get_cache_path(path, sizeof(path), "growth.cache") != 0) return;
+    FILE *fp = fopen(path, "r");
+    if (!fp) return;
+
+    char *line = NULL;
+    size_t capacity = 0;
+    int path_count = 0, jump_count = 0;
+    if (read_stream_line(fp, &line, &capacity) < 0 || strcmp(line, "gitsmart-growth 1") != 0 ||
+        read_stream_line(fp, &line, &capacity) < 0 ||
+        sscanf(line, "%40s %lld %d %d %d", g->head, &g->total_size, &g->commits_indexed, &path_count, &jump_count) != 5) {
+        g->head[0] = '\0';
+        fclose(fp);
+        free(line);
+        return;
+    }
+
+    for (int i = 0; i < path_count && read_stream_line(fp, &line, &capacity) >= 0; i++) {
+        char *tab = strchr(line, '\t');
+        if (!tab) continue;
+        growth_set_path_size(g, path_table_intern(&g->paths, tab + 1), atoll(line));
+    }
+
+    for (int i = 0; i < jump_count && i < GROWTH_KEEP && read_stream_line(fp, &line, &capacity) >= 0; i++) {
+        size_jump_t *jump = &g->jumps[g->jump_count];
+        memset(jump, 0, sizeof(*jump));
+        char *top_path = strchr(line, '\t');
+        char *subject = top_path ? strchr(top_path + 1, '\t') : NULL;
+        if (!subject) continue;
+        *top_path++ = '\0';
+        *subject++ = '\0';
+        if (sscanf(line, "%lld %lld %40s %lld", &jump->delta, &jump->top_path_delta, jump->commit, &jump->epoch) != 4) continue;
+        strncpy(jump->top_path, top_path, MAX_PATH_LENGTH - 1);
+        strncpy(jump->subject, subject, sizeof(jump->subject) - 1);
+        g->jump_count++;
+    }
+
+    free(line);
+    fclose(fp);
+}
+
+void save_growth_cache(const growth_state_t *g) 
+{
+    char path[MAX_PATH_LENGTH], tmp_path[MAX_PATH_LENGTH + 8];
+    if (get_cache_path(path, sizeof(path), "growth.cache") != 0) return;
+    FILE *fp = begin_index_file(path, tmp_path, sizeof(tmp_path));
+    if (!fp) return;
+
+    int live_paths = 0;
+    for (int i = 0; i < g->paths.count; i++) {
+        if (growth_path_size(g, i) > 0) live_paths++;
+    }
+
+    fprintf(fp, "gitsmart-growth 1\n");
+    fprintf(fp, "%s %lld %d %d %d\n", g->head, g->total_size, g->commits_indexed, live_paths, g->jump_count);
+    for (int i = 0; i < g->paths.count; i++) {
+        if (growth_path_size(g, i) > 0) {
+            fprintf(fp, "%lld\t%s\n", growth_path_size(g, i), g->paths.names[i]);
+        }
+    }
+    for (int i = 0; i < g->jump_count; i++) {
+        const size_jump_t *jump = &g->jumps[i];
+        fprintf(fp, "%lld %lld %s %lld\t%s\t%s\n", jump->delta, jump->top_path_delta, jump->commit,
+                jump->epoch, jump->top_path, jump->subject);
+    }
+
+    finish_index_file(fp, tmp_path, path);
+}
+
+// Replays first-parent history with blob sizes, resuming from the cached HEAD when possible.
+// Returns the number of newly indexed commits, or -1 if history could not be read.
+int update_growth_index(growth_state_t *g) 
+{
+    char current_head[41];
+    if (get_head_oid(current_head) != 0) return -1;
+
+    load_growth_cache(g);
+    if (g->head[0] && strcmp(g->head, current_head) == 0) return 0;
+
+    char range[128] = "HEAD";
+    if (is_ancestor_of_head(g->head)) {
+        snprintf(range, sizeof(range), "%s..HEAD", g->head);
+    } else {
+        // History was rewritten (or no cache yet): start over
+        path_table_free(&g->paths);
+        free(g->path_sizes);
+        memset(g, 0, sizeof(*g));
+    }
+
+    git_coprocess_t sizes;
+    if (coprocess_open(&sizes, "git cat-file --batch-check=\"%(objectname) %(objectsize)\"") != 0) return -1;
+
+    FILE *log = open_git_stream("git -c core.quotePath=false log --raw --no-abbrev --no-renames --first-parent -m "
+                                "--reverse --format=\"commit %%H %%ct %%s\" %s", range);
+    if (!log) {
+        coprocess_close(&sizes);
+        return -1;
+    }
+
+    growth_batch_t batch = {0};
+    batch.queued = malloc(20 * SIZE_BATCH);
+    int before = g->commits_indexed;
+    stream_pipe_t lines;
+    stream_pipe_open(&lines, log);
+    char *line;
+
+    // Parsing and the cat-file size lookups overlap with git log producing the next chunks
+    while ((line = stream_pipe_line(&lines, NULL))) {
+        if (strncmp(line, "commit ", 7) == 0) {
+            // Only replay on commit boundaries so every applied commit is complete
+            if (batch.change_count >= SIZE_BATCH * 8) flush_growth_batch(g, &batch, &sizes);
+            parse_growth_commit_line(&batch, line);
+        } else if (line[0] == ':') {
+            parse_growth_raw_line(g, &batch, line);
+            if (batch.queued_count == SIZE_BATCH) resolve_queued_sizes(&batch, &sizes);
+        }
+    }
+    flush_growth_batch(g, &batch, &sizes);
+
+    stream_pipe_close(&lines);
+    pclose(log);
+    coprocess_close(&sizes);
+    free(batch.commits);
+    free(batch.changes);
+    free(batch.queued);
+    oid_map_free(&batch.blob_sizes);
+
+    strcpy(g->head, current_head);
+    save_growth_cache(g);
+    return g->commits_indexed - before;
+}
+
+void show_size_growth(int top_k) 
+{
+    printf("📈 Repository Growth History\n");
+    printf("============================\n");
+
+    growth_state_t *g = calloc(1, sizeof(growth_state_t));
+    int new_commits = update_growth_index(g);
+    if (new_commits < 0 || g->commits_indexed == 0) {
+        printf("No commit history found.\n\n");
+        free(g);
+        return;
+    }
+
+    int live_paths = 0;
+    for (int i = 0; i < g->paths.count; i++) {
+        if (growth_path_size(g, i) > 0) live_paths++;
+    }
+
+    char total[32];
+    format_size(g->total_size, total, sizeof(total));
+    printf("Indexed commits: %d (first-parent, %d new since last run)\n", g->commits_indexed, new_commits);
+    printf("Tracked size at HEAD: %s across %d files\n", total, live_paths);
+
+    if (top_k > g->jump_count) top_k = g->jump_count;
+    if (top_k == 0) {
+        printf("\nNo commits increased repository size.\n\n");
+    } else {
+        printf("\nTop %d size jumps by commit:\n", top_k);
+        for (int i = 0; i < top_k; i++) {
+            const size_jump_t *jump = &g->jumps[i];
+            char delta[32], path_delta[32], date[16] = "";
+            time_t when = (time_t)jump->epoch;
+            struct tm *tm_info = localtime(&when);
+            if (tm_info) strftime(date, sizeof(date), "%Y-%m-%d", tm_info);
+            format_size(jump->delta, delta, sizeof(delta));
+            format_size(jump->top_path_delta, path_delta, sizeof(path_delta));
+            printf("  +%-10s %.7s  %s  %s\n", delta, jump->commit, date, jump->subject);
+            if (jump->top_path[0]) {
+                printf("   %-11s biggest: %s (+%s)\n", "", jump->top_path, path_delta);
+            }
+        }
+        printf("\n");
+    }
+
+    path_table_free(&g->paths);
+    free(g->path_sizes);
+    free(g);
+}
+
+// ==================== LARGEST OBJECTS ====================
+
+#define LFS_THRESHOLD (1024 * 1024)
+
+typedef struct {
+    unsigned char oid[20];
+    long long size;
+    long long disk_size;
+    char path[MAX_PATH_LENGTH];
+    char commit[41];
+    char date[16];
+    char author[64];
+    int at_head;
+} large_object_t;
+
+// Min-heap on size: the root is the smallest of the K largest blobs seen so far
+static void large_object_sift_down(large_object_t *heap, int count, int i) 
+{
+    for (;;) {
+        int smallest = i, left = 2 * i + 1, right = 2 * i + 2;
+        if (left < count && heap[left].size < heap[smallest].size) smallest = left;
+        if (right < count && heap[right].size < heap[smallest].size) smallest = right;
+        if (smallest == i) return;
+        large_object_t t = heap[i];
+        heap[i] = heap[smallest];
+        heap[smallest] = t;
+        i = smallest;
+    }
+}
+
+static void large_object_push(large_object_t *heap, int *count, int capacity, const unsigned char *oid,
+                              long long size, long long disk_size) 
+{
+    int i;
+    if (*count < capacity) {
+        i = (*count)++;
+        while (i > 0 && heap[(i - 1) / 2].size > size) {
+            heap[i] = heap[(i - 1) / 2];
+            i = (i - 1) / 2;
+        }
+    } else if (size > heap[0].size) {
+        i = 0;
+    } else {
+        return;
+    }
+    memset(&heap[i], 0, sizeof(large_object_t));
+    memcpy(heap[i].oid, oid, 20);
+    heap[i].size = size;
+    heap[i].disk_size = disk_size;
+    if (*count == capacity && i == 0) large_object_sift_down(heap, *count, 0);
+}
+
+static int compare_large_objects(const void *a, const void *b) 
+{
+    const large_object_t *x = a, *y = b;
+    if (x->size != y->size) return y->size > x->size ? 1 : -1;
+    return memcmp(x->oid, y->oid, 20);
+}
+
+// Oldest commit on any ref whose diff produced each winner; stops once all are placed
+static void locate_large_objects(large_object_t *objects, int count) 
+{
+    oid_map_t winners = {0};
+    for (int i = 0; i < count; i++) *oid_map_insert(&winners, objects[i].oid, NULL) = i + 1;
+
+    FILE *fp = open_git_stream("git -c core.quotePath=false log --all --reverse --raw --no-abbrev --no-renames "
+                               "--date=short --format=\"commit %%H%%x09%%ad%%x09%%an\"");
+    int remaining = count;
+    if (fp) {
+        char commit[41] = "", date[16] = "", author[64] = "";
+        char *line = NULL;
+        size_t capacity = 0;
+        while (remaining > 0 && read_stream_line(fp, &line, &capacity) >= 0) {
+            if (strncmp(line, "commit ", 7) == 0 && strlen(line) > 48) {
+                snprintf(commit, sizeof(commit), "%.40s", line + 7);
+                char *tab = strchr(line + 48, '\t');
+                snprintf(date, sizeof(date), "%.*s", tab ? (int)(tab - line - 48) : 0, line + 48);
+                snprintf(author, sizeof(author), "%s", tab ? tab + 1 : "");
+                continue;
+            }
+            // :<old mode> <new mode> <old oid> <new oid> <status>\t<path>
+            char *tab = strchr(line, '\t');
+            if (line[0] != ':' || !tab || tab - line < 97) continue;
+            unsigned char oid[20];
+            if (hex_to_oid(line + 56, oid) != 0) continue;
+            long long *slot = oid_map_find(&winners, oid);
+            if (!slot || objects[*slot - 1].commit[0]) continue;
+            large_object_t *object = &objects[*slot - 1];
+            snprintf(object->path, sizeof(object->path), "%s", tab + 1);
+            memcpy(object->commit, commit, sizeof(commit));
+            memcpy(object->date, date, sizeof(date));
+            memcpy(object->author, author, sizeof(author));
+            remaining--;
+        }
+        free(line);
+        pclose(fp);
+    }
+
+    fp = open_git_stream("git ls-tree -r --full-tree HEAD");
+    if (fp) {
+        char *line = NULL;
+        size_t capacity = 0;
+        while (read_stream_line(fp, &line, &capacity) >= 0) {
+            // <mode> blob <oid>\t<path>
+            char *blob = strstr(line, " blob ");
+            unsigned char oid[20];
+            if (!blob || hex_to_oid(blob + 6, oid) != 0) continue;
+            long long *slot = oid_map_find(&winners, oid);
+            if (slot) objects[*slot - 1].at_head = 1;
+        }
+        free(line);
+        pclose(fp);
+    }
+    oid_map_free(&winners);
+}
+
+// Every blob in the object store, loose or packed, reachable or not, in one cat-file pass
+void show_largest_objects(int top_k) 
+{
+    printf("🐘 Largest Objects in History\n");
+    printf("=============================\n");
+
+    FILE *fp = open_git_stream("git cat-file --batch-all-objects --batch-check=\"%%(objecttype) %%(objectname) %%(objectsize) %%(objectsize:disk)\"");
+    if (!fp) {
+        printf("Unable to read the object store\n\n");
+        return;
+    }
+
+    large_object_t *heap = malloc(sizeof(large_object_t) * top_k);
+    int count = 0;
+    long long blob_count = 0, blob_bytes = 0, disk_bytes = 0;
+    char *line = NULL;
+    size_t capacity = 0;
+    while (read_stream_line(fp, &line, &capacity) >= 0) {
+        if (strncmp(line, "blob ", 5) != 0 || strlen(line) < 47) continue;
+        unsigned char oid[20];
+        if (hex_to_oid(line + 5, oid) != 0) continue;
+        char *end;
+        long long size = strtoll(line + 46, &end, 10);
+        long long disk_size = strtoll(end, NULL, 10);
+        blob_count++;
+        blob_bytes += size;
+        disk_bytes += disk_size;
+        large_object_push(heap, &count, top_k, oid, size, disk_size);
+    }
+    free(line);
+    pclose(fp);
+
+    if (count == 0) {
+        printf("No blobs found.\n\n");
+        free(heap);
+        return;
+    }
+
+    qsort(heap, count, sizeof(large_object_t), compare_large_objects);
+    locate_large_objects(heap, count);
+
+    char total[32], on_disk[32];
+    format_size(blob_bytes, total, sizeof(total));
+    format_size(disk_bytes, on_disk, sizeof(on_disk));
+    printf("Blobs: %lld, %s uncompressed, %s on disk\n", blob_count, total, on_disk);
+
+    long long top_bytes = 0, deleted_bytes = 0;
+    printf("\nTop %d blobs by size:\n", count);
+    for (int i = 0; i < count; i++) {
+        const large_object_t *object = &heap[i];
+        char size[32], disk_size[32];
+        format_size(object->size, size, sizeof(size));
+        format_size(object->disk_size, disk_size, sizeof(disk_size));
+        top_bytes += object->size;
+        if (!object->at_head) deleted_bytes += object->size;
+
+        if (object->commit[0]) {
+            printf("  %-10s (%s packed)  %s%s\n", size, disk_size, object->path, object->at_head ? "" : "  [not at HEAD]");
+            printf("   %-10s added in %.7s (%s, %s)\n", "", object->commit, object->date, object->author);
+        } else {
+            char hex[41];
+            oid_to_hex(object->oid, hex);
+            printf("  %-10s (%s packed)  %.12s  [unreachable or only in merges]\n", size, disk_size, hex);
+        }
+    }
+
+    char top[32], deleted[32];
+    format_size(top_bytes, top, sizeof(top));
+    format_size(deleted_bytes, deleted, sizeof(deleted));
+    printf("\nThese %d blobs hold %s (%.1f%% of all blob bytes); %s of it is no longer at HEAD\n",
+           count, top, blob_bytes ? 100.0 * top_bytes / blob_bytes : 0.0, deleted);
+
+    // LFS audit: file extensions of the winners that cross the threshold
+    path_table_t extensions = {0};
+    long long *extension_bytes = NULL;
+    int *extension_blobs = NULL;
+    for (int i = 0; i < count; i++) {
+        if (heap[i].size < LFS_THRESHOLD || !heap[i].path[0]) continue;
+        const char *base = strrchr(heap[i].path, '/');
+        const char *dot = strrchr(base ? base + 1 : heap[i].path, '.');
+        int id = path_table_intern(&extensions, dot ? dot : (base ? base + 1 : heap[i].path));
+        if (id == extensions.count - 1) {
+            extension_bytes = realloc(extension_bytes, sizeof(long long) * extensions.count);
+            extension_blobs = realloc(extension_blobs, sizeof(int) * extensions.count);
+            extension_bytes[id] = 0;
+            extension_blobs[id] = 0;
+        }
+        extension_bytes[id] += heap[i].size;
+        extension_blobs[id]++;
+    }
+
+    char threshold[32];
+    format_size(LFS_THRESHOLD, threshold, sizeof(threshold));
+    if (extensions.count == 0) {
+        printf("\n✅ No blobs over %s — nothing to move to Git LFS\n\n", threshold);
+    } else {
+        printf("\n📦 Git LFS candidates (blobs over %s):\n", threshold);
+        for (int i = 0; i < extensions.count; i++) {
+            char bytes[32];
+            format_size(extension_bytes[i], bytes, sizeof(bytes));
+            printf("  %s%-16s %d blob%s, %s\n", extensions.names[i][0] == '.' ? "*" : "", extensions.names[i],
+                   extension_blobs[i], extension_blobs[i] == 1 ? "" : "s", bytes);
+        }
+        printf("\n💡 git lfs migrate import --everything --include=\"");
+        for (int i = 0; i < extensions.count; i++) {
+            printf("%s%s%s", i ? "," : "", extensions.names[i][0] == '.' ? "*" : "", extensions.names[i]);
+        }
+        printf("\"\n\n");
+    }
+
+    path_table_free(&extensions);
+    free(extension_bytes);
+    free(extension_blobs);
+    free(heap);
+}
+
+// ==================== APPROXIMATE ANALYTICS ====================
+
+// Fixed-size sketches for a quick look at very long histories: one diff-free pass over commit
+// metadata, plus numstat for a uniform sample of commits only
+#define HLL_PRECISION 12
+#define HLL_REGISTERS (1 << HLL_PRECISION)
+#define COUNT_MIN_DEPTH 4
+#define COUNT_MIN_WIDTH 2048
+#define APPROX_TOP 32
+#define APPROX_DEFAULT_SAMPLE 1000
+
+typedef struct {
+    uint8_t registers[HLL_REGISTERS];
+} hyperloglog_t;
+
+typedef struct {
+    uint32_t counts[COUNT_MIN_DEPTH][COUNT_MIN_WIDTH];
+    long long total;
+} count_min_t;
+
+typedef struct {
+    char name[MAX_PATH_LENGTH];
+    long long estimate;
+} approx_top_t;
+
+typedef struct {
+    long long commits;
+    long long merges;
+    char recent_dates[3][16];
+    int date_count;
+    hyperloglog_t authors;
+    hyperloglog_t files;
+    count_min_t author_counts;
+    count_min_t file_counts;
+    approx_top_t top_authors[APPROX_TOP];
+    approx_top_t top_files[APPROX_TOP];
+    int top_author_count;
+    int top_file_count;
+    // Reservoir of commit hashes; churn is filled in once the sample is diffed
+    char (*sample)[41];
+    int *sample_churn;
+    int sample_size;
+    int sampled;
+    long long sample_insertions;
+    long long sample_deletions;
+} approx_stats_t;
+
+static uint64_t sketch_hash(const char *s) 
+{
+    uint64_t h = 0xcbf29ce484222325ULL;
+    for (; *s; s++) h = (h ^ (unsigned char)*s) * 0x100000001b3ULL;
+    // FNV alone leaves the high bits HyperLogLog indexes on poorly mixed
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return h;
+}
+
+static uint64_t sketch_random(uint64_t *state) 
+{
+    *state ^= *state >> 12;
+    *state ^= *state << 25;
+    *state ^= *state >> 27;
+    return *state * 0x2545f4914f6cdd1dULL;
+}
+
+static void hll_add(hyperloglog_t *hll, uint64_t hash) 
+{
+    uint32_t index = (uint32_t)(hash >> (64 - HLL_PRECISION));
+    uint64_t rest = hash << HLL_PRECISION;
+    uint8_t rank = 1;
+    while (rank <= 64 - HLL_PRECISION && !(rest & (1ULL << 63))) {
+        rest <<= 1;
+        rank++;
+    }
+    if (rank > hll->registers[index]) hll->registers[index] = rank;
+}
+
+static double hll_estimate(const hyperloglog_t *hll) 
+{
+    double m = HLL_REGISTERS, sum = 0;
+    int zeros = 0;
+    for (int i = 0; i < HLL_REGISTERS; i++) {
+        sum += ldexp(1.0, -hll->registers[i]);
+        if (hll->registers[i] == 0) zeros++;
+    }
+    double estimate = 0.7213 / (1 + 1.079 / m) * m * m / sum;
+    // Linear counting is more accurate while many registers are still empty
+    if (estimate <= 2.5 * m && zeros > 0) estimate = m * log(m / zeros);
+    return estimate;
+}
+
+// 95% relative error of a HyperLogLog estimate (two standard errors of 1.04/sqrt(m))
+static double hll_error() 
+{
+    return 2 * 1.04 / sqrt((double)HLL_REGISTERS);
+}
+
+// Adds `count` and returns the new estimate, which never undercounts and overcounts by at
+// most total * e / width with probability 1 - e^-depth
+static long long count_min_add(count_min_t *cm, uint64_t hash, int count) 
+{
+    uint32_t h1 = (uint32_t)hash, h2 = (uint32_t)(hash >> 32) | 1;
+    long long estimate = -1;
+    cm->total += count;
+    for (int row = 0; row < COUNT_MIN_DEPTH; row++) {
+        uint32_t *cell = &cm->counts[row][(h1 + (uint32_t)row * h2) & (COUNT_MIN_WIDTH - 1)];
+        *cell += count;
+        if (estimate < 0 || *cell < estimate) estimate = *cell;
+    }
+    return estimate;
+}
+
+static double count_min_error(const count_min_t *cm) 
+{
+    return exp(1.0) / COUNT_MIN_WIDTH * cm->total;
+}
+
+// Keeps the APPROX_TOP keys with the largest running estimates
+static void approx_top_update(approx_top_t *top, int *count, const char *name, long long estimate) 
+{
+    int smallest = 0;
+    for (int i = 0; i < *count; i++) {
+        if (strcmp(top[i].name, name) == 0) {
+            top[i].estimate = estimate;
+            return;
+        }
+        if (top[i].estimate < top[smallest].estimate) smallest = i;
+    }
+    if (*count < APPROX_TOP) smallest = (*count)++;
+    else if (top[smallest].estimate >= estimate) return;
+    snprintf(top[smallest].name, sizeof(top[smallest].name), "%s", name);
+    top[smallest].estimate = estimate;
+}
+
+static int compare_approx_top(const void *a, const void *b) 
+{
+    const approx_top_t *x = a, *y = b;
+    if (x->estimate != y->estimate) return x->estimate < y->estimate ? 1 : -1;
+    return strcmp(x->name, y->name);
+}
+
+static void approx_count_file(approx_stats_t *s, const char *path) 
+{
+    uint64_t hash = sketch_hash(path);
+    hll_add(&s->files, hash);
+    approx_top_update(s->top_files, &s->top_file_count, path, count_min_add(&s->file_counts, hash, 1));
+}
+
+// Numstat for the sampled commits only, in one diff-tree process
+static int diff_approx_sample(approx_stats_t *s) 
+{
+    char list_path[MAX_PATH_LENGTH + 64];
+    if (get_temp_path(list_path, sizeof(list_path), "sample") != 0) return -1;
+    FILE *list = fopen(list_path, "w");
+    if (!list) return -1;
+    for (int i = 0; i < s->sampled; i++) fprintf(list, "%s\n", s->sample[i]);
+    fclose(list);
+
+    FILE *fp = open_git_stream("git -c core.quotePath=false diff-tree --stdin --root --numstat -M < \"%s\"", list_path);
+    if (!fp) {
+        remove(list_path);
+        return -1;
+    }
+    // Output follows input order; merges print nothing, just as in `git log --numstat`
+    walk_changes_t changes;
+    memset(&changes, 0, sizeof(changes));
+    int current = -1, next = 0;
+    char *line = NULL;
+    size_t capacity = 0;
+    while (read_stream_line(fp, &line, &capacity) >= 0) {
+        if (strlen(line) == 40 && !strchr(line, '\t')) {
+            while (next < s->sampled && strcmp(s->sample[next], line) != 0) next++;
+            current = next < s->sampled ? next++ : -1;
+            continue;
+        }
+        if (current < 0 || !line[0]) continue;
+        changes.count = 0;
+        changes.length = 0;
+        parse_walk_change(&changes, line, 1);
+        for (int i = 0; i < changes.count; i++) {
+            s->sample_churn[current] += changes.insertions[i] + changes.deletions[i];
+            s->sample_insertions += changes.insertions[i];
+            s->sample_deletions += changes.deletions[i];
+            approx_count_file(s, changes.text + changes.offsets[2 * i]);
+        }
+    }
+    free(line);
+    pclose(fp);
+    remove(list_path);
+    free(changes.text);
+    free(changes.offsets);
+    free(changes.insertions);
+    free(changes.deletions);
+    return 0;
+}
+
+typedef struct {
+    approx_stats_t *stats;
+    uint64_t random_state;
+} approx_pass_t;
+
+static void approx_count_commit(approx_pass_t *pass, const char *hash, int merge, const char *date, const char *author) 
+{
+    approx_stats_t *s = pass->stats;
+    if (merge) s->merges++;
+    if (s->date_count < 3) snprintf(s->recent_dates[s->date_count++], sizeof(s->recent_dates[0]), "%s", date);
+    uint64_t hash_value = sketch_hash(author);
+    hll_add(&s->authors, hash_value);
+    approx_top_update(s->top_authors, &s->top_author_count, author, count_min_add(&s->author_counts, hash_value, 1));
+
+    // Reservoir sampling: commit n replaces a random slot with probability k/n
+    if (s->sampled < s->sample_size) {
+        strcpy(s->sample[s->sampled++], hash);
+    } else {
+        uint64_t slot = sketch_random(&pass->random_state) % (uint64_t)(s->commits + 1);
+        if (slot < (uint64_t)s->sample_size) strcpy(s->sample[slot], hash);
+    }
+    s->commits++;
+}
+
+static int approx_visit_commit(void *context, const history_commit_t *commit) 
+{
+    approx_count_commit(context, commit->hash, commit->parent_count > 1, commit->date, commit->author);
+    return 1;
+}
+
+// Commit count, merges and authors from every commit; churn and hot files from a uniform
+// sample of `sample_size` commits; distinct files from HEAD's tree plus the sample
+int collect_approx_stats(approx_stats_t *s, int sample_size) 
+{
+    memset(s, 0, sizeof(*s));
+    s->sample_size = sample_size > 0 ? sample_size : APPROX_DEFAULT_SAMPLE;
+    s->sample = malloc(41 * (size_t)s->sample_size);
+    s->sample_churn = calloc(s->sample_size, sizeof(int));
+
+    // The metadata pass covers all history, so it reads the object store when it can
+    approx_pass_t pass = { s, 0x9e3779b97f4a7c15ULL };
+    FILE *fp;
+    char *line = NULL;
+    size_t capacity = 0;
+    if (walk_commits_native(approx_visit_commit, &pass) != 0) {
+        fp = open_git_stream("git log --date=short --format=\"%%H%%x09%%P%%x09%%ad%%x09%%an\" HEAD");
+        if (!fp) return -1;
+        while (read_stream_line(fp, &line, &capacity) >= 0) {
+            char *fields[4];
+            fields[0] = line;
+            int i;
+            for (i = 1; i < 4 && (fields[i] = strchr(fields[i - 1], '\t')); i++) *fields[i]++ = '\0';
+            if (i < 4 || strlen(fields[0]) != 40) continue;
+            approx_count_commit(&pass, fields[0], strchr(fields[1], ' ') != NULL, fields[2], fields[3]);
+        }
+        free(line);
+        pclose(fp);
+    }
+    if (s->commits == 0) return 0;
+
+    fp = open_git_stream("git -c core.quotePath=false ls-tree -r --name-only HEAD");
+    if (fp) {
+        line = NULL;
+        capacity = 0;
+        while (read_stream_line(fp, &line, &capacity) >= 0) {
+            if (line[0]) hll_add(&s->files, sketch_hash(line));
+        }
+        free(line);
+        pclose(fp);
+    }
+    return diff_approx_sample(s);
+}
+
+void free_approx_stats(approx_stats_t *s) 
+{
+    free(s->sample);
+    free(s->sample_churn);
+}
+
+// Sample mean of churn per commit and its 95% half-width, with the finite-population correction
+void approx_churn(const approx_stats_t *s, double *mean, double *margin) 
+{
+    *mean = 0;
+    *margin = 0;
+    if (s->sampled == 0) return;
+    for (int i = 0; i < s->sampled; i++) *mean += s->sample_churn[i];
+    *mean /= s->sampled;
+    if (s->sampled < 2 || s->sampled >= s->commits) return;
+    double variance = 0;
+    for (int i = 0; i < s->sampled; i++) variance += (s->sample_churn[i] - *mean) * (s->sample_churn[i] - *mean);
+    variance /= s->sampled - 1;
+    double correction = (double)(s->commits - s->sampled) / (double)(s->commits - 1);
+    *margin = 1.96 * sqrt(variance / s->sampled * correction);
+}
+
+void show_approx_summary(const approx_stats_t *s) 
+{
+    printf("📊 Repository Analysis (approximate)\n");
+    printf("=====================\n");
+    printf("Total commits: %lld (counted)\n", s->commits);
+    if (s->commits == 0) {
+        printf("No commit history found.\n\n");
+        return;
+    }
+
+    double mean, margin, scale = (double)s->commits / s->sampled;
+    approx_churn(s, &mean, &margin);
+    printf("Total changes: ~+%.0f -%.0f lines (±%.0f, 95%%)\n", s->sample_insertions * scale,
+           s->sample_deletions * scale, margin * s->commits);
+    printf("Average changes per commit: %.1f lines (±%.1f, 95%%)\n", mean, margin);
+    printf("Merge commits: %.1f%% (counted)\n", 100.0 * s->merges / s->commits);
+    printf("Distinct authors: ~%.0f (±%.1f%%)\n", hll_estimate(&s->authors), 100 * hll_error());
+
+    approx_top_t top[APPROX_TOP];
+    memcpy(top, s->top_authors, sizeof(approx_top_t) * s->top_author_count);
+    qsort(top, s->top_author_count, sizeof(approx_top_t), compare_approx_top);
+    if (s->top_author_count > 0) {
+        printf("Most active author: %s (~%lld commits, overcount ≤%.0f)\n", top[0].name, top[0].estimate,
+               count_min_error(&s->author_counts));
+    }
+    printf("Distinct files: ~%.0f (±%.1f%%, HEAD tree and sampled commits)\n", hll_estimate(&s->files), 100 * hll_error());
+    printf("Sample: %d of %lld commits diffed, sketches use %zu KB\n\n", s->sampled, s->commits,
+           (sizeof(approx_stats_t) + 45 * (size_t)s->sample_size) / 1024);
+
+    printf("🔥 Frequently Changed Files (approximate)\n");
+    printf("===========================\n");
+    if (s->top_file_count == 0) {
+        printf("No file changes in the sample.\n\n");
+        return;
+    }
+    memcpy(top, s->top_files, sizeof(approx_top_t) * s->top_file_count);
+    qsort(top, s->top_file_count, sizeof(approx_top_t), compare_approx_top);
+    int count = s->top_file_count < 10 ? s->top_file_count : 10;
+    printf("Top %d most frequently changed files, scaled from %d sampled commits:\n", count, s->sampled);
+    double overcount = count_min_error(&s->file_counts);
+    for (int i = 0; i < count; i++) {
+        // Sketch overcount plus binomial sampling error, both scaled to the whole history
+        double sampling = s->sampled < s->commits ? 1.96 * sqrt((double)top[i].estimate) : 0;
+        printf("~%.0f changes (±%.0f): %s\n", top[i].estimate * scale, (overcount + sampling) * scale, top[i].name);
+    }
+    printf("\n");
+}
+
+// ==================== WORKFLOW OPTIMIZER ====================
+
+typedef struct {
+    int commits;
+    int sampled;
+    int churn;
+    int merges;
+    char recent_dates[3][16];
+    int date_count;
+} workflow_stats_t;
+
+static int workflow_on_commit(analyzer_t *self, const history_commit_t *commit) 
+{
+    workflow_stats_t *stats = self->state;
+    stats->commits++;
+    // Size and merge patterns look at the 20 newest commits, frequency at the newest 3
+    if (stats->commits <= 20) {
+        stats->sampled++;
+        stats->churn += commit->insertions + commit->deletions;
+        if (commit->parent_count > 1) stats->merges++;
+    }
+    if (stats->date_count < 3) {
+        strcpy(stats->recent_dates[stats->date_count++], commit->date);
+    }
+    if (stats->commits == 100) self->active = 0;
+    return 0;
+}
+
+analyzer_t workflow_analyzer(workflow_stats_t *stats) 
+{
+    analyzer_t analyzer = { "workflow", WALK_NEEDS_LINE_STATS, NULL, workflow_on_commit, NULL, NULL, stats, 0 };
+    memset(stats, 0, sizeof(*stats));
+    return analyzer;
+}
+
+// `approx_sample` > 0 judges the whole history from that many sampled commits instead of
+// the newest 100
+void analyze_workflow_patterns(int approx_sample) 
+{
+    printf("🚀 Git Workflow Optimizer\n");
+    printf("========================\n");
+    
+    // Analyze commit frequency, size and merge patterns from one history pass
+    workflow_stats_t stats;
+    approx_stats_t *approx = NULL;
+    double churn_margin = 0;
+    if (approx_sample > 0) {
+        approx = malloc(sizeof(approx_stats_t));
+        collect_approx_stats(approx, approx_sample);
+        double mean;
+        approx_churn(approx, &mean, &churn_margin);
+        memset(&stats, 0, sizeof(stats));
+        stats.commits = (int)approx->commits;
+        stats.sampled = approx->sampled;
+        stats.churn = (int)(mean * approx->sampled + 0.5);
+        stats.date_count = approx->date_count;
+        memcpy(stats.recent_dates, approx->recent_dates, sizeof(stats.recent_dates));
+    } else {
+        analyzer_t analyzer = workflow_analyzer(&stats);
+        analyzer_t *analyzers[] = { &analyzer };
+        run_history_walk(analyzers, 1);
+    }
+    if (stats.commits == 0) {
+        printf("Not enough commit history for workflow analysis.\n\n");
+        if (approx) free_approx_stats(approx);
+        free(approx);
+        return;
+    }
+    
+    if (approx) printf("📊 Workflow Analysis (%d commits, %d sampled):\n\n", stats.commits, stats.sampled);
+    else printf("📊 Workflow Analysis (%d recent commits):\n\n", stats.commits);
+    
+    // Check commit size patterns
+    int avg_changes = stats.sampled > 0 ? stats.churn / stats.sampled : 0;
+    if (approx) printf("• Average changes per commit: %d lines (±%.1f, 95%%)\n", avg_changes, churn_margin);
+    else printf("• Average changes per commit: %d lines\n", avg_changes);
+    if (avg_changes > 500) printf("  ⚠️  Consider smaller, more focused commits\n");
+    else if (avg_changes < 10) printf("  ⚠️  Very small commits - consider batching related changes\n");
+    else printf("  ✅ Good commit size balance\n");
+    
+    // Check time between commits
+    if (stats.date_count > 0) {
+        printf("• Recent commit frequency: ");
+        for (int i = 0; i < stats.date_count; i++) printf("%s ", stats.recent_dates[i]);
+        printf("\n");
+    }
+    
+    // Check branch lifespan
+    char* branch_ages = run_git_command_output("git for-each-ref --format='%%(refname:short)|%%(committerdate:relative)' refs/heads/");
+    if (branch_ages) {
+        printf("• Branch activity:\n");
+        char* branch_line = strtok(branch_ages, "\n");
+        int old_branches = 0;
+        while (branch_line) {
+            char* name = strtok(branch_line, "|");
+            char* age = strtok(NULL, "|");
+            if (name && age && strstr(age, "week") && strcmp(name, "main") != 0 && strcmp(name, "master") != 0) {
+                old_branches++;
+                if (old_branches == 1) printf("  ⏰ Old branches needing attention:\n");
+                printf("    - %s (%s)\n", name, age);
+            }
+            branch_line = strtok(NULL, "\n");
+        }
+        if (old_branches == 0) printf("  ✅ No stale branches found\n");
+    }
+    
+    // Check merge vs rebase patterns
+    if (approx) {
+        int merge_percentage = (int)(approx->merges * 100 / approx->commits);
+        printf("• Merge strategy: %d%% merge commits in all history (counted)\n", merge_percentage);
+        if (merge_percentage > 50) printf("  💡 Consider using rebase for cleaner history\n");
+        else printf("  ✅ Good merge/rebase balance\n");
+        free_approx_stats(approx);
+        free(approx);
+    } else if (stats.sampled > 0) {
+        int merge_percentage = (stats.merges * 100) / stats.sampled;
+        printf("• Merge strategy: %d%% merge commits in recent history\n", merge_percentage);
+        if (merge_percentage > 50) printf("  💡 Consider using rebase for cleaner history\n");
+        else printf("  ✅ Good merge/rebase balance\n");
+    }
+    
+    // Generate personalized recommendations
+    printf("\n🎯 Workflow Recommendations:\n");
+    
+    char current_branch[256];
+    if (current_branch_name(current_branch, sizeof(current_branch)) == 0 && current_branch[0] &&
+        strcmp(current_branch, "main") != 0 && strcmp(current_branch, "master") != 0) {
+        char* branch_age = run_git_command_output("git log -1 --format=%%cr origin/main..HEAD");
+        if (branch_age && strlen(branch_age) > 0) {
+            printf("1. Feature branch '%s' is %s old - consider merging soon\n", current_branch, branch_age);
+        }
+    }
+    
+    int uncommitted = count_uncommitted_paths();
+    if (uncommitted > 5) {
+        printf("2. You have %d uncommitted changes - consider smaller, more frequent commits\n", uncommitted);
+    }
+    
+    char* remote_branches = run_git_command_output("git branch -r | wc -l");
+    char* local_branches = run_git_command_output("git branch | wc -l");
+    if (remote_branches && local_branches) {
+        int remote = atoi(remote_branches);
+        int local = atoi(local_branches);
+        if (remote > local * 2) {
+            printf("3. Many remote branches (%d remote vs %d local) - consider cleaning up\n", remote, local);
+        }
+    }
+    
+    printf("4. Run 'gitsmart review' before pushing changes\n");
+    printf("5. Use 'gitsmart suggest' for better commit messages\n");
+    
+    printf("\n");
+}
+
+// ==================== DOCUMENTATION GAP FINDER ====================
+
+void find_documentation_gaps() 
+{
+    printf("📚 Documentation Gap Analysis\n");
+    printf("============================\n");
+    
+    // Windows-compatible README detection
+    #ifdef _WIN32
+    char* readme = run_git_command_output("dir README* 2>NUL");
+    if (readme && strstr(readme, "README")) {
+        printf("✅ README file found\n");
+    } else {
+        printf("❌ No README file found - consider adding project documentation\n");
+    }
+    #else
+    char* readme = run_git_command_output("ls README* 2>/dev/null | head -1");
+    if (readme && strlen(readme) > 0) {
+        printf("✅ README file found: %s\n", readme);
+    } else {
+        printf("❌ No README file found - consider adding project documentation\n");
+    }
+    #endif
+    
+    recent_commits_t recent;
+    analyzer_t analyzer = recent_commits_analyzer(&recent, 10);
+    analyzer_t *analyzers[] = { &analyzer };
+    run_history_walk(analyzers, 1);
+    if (recent.count > 0) {
+        int doc_commits = 0;
+        for (int i = 0; i < recent.count; i++) {
+            const char *message = recent.commits[i].message;
+            if (strstr(message, "doc") || strstr(message, "readme") || strstr(message, "Documentation")) {
+                doc_commits++;
+            }
+        }
+        
+        printf("\nDocumentation activity in last %d commits: %d doc-related commits\n", 
+               recent.count, doc_commits);
+        
+        if (doc_commits < recent.count / 4) {
+            printf("⚠️  Documentation may be lagging behind code changes\n");
+        }
+    }
+    
+    printf("\n💡 Documentation Tips:\n");
+    printf("• Update README when adding features\n");
+    printf("• Document API changes in commit messages\n");
+    printf("• Consider adding inline comments for complex logic\n");
+    printf("• Keep CHANGELOG.md for release notes\n\n");
+}
+
+// ==================== SHELL PROMPT ====================
+
+// Status for a shell prompt from plain file reads only: HEAD, refs, the stash reflog, the
+// index and a stat of the working tree. Every step checks a deadline; whatever does not fit
+// is left out and the line is marked partial.
+#define PROMPT_DEFAULT_BUDGET_MS 5
+
+typedef struct {
+    char branch[MAX_PATH_LENGTH];
+    int detached;
+    int has_upstream;
+    int ahead, behind;
+    int modified;
+    int untracked;
+    int stashes;
+    int partial;
+} prompt_status_t;
+
+typedef struct {
+    const git_index_t *index;
+    long long index_mtime;
+    int trust_filemode;
+    double deadline;
+    int *modified;       // per chunk
+    int *timed_out;      // per chunk
+} modified_scan_t;
+
+static void scan_index_chunk(void *context, int chunk) 
+{
+    modified_scan_t *scan = context;
+    int last = (chunk + 1) * INDEX_CHUNK < scan->index->count ? (chunk + 1) * INDEX_CHUNK : scan->index->count;
+    for (int i = chunk * INDEX_CHUNK; i < last; i++) {
+        if ((i & 127) == 0 && monotonic_seconds() > scan->deadline) {
+            scan->timed_out[chunk] = 1;
+            return;
+        }
+        scan->modified[chunk] += index_entry_modified(scan->index, i, scan->index_mtime, scan->trust_filemode);
+    }
+}
+
+// The lstat of every tracked file dominates on big checkouts, so chunks run on the worker pool
+static void count_modified_files(const git_index_t *index, long long index_mtime, int trust_filemode,
+                                 double deadline, prompt_status_t *st) 
+{
+    int chunks = (index->count + INDEX_CHUNK - 1) / INDEX_CHUNK;
+    if (chunks == 0) return;
+    modified_scan_t scan = { index, index_mtime, trust_filemode, deadline, calloc(chunks, sizeof(int)), calloc(chunks, sizeof(int)) };
+    int workers = default_job_count();
+    parallel_for(chunks, workers < chunks ? workers : chunks, scan_index_chunk, &scan);
+    for (int i = 0; i < chunks; i++) {
+        st->modified += scan.modified[i];
+        if (scan.timed_out[i]) st->partial = 1;
+    }
+    free(scan.modified);
+    free(scan.timed_out);
+}
+
+typedef struct {
+    char *pattern;
+    char *base;          // directory of the ignore file, "" or ending in '/'
+    int negate;
+    int dir_only;
+    int anchored;
+} ignore_rule_t;
+
+typedef struct {
+    ignore_rule_t *rules;
+    int count, capacity;
+} ignore_list_t;
+
+// gitignore globbing: '*' and '?' stop at '/', "**/" spans directories, [..] classes
+static int glob_match(const char *p, const char *s) 
+{
+    for (; *p; p++, s++) {
+        switch (*p) {
+        case '?':
+            if (!*s || *s == '/') return 0;
+            break;
+        case '*':
+            if (p[1] == '*') {
+                const char *rest = p + 2;
+                if (*rest == '/') {
+                    rest++;
+                    if (glob_match(rest, s)) return 1;
+                    for (const char *t = s; *t; t++) {
+                        if (*t == '/' && glob_match(rest, t + 1)) return 1;
+                    }
+                    return 0;
+                }
+                for (const char *t = s;; t++) {
+                    if (glob_match(rest, t)) return 1;
+                    if (!*t) return 0;
+                }
+            }
+            for (const char *t = s;; t++) {
+                if (glob_match(p + 1, t)) return 1;
+                if (!*t || *t == '/') return 0;
+            }
+        case '[': {
+            if (!*s || *s == '/') return 0;
+            const char *q = p + 1;
+            int negate = *q == '!' || *q == '^', matched = 0;
+            if (negate) q++;
+            for (int first = 1; *q && (first || *q != ']'); first = 0, q++) {
+                unsigned char lo = (unsigned char)(*q == '\\' && q[1] ? *++q : *q), hi = lo;
+                if (q[1] == '-' && q[2] && q[2] != ']') {
+                    q += 2;
+                    hi = (unsigned char)(*q == '\\' && q[1] ? *++q : *q);
+                }
+                if ((unsigned char)*s >= lo && (unsigned char)*s <= hi) matched = 1;
+            }
+            if (*q != ']' || matched == negate) return 0;
+            p = q;
+            break;
+        }
+        case '\\':
+            if (p[1]) p++;
+            /* fall through */
+        default:
+            if (*p != *s) return 0;
+        }
+    }
+    return *s == '\0';
+}
+
+static void load_ignore_file(ignore_list_t *list, const char *path, const char *base) 
+{
+    FILE *fp = fopen(path, "r");
+    if (!fp) return;
+    char line[MAX_PATH_LENGTH];
+    while (fgets(line, sizeof(line), fp)) {
+        size_t length = strcspn(line, "\r\n");
+        line[length] = '\0';
+        while (length > 0 && line[length - 1] == ' ' && (length < 2 || line[length - 2] != '\\')) line[--length] = '\0';
+        if (!line[0] || line[0] == '#') continue;
+
+        ignore_rule_t rule = { NULL, NULL, 0, 0, 0 };
+        char *pattern = line;
+        if (*pattern == '!') {
+            rule.negate = 1;
+            pattern++;
         }
-        printf("Most active author: %s (%d commits)\n", top_author, max_commits);
-    }
-    
-    if (commit_count > 0) {
-        printf("Latest commit: %s\n", commits[0].message);
+        length = strlen(pattern);
+        if (length > 0 && pattern[length - 1] == '/') {
+            rule.dir_only = 1;
+            pattern[--length] = '\0';
+        }
+        if (!pattern[0]) continue;
+        rule.anchored = strchr(pattern, '/') != NULL;
+        if (*pattern == '/') pattern++;
+        rule.pattern = strdup(pattern);
+        rule.base = strdup(base);
+        if (list->count == list->capacity) {
+            list->capacity = list->capacity ? list->capacity * 2 : 32;
+            list->rules = realloc(list->rules, sizeof(ignore_rule_t) * list->capacity);
+        }
+        list->rules[list->count++] = rule;
     }
-    printf("\n");
+    fclose(fp);
 }
 
-// ==================== BRANCH ANALYSIS ====================
+static void truncate_ignore_list(ignore_list_t *list, int count) 
+{
+    while (list->count > count) {
+        list->count--;
+        free(list->rules[list->count].pattern);
+        free(list->rules[list->count].base);
+    }
+}
 
-void load_branch_info() {
-    char *output = run_git_command_output("git branch -v");
-    if (!output) {
-        return;
+// Last matching rule wins; rules are ordered from lowest to highest precedence
+static int is_ignored(const ignore_list_t *list, const char *path, int is_dir) 
+{
+    const char *basename = strrchr(path, '/');
+    basename = basename ? basename + 1 : path;
+    for (int i = list->count - 1; i >= 0; i--) {
+        const ignore_rule_t *rule = &list->rules[i];
+        size_t base_length = strlen(rule->base);
+        if (rule->dir_only && !is_dir) continue;
+        if (strncmp(path, rule->base, base_length) != 0) continue;
+        if (glob_match(rule->pattern, rule->anchored ? path + base_length : basename)) return !rule->negate;
     }
+    return 0;
+}
 
-    char *line = strtok(output, "\n");
-    while (line && branch_count < MAX_BRANCHES) {
-        branch_info_t *branch = &branches[branch_count];
-        
-        const char *ptr = line;
-        while (*ptr == ' ' || *ptr == '*') ptr++;
-        
-        const char *name_end = ptr;
-        while (*name_end && *name_end != ' ') name_end++;
-        
-        if (name_end > ptr) {
-            size_t name_len = name_end - ptr;
-            strncpy(branch->name, ptr, name_len);
-            branch->name[name_len] = '\0';
-            
-            branch->is_merged = 0;
-            if (strcmp(branch->name, "main") != 0 && strcmp(branch->name, "master") != 0) {
-                #ifdef _WIN32
-                char cmd[512];
-                snprintf(cmd, sizeof(cmd), "git branch --merged main 2>NUL | findstr \"^  %s$\"", branch->name);
-                if (run_git_command(cmd) == 0) {
-                    branch->is_merged = 1;
-                } else {
-                    snprintf(cmd, sizeof(cmd), "git branch --merged master 2>NUL | findstr \"^  %s$\"", branch->name);
-                    if (run_git_command(cmd) == 0) {
-                        branch->is_merged = 1;
-                    }
-                }
-                #else
-                char cmd[512];
-                snprintf(cmd, sizeof(cmd), "git branch --merged main 2>/dev/null | grep -q \"^  %s$\"", branch->name);
-                if (run_git_command(cmd) == 0) {
-                    branch->is_merged = 1;
-                } else {
-                    snprintf(cmd, sizeof(cmd), "git branch --merged master 2>/dev/null | grep -q \"^  %s$\"", branch->name);
-                    if (run_git_command(cmd) == 0) {
-                        branch->is_merged = 1;
-                    }
-                }
-                #endif
-            }
-            
-            branch_count++;
-        }
-        line = strtok(NULL, "\n");
+typedef struct {
+    const git_index_t *index;
+    ignore_list_t ignores;
+    double deadline;
+    int entries_seen;
+    int timed_out;
+} untracked_walk_t;
+
+// First index entry at or after `path` in index order
+static int index_lower_bound(const git_index_t *index, const char *path) 
+{
+    int lo = 0, hi = index->count;
+    while (lo < hi) {
+        int mid = lo + (hi - lo) / 2;
+        if (strcmp(INDEX_PATH(index, mid), path) < 0) lo = mid + 1;
+        else hi = mid;
     }
+    return lo;
 }
 
-void show_branch_analysis() 
+// Counts untracked files and untracked directories (once each, as `git status` shows them)
+// under `dir` ("" or ending in '/'). With `probe` set it stops at the first one.
+static int walk_untracked(untracked_walk_t *w, const char *dir, int probe) 
 {
-    printf("🌿 Branch Analysis\n");
-    printf("=================\n");
-    
-    if (branch_count == 0) {
-        printf("No branches found.\n\n");
-        return;
+    char full[MAX_PATH_LENGTH * 2], child[MAX_PATH_LENGTH];
+    int found = 0, rules_before = w->ignores.count;
+    snprintf(full, sizeof(full), "%s/%s.gitignore", repo.worktree, dir);
+    load_ignore_file(&w->ignores, full, dir);
+    snprintf(full, sizeof(full), "%s/%s", repo.worktree, dir);
+
+    #ifdef _WIN32
+    char pattern[MAX_PATH_LENGTH * 2 + 4];
+    snprintf(pattern, sizeof(pattern), "%s*", full);
+    WIN32_FIND_DATAA entry;
+    HANDLE find = FindFirstFileA(pattern, &entry);
+    if (find == INVALID_HANDLE_VALUE) {
+        truncate_ignore_list(&w->ignores, rules_before);
+        return 0;
     }
-    
-    int merged_branches = 0;
-    int active_branches = 0;
-    char current_branch[256] = "";
-    
-    char *current = run_git_command_output("git branch --show-current");
-    if (current) {
-        strncpy(current_branch, current, 255);
-        current_branch[255] = '\0';
+    do {
+        const char *name = entry.cFileName;
+        int is_dir = (entry.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) != 0;
+    #else
+    DIR *handle = opendir(full);
+    if (!handle) {
+        truncate_ignore_list(&w->ignores, rules_before);
+        return 0;
     }
-    
-    for (int i = 0; i < branch_count; i++) {
-        if (branches[i].is_merged) {
-            merged_branches++;
-        } else if (strcmp(branches[i].name, "main") != 0 && 
-                   strcmp(branches[i].name, "master") != 0 &&
-                   strcmp(branches[i].name, current_branch) != 0) {
-            active_branches++;
+    struct dirent *entry;
+    while ((entry = readdir(handle)) != NULL) {
+        const char *name = entry->d_name;
+        int is_dir = 0;
+        #ifdef DT_DIR
+        if (entry->d_type == DT_DIR) is_dir = 1;
+        else if (entry->d_type == DT_UNKNOWN)
+        #endif
+        {
+            struct stat info;
+            char entry_path[MAX_PATH_LENGTH * 3];
+            snprintf(entry_path, sizeof(entry_path), "%s%s", full, name);
+            is_dir = lstat(entry_path, &info) == 0 && S_ISDIR(info.st_mode);
         }
-    }
-    
-    printf("Total branches: %d\n", branch_count);
-    printf("Current branch: %s\n", current_branch[0] ? current_branch : "unknown");
-    printf("Active branches: %d\n", active_branches);
-    printf("Merged branches (can be deleted): %d\n", merged_branches);
-    
-    if (merged_branches > 0) {
-        printf("\n🚮 Branches that can be safely deleted:\n");
-        for (int i = 0; i < branch_count; i++) {
-            if (branches[i].is_merged) {
-                printf("  • %s\n", branches[i].name);
-            }
+    #endif
+        if (strcmp(name, ".") == 0 || strcmp(name, "..") == 0 || strcmp(name, ".git") == 0) continue;
+        if ((++w->entries_seen & 63) == 0 && monotonic_seconds() > w->deadline) w->timed_out = 1;
+        if (w->timed_out) break;
+
+        snprintf(child, sizeof(child), "%s%s", dir, name);
+        int position = index_lower_bound(w->index, child);
+        int exact = position < w->index->count && strcmp(INDEX_PATH(w->index, position), child) == 0;
+        if (!is_dir) {
+            if (!exact && !is_ignored(&w->ignores, child, 0)) found++;
+        } else if (!exact && !is_ignored(&w->ignores, child, 1)) {
+            // Gitlinks are tracked as the directory name itself
+            size_t length = strlen(child);
+            snprintf(child + length, sizeof(child) - length, "/");
+            position = index_lower_bound(w->index, child);
+            int has_tracked = position < w->index->count && strncmp(INDEX_PATH(w->index, position), child, length + 1) == 0;
+            if (has_tracked) found += walk_untracked(w, child, probe);
+            else if (walk_untracked(w, child, 1)) found++;
         }
+        if (probe && found) break;
+    #ifdef _WIN32
+    } while (FindNextFileA(find, &entry));
+    FindClose(find);
+    #else
     }
-    printf("\n");
+    closedir(handle);
+    #endif
+    truncate_ignore_list(&w->ignores, rules_before);
+    return found;
 }
 
-// ==================== FILE ANALYSIS ====================
-
-void load_file_analysis() 
+// Ahead/behind the configured upstream from the commit-graph, or else from a native walk
+// of the object store while the budget lasts; rev-list would blow any prompt budget
+static void prompt_upstream(prompt_status_t *st, const char *head, double deadline) 
 {
-    char *output = run_git_command_output("git ls-files");
-    if (!output) {
+    char remote[MAX_PATH_LENGTH], merge[MAX_PATH_LENGTH], upstream[MAX_PATH_LENGTH * 2 + 16];
+    char (*tips)[41] = malloc(2 * 41);
+    if (read_config_value("branch", st->branch, "remote", remote, sizeof(remote)) != 0 ||
+        read_config_value("branch", st->branch, "merge", merge, sizeof(merge)) != 0) {
+        free(tips);
+        return;
+    }
+    if (strcmp(remote, ".") == 0) snprintf(upstream, sizeof(upstream), "%s", merge);
+    else snprintf(upstream, sizeof(upstream), "refs/remotes/%s/%s", remote,
+                  strncmp(merge, "refs/heads/", 11) == 0 ? merge + 11 : merge);
+    strcpy(tips[0], head);
+    if (resolve_ref(upstream, tips[1], NULL, 0) != 0) {
+        free(tips);
+        return;
+    }
+    st->has_upstream = 1;
+    if (strcmp(tips[0], tips[1]) == 0) {
+        free(tips);
         return;
     }
 
-    char *line = strtok(output, "\n");
-    while (line && file_count < MAX_FILES) {
-        file_info_t *file = &files[file_count];
-        strncpy(file->path, line, MAX_PATH_LENGTH - 1);
-        file->path[MAX_PATH_LENGTH - 1] = '\0';
-        
-        // Windows-compatible change counting
-        #ifdef _WIN32
-        char cmd[512];
-        snprintf(cmd, sizeof(cmd), "git log --oneline -- \"%s\" | find /c /v \"\"", line);
-        char *changes_output = run_git_command_output(cmd);
-        if (changes_output) {
-            file->changes = atoi(changes_output);
-        } else {
-            file->changes = 1;
-        }
-        #else
-        char cmd[512];
-        snprintf(cmd, sizeof(cmd), "git log --oneline -- \"%s\" | wc -l", line);
-        char *changes_output = run_git_command_output(cmd);
-        if (changes_output) {
-            file->changes = atoi(changes_output);
-        } else {
-            file->changes = 1;
+    commit_graph_t graph;
+    int covered = 0;
+    if (monotonic_seconds() < deadline && open_commit_graph(&graph) == 0) {
+        covered = 1;
+        for (int i = 0; i < 2; i++) {
+            unsigned char oid[20];
+            long position = hex_to_oid(tips[i], oid) == 0 ? commit_graph_find(&graph, oid) : -1;
+            if (position < 0) covered = 0;
         }
-        #endif
-        
-        file_count++;
-        line = strtok(NULL, "\n");
+        close_commit_graph(&graph);
     }
+    reach_result_t result;
+    if (covered && compute_reachability(tips, 1, tips + 1, 1, &result) == 0) {
+        st->ahead = result.ahead;
+        st->behind = result.behind;
+    } else if (covered || monotonic_seconds() >= deadline ||
+               ahead_behind_native(tips[0], tips[1], deadline, &st->ahead, &st->behind) != 0) {
+        st->ahead = st->behind = 0;
+        st->partial = 1;
+    }
+    free(tips);
 }
 
-void show_hot_files() 
+static int count_stashes() 
 {
-    printf("🔥 Frequently Changed Files\n");
-    printf("===========================\n");
-    
-    if (file_count == 0) {
-        printf("No files found in repository.\n\n");
-        return;
+    char path[MAX_PATH_LENGTH + 32], buffer[65536];
+    snprintf(path, sizeof(path), "%s/logs/refs/stash", repo.common_dir);
+    FILE *fp = fopen(path, "rb");
+    if (!fp) return 0;
+    int lines = 0;
+    size_t n;
+    while ((n = fread(buffer, 1, sizeof(buffer), fp)) > 0) {
+        for (size_t i = 0; i < n; i++) lines += buffer[i] == '\n';
     }
-    
-    for (int i = 0; i < file_count - 1; i++) {
-        for (int j = 0; j < file_count - i - 1; j++) {
-            if (files[j].changes < files[j + 1].changes) {
-                file_info_t temp = files[j];
-                files[j] = files[j + 1];
-                files[j + 1] = temp;
-            }
+    fclose(fp);
+    return lines;
+}
+
+// Cheapest facts first, so a tight budget still gets the branch and stash count
+int compute_prompt_status(prompt_status_t *st, double budget_seconds) 
+{
+    double deadline = monotonic_seconds() + budget_seconds;
+    memset(st, 0, sizeof(*st));
+    if (discover_repository() != 0) return -1;
+    if (repo.reftable) {
+        st->partial = 1;
+        return 0;
+    }
+
+    char head[41] = "", symref[MAX_PATH_LENGTH];
+    int have_head = resolve_ref("HEAD", head, symref, sizeof(symref)) == 0;
+    if (strncmp(symref, "refs/heads/", 11) == 0) {
+        snprintf(st->branch, sizeof(st->branch), "%s", symref + 11);
+    } else {
+        st->detached = 1;
+        snprintf(st->branch, sizeof(st->branch), "%.7s", have_head ? head : "unknown");
+    }
+    st->stashes = count_stashes();
+    if (have_head && !st->detached) prompt_upstream(st, head, deadline);
+    if (!repo.worktree[0]) return 0;
+
+    git_index_t index;
+    char index_path[MAX_PATH_LENGTH + 16];
+    long long index_mtime = 0;
+    snprintf(index_path, sizeof(index_path), "%s/index", repo.git_dir);
+    #ifdef _WIN32
+    struct _stat64 info;
+    if (_stat64(index_path, &info) == 0) index_mtime = info.st_mtime;
+    #else
+    struct stat info;
+    if (stat(index_path, &info) == 0) index_mtime = info.st_mtime;
+    #endif
+    if (load_git_index(&index) != 0) {
+        memset(&index, 0, sizeof(index));
+        // No index yet means nothing is tracked; one we can't read leaves the counts unknown
+        if (file_exists(index_path)) {
+            st->partial = 1;
+            return 0;
         }
     }
-    
-    int count = (file_count < 10) ? file_count : 10;
-    printf("Top %d most frequently changed files:\n", count);
-    for (int i = 0; i < count; i++) {
-        printf("%3d changes: %s\n", files[i].changes, files[i].path);
+
+    if (monotonic_seconds() > deadline) {
+        st->partial = 1;
+    } else {
+        char filemode[16] = "true";
+        read_config_value("core", NULL, "filemode", filemode, sizeof(filemode));
+        count_modified_files(&index, index_mtime, strcasecmp(filemode, "false") != 0, deadline, st);
+    }
+
+    if (monotonic_seconds() > deadline) {
+        st->partial = 1;
+    } else {
+        untracked_walk_t walk;
+        memset(&walk, 0, sizeof(walk));
+        walk.index = &index;
+        walk.deadline = deadline;
+        // Lowest precedence first: global excludes, info/exclude, then .gitignore files
+        char path[MAX_PATH_LENGTH * 2];
+        const char *xdg = getenv("XDG_CONFIG_HOME"), *home = getenv("HOME");
+        if (xdg && xdg[0]) snprintf(path, sizeof(path), "%s/git/ignore", xdg);
+        else snprintf(path, sizeof(path), "%s/.config/git/ignore", home ? home : "");
+        load_ignore_file(&walk.ignores, path, "");
+        snprintf(path, sizeof(path), "%s/info/exclude", repo.common_dir);
+        load_ignore_file(&walk.ignores, path, "");
+        st->untracked = walk_untracked(&walk, "", 0);
+        if (walk.timed_out) st->partial = 1;
+        truncate_ignore_list(&walk.ignores, 0);
+        free(walk.ignores.rules);
     }
+    free_git_index(&index);
+    return 0;
+}
+
+// branch ↑ahead ↓behind *modified ?untracked $stashes, with … when the budget ran out
+void show_prompt(int budget_ms) 
+{
+    prompt_status_t st;
+    if (compute_prompt_status(&st, budget_ms / 1000.0) != 0) return;
+    printf(st.detached ? "(%s)" : "%s", st.branch);
+    if (st.ahead) printf(" ↑%d", st.ahead);
+    if (st.behind) printf(" ↓%d", st.behind);
+    if (st.modified) printf(" *%d", st.modified);
+    if (st.untracked) printf(" ?%d", st.untracked);
+    if (st.stashes) printf(" $%d", st.stashes);
+    if (st.partial) printf(" …");
     printf("\n");
 }
 
-// ==================== SMART BLAME ====================
+// ==================== BENCHMARKS ====================
 
-void smart_blame(const char *filepath) 
+double monotonic_seconds() 
 {
-    if (access(filepath, R_OK) != 0) {
-        printf("❌ File not found or not readable: %s\n", filepath);
-        return;
+    #ifdef _WIN32
+    LARGE_INTEGER frequency, counter;
+    QueryPerformanceFrequency(&frequency);
+    QueryPerformanceCounter(&counter);
+    return (double)counter.QuadPart / (double)frequency.QuadPart;
+    #else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+    #endif
+}
+
+// Single-file history: a plain pathspec walk that diffs every commit versus the Bloom-filtered walk
+int bench_path_history(const char *target, int runs) 
+{
+    char path[MAX_PATH_LENGTH];
+    normalize_repo_path(target, path, sizeof(path));
+    size_t length = strlen(path);
+    while (length > 0 && path[length - 1] == '/') path[--length] = '\0';
+    if (!path[0]) {
+        printf("Please specify a file or directory\n");
+        return 1;
     }
-    
-    printf("🔍 Smart Blame: %s\n", filepath);
-    printf("==========================================\n");
-    
-    char *output = run_git_command_output("git blame -s \"%s\"", filepath);
-    if (!output || strlen(output) == 0) {
-        printf("No blame information available.\n\n");
-        return;
+
+    printf("⏱️  History benchmark: %s (%d runs)\n", path, runs);
+    printf("==============================\n");
+
+    // Warm the caches (and build bloom.idx if needed) outside the timed runs
+    char (*fast)[41] = NULL;
+    path_walk_stats_t stats;
+    int fast_count = bloom_path_history(path, 0, &fast, &stats);
+
+    char quoted[MAX_PATH_LENGTH * 4];
+    if (!shell_quote(path, quoted, sizeof(quoted))) {
+        printf("❌ Path too long: %s\n", path);
+        free(fast);
+        return 1;
     }
-    
-    char *line = strtok(output, "\n");
-    int line_num = 1;
-    int lines_shown = 0;
-    
-    while (line && lines_shown < 10) {
-        char *hash = line;
-        
-        char *author_start = strchr(line, '(');
-        if (author_start) {
-            author_start++;
-            char *author_end = strchr(author_start, ' ');
-            if (author_end) {
-                char author[256] = {0};
-                strncpy(author, author_start, author_end - author_start);
-                author[author_end - author_start] = '\0';
-                
-                #ifdef _WIN32
-                char msg_cmd[256];
-                snprintf(msg_cmd, sizeof(msg_cmd), "git show -s --format=%%s %s", hash);
-                char *message = run_git_command_output(msg_cmd);
-                #else
-                char msg_cmd[256];
-                snprintf(msg_cmd, sizeof(msg_cmd), "git show -s --format=%%s %s", hash);
-                char *message = run_git_command_output(msg_cmd);
-                #endif
-                
-                if (message) {
-                    message[strcspn(message, "\n")] = 0;
-                    printf("%3d: %s - %s\n", line_num, author, message);
-                    lines_shown++;
-                }
-            }
+
+    double baseline = 0, filtered = 0;
+    int baseline_count = 0, mismatch = fast_count < 0;
+    for (int run = 0; run < runs && !mismatch; run++) {
+        double start = monotonic_seconds();
+        FILE *fp = open_git_stream("git -c core.commitGraph=false log --format=%%H --no-merges HEAD -- %s", quoted);
+        if (!fp) return 1;
+        char *line = NULL;
+        size_t capacity = 0;
+        baseline_count = 0;
+        while (read_stream_line(fp, &line, &capacity) >= 0) {
+            if (baseline_count >= fast_count || strcmp(line, fast[baseline_count]) != 0) mismatch = 1;
+            baseline_count++;
         }
-        
-        line_num++;
-        line = strtok(NULL, "\n");
+        free(line);
+        pclose(fp);
+        baseline += monotonic_seconds() - start;
+
+        start = monotonic_seconds();
+        free(fast);
+        fast_count = bloom_path_history(path, 0, &fast, &stats);
+        filtered += monotonic_seconds() - start;
+        if (baseline_count != fast_count) mismatch = 1;
     }
-    
-    if (lines_shown == 10) {
-        printf("... (showing first 10 lines)\n");
+    free(fast);
+
+    if (mismatch) {
+        printf("❌ Results differ: pathspec walk found %d commits, Bloom walk %d\n", baseline_count, fast_count);
+        return 1;
     }
+
+    printf("Matching commits:     %d of %d scanned\n", fast_count, stats.scanned);
+    printf("Filter source:        %s\n", stats.source);
+    printf("Skipped by filters:   %d (%.1f%%)\n", stats.skipped, stats.scanned ? 100.0 * stats.skipped / stats.scanned : 0.0);
+    printf("False positives:      %d of %d diffed\n", stats.false_positives, stats.verified);
+    printf("git log -- path:      %.1f ms/run\n", 1000 * baseline / runs);
+    printf("Bloom-filtered walk:  %.1f ms/run\n", 1000 * filtered / runs);
+    if (filtered > 0) printf("Speedup:              %.2fx\n", baseline / filtered);
     printf("\n");
+    return 0;
 }
 
-// ==================== CLEANUP SUGGESTIONS ====================
-
-void show_cleanup_suggestions() 
+// Prompt status from file reads versus the two git commands a prompt would otherwise run
+int bench_prompt(int runs) 
 {
-    printf("🧹 Cleanup Suggestions\n");
-    printf("=====================\n");
-    
-    char *status = run_git_command_output("git status --porcelain");
-    if (status && strlen(status) > 0) {
-        int untracked = 0, modified = 0;
-        char *line = strtok(status, "\n");
-        while (line) {
-            if (line[0] == '?') untracked++;
-            else modified++;
-            line = strtok(NULL, "\n");
-        }
-        
-        if (modified > 0) printf("📝 Modified files: %d (consider committing changes)\n", modified);
-        if (untracked > 0) printf("❓ Untracked files: %d (consider adding to .gitignore)\n", untracked);
-        
-        if (modified == 0 && untracked == 0) {
-            printf("✅ Working directory is clean\n");
-        }
-    } else {
-        printf("✅ Working directory is clean\n");
+    printf("⏱️  Prompt benchmark (%d runs)\n", runs);
+    printf("==========================\n");
+
+    prompt_status_t st;
+    double native = 0, slowest = 0, spawned = 0;
+    for (int run = 0; run < runs; run++) {
+        double start = monotonic_seconds();
+        compute_prompt_status(&st, 60);
+        double elapsed = monotonic_seconds() - start;
+        native += elapsed;
+        if (elapsed > slowest) slowest = elapsed;
     }
-    
-    char *stash = run_git_command_output("git stash list");
-    if (stash && strlen(stash) > 0) {
-        int stash_count = 0;
-        char *line = strtok(stash, "\n");
-        while (line) {
-            stash_count++;
-            line = strtok(NULL, "\n");
+
+    int modified = 0, untracked = 0, stashes = 0;
+    for (int run = 0; run < runs; run++) {
+        double start = monotonic_seconds();
+        FILE *fp = open_git_stream("git status --porcelain=v2 --branch");
+        if (!fp) return 1;
+        char *line = NULL;
+        size_t capacity = 0;
+        modified = untracked = stashes = 0;
+        while (read_stream_line(fp, &line, &capacity) >= 0) {
+            // Worktree-side changes only ("1 XY ..." with Y set) plus unmerged paths
+            if ((line[0] == '1' || line[0] == '2') && line[1] == ' ' && line[3] != '.') modified++;
+            else if (line[0] == 'u') modified++;
+            else if (line[0] == '?') untracked++;
         }
-        printf("💼 Stashed changes: %d (consider reviewing or applying)\n", stash_count);
+        pclose(fp);
+        fp = open_git_stream("git stash list");
+        if (!fp) return 1;
+        while (read_stream_line(fp, &line, &capacity) >= 0) stashes++;
+        pclose(fp);
+        free(line);
+        spawned += monotonic_seconds() - start;
     }
-    
-    printf("\n");
+
+    printf("Native status:        %.2f ms/run (slowest %.2f ms)\n", 1000 * native / runs, 1000 * slowest);
+    printf("git status + stash:   %.2f ms/run\n", 1000 * spawned / runs);
+    if (native > 0) printf("Speedup:              %.1fx\n", spawned / native);
+    if (st.modified == modified && st.untracked == untracked && st.stashes == stashes) {
+        printf("✅ Counts agree: %d modified, %d untracked, %d stashed\n\n", modified, untracked, stashes);
+        return 0;
+    }
+    printf("❌ Counts differ: native %d/%d/%d, git %d/%d/%d (modified/untracked/stashed)\n\n",
+           st.modified, st.untracked, st.stashes, modified, untracked, stashes);
+    return 1;
 }
 
-// ==================== AI COMMIT SUGGESTIONS ====================
+// Counts every commit and file change of the loader walk, so no run stops early
+static int loader_count_commit(analyzer_t *self, const history_commit_t *commit) 
+{
+    (void)commit;
+    ((long long *)self->state)[0]++;
+    return 1;
+}
 
-void analyze_changes_for_commit_type(char* diff_output, char* type, char* description) 
+static void loader_count_change(analyzer_t *self, const history_commit_t *commit, const file_change_t *change) 
 {
-    if (strstr(diff_output, "+++ b/") && strstr(diff_output, "--- /dev/null")) {
-        strcpy(type, "feat");
-        strcpy(description, "add new feature");
-    } else if (strstr(diff_output, "fix") || strstr(diff_output, "bug") || strstr(diff_output, "error")) {
-        strcpy(type, "fix");
-        strcpy(description, "resolve issue");
-    } else if (strstr(diff_output, "refactor") || strstr(diff_output, "cleanup") || strstr(diff_output, "optimize")) {
-        strcpy(type, "refactor");
-        strcpy(description, "improve code structure");
-    } else if (strstr(diff_output, "test")) {
-        strcpy(type, "test");
-        strcpy(description, "add or update tests");
-    } else if (strstr(diff_output, "doc") || strstr(diff_output, "readme") || strstr(diff_output, "comment")) {
-        strcpy(type, "docs");
-        strcpy(description, "update documentation");
-    } else {
-        strcpy(type, "chore");
-        strcpy(description, "maintenance tasks");
-    }
+    (void)commit;
+    (void)change;
+    ((long long *)self->state)[1]++;
 }
 
-char* extract_commit_subject(char* diff_output) 
+#define LOADER_BUFFERED 0
+#define LOADER_STDIO 1
+#define LOADER_PIPELINE 2
+
+// One full --numstat history load: the whole output buffered before parsing, line reads
+// through stdio, or the chunk ring. Returns the seconds taken; counts[] gets commits and
+// changes, and a buffered run hands its raw text to `keep` for the parser-only pass.
+static double bench_load_history(int mode, long long counts[2], size_t *bytes, char **keep) 
 {
-    static char subject[200];
-    strcpy(subject, "implement changes");
-    
-    char* line = strtok(diff_output, "\n");
-    while (line) {
-        if (strstr(line, "+class ") || strstr(line, "+function ") || strstr(line, "+def ") || strstr(line, "+fn ")) {
-            char* name_start = strstr(line, "class ");
-            if (!name_start) name_start = strstr(line, "function ");
-            if (!name_start) name_start = strstr(line, "def ");
-            if (!name_start) name_start = strstr(line, "fn ");
-            
-            if (name_start) {
-                name_start += 6;
-                char* name_end = strchr(name_start, ' ');
-                if (name_end && (name_end - name_start) < 50) {
-                    strncpy(subject, name_start, name_end - name_start);
-                    subject[name_end - name_start] = '\0';
-                    strcat(subject, " implementation");
-                    break;
-                }
+    counts[0] = counts[1] = 0;
+    analyzer_t counter = { "count", WALK_NEEDS_LINE_STATS, NULL, loader_count_commit, loader_count_change, NULL, counts, 1 };
+    analyzer_t *analyzers[] = { &counter };
+    walk_state_t w;
+    memset(&w, 0, sizeof(w));
+    w.analyzers = analyzers;
+    w.count = 1;
+    w.numstat = 1;
+
+    double start = monotonic_seconds();
+    FILE *log = open_git_stream("git -c core.quotePath=false log --numstat -M " WALK_FORMAT " HEAD");
+    if (!log) return -1;
+    *bytes = 0;
+    if (mode == LOADER_BUFFERED) {
+        size_t capacity = 1 << 20, got;
+        char *text = malloc(capacity);
+        while ((got = fread(text + *bytes, 1, capacity - *bytes - 1, log)) > 0) {
+            *bytes += got;
+            if (capacity - *bytes < 4096) {
+                capacity *= 2;
+                text = realloc(text, capacity);
             }
         }
-        line = strtok(NULL, "\n");
+        pclose(log);
+        text[*bytes] = '\0';
+        if (keep) *keep = strdup(text);
+        for (char *p = text, *end = text + *bytes; p < end; ) {
+            char *nl = memchr(p, '\n', end - p);
+            if (!nl) nl = end;
+            *nl = '\0';
+            walk_feed_line(&w, p);
+            p = nl + 1;
+        }
+        free(text);
+    } else if (mode == LOADER_STDIO) {
+        char *line = NULL;
+        size_t capacity = 0;
+        long length;
+        while ((length = read_stream_line(log, &line, &capacity)) >= 0) {
+            *bytes += (size_t)length + 1;
+            walk_feed_line(&w, line);
+        }
+        free(line);
+        pclose(log);
+    } else {
+        stream_pipe_t lines;
+        stream_pipe_open(&lines, log);
+        char *line;
+        while ((line = stream_pipe_line(&lines, NULL))) walk_feed_line(&w, line);
+        *bytes = lines.bytes;
+        stream_pipe_close(&lines);
+        pclose(log);
     }
-    
-    return subject;
+    walk_flush(&w);
+    double elapsed = monotonic_seconds() - start;
+    walk_changes_free(&w.changes);
+    return elapsed;
 }
 
-int extract_key_changes(char* diff_output, char* output) 
+// History loader throughput in MB/s of log text, with and without overlapping the parse
+// with git; the parser-only figure is the ceiling any reading strategy can reach
+int bench_history_loader(int runs) 
 {
-    strcpy(output, "code changes");
-    
-    if (strstr(diff_output, "TODO") || strstr(diff_output, "FIXME")) {
-        strcpy(output, "address code comments");
-        return 1;
+    printf("⏱️  History loader benchmark (%d runs)\n", runs);
+    printf("=====================================\n");
+
+    static const char *labels[] = { "Buffered, then parsed:", "stdio line reads:", "Chunk ring pipeline:" };
+    double seconds[3] = { 0, 0, 0 };
+    long long counts[3][2];
+    size_t bytes = 0;
+    char *text = NULL;
+    for (int run = 0; run < runs; run++) {
+        for (int mode = 0; mode < 3; mode++) {
+            double elapsed = bench_load_history(mode, counts[mode], &bytes, run == 0 && mode == LOADER_BUFFERED ? &text : NULL);
+            if (elapsed < 0) {
+                free(text);
+                return 1;
+            }
+            seconds[mode] += elapsed;
+        }
     }
-    if (strstr(diff_output, "import") || strstr(diff_output, "include") || strstr(diff_output, "require")) {
-        strcpy(output, "update dependencies");
+    if (!text || bytes == 0) {
+        printf("No commit history found.\n\n");
+        free(text);
         return 1;
     }
-    if (strstr(diff_output, "config") || strstr(diff_output, "setting")) {
-        strcpy(output, "update configuration");
-        return 1;
+
+    // Parser alone, over a copy of the buffered text so every run sees unsplit lines
+    size_t size = strlen(text);
+    char *copy = malloc(size + 1);
+    long long parsed[2];
+    double parse_seconds = 0;
+    for (int run = 0; run < runs; run++) {
+        memcpy(copy, text, size + 1);
+        parsed[0] = parsed[1] = 0;
+        analyzer_t counter = { "count", WALK_NEEDS_LINE_STATS, NULL, loader_count_commit, loader_count_change, NULL, parsed, 1 };
+        analyzer_t *analyzers[] = { &counter };
+        walk_state_t w;
+        memset(&w, 0, sizeof(w));
+        w.analyzers = analyzers;
+        w.count = 1;
+        w.numstat = 1;
+        double start = monotonic_seconds();
+        for (char *p = copy, *end = copy + size; p < end; ) {
+            char *nl = memchr(p, '\n', end - p);
+            if (!nl) nl = end;
+            *nl = '\0';
+            walk_feed_line(&w, p);
+            p = nl + 1;
+        }
+        walk_flush(&w);
+        parse_seconds += monotonic_seconds() - start;
+        walk_changes_free(&w.changes);
     }
-    
+    free(copy);
+    free(text);
+
+    double megabytes = size / 1e6;
+    printf("Log text:               %.1f MB, %lld commits, %lld file changes\n", megabytes, counts[0][0], counts[0][1]);
+    for (int mode = 0; mode < 3; mode++) {
+        printf("%-23s %8.1f ms/run  %7.1f MB/s\n", labels[mode], 1000 * seconds[mode] / runs,
+               seconds[mode] > 0 ? megabytes * runs / seconds[mode] : 0.0);
+    }
+    printf("%-23s %8.1f ms/run  %7.1f MB/s\n", "Parser alone:", 1000 * parse_seconds / runs,
+           parse_seconds > 0 ? megabytes * runs / parse_seconds : 0.0);
+    if (seconds[LOADER_PIPELINE] > 0) {
+        printf("Pipeline speedup:       %.2fx over buffered\n", seconds[LOADER_BUFFERED] / seconds[LOADER_PIPELINE]);
+    }
+    for (int mode = 1; mode < 3; mode++) {
+        if (counts[mode][0] != counts[0][0] || counts[mode][1] != counts[0][1] ||
+            parsed[0] != counts[0][0] || parsed[1] != counts[0][1]) {
+            printf("❌ Counts differ: %s %lld commits / %lld changes\n\n", labels[mode], counts[mode][0], counts[mode][1]);
+            return 1;
+        }
+    }
+    printf("✅ All loaders parsed the same commits and changes\n\n");
     return 0;
 }
 
-void generate_commit_suggestions() 
+int run_benchmark(const char *name, const char *arg, int runs) 
 {
-    printf("🤖 AI Commit Message Suggestions\n");
-    printf("===============================\n");
-    
-    char* diff_output = run_git_command_output("git diff --staged");
-    if (!diff_output || strlen(diff_output) == 0) {
-        printf("No staged changes found. Use 'git add' to stage changes first.\n\n");
-        return;
+    if (strcmp(name, "history") == 0 && arg) {
+        return bench_path_history(arg, runs > 0 ? runs : 3);
     }
-    
-    char commit_type[20];
-    char description[100];
-    analyze_changes_for_commit_type(diff_output, commit_type, description);
-    
-    int files_changed = 0;
-    char* line = strtok(diff_output, "\n");
-    while (line) {
-        if (strstr(line, "diff --git") != NULL) {
-            files_changed++;
-        }
-        line = strtok(NULL, "\n");
+    if (strcmp(name, "prompt") == 0) {
+        runs = arg ? atoi(arg) : 0;
+        return bench_prompt(runs > 0 ? runs : 20);
     }
-    
-    printf("Based on your changes (%d files, %s):\n\n", files_changed, description);
-    
-    printf("1. %s: %s\n", commit_type, extract_commit_subject(diff_output));
-    printf("2. %s: update %d files for %s\n", commit_type, files_changed, description);
-    
-    char specific_desc[100] = "changes";
-    if (extract_key_changes(diff_output, specific_desc)) {
-        printf("3. %s: %s\n", commit_type, specific_desc);
+    if (strcmp(name, "loader") == 0) {
+        runs = arg ? atoi(arg) : 0;
+        return bench_history_loader(runs > 0 ? runs : 3);
     }
-    
-    printf("\n💡 Tip: Use conventional commit format: <type>[optional scope]: <description>\n\n");
+    printf("Unknown benchmark: %s\n", name);
+    printf("Available: history PATH [RUNS], prompt [RUNS], loader [RUNS]\n");
+    return 1;
 }
 
-// ==================== CODE REVIEW HELPER ====================
+// ==================== SUBMODULES ====================
 
-void generate_review_checklist() 
+// Each checked-out submodule is analyzed by a child gitsmart running `stats` in its own
+// directory, so its history index and caches stay in the submodule's git dir
+typedef struct {
+    char path[MAX_PATH_LENGTH];     // relative to the superproject root
+    int checked_out;
+    int failed;
+    commit_summary_t summary;
+    file_info_t *files;
+    int file_count;
+} submodule_report_t;
+
+static char self_executable[MAX_PATH_LENGTH];
+static submodule_report_t *submodule_reports = NULL;
+static int submodule_count = 0;
+
+void remember_self_executable(const char *argv0) 
 {
-    printf("🔍 Code Review Checklist\n");
-    printf("=======================\n");
-    
-    char* diff_output = run_git_command_output("git diff HEAD~1");
-    if (!diff_output || strlen(diff_output) == 0) {
-        printf("No changes to review (or only one commit in repository).\n\n");
+    #ifdef _WIN32
+    DWORD length = GetModuleFileNameA(NULL, self_executable, sizeof(self_executable));
+    if (length > 0 && length < sizeof(self_executable)) return;
+    #else
+    ssize_t length = readlink("/proc/self/exe", self_executable, sizeof(self_executable) - 1);
+    if (length > 0) {
+        self_executable[length] = '\0';
         return;
     }
-    
-    printf("Review the following for recent changes:\n\n");
-    
-    int issues_found = 0;
-    
-    if (strstr(diff_output, "TODO") || strstr(diff_output, "FIXME")) {
-        printf("❌ TODO/FIXME comments added - consider addressing before merge\n");
-        issues_found++;
-    }
-    
-    if (strstr(diff_output, "printf(") || strstr(diff_output, "console.log") || strstr(diff_output, "print(")) {
-        printf("⚠️  Debug prints found - remove before production\n");
-        issues_found++;
-    }
-    
-    if (strstr(diff_output, "password") || strstr(diff_output, "secret") || strstr(diff_output, "api_key")) {
-        printf("🚨 Potential secrets in code - verify no hardcoded credentials\n");
-        issues_found++;
-    }
-    
-    if (strstr(diff_output, "//") && !strstr(diff_output, "// TODO") && !strstr(diff_output, "// FIXME")) {
-        printf("💡 New comments added - verify they provide useful context\n");
-        issues_found++;
+    #endif
+    // A bare name is found through PATH again; a relative one has to survive the cd
+    if (!strchr(argv0, '/') || absolute_path(argv0, self_executable, sizeof(self_executable)) != 0) {
+        snprintf(self_executable, sizeof(self_executable), "%s", argv0);
     }
-    
-    int files_changed = 0;
-    char* line = strtok(diff_output, "\n");
-    while (line) {
-        if (strstr(line, "diff --git")) {
-            files_changed++;
+}
+
+// Gitlinks come straight from the index; a submodule counts as checked out once its .git exists.
+// Called before load_file_analysis so the gitlinks themselves stay out of the hot files.
+int list_submodules() 
+{
+    static int listed = 0;
+    git_index_t index;
+    if (listed) return submodule_count;
+    listed = 1;
+    if (discover_repository() != 0 || !repo.worktree[0] || load_git_index(&index) != 0) return 0;
+
+    int capacity = 0;
+    for (int i = 0; i < index.count; i++) {
+        const index_entry_t *entry = &index.entries[i];
+        const char *name = index.paths + entry->path;
+        if ((entry->mode & 0170000) != 0160000) continue;
+        if (submodule_count > 0 && strcmp(submodule_reports[submodule_count - 1].path, name) == 0) continue;
+        if (submodule_count == capacity) {
+            capacity = capacity ? capacity * 2 : 16;
+            submodule_reports = realloc(submodule_reports, sizeof(submodule_report_t) * capacity);
         }
-        line = strtok(NULL, "\n");
-    }
-    
-    printf("\n📊 Summary: %d files changed, %d potential issues to check\n", files_changed, issues_found);
-    
-    if (issues_found == 0) {
-        printf("✅ No obvious issues detected in automated checks\n");
+        submodule_report_t *sub = &submodule_reports[submodule_count++];
+        memset(sub, 0, sizeof(*sub));
+        snprintf(sub->path, sizeof(sub->path), "%s", name);
+
+        char git_path[MAX_PATH_LENGTH * 2 + 8];
+        snprintf(git_path, sizeof(git_path), "%s/%s/.git", repo.worktree, name);
+        sub->checked_out = access(git_path, F_OK) == 0;
     }
-    
-    printf("\n");
+    free_git_index(&index);
+    return submodule_count;
 }
 
-// ==================== SECURITY AUDIT ====================
+// Submodules are listed in index order, which sorts paths bytewise
+int is_submodule_path(const char *path) 
+{
+    int low = 0, high = submodule_count;
+    while (low < high) {
+        int mid = (low + high) / 2, c = strcmp(submodule_reports[mid].path, path);
+        if (c == 0) return 1;
+        if (c < 0) low = mid + 1;
+        else high = mid;
+    }
+    return 0;
+}
 
-void run_security_audit() 
+static void add_submodule_file(submodule_report_t *sub, int *capacity, char *fields) 
 {
-    printf("🛡️  Security Audit\n");
-    printf("=================\n");
-    
-    // Use HEAD~1 instead of HEAD~10 for Windows compatibility
-    char* diff_output = run_git_command_output("git diff HEAD~1");
-    if (!diff_output || strlen(diff_output) == 0) {
-        printf("No recent changes to audit.\n\n");
-        return;
+    char *commit = strchr(fields, '\t');
+    char *author = commit ? strchr(commit + 1, '\t') : NULL;
+    char *path = author ? strchr(author + 1, '\t') : NULL;
+    if (!path) return;
+    *commit++ = *author++ = *path++ = '\0';
+
+    if (sub->file_count == *capacity) {
+        *capacity = *capacity ? *capacity * 2 : 64;
+        sub->files = realloc(sub->files, sizeof(file_info_t) * *capacity);
     }
-    
-    int security_issues = 0;
-    
-    printf("Scanning for potential security issues...\n\n");
-    
-    if (strstr(diff_output, "system(") || strstr(diff_output, "exec(") || strstr(diff_output, "popen(")) {
-        printf("❌ System command execution found - validate input sanitization\n");
-        security_issues++;
+    file_info_t *file = &sub->files[sub->file_count++];
+    memset(file, 0, sizeof(*file));
+    file->changes = atoi(fields);
+    snprintf(file->last_commit, sizeof(file->last_commit), "%s", commit);
+    snprintf(file->last_author, sizeof(file->last_author), "%s", author);
+    // Prefixed paths that no longer fit are dropped rather than shown cut short
+    if (snprintf(file->path, sizeof(file->path), "%s/%s", sub->path, path) >= (int)sizeof(file->path)) {
+        sub->file_count--;
     }
-    
-    if (strstr(diff_output, "strcpy(") || strstr(diff_output, "strcat(") || strstr(diff_output, "sprintf(")) {
-        printf("⚠️  Unsafe string functions used - consider strncpy/strncat/snprintf\n");
-        security_issues++;
+}
+
+// A child `gitsmart stats` started in a submodule without going through a shell, so
+// nothing in the submodule's path is ever parsed as a command
+typedef struct {
+    FILE *out;
+#ifdef _WIN32
+    HANDLE process;
+#else
+    pid_t pid;
+#endif
+} child_stats_t;
+
+static int child_stats_open(child_stats_t *child, const char *dir, int jobs) 
+{
+    char jobs_arg[16];
+    snprintf(jobs_arg, sizeof(jobs_arg), "%d", jobs);
+    memset(child, 0, sizeof(*child));
+#ifdef _WIN32
+    char command[MAX_PATH_LENGTH + 64];
+    snprintf(command, sizeof(command), "\"%s\" stats --recurse-submodules --jobs %s", self_executable, jobs_arg);
+    SECURITY_ATTRIBUTES inherit = { sizeof(inherit), NULL, TRUE };
+    HANDLE read_end, write_end;
+    if (!CreatePipe(&read_end, &write_end, &inherit, 0)) return -1;
+    SetHandleInformation(read_end, HANDLE_FLAG_INHERIT, 0);
+    HANDLE null_device = CreateFileA(NULL_DEVICE, GENERIC_WRITE, FILE_SHARE_WRITE, &inherit, OPEN_EXISTING, 0, NULL);
+
+    STARTUPINFOA startup;
+    PROCESS_INFORMATION info;
+    memset(&startup, 0, sizeof(startup));
+    startup.cb = sizeof(startup);
+    startup.dwFlags = STARTF_USESTDHANDLES;
+    startup.hStdInput = GetStdHandle(STD_INPUT_HANDLE);
+    startup.hStdOutput = write_end;
+    startup.hStdError = null_device;
+    BOOL started = CreateProcessA(NULL, command, NULL, NULL, TRUE, 0, NULL, dir, &startup, &info);
+    CloseHandle(write_end);
+    if (null_device != INVALID_HANDLE_VALUE) CloseHandle(null_device);
+    if (!started) {
+        CloseHandle(read_end);
+        return -1;
     }
-    
-    if (strstr(diff_output, "malloc(") && !strstr(diff_output, "free(")) {
-        printf("💡 Memory allocation without obvious free - check for leaks\n");
-        security_issues++;
+    CloseHandle(info.hThread);
+    child->process = info.hProcess;
+    int fd = _open_osfhandle((intptr_t)read_end, _O_RDONLY);
+    child->out = fd >= 0 ? _fdopen(fd, "r") : NULL;
+    if (!child->out) {
+        if (fd >= 0) _close(fd);
+        else CloseHandle(read_end);
+        WaitForSingleObject(child->process, INFINITE);
+        CloseHandle(child->process);
+        return -1;
     }
-    
-    if (strstr(diff_output, "password") || strstr(diff_output, "secret") || strstr(diff_output, "key")) {
-        printf("🔐 Security-related strings modified - verify no sensitive data exposure\n");
-        security_issues++;
+    return 0;
+#else
+    int pipe_fds[2];
+    if (pipe(pipe_fds) != 0) return -1;
+    int search_path = strchr(self_executable, '/') == NULL;
+    pid_t pid = fork();
+    if (pid < 0) {
+        close(pipe_fds[0]);
+        close(pipe_fds[1]);
+        return -1;
     }
-    
-    if (strstr(diff_output, "permission") || strstr(diff_output, "chmod") || strstr(diff_output, "access")) {
-        printf("🔒 Permission changes detected - review access control requirements\n");
-        security_issues++;
+    if (pid == 0) {
+        int null_fd = open(NULL_DEVICE, O_WRONLY);
+        if (null_fd >= 0) dup2(null_fd, STDERR_FILENO);
+        dup2(pipe_fds[1], STDOUT_FILENO);
+        close(pipe_fds[0]);
+        close(pipe_fds[1]);
+        if (chdir(dir) != 0) _exit(127);
+        if (search_path) {
+            execlp(self_executable, self_executable, "stats", "--recurse-submodules", "--jobs", jobs_arg, (char *)NULL);
+        } else {
+            execl(self_executable, self_executable, "stats", "--recurse-submodules", "--jobs", jobs_arg, (char *)NULL);
+        }
+        _exit(127);
     }
-    
-    printf("\n");
-    if (security_issues == 0) {
-        printf("✅ No obvious security issues detected\n");
-    } else {
-        printf("🔍 Found %d potential security considerations to review\n", security_issues);
+    close(pipe_fds[1]);
+    child->pid = pid;
+    child->out = fdopen(pipe_fds[0], "r");
+    if (!child->out) {
+        close(pipe_fds[0]);
+        waitpid(pid, NULL, 0);
+        return -1;
     }
-    printf("\n");
+    return 0;
+#endif
 }
 
-// ==================== CHANGE IMPACT ANALYZER ====================
+// The child's exit status, or -1 if it did not exit normally
+static int child_stats_close(child_stats_t *child) 
+{
+    fclose(child->out);
+#ifdef _WIN32
+    DWORD code = 1;
+    WaitForSingleObject(child->process, INFINITE);
+    GetExitCodeProcess(child->process, &code);
+    CloseHandle(child->process);
+    return (int)code;
+#else
+    int status;
+    if (waitpid(child->pid, &status, 0) < 0 || !WIFEXITED(status)) return -1;
+    return WEXITSTATUS(status);
+#endif
+}
 
-void analyze_change_impact(const char* target) 
+static void submodule_stats_task(void *context, int index) 
 {
-    printf("📈 Change Impact Analysis: %s\n", target);
-    printf("==============================\n");
-    
-    if (strlen(target) == 0) {
-        printf("Please specify a file or function to analyze\n\n");
-        return;
-    }
-    
-    if (access(target, F_OK) == 0) {
-        printf("Analyzing impact of changes to file: %s\n\n", target);
-        
-        char* commits = run_git_command_output("git log --oneline --follow -- \"%s\"", target);
-        if (commits && strlen(commits) > 0) {
-            printf("Recent changes to this file:\n");
-            char* line = strtok(commits, "\n");
-            int count = 0;
-            while (line && count < 5) {
-                printf("  • %s\n", line);
-                line = strtok(NULL, "\n");
-                count++;
+    submodule_report_t *sub = &submodule_reports[index];
+    int child_jobs = *(int *)context;
+    if (!sub->checked_out) return;
+
+    sub->failed = 1;
+    char dir[MAX_PATH_LENGTH * 2 + 2];
+    snprintf(dir, sizeof(dir), "%s/%s", repo.worktree, sub->path);
+    child_stats_t child;
+    if (child_stats_open(&child, dir, child_jobs) != 0) return;
+    FILE *fp = child.out;
+
+    char *line = NULL;
+    size_t capacity = 0;
+    int file_capacity = 0;
+    commit_summary_t *summary = &sub->summary;
+    while (read_stream_line(fp, &line, &capacity) >= 0) {
+        char *fields = strchr(line, ' ');
+        if (!fields) continue;
+        *fields++ = '\0';
+        if (strcmp(line, "commits") == 0) {
+            if (sscanf(fields, "%d %d %d", &summary->commits, &summary->insertions, &summary->deletions) == 3) {
+                sub->failed = 0;
             }
+        } else if (strcmp(line, "latest") == 0) {
+            char *message = strchr(fields, '\t');
+            if (message) *message++ = '\0';
+            snprintf(summary->latest_date, sizeof(summary->latest_date), "%s", fields);
+            snprintf(summary->latest_message, sizeof(summary->latest_message), "%s", message ? message : "");
+        } else if (strcmp(line, "author") == 0) {
+            char *name = strchr(fields, '\t');
+            if (name) summary_add_author(summary, name + 1, atoi(fields));
+        } else if (strcmp(line, "file") == 0) {
+            add_submodule_file(sub, &file_capacity, fields);
         }
-    } else {
-        printf("Analyzing impact of: %s\n", target);
-        printf("(Note: This is a simple analysis. For complex projects, consider specialized tools.)\n");
     }
-    
-    printf("\n💡 Consider running tests after modifying this component\n\n");
+    if (child_stats_close(&child) != 0) sub->failed = 1;
+    free(line);
 }
 
-// ==================== INTERACTIVE CONFLICT RESOLVER ====================
+// Each submodule's list is already its own top MAX_FILES, so the merged top stays exact
+static void merge_submodule_files(const submodule_report_t *sub) 
+{
+    int total = file_count + sub->file_count;
+    if (sub->file_count == 0) return;
+    file_info_t *merged = malloc(sizeof(file_info_t) * total);
+    memcpy(merged, files, sizeof(file_info_t) * file_count);
+    memcpy(merged + file_count, sub->files, sizeof(file_info_t) * sub->file_count);
+    qsort(merged, total, sizeof(file_info_t), compare_file_changes);
+    file_count = total < MAX_FILES ? total : MAX_FILES;
+    memcpy(files, merged, sizeof(file_info_t) * file_count);
+    free(merged);
+}
 
-void interactive_conflict_resolver() 
+// Analyzes every checked-out submodule concurrently on the worker pool and merges the hot
+// files, prefixed with the submodule path, into files[]; commit totals are folded in by
+// show_commit_summary. Nested submodules recurse through the children.
+void load_submodules() 
 {
-    printf("🔄 Interactive Conflict Resolver\n");
-    printf("===============================\n");
-    
-    char* status = run_git_command_output("git status --porcelain");
-    if (!status || !strstr(status, "UU")) {
-        printf("No merge conflicts detected.\n");
-        printf("This helper assists when you have merge conflicts (files marked with 'UU').\n\n");
-        return;
-    }
-    
-    printf("Merge conflicts detected. Here's how to resolve them:\n\n");
-    
-    printf("1. Identify conflicted files:\n");
-    char* line = strtok(status, "\n");
-    while (line) {
-        if (strstr(line, "UU")) {
-            printf("   • %s\n", line + 3);
-        }
-        line = strtok(NULL, "\n");
+    if (list_submodules() == 0) return;
+    int workers = default_job_count();
+    int child_jobs = workers / submodule_count > 1 ? workers / submodule_count : 1;
+    parallel_for(submodule_count, workers, submodule_stats_task, &child_jobs);
+    for (int i = 0; i < submodule_count; i++) {
+        merge_submodule_files(&submodule_reports[i]);
+        free(submodule_reports[i].files);
+        submodule_reports[i].files = NULL;
     }
-    
-    printf("\n2. For each conflicted file:\n");
-    printf("   - Open the file in your editor\n");
-    printf("   - Look for <<<<<<<, =======, >>>>>>> markers\n");
-    printf("   - Choose which changes to keep (ours/theirs/both)\n");
-    printf("   - Remove the conflict markers and clean up the code\n");
-    printf("   - Save the file\n");
-    
-    printf("\n3. After resolving all conflicts:\n");
-    printf("   git add .\n");
-    printf("   git commit\n");
-    
-    printf("\n4. Common tools that can help:\n");
-    printf("   - git mergetool (opens configured merge tool)\n");
-    printf("   - git diff (see differences)\n");
-    printf("   - git log --merge (see conflicting commits)\n");
-    
-    printf("\n💡 Tip: Use 'git config --global merge.tool vscode' to set up VS Code as merge tool\n\n");
 }
 
-// ==================== PERFORMANCE REGRESSION DETECTOR ====================
-
-void detect_performance_regressions() 
+void fold_submodule_summaries(commit_summary_t *summary) 
 {
-    printf("⚡ Performance Regression Detection\n");
-    printf("==================================\n");
-    
-    // Windows-compatible performance analysis
-    char* recent_commits = run_git_command_output("git log --oneline -5");
-    if (recent_commits && strlen(recent_commits) > 0) {
-        printf("Recent commits (watch for large changes):\n");
-        char* line = strtok(recent_commits, "\n");
-        while (line) {
-            printf("  • %s\n", line);
-            line = strtok(NULL, "\n");
+    for (int i = 0; i < submodule_count; i++) {
+        const commit_summary_t *sub = &submodule_reports[i].summary;
+        summary->commits += sub->commits;
+        summary->insertions += sub->insertions;
+        summary->deletions += sub->deletions;
+        for (int j = 0; j < sub->author_count; j++) {
+            summary_add_author(summary, sub->authors[j], sub->author_counts[j]);
         }
-    }
-    
-    #ifdef _WIN32
-    char* large_files = run_git_command_output("git ls-tree -r -l HEAD | sort /R");
-    #else
-    char* large_files = run_git_command_output("git ls-tree -r -l HEAD | sort -n -k4 | tail -3");
-    #endif
-    
-    if (large_files && strlen(large_files) > 0) {
-        printf("\nFiles to monitor for size (potential performance concerns):\n");
-        char* line = strtok(large_files, "\n");
-        int count = 0;
-        while (line && count < 3) {
-            printf("  • %s\n", line);
-            line = strtok(NULL, "\n");
-            count++;
+        if (strcmp(sub->latest_date, summary->latest_date) > 0) {
+            strcpy(summary->latest_date, sub->latest_date);
+            strcpy(summary->latest_message, sub->latest_message);
         }
     }
-    
-    printf("\n🔍 Performance Monitoring Tips:\n");
-    printf("• Monitor file size growth over time\n");
-    printf("• Watch for large binary files in repo\n");
-    printf("• Consider git-lfs for large assets\n");
-    printf("• Use profilers for performance-critical code\n\n");
 }
 
-// ==================== WORKFLOW OPTIMIZER ====================
+void show_submodule_status() 
+{
+    int analyzed = 0, missing = 0, failed = 0;
+    for (int i = 0; i < submodule_count; i++) {
+        if (!submodule_reports[i].checked_out) missing++;
+        else if (submodule_reports[i].failed) failed++;
+        else analyzed++;
+    }
+    printf("📦 Submodules: %d analyzed", analyzed);
+    if (missing > 0) printf(", %d not checked out", missing);
+    if (failed > 0) printf(", %d failed", failed);
+    printf("\n\n");
+}
+
+// ==================== RESULT CACHE ====================
+
+// Rendered reports of read-only commands, keyed by everything their output depends on:
+// arguments, HEAD, every ref and the index. A hit is printed without spawning git.
+#define RESULT_CACHE_VERSION 1
+#define RESULT_CACHE_ENTRIES 32
 
-void analyze_workflow_patterns() 
+typedef struct {
+    uint64_t lo, hi;
+} result_key_t;
+
+static void result_key_update(result_key_t *key, const void *data, size_t length) 
 {
-    printf("🚀 Git Workflow Optimizer\n");
-    printf("========================\n");
-    
-    // Analyze commit frequency and patterns
-    char* commit_times = run_git_command_output("git log --format=%%ad --date=iso-strict -100");
-    if (!commit_times || strlen(commit_times) == 0) {
-        printf("Not enough commit history for workflow analysis.\n\n");
-        return;
+    const unsigned char *p = data;
+    for (size_t i = 0; i < length; i++) {
+        key->lo = (key->lo ^ p[i]) * 0x100000001b3ULL;
+        key->hi = (key->hi ^ p[i]) * 0x00000100000001b3ULL + 0x9e3779b97f4a7c15ULL;
     }
-    
-    int total_commits = 0;
-    char* line = strtok(commit_times, "\n");
-    while (line) { total_commits++; line = strtok(NULL, "\n"); }
-    
-    printf("📊 Workflow Analysis (%d recent commits):\n\n", total_commits);
-    
-    // Check commit size patterns
-    char* large_commits = run_git_command_output("git log --oneline --numstat -20 | grep -E \"^[0-9]+\" | awk '{sum+=$1+$2} END {print sum}'");
-    if (large_commits) {
-        int total_changes = atoi(large_commits);
-        int avg_changes = total_commits > 0 ? total_changes / total_commits : 0;
-        printf("• Average changes per commit: %d lines\n", avg_changes);
-        if (avg_changes > 500) printf("  ⚠️  Consider smaller, more focused commits\n");
-        else if (avg_changes < 10) printf("  ⚠️  Very small commits - consider batching related changes\n");
-        else printf("  ✅ Good commit size balance\n");
+    // Separator, so ("ab","c") and ("a","bc") differ
+    key->lo = (key->lo ^ 0xff) * 0x100000001b3ULL;
+    key->hi = (key->hi ^ 0xff) * 0x00000100000001b3ULL;
+}
+
+static int result_key_ref(const ref_record_t *ref, void *context) 
+{
+    result_key_update(context, ref->name, strlen(ref->name));
+    result_key_update(context, ref->oid, 40);
+    return 0;
+}
+
+static int is_cacheable_command(int argc, char *argv[]) 
+{
+    if (argc < 2) return 0;
+    // Submodule checkouts move without touching the superproject's HEAD, refs or index
+    for (int i = 2; i < argc; i++) {
+        if (strcmp(argv[i], "--recurse-submodules") == 0) return 0;
     }
-    
-    // Check time between commits
-    char* recent_dates = run_git_command_output("git log --format=%%ad --date=iso-strict -5 | head -5");
-    if (recent_dates && strchr(recent_dates, 'T')) {
-        printf("• Recent commit frequency: ");
-        int line_count = 0;
-        char* date_line = strtok(recent_dates, "\n");
-        while (date_line && line_count < 3) {
-            // Extract just the date part for simplicity
-            char* date_part = strtok(date_line, "T");
-            if (date_part) printf("%s ", date_part);
-            date_line = strtok(NULL, "\n");
-            line_count++;
-        }
-        printf("\n");
+    return strcmp(argv[1], "hotfiles") == 0 || strcmp(argv[1], "branches") == 0 ||
+           strcmp(argv[1], "docs") == 0 || strcmp(argv[1], "performance") == 0;
+}
+
+// Fails (no caching) when the state can't be read natively, e.g. with reftable
+static int compute_result_key(int argc, char *argv[], char *out, size_t size) 
+{
+    result_key_t key = { 0xcbf29ce484222325ULL, 0x84222325cbf29ce4ULL };
+    int version = RESULT_CACHE_VERSION;
+    result_key_update(&key, &version, sizeof(version));
+    for (int i = 1; i < argc; i++) result_key_update(&key, argv[i], strlen(argv[i]));
+    result_key_update(&key, repo.git_dir, strlen(repo.git_dir));
+    result_key_update(&key, repo.prefix, strlen(repo.prefix));
+
+    char head[41], symref[MAX_PATH_LENGTH];
+    if (resolve_ref("HEAD", head, symref, sizeof(symref)) != 0) {
+        // An unborn branch still renders the same report until something is committed
+        if (!symref[0]) return -1;
+        strcpy(head, "unborn");
     }
-    
-    // Check branch lifespan
-    char* branch_ages = run_git_command_output("git for-each-ref --format='%%(refname:short)|%%(committerdate:relative)' refs/heads/");
-    if (branch_ages) {
-        printf("• Branch activity:\n");
-        char* branch_line = strtok(branch_ages, "\n");
-        int old_branches = 0;
-        while (branch_line) {
-            char* name = strtok(branch_line, "|");
-            char* age = strtok(NULL, "|");
-            if (name && age && strstr(age, "week") && strcmp(name, "main") != 0 && strcmp(name, "master") != 0) {
-                old_branches++;
-                if (old_branches == 1) printf("  ⏰ Old branches needing attention:\n");
-                printf("    - %s (%s)\n", name, age);
-            }
-            branch_line = strtok(NULL, "\n");
-        }
-        if (old_branches == 0) printf("  ✅ No stale branches found\n");
+    result_key_update(&key, head, strlen(head));
+    result_key_update(&key, symref, strlen(symref));
+    if (for_each_ref("refs/", result_key_ref, &key) != 0) return -1;
+
+    // git rewrites the index through a rename, so the inode changes along with mtime and size
+    char index_path[MAX_PATH_LENGTH + 16];
+    snprintf(index_path, sizeof(index_path), "%s/index", repo.git_dir);
+    #ifdef _WIN32
+    struct _stat64 st;
+    if (_stat64(index_path, &st) == 0) {
+        long long index_state[2] = { (long long)st.st_mtime, (long long)st.st_size };
+        result_key_update(&key, index_state, sizeof(index_state));
     }
-    
-    // Check merge vs rebase patterns
-    char* merge_commits = run_git_command_output("git log --oneline --merges -10 | wc -l");
-    char* total_recent = run_git_command_output("git log --oneline -20 | wc -l");
-    if (merge_commits && total_recent) {
-        int merges = atoi(merge_commits);
-        int total = atoi(total_recent);
-        if (total > 0) {
-            int merge_percentage = (merges * 100) / total;
-            printf("• Merge strategy: %d%% merge commits in recent history\n", merge_percentage);
-            if (merge_percentage > 50) printf("  💡 Consider using rebase for cleaner history\n");
-            else printf("  ✅ Good merge/rebase balance\n");
-        }
+    #else
+    struct stat st;
+    if (stat(index_path, &st) == 0) {
+        long long index_state[3] = { (long long)st.st_mtime, (long long)st.st_size, (long long)st.st_ino };
+        result_key_update(&key, index_state, sizeof(index_state));
     }
-    
-    // Generate personalized recommendations
-    printf("\n🎯 Workflow Recommendations:\n");
-    
-    char* current_branch = run_git_command_output("git branch --show-current");
-    if (current_branch && strcmp(current_branch, "main") != 0 && strcmp(current_branch, "master") != 0) {
-        char* branch_age = run_git_command_output("git log -1 --format=%%cr origin/main..HEAD");
-        if (branch_age && strlen(branch_age) > 0) {
-            printf("1. Feature branch '%s' is %s old - consider merging soon\n", current_branch, branch_age);
+    #endif
+
+    // Stale-branch ages depend on the date; docs reports the README* names in the working
+    // directory, so those names are the key (a directory mtime is too coarse to notice them)
+    if (strcmp(argv[1], "branches") == 0) {
+        long long day = (long long)time(NULL) / 86400;
+        result_key_update(&key, &day, sizeof(day));
+    } else if (strcmp(argv[1], "docs") == 0) {
+        char cwd[MAX_PATH_LENGTH];
+        if (!getcwd(cwd, sizeof(cwd))) return -1;
+        result_key_update(&key, cwd, strlen(cwd));
+        #ifdef _WIN32
+        WIN32_FIND_DATAA found;
+        HANDLE handle = FindFirstFileA("README*", &found);
+        if (handle != INVALID_HANDLE_VALUE) {
+            do {
+                result_key_update(&key, found.cFileName, strlen(found.cFileName) + 1);
+            } while (FindNextFileA(handle, &found));
+            FindClose(handle);
         }
-    }
-    
-    char* unstaged = run_git_command_output("git status --porcelain | grep -v \"^??\" | wc -l");
-    if (unstaged && atoi(unstaged) > 5) {
-        printf("2. You have %s uncommitted changes - consider smaller, more frequent commits\n", unstaged);
-    }
-    
-    char* remote_branches = run_git_command_output("git branch -r | wc -l");
-    char* local_branches = run_git_command_output("git branch | wc -l");
-    if (remote_branches && local_branches) {
-        int remote = atoi(remote_branches);
-        int local = atoi(local_branches);
-        if (remote > local * 2) {
-            printf("3. Many remote branches (%d remote vs %d local) - consider cleaning up\n", remote, local);
+        #else
+        DIR *dir = opendir(".");
+        if (!dir) return -1;
+        struct dirent *entry;
+        while ((entry = readdir(dir)) != NULL) {
+            if (strncmp(entry->d_name, "README", 6) == 0) result_key_update(&key, entry->d_name, strlen(entry->d_name) + 1);
         }
+        closedir(dir);
+        #endif
     }
-    
-    printf("4. Run 'gitsmart review' before pushing changes\n");
-    printf("5. Use 'gitsmart suggest' for better commit messages\n");
-    
-    printf("\n");
+
+    snprintf(out, size, "%016llx%016llx", (unsigned long long)key.hi, (unsigned long long)key.lo);
+    return 0;
 }
 
-// Add to main command handler
-void show_help_full() 
+static int result_cache_path(const char *key, const char *suffix, char *out, size_t size) 
 {
-    printf("GitSmart - Intelligent Git Repository Analysis\n");
-    printf("=============================================\n");
-    printf("Usage: gitsmart [COMMAND] [OPTIONS]\n");
-    printf("\nCommands:\n");
-    printf("  analysis    Show comprehensive repository analysis (default)\n");
-    printf("  blame FILE  Show smart blame with commit context\n");
-    printf("  branches    Show branch analysis and cleanup suggestions\n");
-    printf("  hotfiles    Show most frequently changed files\n");
-    printf("  cleanup     Show cleanup suggestions\n");
-    printf("  suggest     AI-powered commit message suggestions\n");
-    printf("  review      Generate code review checklist\n");
-    printf("  security    Run security audit on recent changes\n");
-    printf("  impact TGT  Analyze change impact for file/component\n");
-    printf("  resolve     Interactive merge conflict resolver\n");
-    printf("  performance Detect potential performance regressions\n");
-    printf("  docs        Find documentation gaps\n");
-    printf("  workflow    Analyze and optimize git workflow patterns\n");  // NEW
-    printf("  help        Show this help message\n");
-    printf("\nExamples:\n");
-    printf("  gitsmart                    # Full analysis\n");
-    printf("  gitsmart workflow           # Workflow optimization\n");  // NEW
-    printf("  gitsmart suggest            # AI commit suggestions\n");
+    char name[64];
+    if (get_cache_path(out, size, "results") != 0) return -1;
+    make_directory(out);
+    snprintf(name, sizeof(name), "results/%s%s", key, suffix);
+    return get_cache_path(out, size, name);
 }
 
-// ==================== DOCUMENTATION GAP FINDER ====================
+static void copy_to_stdout(FILE *fp) 
+{
+    char buffer[65536];
+    size_t n;
+    while ((n = fread(buffer, 1, sizeof(buffer), fp)) > 0) fwrite(buffer, 1, n, stdout);
+    fflush(stdout);
+}
 
-void find_documentation_gaps() 
+// Prints a stored report; returns 0 on a hit
+int result_cache_lookup(const char *key) 
 {
-    printf("📚 Documentation Gap Analysis\n");
-    printf("============================\n");
-    
-    // Windows-compatible README detection
+    char path[MAX_PATH_LENGTH];
+    if (result_cache_path(key, "", path, sizeof(path)) != 0) return -1;
+    FILE *fp = fopen(path, "rb");
+    if (!fp) return -1;
+    copy_to_stdout(fp);
+    fclose(fp);
+    return 0;
+}
+
+// Keeps the newest RESULT_CACHE_ENTRIES reports
+static void prune_result_cache() 
+{
+    char dir[MAX_PATH_LENGTH];
+    if (get_cache_path(dir, sizeof(dir), "results") != 0) return;
+    char (*names)[64] = NULL;
+    long long *times = NULL;
+    int count = 0, capacity = 0;
+
     #ifdef _WIN32
-    char* readme = run_git_command_output("dir README* 2>NUL");
-    if (readme && strstr(readme, "README")) {
-        printf("✅ README file found\n");
-    } else {
-        printf("❌ No README file found - consider adding project documentation\n");
-    }
+    char pattern[MAX_PATH_LENGTH + 4];
+    snprintf(pattern, sizeof(pattern), "%s/*", dir);
+    WIN32_FIND_DATAA entry;
+    HANDLE find = FindFirstFileA(pattern, &entry);
+    if (find == INVALID_HANDLE_VALUE) return;
+    do {
+        const char *name = entry.cFileName;
+        long long modified = ((long long)entry.ftLastWriteTime.dwHighDateTime << 32) | entry.ftLastWriteTime.dwLowDateTime;
     #else
-    char* readme = run_git_command_output("ls README* 2>/dev/null | head -1");
-    if (readme && strlen(readme) > 0) {
-        printf("✅ README file found: %s\n", readme);
-    } else {
-        printf("❌ No README file found - consider adding project documentation\n");
-    }
+    DIR *d = opendir(dir);
+    if (!d) return;
+    struct dirent *entry;
+    while ((entry = readdir(d)) != NULL) {
+        const char *name = entry->d_name;
+        char path[MAX_PATH_LENGTH * 2];
+        struct stat st;
+        snprintf(path, sizeof(path), "%s/%s", dir, name);
+        if (stat(path, &st) != 0) continue;
+        long long modified = (long long)st.st_mtime;
     #endif
-    
-    char* recent_commits = run_git_command_output("git log --oneline -10");
-    if (recent_commits && strlen(recent_commits) > 0) {
-        int total_commits = 0;
-        int doc_commits = 0;
-        
-        char* line = strtok(recent_commits, "\n");
-        while (line) {
-            total_commits++;
-            if (strstr(line, "doc") || strstr(line, "readme") || strstr(line, "Documentation")) {
-                doc_commits++;
-            }
-            line = strtok(NULL, "\n");
+        if (strlen(name) != 32) continue;
+        if (count == capacity) {
+            capacity = capacity ? capacity * 2 : 64;
+            names = realloc(names, 64 * (size_t)capacity);
+            times = realloc(times, sizeof(long long) * capacity);
         }
-        
-        printf("\nDocumentation activity in last %d commits: %d doc-related commits\n", 
-               total_commits, doc_commits);
-        
-        if (doc_commits < total_commits / 4) {
-            printf("⚠️  Documentation may be lagging behind code changes\n");
+        strcpy(names[count], name);
+        times[count++] = modified;
+    #ifdef _WIN32
+    } while (FindNextFileA(find, &entry));
+    FindClose(find);
+    #else
+    }
+    closedir(d);
+    #endif
+
+    while (count > RESULT_CACHE_ENTRIES) {
+        int oldest = 0;
+        for (int i = 1; i < count; i++) {
+            if (times[i] < times[oldest]) oldest = i;
         }
+        char path[MAX_PATH_LENGTH * 2];
+        snprintf(path, sizeof(path), "%s/%s", dir, names[oldest]);
+        remove(path);
+        strcpy(names[oldest], names[count - 1]);
+        times[oldest] = times[--count];
     }
-    
-    printf("\n💡 Documentation Tips:\n");
-    printf("• Update README when adding features\n");
-    printf("• Document API changes in commit messages\n");
-    printf("• Consider adding inline comments for complex logic\n");
-    printf("• Keep CHANGELOG.md for release notes\n\n");
+    free(names);
+    free(times);
+}
+
+// Runs `run` with stdout captured into the cache, then prints what it wrote. Only
+// successful runs are kept.
+int run_cached(const char *key, int (*run)(int, char **), int argc, char *argv[]) 
+{
+    // Identical invocations (e.g. from concurrent hooks) each capture into their own file;
+    // whichever finishes last renames its report into place
+    char tmp_path[MAX_PATH_LENGTH + 64], final_path[MAX_PATH_LENGTH];
+    if (result_cache_path(key, "", final_path, sizeof(final_path)) != 0 ||
+        unique_temp_path(tmp_path, sizeof(tmp_path), final_path) != 0) {
+        return run(argc, argv);
+    }
+    FILE *capture = fopen(tmp_path, "w+b");
+    if (!capture) return run(argc, argv);
+
+    fflush(stdout);
+    int saved = dup(fileno(stdout));
+    dup2(fileno(capture), fileno(stdout));
+    int status = run(argc, argv);
+    fflush(stdout);
+    dup2(saved, fileno(stdout));
+    close(saved);
+
+    fseek(capture, 0, SEEK_SET);
+    copy_to_stdout(capture);
+    fclose(capture);
+    if (status == 0 && replace_file(tmp_path, final_path) == 0) prune_result_cache();
+    else remove(tmp_path);
+    return status;
 }
 
 // ==================== MAIN COMMAND HANDLER ====================
 
-void show_analysis() 
+int progressive_output = -1;    // -1: progressive when stdout is a terminal
+
+// One history pass feeds the commit summary and keeps the hot-file index current
+static void load_analysis_history() 
+{
+    history_update_t history_update;
+    analyzer_t commit_store = commit_store_analyzer();
+    analyzer_t history_index = history_index_analyzer(&history_update);
+    analyzer_t *analyzers[] = { &commit_store, &history_index };
+    run_history_walk(analyzers, 2);
+}
+
+// Provisional view of the analysis walk: the commit summary so far and the most touched
+// paths, redrawn in place. It only stays active while another analyzer wants history.
+typedef struct {
+    live_block_t block;
+    analyzer_t **others;
+    int other_count;
+    path_table_t paths;
+    int *counts;
+    int count_capacity;
+    int commits_read;
+} live_analysis_t;
+
+static void draw_live_analysis(live_analysis_t *live) 
+{
+    commit_summary_t *summary = malloc(sizeof(commit_summary_t));
+    summarize_commits(summary);
+    live_printf(&live->block, "📊 Repository Analysis (provisional, %d commits read)\n", live->commits_read);
+    int top = summary_top_author(summary);
+    if (top >= 0) live_printf(&live->block, "Most active author so far: %s (%d commits)\n", summary->authors[top], summary->author_counts[top]);
+    free(summary);
+
+    int best[10], best_count = 0;
+    for (int id = 0; id < live->paths.count; id++) {
+        if (best_count == 10 && live->counts[id] <= live->counts[best[9]]) continue;
+        int i = best_count < 10 ? best_count++ : 9;
+        while (i > 0 && live->counts[best[i - 1]] < live->counts[id]) {
+            best[i] = best[i - 1];
+            i--;
+        }
+        best[i] = id;
+    }
+    if (best_count > 0) live_printf(&live->block, "Most changed files so far:\n");
+    for (int i = 0; i < best_count; i++) {
+        live_printf(&live->block, "%3d changes: %s\n", live->counts[best[i]], live->paths.names[best[i]]);
+    }
+    live_block_flush(&live->block);
+}
+
+static int live_analysis_on_commit(analyzer_t *self, const history_commit_t *c) 
+{
+    live_analysis_t *live = self->state;
+    (void)c;
+    // Placed last, so the other analyzers have already seen this commit
+    self->active = any_analyzer_active(live->others, live->other_count);
+    if (!self->active) return 0;
+    live->commits_read++;
+    if (live_block_due(&live->block)) draw_live_analysis(live);
+    return 1;
+}
+
+static void live_analysis_on_file_change(analyzer_t *self, const history_commit_t *c, const file_change_t *change) 
+{
+    live_analysis_t *live = self->state;
+    (void)c;
+    int id = path_table_intern(&live->paths, change->path);
+    if (id >= live->count_capacity) {
+        int old = live->count_capacity;
+        live->count_capacity = live->count_capacity ? live->count_capacity * 2 : 1024;
+        live->counts = realloc(live->counts, sizeof(int) * live->count_capacity);
+        memset(live->counts + old, 0, sizeof(int) * (live->count_capacity - old));
+    }
+    live->counts[id]++;
+}
+
+// Prints the cheap sections first, then shows provisional results during the history pass
+static void show_analysis_progressive(int recurse_submodules) 
+{
+    load_branch_info(NULL, NULL, 0);
+    show_branch_analysis();
+    show_cleanup_suggestions();
+    fflush(stdout);
+
+    history_update_t history_update;
+    live_analysis_t live;
+    memset(&live, 0, sizeof(live));
+    live_block_begin(&live.block);
+    analyzer_t commit_store = commit_store_analyzer();
+    analyzer_t history_index = history_index_analyzer(&history_update);
+    analyzer_t *others[] = { &commit_store, &history_index };
+    live.others = others;
+    live.other_count = 2;
+    analyzer_t live_view = { "live", WALK_NEEDS_FILES, NULL, live_analysis_on_commit,
+                             live_analysis_on_file_change, NULL, &live, 0 };
+    analyzer_t *analyzers[] = { &commit_store, &history_index, &live_view };
+    run_history_walk(analyzers, live.block.enabled ? 3 : 2);
+    live_block_end(&live.block);
+    path_table_free(&live.paths);
+    free(live.counts);
+
+    if (recurse_submodules) list_submodules();
+    load_file_analysis();
+    if (recurse_submodules) load_submodules();
+    show_commit_summary();
+    show_hot_files();
+    if (recurse_submodules) show_submodule_status();
+}
+
+// `approx_sample` > 0 swaps the exact commit summary and hot files for sketch estimates
+void show_analysis(int approx_sample, int recurse_submodules) 
 {
     printf("\n");
     printf("🎯 GitSmart Analysis Report\n");
     printf("==========================\n\n");
     
-    load_commit_history();
-    load_branch_info();
+    if (approx_sample > 0) {
+        approx_stats_t *approx = malloc(sizeof(approx_stats_t));
+        collect_approx_stats(approx, approx_sample);
+        load_branch_info(NULL, NULL, 0);
+        show_approx_summary(approx);
+        show_branch_analysis();
+        show_cleanup_suggestions();
+        free_approx_stats(approx);
+        free(approx);
+        return;
+    }
+    
+    if (progressive_output < 0) progressive_output = stream_is_terminal(stdout);
+    if (progressive_output) {
+        show_analysis_progressive(recurse_submodules);
+        return;
+    }
+    
+    load_analysis_history();
+    load_branch_info(NULL, NULL, 0);
+    if (recurse_submodules) list_submodules();
     load_file_analysis();
+    if (recurse_submodules) load_submodules();
     
     show_commit_summary();
     show_branch_analysis();
     show_hot_files();
     show_cleanup_suggestions();
+    if (recurse_submodules) show_submodule_status();
+}
+
+// Machine-readable commit and hot-file totals, read back by --recurse-submodules
+void show_repository_stats(int recurse_submodules) 
+{
+    load_analysis_history();
+    if (recurse_submodules) list_submodules();
+    load_file_analysis();
+    if (recurse_submodules) load_submodules();
+
+    commit_summary_t summary;
+    summarize_commits(&summary);
+    fold_submodule_summaries(&summary);
+    printf("commits %d %d %d\n", summary.commits, summary.insertions, summary.deletions);
+    printf("latest %s\t%s\n", summary.latest_date, summary.latest_message);
+    for (int i = 0; i < summary.author_count; i++) {
+        printf("author %d\t%s\n", summary.author_counts[i], summary.authors[i]);
+    }
+    for (int i = 0; i < file_count; i++) {
+        printf("file %d\t%s\t%s\t%s\n", files[i].changes, files[i].last_commit, files[i].last_author, files[i].path);
+    }
 }
 
 void show_help_full() 
@@ -1132,20 +11417,50 @@ void show_help_full()
     printf("Usage: gitsmart [COMMAND] [OPTIONS]\n");
     printf("\nCommands:\n");
     printf("  analysis    Show comprehensive repository analysis (default)\n");
+    printf("              --approx [--sample N]  sketch estimates with error bounds\n");
+    printf("              --jobs N  parallel diff processes for history (default: CPU count)\n");
+    printf("              --recurse-submodules  merge in checked-out submodules, paths prefixed\n");
+    printf("              --progressive  print sections as they are ready (default on a terminal)\n");
     printf("  blame FILE  Show smart blame with commit context\n");
-    printf("  branches    Show branch analysis and cleanup suggestions\n");
+    printf("  branches [PREFIX]  Show branch analysis and cleanup suggestions\n");
+    printf("              --base NAME  compare against NAME (repeatable; default main/master)\n");
+    printf("  owners [PATH] Map surviving lines to authors per directory\n");
+    printf("              --jobs N  parallel blames (default: CPU count)\n");
+    printf("              --depth N directory levels to show (default: 2)\n");
     printf("  hotfiles    Show most frequently changed files\n");
+    printf("              --recurse-submodules  include checked-out submodules, analyzed in parallel\n");
+    printf("              --by-dir [--depth N]  changes, line churn and authors per directory\n");
+    printf("  stats       Machine-readable commit and hot-file totals\n");
     printf("  cleanup     Show cleanup suggestions\n");
     printf("  suggest     AI-powered commit message suggestions\n");
     printf("  review      Generate code review checklist\n");
     printf("  security    Run security audit on recent changes\n");
+    printf("              --history [--jobs N]  scan all history for secrets\n");
     printf("  impact TGT  Analyze change impact for file/component\n");
     printf("  resolve     Interactive merge conflict resolver\n");
     printf("  performance Detect potential performance regressions\n");
+    printf("              --growth [K]  rank the K commits that grew the repo most\n");
+    printf("              --largest [K] the K largest blobs ever committed\n");
     printf("  docs        Find documentation gaps\n");
+    printf("  workflow    Analyze and optimize git workflow patterns\n");
+    printf("              --approx [--sample N]  judge all history from N sampled commits\n");
+    printf("  prompt      One-line status for shell prompts (no git processes)\n");
+    printf("              --budget MS  time limit, partial output marked … (default: 5)\n");
+    printf("  bench NAME  Time an optimized path against plain git\n");
+    printf("              history PATH [RUNS]  single-path history walk\n");
+    printf("              prompt [RUNS]        prompt status vs git status\n");
+    printf("              loader [RUNS]        history loader throughput, three readers\n");
     printf("  help        Show this help message\n");
+    printf("\nOptions:\n");
+    printf("  --no-cache  Recompute hotfiles/branches/docs/performance instead of reusing\n");
+    printf("              the report saved for the same HEAD, refs and index\n");
+    printf("  --mem-limit SIZE  Cap memory for counting (e.g. 256M); co-change pair counts and\n");
+    printf("              the history index's postings and path events spill to sorted run\n");
+    printf("              files under the cache directory. Path names and per-commit records\n");
+    printf("              stay in memory, so they are not covered by the limit\n");
     printf("\nExamples:\n");
     printf("  gitsmart                    # Full analysis\n");
+    printf("  gitsmart workflow           # Workflow optimization\n");
     printf("  gitsmart suggest            # AI commit suggestions\n");
     printf("  gitsmart review             # Code review helper\n");
     printf("  gitsmart security           # Security audit\n");
@@ -1156,29 +11471,140 @@ void show_help_full()
 
 // ==================== MAIN FUNCTION ====================
 
-int main(int argc, char *argv[]) 
+static int run_command(int argc, char *argv[]) 
 {
-    if (!is_git_repository()) {
-        printf("❌ Error: Not a git repository\n");
-        printf("Run this command in a git repository\n");
-        return 1;
-    }
-    
     if (argc == 1) {
-        show_analysis();
+        show_analysis(0, 0);
+    } else if (strcmp(argv[1], "owners") == 0) {
+        const char *path = NULL;
+        int jobs = default_job_count(), depth = 2;
+        for (int i = 2; i < argc; i++) {
+            if ((strcmp(argv[i], "--jobs") == 0 || strcmp(argv[i], "-j") == 0) && i + 1 < argc) {
+                jobs = atoi(argv[++i]);
+            } else if (strcmp(argv[i], "--depth") == 0 && i + 1 < argc) {
+                depth = atoi(argv[++i]);
+            } else if (!path) {
+                path = argv[i];
+            } else {
+                show_help_full();
+                return 1;
+            }
+        }
+        show_ownership_map(path, jobs > 0 ? jobs : 1, depth >= 0 ? depth : 2);
+    } else if (strcmp(argv[1], "branches") == 0) {
+        const char *prefix = NULL;
+        char bases[MAX_BASE_BRANCHES][256];
+        int base_count = 0;
+        for (int i = 2; i < argc; i++) {
+            if (strcmp(argv[i], "--base") == 0 && i + 1 < argc && base_count < MAX_BASE_BRANCHES) {
+                snprintf(bases[base_count++], sizeof(bases[0]), "%s", argv[++i]);
+            } else if (!prefix && argv[i][0] != '-') {
+                prefix = argv[i];
+            } else {
+                show_help_full();
+                return 1;
+            }
+        }
+        load_branch_info(prefix, bases, base_count);
+        show_branch_analysis();
+    } else if ((strcmp(argv[1], "analysis") == 0 || strcmp(argv[1], "workflow") == 0) && argc > 2) {
+        int approx = 0, sample = APPROX_DEFAULT_SAMPLE, recurse = 0;
+        for (int i = 2; i < argc; i++) {
+            if (strcmp(argv[i], "--approx") == 0) {
+                approx = 1;
+            } else if (strcmp(argv[i], "--recurse-submodules") == 0 && strcmp(argv[1], "analysis") == 0) {
+                recurse = 1;
+            } else if (strcmp(argv[i], "--progressive") == 0 && strcmp(argv[1], "analysis") == 0) {
+                progressive_output = 1;
+            } else if (strcmp(argv[i], "--sample") == 0 && i + 1 < argc) {
+                sample = atoi(argv[++i]);
+            } else if ((strcmp(argv[i], "--jobs") == 0 || strcmp(argv[i], "-j") == 0) && i + 1 < argc) {
+                walk_jobs = atoi(argv[++i]);
+            } else {
+                show_help_full();
+                return 1;
+            }
+        }
+        if (sample <= 0 || walk_jobs < 0 || (approx && recurse)) {
+            show_help_full();
+            return 1;
+        }
+        if (strcmp(argv[1], "analysis") == 0) show_analysis(approx ? sample : 0, recurse);
+        else analyze_workflow_patterns(approx ? sample : 0);
+    } else if ((strcmp(argv[1], "hotfiles") == 0 || strcmp(argv[1], "stats") == 0) && argc > 2) {
+        int recurse = 0, by_dir = 0, depth = 2;
+        for (int i = 2; i < argc; i++) {
+            if (strcmp(argv[i], "--recurse-submodules") == 0) {
+                recurse = 1;
+            } else if (strcmp(argv[i], "--by-dir") == 0 && strcmp(argv[1], "hotfiles") == 0) {
+                by_dir = 1;
+            } else if (strcmp(argv[i], "--depth") == 0 && i + 1 < argc) {
+                depth = atoi(argv[++i]);
+            } else if ((strcmp(argv[i], "--jobs") == 0 || strcmp(argv[i], "-j") == 0) && i + 1 < argc) {
+                walk_jobs = atoi(argv[++i]);
+            } else {
+                show_help_full();
+                return 1;
+            }
+        }
+        if (by_dir && recurse) {
+            printf("❌ hotfiles --by-dir does not support --recurse-submodules\n");
+            return 1;
+        }
+        if (walk_jobs < 0 || depth < 1) {
+            show_help_full();
+            return 1;
+        }
+        if (strcmp(argv[1], "stats") == 0) {
+            show_repository_stats(recurse);
+        } else if (by_dir) {
+            show_directory_churn(depth);
+        } else {
+            if (recurse) list_submodules();
+            load_file_analysis();
+            if (recurse) load_submodules();
+            show_hot_files();
+            if (recurse) show_submodule_status();
+        }
+    } else if (strcmp(argv[1], "security") == 0 && argc > 2) {
+        int history = 0, jobs = default_job_count();
+        for (int i = 2; i < argc; i++) {
+            if (strcmp(argv[i], "--history") == 0) {
+                history = 1;
+            } else if ((strcmp(argv[i], "--jobs") == 0 || strcmp(argv[i], "-j") == 0) && i + 1 < argc) {
+                jobs = atoi(argv[++i]);
+            } else {
+                show_help_full();
+                return 1;
+            }
+        }
+        if (history) run_history_secret_scan(jobs > 0 ? jobs : 1);
+        else run_security_audit();
+    } else if (strcmp(argv[1], "prompt") == 0) {
+        int budget = PROMPT_DEFAULT_BUDGET_MS;
+        for (int i = 2; i < argc; i++) {
+            if (strcmp(argv[i], "--budget") == 0 && i + 1 < argc) {
+                budget = atoi(argv[++i]);
+            } else {
+                show_help_full();
+                return 1;
+            }
+        }
+        show_prompt(budget > 0 ? budget : PROMPT_DEFAULT_BUDGET_MS);
+    } else if (strcmp(argv[1], "bench") == 0 && argc >= 3) {
+        return run_benchmark(argv[2], argc > 3 ? argv[3] : NULL, argc > 4 ? atoi(argv[4]) : 0);
     } else if (argc == 2) {
         if (strcmp(argv[1], "help") == 0) {
             show_help_full();
-        } else if (strcmp(argv[1], "branches") == 0) {
-            load_branch_info();
-            show_branch_analysis();
         } else if (strcmp(argv[1], "hotfiles") == 0) {
             load_file_analysis();
             show_hot_files();
+        } else if (strcmp(argv[1], "stats") == 0) {
+            show_repository_stats(0);
         } else if (strcmp(argv[1], "cleanup") == 0) {
             show_cleanup_suggestions();
         } else if (strcmp(argv[1], "analysis") == 0) {
-            show_analysis();
+            show_analysis(0, 0);
         } else if (strcmp(argv[1], "suggest") == 0) {
             generate_commit_suggestions();
         } else if (strcmp(argv[1], "review") == 0) {
@@ -1190,7 +11616,7 @@ int main(int argc, char *argv[])
         } else if (strcmp(argv[1], "performance") == 0) {
             detect_performance_regressions();
         } else if(strcmp(argv[1], "workflow") == 0) {
-            analyze_workflow_patterns();
+            analyze_workflow_patterns(0);
         } else if (strcmp(argv[1], "docs") == 0) {
             find_documentation_gaps();
         } else {
@@ -1198,8 +11624,17 @@ int main(int argc, char *argv[])
             show_help_full();
             return 1;
         }
-    } else if (argc == 3) {
-        if (strcmp(argv[1], "blame") == 0) {
+    } else if (argc == 3 || argc == 4) {
+        if (strcmp(argv[1], "performance") == 0 && strcmp(argv[2], "--growth") == 0) {
+            int top_k = argc == 4 ? atoi(argv[3]) : 10;
+            show_size_growth(top_k > 0 ? top_k : 10);
+        } else if (strcmp(argv[1], "performance") == 0 && strcmp(argv[2], "--largest") == 0) {
+            int top_k = argc == 4 ? atoi(argv[3]) : 20;
+            show_largest_objects(top_k > 0 ? top_k : 20);
+        } else if (argc == 4) {
+            show_help_full();
+            return 1;
+        } else if (strcmp(argv[1], "blame") == 0) {
             smart_blame(argv[2]);
         } else if (strcmp(argv[1], "impact") == 0) {
             analyze_change_impact(argv[2]);
@@ -1214,4 +11649,37 @@ int main(int argc, char *argv[])
     }
     
     return 0;
-}
\ No newline at end of file
+}
+
+int main(int argc, char *argv[]) 
+{
+    if (!is_git_repository()) {
+        printf("❌ Error: Not a git repository\n");
+        printf("Run this command in a git repository\n");
+        return 1;
+    }
+
+    remember_self_executable(argv[0]);
+    int use_cache = 1, kept = 1;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--no-cache") == 0) {
+            use_cache = 0;
+        } else if (strcmp(argv[i], "--mem-limit") == 0 && i + 1 < argc) {
+            aggregation_memory_limit = parse_memory_size(argv[++i]);
+            if (aggregation_memory_limit == 0) {
+                printf("❌ Invalid --mem-limit: %s (use e.g. 256M or 2G)\n", argv[i]);
+                return 1;
+            }
+        } else {
+            argv[kept++] = argv[i];
+        }
+    }
+    argc = kept;
+
+    char key[40];
+    if (use_cache && is_cacheable_command(argc, argv) && compute_result_key(argc, argv, key, sizeof(key)) == 0) {
+        if (result_cache_lookup(key) == 0) return 0;
+        return run_cached(key, run_command, argc, argv);
+    }
+    return run_command(argc, argv);
+}